@@ -137,6 +137,14 @@ EV_CPP(extern "C" {)
 # define EV_EMBED_ENABLE EV_FEATURE_WATCHERS
 #endif
 
+#ifndef EV_URING_ENABLE
+# ifdef _WIN32
+#  define EV_URING_ENABLE 0
+# else
+#  define EV_URING_ENABLE EV_FEATURE_WATCHERS
+# endif
+#endif
+
 #ifndef EV_WALK_ENABLE
 # define EV_WALK_ENABLE 0 /* not yet */
 #endif
@@ -236,6 +244,7 @@ enum {
   EV_FORK     =      0x00020000, /* event loop resumed in child */
   EV_CLEANUP  =      0x00040000, /* event loop resumed in child */
   EV_ASYNC    =      0x00080000, /* async intra-loop signal */
+  EV_URING    =      0x00100000, /* read/write/accept request completed */
   EV_CUSTOM   =      0x01000000, /* for use by user code */
   EV_ERROR    = (int)0x80000000  /* sent when an error occurs */
 };
@@ -464,6 +473,32 @@ typedef struct ev_async
 # define ev_async_pending(w) (+(w)->sent)
 #endif
 
+#if EV_URING_ENABLE
+enum {
+  EV_URING_READ,   /* read (fd, buf, len) */
+  EV_URING_WRITE,  /* write (fd, buf, len) */
+  EV_URING_ACCEPT  /* accept (fd, buf, &len), buf/len describe the peer address and may be 0 */
+};
+
+/* a single read, write or accept request, the watcher stops itself on completion */
+/* the io_uring backend submits it to the kernel, other backends wait for readiness and do the syscall */
+/* buf must stay valid until the callback runs or ev_uring_stop returns, */
+/* requests in flight at ev_loop_fork time never complete in the child */
+/* revent EV_URING */
+typedef struct ev_uring
+{
+  EV_WATCHER (ev_uring)
+
+  int fd;           /* ro */
+  int op;           /* ro */
+  void *buf;        /* ro */
+  unsigned int len; /* rw, the peer address length after an accept */
+  int res;          /* ro, the syscall result, or -errno */
+
+  ev_io io;         /* private */
+} ev_uring;
+#endif
+
 /* the presence of this union forces similar struct layout */
 union ev_any_watcher
 {
@@ -495,6 +530,9 @@ union ev_any_watcher
 #if EV_ASYNC_ENABLE
   struct ev_async async;
 #endif
+#if EV_URING_ENABLE
+  struct ev_uring uring;
+#endif
 };
 
 /* flag bits for ev_default_loop and ev_loop_new */
@@ -510,7 +548,8 @@ enum {
   EVFLAG_NOSIGFD   = 0, /* compatibility to pre-3.9 */
 #endif
   EVFLAG_SIGNALFD  = 0x00200000U, /* attempt to use signalfd */
-  EVFLAG_NOSIGMASK = 0x00400000U  /* avoid modifying the signal mask */
+  EVFLAG_NOSIGMASK = 0x00400000U, /* avoid modifying the signal mask */
+  EVFLAG_TIMERFD   = 0x00800000U  /* wake up for timers through a timerfd, for sub-millisecond precision with epoll */
 };
 
 /* method bits to be ored together */
@@ -521,7 +560,8 @@ enum {
   EVBACKEND_KQUEUE  = 0x00000008U, /* bsd */
   EVBACKEND_DEVPOLL = 0x00000010U, /* solaris 8 */ /* NYI */
   EVBACKEND_PORT    = 0x00000020U, /* solaris 10 */
-  EVBACKEND_ALL     = 0x0000003FU, /* all known backends */
+  EVBACKEND_IOURING = 0x00000080U, /* linux >= 5.6 */
+  EVBACKEND_ALL     = 0x000000BFU, /* all known backends */
   EVBACKEND_MASK    = 0x0000FFFFU  /* all future backends */
 };
 
@@ -703,6 +743,10 @@ EV_API_DECL void ev_resume  (EV_P) EV_THROW;
 #define ev_fork_set(ev)                      /* nop, yes, this is a serious in-joke */
 #define ev_cleanup_set(ev)                   /* nop, yes, this is a serious in-joke */
 #define ev_async_set(ev)                     /* nop, yes, this is a serious in-joke */
+#define ev_uring_set(ev,op_,fd_,buf_,len_)   do { (ev)->op = (op_); (ev)->fd = (fd_); (ev)->buf = (buf_); (ev)->len = (len_); } while (0)
+#define ev_uring_read_set(ev,fd,buf,len)     ev_uring_set ((ev), EV_URING_READ, (fd), (buf), (len))
+#define ev_uring_write_set(ev,fd,buf,len)    ev_uring_set ((ev), EV_URING_WRITE, (fd), (void *)(buf), (len))
+#define ev_uring_accept_set(ev,fd,addr,len)  ev_uring_set ((ev), EV_URING_ACCEPT, (fd), (addr), (len))
 
 #define ev_io_init(ev,cb,fd,events)          do { ev_init ((ev), (cb)); ev_io_set ((ev),(fd),(events)); } while (0)
 #define ev_timer_init(ev,cb,after,repeat)    do { ev_init ((ev), (cb)); ev_timer_set ((ev),(after),(repeat)); } while (0)
@@ -717,6 +761,7 @@ EV_API_DECL void ev_resume  (EV_P) EV_THROW;
 #define ev_fork_init(ev,cb)                  do { ev_init ((ev), (cb)); ev_fork_set ((ev)); } while (0)
 #define ev_cleanup_init(ev,cb)               do { ev_init ((ev), (cb)); ev_cleanup_set ((ev)); } while (0)
 #define ev_async_init(ev,cb)                 do { ev_init ((ev), (cb)); ev_async_set ((ev)); } while (0)
+#define ev_uring_init(ev,cb,op,fd,buf,len)   do { ev_init ((ev), (cb)); ev_uring_set ((ev),(op),(fd),(buf),(len)); } while (0)
 
 #define ev_is_pending(ev)                    (0 + ((ev_watcher *)(void *)(ev))->pending) /* ro, true when watcher is waiting for callback invocation */
 #define ev_is_active(ev)                     (0 + ((ev_watcher *)(void *)(ev))->active) /* ro, true when the watcher has been started */
@@ -825,6 +870,12 @@ EV_API_DECL void ev_async_stop     (EV_P_ ev_async *w) EV_THROW;
 EV_API_DECL void ev_async_send     (EV_P_ ev_async *w) EV_THROW;
 # endif
 
+# if EV_URING_ENABLE
+EV_API_DECL void ev_uring_start    (EV_P_ ev_uring *w) EV_THROW;
+/* cancels the request, and only returns once the kernel is done with the buffer */
+EV_API_DECL void ev_uring_stop     (EV_P_ ev_uring *w) EV_THROW;
+# endif
+
 #if EV_COMPAT3
   #define EVLOOP_NONBLOCK EVRUN_NOWAIT
   #define EVLOOP_ONESHOT  EVRUN_ONCE
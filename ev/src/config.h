@@ -3,9 +3,6 @@
 /* config.h.  Generated from config.h.in by configure.  */
 /* config.h.in.  Generated from configure.ac by autoheader.  */
 
-/* Define to 1 if you have the `clock_gettime' function. */
-/* #undef HAVE_CLOCK_GETTIME */
-
 /* Define to 1 if you have the <dlfcn.h> header file. */
 #define HAVE_DLFCN_H 1
 
@@ -45,8 +42,11 @@
 /* #undef HAVE_PORT_H */
 
 #ifdef Linux
+/* Define to 1 if you have the `clock_gettime' function. */
+#define HAVE_CLOCK_GETTIME 1
+
 /* Define to 1 if you have the `eventfd' function. */
-#define HAVE_EVENTFD 0
+#define HAVE_EVENTFD 1
 
 /* Define to 1 if you have the `signalfd' function. */
 #define HAVE_SIGNALFD 0
@@ -54,6 +54,15 @@
 /* Define to 1 if you have the <sys/epoll.h> header file. */
 #define HAVE_SYS_EPOLL_H 1
 
+/* Define to 1 if you have the `timerfd_create' function. */
+#define HAVE_TIMERFD 1
+
+/* Define to 1 if you have the <sys/timerfd.h> header file. */
+#define HAVE_SYS_TIMERFD_H 1
+
+/* Define to 1 to build the io_uring backend, it checks the kernel at runtime. */
+#define HAVE_IO_URING 1
+
 /* Define to 1 to use the syscall interface for clock_gettime */
 #define HAVE_CLOCK_SYSCALL 0
 
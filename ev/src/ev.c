@@ -117,6 +117,15 @@
 #  define EV_USE_EPOLL 0
 # endif
    
+# if HAVE_IO_URING
+#  ifndef EV_USE_IOURING
+#   define EV_USE_IOURING EV_FEATURE_BACKENDS
+#  endif
+# else
+#  undef EV_USE_IOURING
+#  define EV_USE_IOURING 0
+# endif
+   
 # if HAVE_KQUEUE && HAVE_SYS_EVENT_H
 #  ifndef EV_USE_KQUEUE
 #   define EV_USE_KQUEUE EV_FEATURE_BACKENDS
@@ -161,6 +170,15 @@
 #  undef EV_USE_EVENTFD
 #  define EV_USE_EVENTFD 0
 # endif
+
+# if HAVE_TIMERFD && HAVE_SYS_TIMERFD_H
+#  ifndef EV_USE_TIMERFD
+#   define EV_USE_TIMERFD EV_FEATURE_OS
+#  endif
+# else
+#  undef EV_USE_TIMERFD
+#  define EV_USE_TIMERFD 0
+# endif
  
 #endif
 
@@ -307,6 +325,10 @@
 # endif
 #endif
 
+#ifndef EV_USE_IOURING
+# define EV_USE_IOURING 0
+#endif
+
 #ifndef EV_USE_KQUEUE
 # define EV_USE_KQUEUE 0
 #endif
@@ -347,6 +369,20 @@
 # endif
 #endif
 
+#ifndef EV_USE_TIMERFD
+# if __linux && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 8))
+#  define EV_USE_TIMERFD EV_FEATURE_OS
+# else
+#  define EV_USE_TIMERFD 0
+# endif
+#endif
+
+/* read the monotonic clock from CLOCK_MONOTONIC_COARSE: much cheaper where the */
+/* precise clock needs a syscall, but timers are then only accurate to a tick */
+#ifndef EV_USE_MONOTONIC_COARSE
+# define EV_USE_MONOTONIC_COARSE 0
+#endif
+
 #if 0 /* debugging */
 # define EV_VERIFY 3
 # define EV_USE_4HEAP 1
@@ -402,6 +438,17 @@
 # define EV_USE_MONOTONIC 0
 #endif
 
+#if !EV_USE_MONOTONIC || !defined CLOCK_MONOTONIC_COARSE
+# undef EV_USE_MONOTONIC_COARSE
+# define EV_USE_MONOTONIC_COARSE 0
+#endif
+
+#if EV_USE_MONOTONIC_COARSE
+# define EV_CLOCK_MONOTONIC CLOCK_MONOTONIC_COARSE
+#else
+# define EV_CLOCK_MONOTONIC CLOCK_MONOTONIC
+#endif
+
 #ifndef CLOCK_REALTIME
 # undef EV_USE_REALTIME
 # define EV_USE_REALTIME 0
@@ -445,6 +492,10 @@
 EV_CPP(extern "C") int (eventfd) (unsigned int initval, int flags);
 #endif
 
+#if EV_USE_TIMERFD
+# include <sys/timerfd.h>
+#endif
+
 #if EV_USE_SIGNALFD
 /* our minimum requirement is glibc 2.7 which has the stub, but not the header */
 # include <stdint.h>
@@ -1427,6 +1478,10 @@ static EV_ATOMIC_T have_realtime; /* did clock_gettime (CLOCK_REALTIME) work? */
 static EV_ATOMIC_T have_monotonic; /* did clock_gettime (CLOCK_MONOTONIC) work? */
 #endif
 
+#if EV_USE_MONOTONIC_COARSE
+static ev_tstamp monotonic_res; /* how far the coarse clock can lag behind */
+#endif
+
 #ifndef EV_FD_TO_WIN32_HANDLE
 # define EV_FD_TO_WIN32_HANDLE(fd) _get_osfhandle (fd)
 #endif
@@ -1630,8 +1685,8 @@ typedef struct
   unsigned char reify;  /* flag set when this ANFD needs reification (EV_ANFD_REIFY, EV__IOFDSET) */
   unsigned char emask;  /* the epoll backend stores the actual kernel mask in here */
   unsigned char unused;
-#if EV_USE_EPOLL
-  unsigned int egen;    /* generation counter to counter epoll bugs */
+#if EV_USE_EPOLL || EV_USE_IOURING
+  unsigned int egen;    /* generation counter to counter epoll bugs and stale io_uring polls */
 #endif
 #if EV_SELECT_IS_WINSOCKET || EV_USE_IOCP
   SOCKET handle;
@@ -1742,7 +1797,7 @@ get_clock (void)
   if (expect_true (have_monotonic))
     {
       struct timespec ts;
-      clock_gettime (CLOCK_MONOTONIC, &ts);
+      clock_gettime (EV_CLOCK_MONOTONIC, &ts);
       return ts.tv_sec + ts.tv_nsec * 1e-9;
     }
 #endif
@@ -2482,6 +2537,55 @@ sigfdcb (EV_P_ ev_io *iow, int revents)
 
 /*****************************************************************************/
 
+#if EV_USE_TIMERFD
+
+/* the timer expired, the due ev_timers are handled by timers_reify as usual */
+static void
+timerfdcb (EV_P_ ev_io *iow, int revents)
+{
+  uint64_t expirations;
+
+  read (timerfd, &expirations, sizeof (expirations));
+  timerfd_at = 0.;
+}
+
+static void noinline ecb_cold
+timerfd_init (EV_P)
+{
+  timerfd    = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  timerfd_at = 0.;
+
+  if (timerfd >= 0)
+    {
+      ev_io_init (&timerfd_w, timerfdcb, timerfd, EV_READ);
+      ev_set_priority (&timerfd_w, EV_MAXPRI);
+      ev_io_start (EV_A_ &timerfd_w);
+      ev_unref (EV_A); /* watcher should not keep loop alive */
+    }
+}
+
+/* make the timerfd fire after waittime, unless it is armed for that already */
+inline_speed void
+timerfd_arm (EV_P_ ev_tstamp waittime)
+{
+  ev_tstamp at = mn_now + waittime;
+
+  if (at != timerfd_at)
+    {
+      struct itimerspec its;
+
+      memset (&its, 0, sizeof (its));
+      EV_TS_SET (its.it_value, waittime);
+      timerfd_settime (timerfd, 0, &its, 0);
+
+      timerfd_at = at;
+    }
+}
+
+#endif
+
+/*****************************************************************************/
+
 #if EV_CHILD_ENABLE
 static WL childs [EV_PID_HASHSIZE];
 
@@ -2550,6 +2654,9 @@ childcb (EV_P_ ev_signal *sw, int revents)
 #if EV_USE_KQUEUE
 # include "ev_kqueue.inl"
 #endif
+#if EV_USE_IOURING
+# include "ev_iouring.inl"
+#endif
 #if EV_USE_EPOLL
 # include "ev_epoll.inl"
 #endif
@@ -2592,6 +2699,7 @@ ev_supported_backends (void) EV_THROW
   if (EV_USE_PORT  ) flags |= EVBACKEND_PORT;
   if (EV_USE_KQUEUE) flags |= EVBACKEND_KQUEUE;
   if (EV_USE_EPOLL ) flags |= EVBACKEND_EPOLL;
+  if (EV_USE_IOURING) flags |= EVBACKEND_IOURING;
   if (EV_USE_POLL  ) flags |= EVBACKEND_POLL;
   if (EV_USE_SELECT) flags |= EVBACKEND_SELECT;
   
@@ -2616,6 +2724,8 @@ ev_recommended_backends (void) EV_THROW
 #ifdef __FreeBSD__
   flags &= ~EVBACKEND_POLL;   /* poll return value is unusable (http://forums.freebsd.org/archive/index.php/t-10270.html) */
 #endif
+  /* io_uring is opt-in for now, it needs a recent kernel and is not embeddable */
+  flags &= ~EVBACKEND_IOURING;
 
   return flags;
 }
@@ -2712,8 +2822,14 @@ loop_init (EV_P_ unsigned int flags) EV_THROW
         {
           struct timespec ts;
 
-          if (!clock_gettime (CLOCK_MONOTONIC, &ts))
-            have_monotonic = 1;
+          if (!clock_gettime (EV_CLOCK_MONOTONIC, &ts))
+            {
+#if EV_USE_MONOTONIC_COARSE
+              clock_getres (EV_CLOCK_MONOTONIC, &ts);
+              monotonic_res = ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+              have_monotonic = 1;
+            }
         }
 #endif
 
@@ -2767,6 +2883,16 @@ loop_init (EV_P_ unsigned int flags) EV_THROW
 #if EV_USE_KQUEUE
       if (!backend && (flags & EVBACKEND_KQUEUE)) backend = kqueue_init (EV_A_ flags);
 #endif
+#if EV_USE_IOURING
+      if (!backend && (flags & EVBACKEND_IOURING))
+        {
+          backend = iouring_init (EV_A_ flags);
+
+          /* the kernel is too old, fall back to what we would have picked otherwise */
+          if (!backend)
+            flags |= ev_recommended_backends ();
+        }
+#endif
 #if EV_USE_EPOLL
       if (!backend && (flags & EVBACKEND_EPOLL )) backend = epoll_init  (EV_A_ flags);
 #endif
@@ -2777,6 +2903,19 @@ loop_init (EV_P_ unsigned int flags) EV_THROW
       if (!backend && (flags & EVBACKEND_SELECT)) backend = select_init (EV_A_ flags);
 #endif
 
+#if EV_USE_TIMERFD
+      timerfd = -1;
+
+      /* only worth a syscall per timeout if the backend rounds to milliseconds */
+      if ((flags & EVFLAG_TIMERFD) && backend_mintime >= 1e-3)
+        {
+          timerfd_init (EV_A);
+
+          if (timerfd >= 0)
+            backend_mintime = 1e-6;
+        }
+#endif
+
       ev_prepare_init (&pending_w, pendingcb);
 
 #if EV_SIGNAL_ENABLE || EV_ASYNC_ENABLE
@@ -2829,6 +2968,11 @@ ev_loop_destroy (EV_P)
     close (sigfd);
 #endif
 
+#if EV_USE_TIMERFD
+  if (ev_is_active (&timerfd_w))
+    close (timerfd);
+#endif
+
 #if EV_USE_INOTIFY
   if (fs_fd >= 0)
     close (fs_fd);
@@ -2846,6 +2990,9 @@ ev_loop_destroy (EV_P)
 #if EV_USE_KQUEUE
   if (backend == EVBACKEND_KQUEUE) kqueue_destroy (EV_A);
 #endif
+#if EV_USE_IOURING
+  if (backend == EVBACKEND_IOURING) iouring_destroy (EV_A);
+#endif
 #if EV_USE_EPOLL
   if (backend == EVBACKEND_EPOLL ) epoll_destroy  (EV_A);
 #endif
@@ -2910,6 +3057,9 @@ loop_fork (EV_P)
 #if EV_USE_KQUEUE
   if (backend == EVBACKEND_KQUEUE) kqueue_fork (EV_A);
 #endif
+#if EV_USE_IOURING
+  if (backend == EVBACKEND_IOURING) iouring_fork (EV_A);
+#endif
 #if EV_USE_EPOLL
   if (backend == EVBACKEND_EPOLL ) epoll_fork  (EV_A);
 #endif
@@ -2934,6 +3084,18 @@ loop_fork (EV_P)
     }
 #endif
 
+#if EV_USE_TIMERFD
+  /* the timerfd is shared with the parent, get our own */
+  if (ev_is_active (&timerfd_w))
+    {
+      ev_ref (EV_A);
+      ev_io_stop (EV_A_ &timerfd_w);
+
+      close (timerfd);
+      timerfd_init (EV_A);
+    }
+#endif
+
   postfork = 0;
 }
 
@@ -3478,6 +3640,10 @@ ev_run (EV_P_ int flags)
             if (timercnt)
               {
                 ev_tstamp to = ANHE_at (timers [HEAP0]) - mn_now;
+#if EV_USE_MONOTONIC_COARSE
+                /* the coarse clock lags, do not wake up before it caught up */
+                to += monotonic_res;
+#endif
                 if (waittime > to) waittime = to;
               }
 
@@ -3518,7 +3684,16 @@ ev_run (EV_P_ int flags)
         ++loop_count;
 #endif
         assert ((loop_done = EVBREAK_RECURSE, 1)); /* assert for side effect */
-        backend_poll (EV_A_ waittime);
+#if EV_USE_TIMERFD
+        /* the timerfd wakes the backend up precisely, instead of its own timeout */
+        if (timerfd >= 0 && waittime > 0. && waittime < MAX_BLOCKTIME)
+          {
+            timerfd_arm (EV_A_ waittime);
+            backend_poll (EV_A_ MAX_BLOCKTIME);
+          }
+        else
+#endif
+          backend_poll (EV_A_ waittime);
         assert ((loop_done = EVBREAK_CANCEL, 1)); /* assert for side effect */
 
         pipe_write_wanted = 0; /* just an optimisation, no fence needed */
@@ -4774,6 +4949,115 @@ ev_async_send (EV_P_ ev_async *w) EV_THROW
 }
 #endif
 
+#if EV_URING_ENABLE
+
+#include <sys/socket.h>
+
+/* the request is done: stop the watcher, then report the result */
+static void noinline
+uring_done (EV_P_ ev_uring *w, int res)
+{
+  w->res = res;
+
+  if (ev_is_active (&w->io))
+    {
+      ev_ref (EV_A);
+      ev_io_stop (EV_A_ &w->io);
+    }
+
+  ev_stop (EV_A_ (W)w);
+  ev_feed_event (EV_A_ w, EV_URING);
+}
+
+/* backends other than io_uring wait for readiness and do the syscall themselves */
+static void
+uring_io_cb (EV_P_ ev_io *w_, int revents)
+{
+  ev_uring *w = (ev_uring *)(((char *)w_) - offsetof (ev_uring, io));
+  int res;
+
+  /* fd_kill stops the io watcher behind our back, keep the refcount balanced */
+  if (expect_false (!ev_is_active (w_)))
+    ev_ref (EV_A);
+
+  switch (w->op)
+    {
+      case EV_URING_READ:
+        res = read (w->fd, w->buf, w->len);
+        break;
+
+      case EV_URING_WRITE:
+        res = write (w->fd, w->buf, w->len);
+        break;
+
+      default:
+        {
+          socklen_t len = w->len;
+
+          res = accept (w->fd, (struct sockaddr *)w->buf, w->buf ? &len : 0);
+          w->len = len;
+        }
+        break;
+    }
+
+  if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) && ev_is_active (w_))
+    return;
+
+  uring_done (EV_A_ w, res < 0 ? -errno : res);
+}
+
+void
+ev_uring_start (EV_P_ ev_uring *w) EV_THROW
+{
+  if (expect_false (ev_is_active (w)))
+    return;
+
+  assert (("libev: ev_uring_start called with unknown op", w->op >= EV_URING_READ && w->op <= EV_URING_ACCEPT));
+
+  w->res = 0;
+
+  EV_FREQUENT_CHECK;
+
+#if EV_USE_IOURING
+  if (backend == EVBACKEND_IOURING)
+    iouring_req_start (EV_A_ w);
+  else
+#endif
+    {
+      ev_io_init (&w->io, uring_io_cb, w->fd, w->op == EV_URING_WRITE ? EV_WRITE : EV_READ);
+      ev_set_priority (&w->io, ev_priority (w));
+      ev_io_start (EV_A_ &w->io);
+      ev_unref (EV_A);
+    }
+
+  ev_start (EV_A_ (W)w, 1);
+
+  EV_FREQUENT_CHECK;
+}
+
+void
+ev_uring_stop (EV_P_ ev_uring *w) EV_THROW
+{
+  clear_pending (EV_A_ (W)w);
+  if (expect_false (!ev_is_active (w)))
+    return;
+
+  EV_FREQUENT_CHECK;
+
+#if EV_USE_IOURING
+  if (backend == EVBACKEND_IOURING)
+    iouring_req_cancel (EV_A_ w);
+  else
+#endif
+    uring_done (EV_A_ w, -ECANCELED);
+
+  /* either way the result was fed as an event, but stopped watchers get no callback */
+  clear_pending (EV_A_ (W)w);
+
+  EV_FREQUENT_CHECK;
+}
+#endif
+
 /*****************************************************************************/
 
 struct ev_once
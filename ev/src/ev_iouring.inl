@@ -0,0 +1,563 @@
+/*
+ * libev linux io_uring fd activity backend
+ *
+ * Copyright (c) 2007,2008,2009,2010,2011 Marc Alexander Lehmann <libev@schmorp.de>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modifica-
+ * tion, are permitted provided that the following conditions are met:
+ *
+ *   1.  Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *   2.  Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MER-
+ * CHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPE-
+ * CIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTH-
+ * ERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * the GNU General Public License ("GPL") version 2 or any later version,
+ * in which case the provisions of the GPL are applicable instead of
+ * the above. If you wish to allow the use of your version of this file
+ * only under the terms of the GPL and not to allow others to use your
+ * version of this file under the BSD license, indicate your decision
+ * by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL. If you do not delete the
+ * provisions above, a recipient may use your version of this file under
+ * either the BSD or the GPL.
+ */
+
+/*
+ * general notes about io_uring:
+ *
+ * a) io_uring polls are one-shot, every poll is its own request. we
+ *    re-arm an fd after each event by letting fd_reify queue a fresh
+ *    poll, which costs no extra syscall, as all queued sqes are
+ *    submitted by the same io_uring_enter that waits for completions.
+ * b) a poll holds a reference to the file, so closing the fd does not
+ *    cancel it. libev reifies (re-)started fds with EV__IOFDSET, which
+ *    makes us remove the old poll and add a new one.
+ * c) completions of removed polls can still be in the completion queue,
+ *    so, like the epoll backend, we keep a generation counter in the
+ *    user_data and drop stale completions.
+ * d) besides polls, the ring carries ev_uring requests (read, write,
+ *    accept), which complete without a separate read/write syscall.
+ * e) the wait timeout is passed to io_uring_enter on kernels with
+ *    IORING_FEAT_EXT_ARG (5.11+), and queued as a timeout sqe in the
+ *    same batch on older ones.
+ * f) we require IORING_FEAT_NODROP and IORING_FEAT_RW_CUR_POS (5.6+),
+ *    loop_init falls back to the other backends on older kernels.
+ */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+
+#ifndef __NR_io_uring_setup
+# define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+# define __NR_io_uring_enter 426
+#endif
+
+/* the kernel abi, spelled out so we do not depend on recent kernel headers */
+
+struct io_uring_sqe
+{
+  uint8_t  opcode;
+  uint8_t  flags;
+  uint16_t ioprio;
+  int32_t  fd;
+  uint64_t off;         /* addr2 for accept */
+  uint64_t addr;
+  uint32_t len;
+  union
+  {
+    uint32_t op_flags;
+    uint16_t poll_events;
+  } u;
+  uint64_t user_data;
+  uint64_t pad [3];
+};
+
+struct io_uring_cqe
+{
+  uint64_t user_data;
+  int32_t  res;
+  uint32_t flags;
+};
+
+struct io_sqring_offsets
+{
+  uint32_t head, tail, ring_mask, ring_entries, flags, dropped, array, resv1;
+  uint64_t resv2;
+};
+
+struct io_cqring_offsets
+{
+  uint32_t head, tail, ring_mask, ring_entries, overflow, cqes, flags, resv1;
+  uint64_t resv2;
+};
+
+struct io_uring_params
+{
+  uint32_t sq_entries, cq_entries, flags, sq_thread_cpu, sq_thread_idle, features, wq_fd, resv [3];
+  struct io_sqring_offsets sq_off;
+  struct io_cqring_offsets cq_off;
+};
+
+struct ev_iouring_timespec
+{
+  int64_t tv_sec;
+  long long tv_nsec;
+};
+
+struct ev_iouring_getevents_arg
+{
+  uint64_t sigmask;
+  uint32_t sigmask_sz;
+  uint32_t pad;
+  uint64_t ts;
+};
+
+#define IORING_OFF_SQ_RING        0x00000000ULL
+#define IORING_OFF_CQ_RING        0x08000000ULL
+#define IORING_OFF_SQES           0x10000000ULL
+
+#define IORING_FEAT_NODROP        0x00000002
+#define IORING_FEAT_SUBMIT_STABLE 0x00000004
+#define IORING_FEAT_RW_CUR_POS    0x00000008
+#define IORING_FEAT_EXT_ARG       0x00000100
+
+#define IORING_ENTER_GETEVENTS    0x00000001
+#define IORING_ENTER_EXT_ARG      0x00000008
+
+#define IORING_OP_POLL_ADD         6
+#define IORING_OP_POLL_REMOVE      7
+#define IORING_OP_TIMEOUT         11
+#define IORING_OP_ACCEPT          13
+#define IORING_OP_ASYNC_CANCEL    14
+#define IORING_OP_READ            22
+#define IORING_OP_WRITE           23
+
+/* user_data of sqes whose completion we do not care about */
+#define EV_IOURING_IGNORE (~(uint64_t)0)
+/* user_data bit marking ev_uring requests, the rest is the watcher address */
+#define EV_IOURING_REQ    ((uint64_t)1 << 63)
+
+#if EV_URING_ENABLE
+/* completed ev_uring requests are handed to this one, see ev.c */
+static void noinline uring_done (EV_P_ ev_uring *w, int res);
+#endif
+
+inline_size unsigned int
+iouring_load_acquire (const unsigned int *p)
+{
+  unsigned int v = *(volatile const unsigned int *)p;
+  ECB_MEMORY_FENCE_ACQUIRE;
+  return v;
+}
+
+inline_size void
+iouring_store_release (unsigned int *p, unsigned int v)
+{
+  ECB_MEMORY_FENCE_RELEASE;
+  *(volatile unsigned int *)p = v;
+}
+
+/* submits all queued sqes, and optionally waits for completions */
+static int
+iouring_enter (EV_P_ unsigned int min_complete, unsigned int flags, const void *arg, size_t argsz)
+{
+  int res = syscall (__NR_io_uring_enter, backend_fd, iouring_to_submit, min_complete, flags, arg, argsz);
+
+  /* without sqpoll the kernel consumes sqes synchronously, whatever is left was not submitted */
+  iouring_to_submit = *iouring_sq_tail - iouring_load_acquire (iouring_sq_head);
+
+  return res;
+}
+
+/* the user_data of the poll for the fd, carrying the generation counter */
+inline_size uint64_t
+iouring_poll_ud (EV_P_ int fd)
+{
+  return (uint64_t)(uint32_t)fd
+       | ((uint64_t)(anfds [fd].egen & 0x7fffffffU) << 32);
+}
+
+static void
+iouring_process_cqe (EV_P_ uint64_t ud, int res)
+{
+  int fd;
+
+  if (ud == EV_IOURING_IGNORE)
+    return;
+
+#if EV_URING_ENABLE
+  if (ud & EV_IOURING_REQ)
+    {
+      uring_done (EV_A_ (ev_uring *)(uintptr_t)(ud & ~EV_IOURING_REQ), res);
+      return;
+    }
+#endif
+
+  fd = (uint32_t)ud;
+
+  /*
+   * check for stale completions, from polls we removed in the meantime.
+   * we assume that fd is always in range, as we never shrink the anfds array
+   */
+  if (expect_false ((uint32_t)(ud >> 32) != (anfds [fd].egen & 0x7fffffffU)))
+    return;
+
+  /* the poll is done either way, so the kernel no longer watches anything */
+  anfds [fd].events = 0;
+
+  if (expect_false (res < 0))
+    {
+      if (res == -EBADF)
+        {
+          fd_kill (EV_A_ fd);
+          return;
+        }
+
+      /* cancelled by the kernel, or some other transient failure, just re-arm */
+    }
+  else
+    fd_event (EV_A_ fd,
+              (res & (POLLOUT | POLLERR | POLLHUP) ? EV_WRITE : 0)
+            | (res & (POLLIN  | POLLERR | POLLHUP) ? EV_READ  : 0));
+
+  /* polls are one-shot, let fd_reify queue a new one for the next submit */
+  fd_change (EV_A_ fd, EV_ANFD_REIFY);
+}
+
+static void
+iouring_handle_cq (EV_P)
+{
+  unsigned int head = *iouring_cq_head;
+  unsigned int tail = iouring_load_acquire (iouring_cq_tail);
+
+  while (head != tail)
+    {
+      /* cqes are processed in batches, handlers only queue events and never re-enter */
+      do
+        {
+          struct io_uring_cqe *cqe = iouring_cqes + (head & iouring_cq_mask);
+
+          iouring_process_cqe (EV_A_ cqe->user_data, cqe->res);
+        }
+      while (++head != tail);
+
+      iouring_store_release (iouring_cq_head, head);
+      tail = iouring_load_acquire (iouring_cq_tail);
+    }
+}
+
+static struct io_uring_sqe *
+iouring_sqe_get (EV_P)
+{
+  unsigned int tail = *iouring_sq_tail;
+  struct io_uring_sqe *sqe;
+
+  /* if the sq is full, submit it early to make room */
+  while (expect_false (tail - iouring_load_acquire (iouring_sq_head) >= iouring_entries))
+    if (iouring_enter (EV_A_ 0, 0, 0, 0) < 0)
+      {
+        if (errno == EBUSY || errno == EAGAIN)
+          iouring_handle_cq (EV_A); /* the kernel wants us to reap completions first */
+        else if (errno != EINTR)
+          ev_syserr ("(libev) io_uring_enter");
+      }
+
+  sqe = iouring_sqes + (tail & iouring_sq_mask);
+  memset (sqe, 0, sizeof (*sqe));
+
+  return sqe;
+}
+
+/* queue the sqe, it is submitted by the next io_uring_enter */
+inline_size void
+iouring_sqe_submit (EV_P)
+{
+  iouring_store_release (iouring_sq_tail, *iouring_sq_tail + 1);
+  ++iouring_to_submit;
+}
+
+static void
+iouring_modify (EV_P_ int fd, int oev, int nev)
+{
+  struct io_uring_sqe *sqe;
+
+  if (oev)
+    {
+      /* remove the armed poll, any completion it still produces is stale from now on */
+      sqe = iouring_sqe_get (EV_A);
+      sqe->opcode    = IORING_OP_POLL_REMOVE;
+      sqe->fd        = -1;
+      sqe->addr      = iouring_poll_ud (EV_A_ fd);
+      sqe->user_data = EV_IOURING_IGNORE;
+      iouring_sqe_submit (EV_A);
+
+      ++anfds [fd].egen;
+    }
+
+  if (nev)
+    {
+      sqe = iouring_sqe_get (EV_A);
+      sqe->opcode        = IORING_OP_POLL_ADD;
+      sqe->fd            = fd;
+      sqe->u.poll_events = (nev & EV_READ  ? POLLIN  : 0)
+                         | (nev & EV_WRITE ? POLLOUT : 0);
+      sqe->user_data     = iouring_poll_ud (EV_A_ fd);
+      iouring_sqe_submit (EV_A);
+    }
+}
+
+static void
+iouring_poll (EV_P_ ev_tstamp timeout)
+{
+  struct ev_iouring_timespec ts;
+  struct ev_iouring_getevents_arg arg;
+  unsigned int min_complete = 0;
+  unsigned int flags = IORING_ENTER_GETEVENTS;
+  int res;
+
+  /* completions may be waiting already, e.g. reaped while making room in the sq */
+  if (*iouring_cq_head != iouring_load_acquire (iouring_cq_tail))
+    timeout = 0.;
+
+  if (timeout)
+    {
+      EV_TS_SET (ts, timeout);
+      min_complete = 1;
+
+      if (iouring_features & IORING_FEAT_EXT_ARG)
+        {
+          memset (&arg, 0, sizeof (arg));
+          arg.ts = (uint64_t)(uintptr_t)&ts;
+          flags |= IORING_ENTER_EXT_ARG;
+        }
+      else
+        {
+          /* the timeout completes on the first other completion as well, so it never lingers */
+          struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
+          sqe->opcode    = IORING_OP_TIMEOUT;
+          sqe->fd        = -1;
+          sqe->addr      = (uint64_t)(uintptr_t)&ts;
+          sqe->len       = 1;
+          sqe->off       = 1;
+          sqe->user_data = EV_IOURING_IGNORE;
+          iouring_sqe_submit (EV_A);
+        }
+    }
+
+  /* one syscall submits all queued polls and requests, and waits */
+  EV_RELEASE_CB;
+  res = iouring_enter (EV_A_ min_complete, flags,
+                       flags & IORING_ENTER_EXT_ARG ? &arg : 0,
+                       flags & IORING_ENTER_EXT_ARG ? sizeof (arg) : 0);
+  EV_ACQUIRE_CB;
+
+  if (expect_false (res < 0)
+      && errno != EINTR && errno != ETIME && errno != EBUSY && errno != EAGAIN)
+    ev_syserr ("(libev) io_uring_enter");
+
+  iouring_handle_cq (EV_A);
+}
+
+#if EV_URING_ENABLE
+/* submit an ev_uring request, its completion carries the watcher address */
+inline_size void
+iouring_req_start (EV_P_ ev_uring *w)
+{
+  struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
+
+  sqe->fd        = w->fd;
+  sqe->addr      = (uint64_t)(uintptr_t)w->buf;
+  sqe->user_data = (uint64_t)(uintptr_t)w | EV_IOURING_REQ;
+
+  switch (w->op)
+    {
+      case EV_URING_READ:
+        sqe->opcode = IORING_OP_READ;
+        sqe->len    = w->len;
+        sqe->off    = (uint64_t)-1; /* current file position, like read */
+        break;
+
+      case EV_URING_WRITE:
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->len    = w->len;
+        sqe->off    = (uint64_t)-1;
+        break;
+
+      case EV_URING_ACCEPT:
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->off    = w->buf ? (uint64_t)(uintptr_t)&w->len : 0;
+        break;
+    }
+
+  iouring_sqe_submit (EV_A);
+}
+
+/* cancel a request and wait until the kernel is done with its buffer */
+inline_size void
+iouring_req_cancel (EV_P_ ev_uring *w)
+{
+  struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
+
+  sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+  sqe->fd        = -1;
+  sqe->addr      = (uint64_t)(uintptr_t)w | EV_IOURING_REQ;
+  sqe->user_data = EV_IOURING_IGNORE;
+  iouring_sqe_submit (EV_A);
+
+  /* the request reports back either way, cancelled or not, and uring_done stops the watcher */
+  for (;;)
+    {
+      iouring_handle_cq (EV_A);
+
+      if (!ev_is_active (w))
+        break;
+
+      if (iouring_enter (EV_A_ 1, IORING_ENTER_GETEVENTS, 0, 0) < 0
+          && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+        ev_syserr ("(libev) io_uring_enter");
+    }
+}
+#endif
+
+static void
+iouring_internal_destroy (EV_P)
+{
+  if (iouring_sq_ring) munmap (iouring_sq_ring, iouring_sq_ring_size);
+  if (iouring_cq_ring) munmap (iouring_cq_ring, iouring_cq_ring_size);
+  if (iouring_sqes   ) munmap (iouring_sqes   , iouring_sqes_size   );
+
+  iouring_sq_ring = 0;
+  iouring_cq_ring = 0;
+  iouring_sqes    = 0;
+}
+
+/* returns 0 on success, -1 if the ring cannot be set up or lacks features we need */
+static int
+iouring_internal_init (EV_P)
+{
+  struct io_uring_params params;
+  unsigned int i;
+  void *p;
+
+  memset (&params, 0, sizeof (params));
+
+  iouring_sq_ring   = 0;
+  iouring_cq_ring   = 0;
+  iouring_sqes      = 0;
+  iouring_to_submit = 0;
+
+  backend_fd = syscall (__NR_io_uring_setup, iouring_entries, &params);
+
+  if (backend_fd < 0)
+    return -1;
+
+  if ((~params.features) & (IORING_FEAT_NODROP | IORING_FEAT_SUBMIT_STABLE | IORING_FEAT_RW_CUR_POS))
+    return -1;
+
+  iouring_features     = params.features;
+  iouring_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof (unsigned int);
+  iouring_cq_ring_size = params.cq_off.cqes  + params.cq_entries * sizeof (struct io_uring_cqe);
+  iouring_sqes_size    = params.sq_entries * sizeof (struct io_uring_sqe);
+
+  p = mmap (0, iouring_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend_fd, IORING_OFF_SQ_RING);
+  if (p == MAP_FAILED)
+    return -1;
+  iouring_sq_ring = (char *)p;
+
+  p = mmap (0, iouring_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend_fd, IORING_OFF_CQ_RING);
+  if (p == MAP_FAILED)
+    return -1;
+  iouring_cq_ring = (char *)p;
+
+  p = mmap (0, iouring_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend_fd, IORING_OFF_SQES);
+  if (p == MAP_FAILED)
+    return -1;
+  iouring_sqes = (struct io_uring_sqe *)p;
+
+  iouring_sq_head = (unsigned int *)(iouring_sq_ring + params.sq_off.head);
+  iouring_sq_tail = (unsigned int *)(iouring_sq_ring + params.sq_off.tail);
+  iouring_sq_mask = *(unsigned int *)(iouring_sq_ring + params.sq_off.ring_mask);
+  iouring_entries = *(unsigned int *)(iouring_sq_ring + params.sq_off.ring_entries);
+  iouring_cq_head = (unsigned int *)(iouring_cq_ring + params.cq_off.head);
+  iouring_cq_tail = (unsigned int *)(iouring_cq_ring + params.cq_off.tail);
+  iouring_cq_mask = *(unsigned int *)(iouring_cq_ring + params.cq_off.ring_mask);
+  iouring_cqes    = (struct io_uring_cqe *)(iouring_cq_ring + params.cq_off.cqes);
+
+  /* we always fill sqes in ring order, so the indirection array is the identity */
+  for (i = 0; i < iouring_entries; ++i)
+    ((unsigned int *)(iouring_sq_ring + params.sq_off.array)) [i] = i;
+
+  return 0;
+}
+
+int inline_size
+iouring_init (EV_P_ int flags)
+{
+  iouring_entries = 256; /* sq size, the kernel sizes the cq twice as large */
+
+  if (iouring_internal_init (EV_A) < 0)
+    {
+      iouring_internal_destroy (EV_A);
+
+      if (backend_fd >= 0)
+        close (backend_fd);
+
+      backend_fd = -1;
+      return 0;
+    }
+
+  fcntl (backend_fd, F_SETFD, FD_CLOEXEC);
+
+  backend_mintime = 1e-9; /* nanosecond timeouts */
+  backend_modify  = iouring_modify;
+  backend_poll    = iouring_poll;
+
+  return EVBACKEND_IOURING;
+}
+
+void inline_size
+iouring_destroy (EV_P)
+{
+  iouring_internal_destroy (EV_A);
+}
+
+void inline_size
+iouring_fork (EV_P)
+{
+  /* the rings are shared with the parent, so only drop our mapping and reference */
+  iouring_internal_destroy (EV_A);
+  close (backend_fd);
+
+  while (iouring_internal_init (EV_A) < 0)
+    {
+      iouring_internal_destroy (EV_A);
+
+      if (backend_fd >= 0)
+        close (backend_fd);
+
+      ev_syserr ("(libev) io_uring_setup");
+    }
+
+  fcntl (backend_fd, F_SETFD, FD_CLOEXEC);
+
+  /* polls and ev_uring requests of the parent ring are gone, re-arm the fds */
+  fd_rearm_all (EV_A);
+}
@@ -107,6 +107,25 @@ VARx(int, epoll_epermcnt)
 VARx(int, epoll_epermmax)
 #endif
 
+#if EV_USE_IOURING || EV_GENWRAP
+VARx(unsigned int, iouring_features)
+VARx(unsigned int, iouring_entries)
+VARx(unsigned int, iouring_to_submit)
+VARx(char *, iouring_sq_ring)
+VARx(unsigned int, iouring_sq_ring_size)
+VARx(unsigned int *, iouring_sq_head)
+VARx(unsigned int *, iouring_sq_tail)
+VARx(unsigned int, iouring_sq_mask)
+VARx(struct io_uring_sqe *, iouring_sqes)
+VARx(unsigned int, iouring_sqes_size)
+VARx(char *, iouring_cq_ring)
+VARx(unsigned int, iouring_cq_ring_size)
+VARx(unsigned int *, iouring_cq_head)
+VARx(unsigned int *, iouring_cq_tail)
+VARx(unsigned int, iouring_cq_mask)
+VARx(struct io_uring_cqe *, iouring_cqes)
+#endif
+
 #if EV_USE_KQUEUE || EV_GENWRAP
 VARx(pid_t, kqueue_fd_pid)
 VARx(struct kevent *, kqueue_changes)
@@ -187,6 +206,12 @@ VARx(ev_io, sigfd_w)
 VARx(sigset_t, sigfd_set)
 #endif
 
+#if EV_USE_TIMERFD || EV_GENWRAP
+VARx(int, timerfd)
+VARx(ev_io, timerfd_w)
+VARx(ev_tstamp, timerfd_at) /* the deadline the timerfd is armed for, 0 if not armed */
+#endif
+
 VARx(unsigned int, origflags) /* original loop flags */
 
 #if EV_FEATURE_API || EV_GENWRAP
@@ -44,6 +44,22 @@
 #define invoke_cb ((loop)->invoke_cb)
 #define io_blocktime ((loop)->io_blocktime)
 #define iocp ((loop)->iocp)
+#define iouring_cq_head ((loop)->iouring_cq_head)
+#define iouring_cq_mask ((loop)->iouring_cq_mask)
+#define iouring_cq_ring ((loop)->iouring_cq_ring)
+#define iouring_cq_ring_size ((loop)->iouring_cq_ring_size)
+#define iouring_cq_tail ((loop)->iouring_cq_tail)
+#define iouring_cqes ((loop)->iouring_cqes)
+#define iouring_entries ((loop)->iouring_entries)
+#define iouring_features ((loop)->iouring_features)
+#define iouring_sq_head ((loop)->iouring_sq_head)
+#define iouring_sq_mask ((loop)->iouring_sq_mask)
+#define iouring_sq_ring ((loop)->iouring_sq_ring)
+#define iouring_sq_ring_size ((loop)->iouring_sq_ring_size)
+#define iouring_sq_tail ((loop)->iouring_sq_tail)
+#define iouring_sqes ((loop)->iouring_sqes)
+#define iouring_sqes_size ((loop)->iouring_sqes_size)
+#define iouring_to_submit ((loop)->iouring_to_submit)
 #define kqueue_changecnt ((loop)->kqueue_changecnt)
 #define kqueue_changemax ((loop)->kqueue_changemax)
 #define kqueue_changes ((loop)->kqueue_changes)
@@ -89,6 +105,9 @@
 #define sigfd_w ((loop)->sigfd_w)
 #define timeout_blocktime ((loop)->timeout_blocktime)
 #define timercnt ((loop)->timercnt)
+#define timerfd ((loop)->timerfd)
+#define timerfd_at ((loop)->timerfd_at)
+#define timerfd_w ((loop)->timerfd_w)
 #define timermax ((loop)->timermax)
 #define timers ((loop)->timers)
 #define userdata ((loop)->userdata)
@@ -143,6 +162,22 @@
 #undef invoke_cb
 #undef io_blocktime
 #undef iocp
+#undef iouring_cq_head
+#undef iouring_cq_mask
+#undef iouring_cq_ring
+#undef iouring_cq_ring_size
+#undef iouring_cq_tail
+#undef iouring_cqes
+#undef iouring_entries
+#undef iouring_features
+#undef iouring_sq_head
+#undef iouring_sq_mask
+#undef iouring_sq_ring
+#undef iouring_sq_ring_size
+#undef iouring_sq_tail
+#undef iouring_sqes
+#undef iouring_sqes_size
+#undef iouring_to_submit
 #undef kqueue_changecnt
 #undef kqueue_changemax
 #undef kqueue_changes
@@ -188,6 +223,9 @@
 #undef sigfd_w
 #undef timeout_blocktime
 #undef timercnt
+#undef timerfd
+#undef timerfd_at
+#undef timerfd_w
 #undef timermax
 #undef timers
 #undef userdata
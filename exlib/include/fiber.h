@@ -21,6 +21,7 @@ namespace exlib
 #define TLS_SIZE    8
 
 class Locker;
+class Timer;
 
 class Task_base : public linkitem
 {
@@ -37,6 +38,9 @@ public:
     {
         return false;
     }
+
+public:
+    atomic_ptr<Timer> m_timer;
 };
 
 class Thread_base : public Task_base
@@ -231,7 +235,7 @@ class Fiber : public Thread_base
 {
 public:
     Fiber(Service* pService, void* data) :
-        m_pService(pService), m_data(data)
+        m_pService(pService), m_data(data), m_stack(NULL), m_stacksize(0)
     {
         memset(&m_cntxt, 0, sizeof(m_cntxt));
         memset(&name_, 0, sizeof(name_));
@@ -277,6 +281,8 @@ public:
     Event m_joins;
     Service* m_pService;
     void* m_data;
+    void* m_stack;
+    int32_t m_stacksize;
     char name_[16];
 
 #ifdef DEBUG
@@ -198,6 +198,22 @@ public:
         m_count = 0;
     }
 
+    void putList(List<T> &list)
+    {
+        T *p;
+
+        while ((p = list.getHead()) != 0)
+            putTail(p);
+    }
+
+    void getHalf(List<T> &list)
+    {
+        int32_t n = (m_count + 1) / 2;
+
+        while (n--)
+            list.putTail(getHead());
+    }
+
     bool has(T* o) const
     {
         linkitem *p = m_first;
@@ -293,6 +309,20 @@ public:
         return pNow;
     }
 
+    void putList(List<T> &list)
+    {
+        m_lock.lock();
+        List<T>::putList(list);
+        m_lock.unlock();
+    }
+
+    void getHalf(List<T> &list)
+    {
+        m_lock.lock();
+        List<T>::getHalf(list);
+        m_lock.unlock();
+    }
+
     bool has(T* o)
     {
         m_lock.lock();
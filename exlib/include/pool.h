@@ -0,0 +1,78 @@
+/*
+ *  pool.h
+ *  Created on: Oct 16, 2026
+ *
+ *  Copyright (c) 2026 by Leo Hoo
+ *  lion@9465.net
+ */
+
+#ifndef _ex_pool_h__
+#define _ex_pool_h__
+
+#include "thread.h"
+
+namespace exlib
+{
+
+class AsyncTask : public linkitem
+{
+public:
+    virtual ~AsyncTask()
+    {}
+
+public:
+    virtual void invoke() = 0;
+};
+
+/*
+ * a bounded set of os threads for work that has to block: file i/o,
+ * fsync, background compaction. threads are started on demand up to
+ * m_max and never exit. call() parks the calling fiber until the task
+ * has run, so the worker it came from keeps scheduling other fibers.
+ * the pool threads are OSThreads, so Locker/CondVar work inside tasks.
+ *
+ * cpu-bound work such as tls handshake crypto belongs in its own pool,
+ * sized to the number of cores, so it neither queues behind blocking
+ * i/o nor starves the fibers of the worker that asked for it.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool(int32_t max_threads) : m_max(max_threads)
+    {
+    }
+
+public:
+    void post(AsyncTask* task);
+    void call(AsyncTask* task);
+
+    void set_max_threads(int32_t max_threads);
+    int32_t max_threads() const
+    {
+        return m_max;
+    }
+
+    // true when the caller is a fiber that must not block its worker.
+    static bool on_fiber();
+
+    // run fn(arg) on the pool given as the first argument and return its
+    // result, parking the calling fiber meanwhile. the signature matches
+    // c offload hooks such as mbedtls_ssl_conf_offload().
+    static int32_t offload(void* pool, int32_t (*fn)(void*), void* arg);
+
+private:
+    class Worker;
+    void start_worker();
+    bool claim_idle();
+
+private:
+    int32_t m_max;
+    atomic m_threads;
+    atomic m_idle;
+    LockedList<AsyncTask> m_tasks;
+    OSSemaphore m_sem;
+};
+
+}
+
+#endif
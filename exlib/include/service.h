@@ -11,6 +11,7 @@
 
 #include "fiber.h"
 #include "thread.h"
+#include "timer.h"
 
 namespace exlib
 {
@@ -33,8 +34,6 @@ public:
     virtual void Run()
     {
         m_main.saveStackGuard();
-
-        m_master->m_idleWorkers.dec();
         dispatch_loop();
     }
 
@@ -45,50 +44,25 @@ public:
     typedef void *(*fiber_func)(void *);
 
 public:
-    static void init(int32_t workers);
+    static void init(int32_t workers, bool local_timer = false);
+    static bool local_timer();
     static Service *current();
     static void init();
 
     static void Create(fiber_func func, void *data, int32_t stacksize,
                        const char* name = NULL, Fiber** retVal = NULL);
+    static void set_stack_watermark(int32_t low, int32_t high);
+
+    static int32_t worker_count();
+    static Service* worker(int32_t idx);
 
     void post(Fiber* fiber)
     {
-        if (m_master)
-            m_master->post(fiber);
-        else
-        {
-            m_resumeList.putTail(fiber);
-            m_sem.Post();
-        }
+        m_resumeList.putTail(fiber);
+        root()->wakeup();
     }
 
-    Fiber* next()
-    {
-        if (m_master)
-            return m_master->next();
-
-        Fiber* fb;
-
-        m_idleWorkers.inc();
-
-        m_sem.Wait();
-        fb = m_resumeList.getHead();
-
-        if (m_idleWorkers.dec() == 0 && m_workers > 0)
-        {
-            if (m_workers.dec() < 0)
-                m_workers.inc();
-            else
-            {
-                m_idleWorkers.inc();
-                Service* worker = new Service();
-                worker->start();
-            }
-        }
-
-        return fb;
-    }
+    Fiber* next();
 
     Fiber* running()
     {
@@ -121,6 +95,14 @@ public:
         switchConext();
     }
 
+public:
+    // run expired timers of this worker, returns ms until the next one.
+    int32_t run_timers();
+
+public:
+    TimerWheel m_timers;
+    LockedList<linkitem> m_timerCancels;
+
 #ifdef DEBUG
 public:
     static void forEach(void (*func)(Fiber*));
@@ -129,6 +111,15 @@ public:
 private:
     static void fiber_proc(void *(*func)(void *), Fiber* fb);
 
+    Service* root()
+    {
+        return m_master ? m_master : this;
+    }
+
+    Fiber* steal();
+    void wakeup();
+    void cancel_idle();
+
 private:
     Service* m_master;
 
@@ -137,9 +128,14 @@ private:
     Fiber *m_running;
     switchConextCallback* m_cb;
 
+    LockedList<Fiber> m_resumeList;
+    int32_t m_ticks;
+    int32_t m_seed;
+
     exlib::atomic m_workers;
     exlib::atomic m_idleWorkers;
-    LockedList<Fiber> m_resumeList;
+    exlib::atomic m_count;
+    Service** m_services;
     OSSemaphore m_sem;
 };
 
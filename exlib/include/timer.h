@@ -0,0 +1,83 @@
+/*
+ *  timer.h
+ *  Created on: Oct 16, 2026
+ *
+ *  Copyright (c) 2026 by Leo Hoo
+ *  lion@9465.net
+ */
+
+#ifndef _ex_timer_h__
+#define _ex_timer_h__
+
+#include <stdint.h>
+#include "list.h"
+
+namespace exlib
+{
+
+class Timer : public linkitem
+{
+public:
+    Timer() : m_expire(0), m_slot(0)
+    {
+    }
+
+public:
+    int64_t m_expire;
+    List<Timer>* m_slot;
+};
+
+#define TVR_BITS    8
+#define TVN_BITS    6
+#define TVR_SIZE    (1 << TVR_BITS)
+#define TVN_SIZE    (1 << TVN_BITS)
+#define TVR_MASK    (TVR_SIZE - 1)
+#define TVN_MASK    (TVN_SIZE - 1)
+#define TVN_LEVELS  4
+
+/*
+ * hierarchical timing wheel with a 1ms tick, the same layout as the
+ * classic kernel timer vectors: 256 slots for the next 256ms, then four
+ * levels of 64 slots that cascade down as time advances.
+ * add and remove are O(1), the Timer object itself is the cancel handle.
+ * a wheel is not locked, it must only be touched by its owner thread.
+ */
+class TimerWheel
+{
+public:
+    TimerWheel() : m_base(0), m_count(0), m_next(0), m_next_valid(false)
+    {
+    }
+
+public:
+    void add(Timer* tm, int64_t now, int32_t ms);
+    void remove(Timer* tm);
+    void expire(int64_t now, List<Timer>& fired);
+    int32_t timeout(int64_t now);
+
+    int32_t count() const
+    {
+        return m_count;
+    }
+
+private:
+    void insert(Timer* tm, int64_t expire);
+    int32_t cascade(int32_t level);
+
+private:
+    int64_t m_base;
+    int32_t m_count;
+
+    // cached result of the slot scan in timeout(): the first non-empty
+    // near slot, or the next cascade point. kept up to date on insert and
+    // only rescanned after the timer that set it is removed or fires.
+    int64_t m_next;
+    bool m_next_valid;
+    List<Timer> m_tv1[TVR_SIZE];
+    List<Timer> m_tvn[TVN_LEVELS][TVN_SIZE];
+};
+
+}
+
+#endif
+
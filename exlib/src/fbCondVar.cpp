@@ -13,13 +13,14 @@ namespace exlib
 
 void CondVar::wait(Locker &l)
 {
-	l.unlock();
-
 	Task_base* current = Thread_base::current();
 	assert(current != 0);
 
+	// queue up before releasing l, a notify from another thread between
+	// the two would otherwise be lost.
 	m_lock.lock();
 	m_blocks.putTail(current);
+	l.unlock();
 	current->suspend(m_lock);
 
 	l.lock();
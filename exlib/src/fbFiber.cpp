@@ -15,8 +15,6 @@
 #include "service.h"
 #include "thread.h"
 
-#include <map>
-
 #ifndef WIN32
 #include <cxxabi.h>
 #include <dlfcn.h>
@@ -39,31 +37,123 @@ public:
 namespace exlib
 {
 
-class Sleeping : public linkitem,
+#define MAX_TIMER_POOL  10000
+
+void stack_free(void* stk, int32_t size);
+
+static inline int64_t now_ms()
+{
+    return (int64_t)v8::base::OS::TimeCurrentMillis();
+}
+
+/*
+ * a sleeping task is claimed either by the timer that fires or by
+ * cancel_sleep, through an atomic exchange on Task_base::m_timer, so
+ * exactly one of them resumes the task. the node itself is only unlinked
+ * and recycled by the thread that owns the wheel it lives in.
+ */
+class Sleeping : public Timer,
     public Service::switchConextCallback
 {
 public:
-    Sleeping(Task_base* now, int32_t tm) :
-        m_now(now), m_tm(tm)
-    {}
+    enum
+    {
+        ARMING = 0,
+        PENDING,
+        DONE
+    };
+
+public:
+    static Sleeping* alloc(Task_base* now, int32_t tm, Service* owner);
+    void release();
 
 public:
     virtual void invoke();
 
+    void fire();
+    void cancel();
+
 public:
     Task_base* m_now;
     int32_t m_tm;
+    Service* m_owner;
+    atomic m_state;
+    atomic m_refs;
+    linkitem m_cancel;
 };
 
-class Canceling : public linkitem
+static LockedList<Sleeping> s_pool;
+
+Sleeping* Sleeping::alloc(Task_base* now, int32_t tm, Service* owner)
 {
-public:
-    Canceling(Task_base* now) : m_now(now)
-    {}
+    Sleeping* p = s_pool.getHead();
 
-public:
-    Task_base* m_now;
-};
+    if (p == NULL)
+        p = new Sleeping();
+
+    p->m_now = now;
+    p->m_tm = tm;
+    p->m_owner = owner;
+    p->m_state = ARMING;
+
+    // one reference for the wheel, one for whoever claims the task.
+    p->m_refs = 2;
+
+    return p;
+}
+
+void Sleeping::release()
+{
+    if (m_refs.dec() == 0)
+    {
+        if (s_pool.count() < MAX_TIMER_POOL)
+            s_pool.putTail(this);
+        else
+            delete this;
+    }
+}
+
+static inline Sleeping* cancel_item(linkitem* p)
+{
+    Sleeping* zs = 0;
+    return (Sleeping*)((intptr_t)p - (intptr_t)(&zs->m_cancel));
+}
+
+static void timer_add(TimerWheel& wheel, Sleeping* p, int64_t tm)
+{
+    if (p->m_state == Sleeping::DONE)
+        p->release();
+    else
+        wheel.add(p, tm, p->m_tm);
+}
+
+static void timer_cancel(TimerWheel& wheel, LockedList<linkitem>& cancels)
+{
+    linkitem* p1;
+
+    while ((p1 = cancels.getHead()) != NULL)
+    {
+        Sleeping* p = cancel_item(p1);
+
+        if (p->m_slot)
+        {
+            wheel.remove(p);
+            p->release();
+        }
+
+        p->release();
+    }
+}
+
+static void timer_fire(TimerWheel& wheel, int64_t tm)
+{
+    List<Timer> fired;
+    Timer* p;
+
+    wheel.expire(tm, fired);
+    while ((p = fired.getHead()) != NULL)
+        static_cast<Sleeping*>(p)->fire();
+}
 
 Fiber *Fiber::current()
 {
@@ -77,11 +167,7 @@ Fiber *Fiber::current()
 
 void Fiber::destroy()
 {
-#ifdef WIN32
-    VirtualFree(this, 0, MEM_RELEASE);
-#else
-    free(this);
-#endif
+    stack_free(m_stack, m_stacksize);
 }
 
 void Fiber::join()
@@ -144,95 +230,105 @@ void Fiber::yield()
 static class _timerThread: public OSThread
 {
 public:
-    void wait()
-    {
-        std::multimap<double, Sleeping *>::iterator e;
-
-        e = m_tms.begin();
-        if (e != m_tms.end())
-            m_sem.TimedWait((int32_t)(e->first - m_tm));
-        else
-            m_sem.Wait();
-    }
-
     virtual void Run()
     {
+        int64_t tm = now_ms();
+
         while (1)
         {
             Sleeping *p;
-            Canceling *p1;
-            std::multimap<double, Sleeping *>::iterator e;
+            int32_t tmo = m_wheel.timeout(tm);
 
-            wait();
+            if (tmo < 0)
+                m_sem.Wait();
+            else
+                m_sem.TimedWait(tmo);
 
-            m_tm = v8::base::OS::TimeCurrentMillis();
+            tm = now_ms();
 
             while ((p = m_acSleep.getHead()) != NULL)
-            {
-                m_tms.insert(std::make_pair(m_tm + p->m_tm, p));
-            }
-
-            while ((p1 = m_acCancel.getHead()) != NULL)
-            {
-                e = m_tms.begin();
-                while (e != m_tms.end())
-                {
-                    if (e->second->m_now == p1->m_now)
-                    {
-                        e->second->m_now->resume();
-                        delete e->second;
-                        m_tms.erase(e);
-                        break;
-                    }
-
-                    e++;
-                }
-
-                delete p1;
-            }
-
-            while (1)
-            {
-                e = m_tms.begin();
-                if (e == m_tms.end())
-                    break;
-                if (e->first > m_tm)
-                    break;
-
-                e->second->m_now->resume();
-                delete e->second;
-                m_tms.erase(e);
-            }
+                timer_add(m_wheel, p, tm);
+
+            timer_cancel(m_wheel, m_acCancel);
+            timer_fire(m_wheel, tm);
         }
     }
 
-    void sleep(Task_base* now, int32_t ms)
+    void post(Sleeping* p)
     {
-        m_acSleep.putTail(new Sleeping(now, ms));
+        m_acSleep.putTail(p);
         m_sem.Post();
-        now->suspend();
     }
 
-    void cancel(Task_base* now)
+    void cancel(linkitem* p)
     {
-        m_acCancel.putTail(new Canceling(now));
+        m_acCancel.putTail(p);
         m_sem.Post();
     }
 
 private:
     OSSemaphore m_sem;
-    double m_tm;
     LockedList<Sleeping> m_acSleep;
-    LockedList<Canceling> m_acCancel;
-    std::multimap<double, Sleeping *> m_tms;
-
-    friend class Sleeping;
+    LockedList<linkitem> m_acCancel;
+    TimerWheel m_wheel;
 } s_timer;
 
 void Sleeping::invoke()
 {
-    s_timer.m_acSleep.putTail(this);
-    s_timer.m_sem.Post();
+    if (m_state.CompareAndSwap(ARMING, PENDING) != ARMING)
+    {
+        // cancel_sleep came in while the fiber was switching out.
+        Task_base* now = m_now;
+
+        release();
+        now->resume();
+        return;
+    }
+
+    if (m_owner)
+        timer_add(m_owner->m_timers, this, now_ms());
+    else
+        s_timer.post(this);
+}
+
+void Sleeping::fire()
+{
+    Task_base* now = m_now;
+
+    if (now->m_timer.CompareAndSwap(this, NULL) == this)
+    {
+        now->resume();
+        release();
+    }
+
+    release();
+}
+
+void Sleeping::cancel()
+{
+    Service* owner = m_owner;
+
+    if (m_state.xchg(DONE) == PENDING)
+        m_now->resume();
+
+    if (owner)
+        owner->m_timerCancels.putTail(&m_cancel);
+    else
+        s_timer.cancel(&m_cancel);
+}
+
+int32_t Service::run_timers()
+{
+    if (!m_timerCancels.List<linkitem>::empty())
+        timer_cancel(m_timers, m_timerCancels);
+
+    if (m_timers.count() == 0)
+        return -1;
+
+    int64_t tm = now_ms();
+
+    timer_fire(m_timers, tm);
+    return m_timers.timeout(tm);
 }
 
 void init_timer()
@@ -253,20 +349,33 @@ void Fiber::sleep(int32_t ms, Task_base* now)
             ((Fiber*)now)->yield();
         else
         {
-            ((Fiber*)now)->m_pService->switchConext(new Sleeping(now, ms));
+            Service* pService = ((Fiber*)now)->m_pService;
+            Sleeping* p = Sleeping::alloc(now, ms,
+                                          Service::local_timer() ? pService : NULL);
+
+            now->m_timer = p;
+            pService->switchConext(p);
         }
     } else
     {
         if (ms <= 0)
             ms = 0;
 
-        s_timer.sleep(now, ms);
+        Sleeping* p = Sleeping::alloc(now, ms, NULL);
+
+        p->m_state = Sleeping::PENDING;
+        now->m_timer = p;
+        s_timer.post(p);
+        now->suspend();
     }
 }
 
 void Fiber::cancel_sleep(Task_base* now)
 {
-    s_timer.cancel(now);
+    Sleeping* p = static_cast<Sleeping*>(now->m_timer.xchg(NULL));
+
+    if (p)
+        p->cancel();
 }
 
 }
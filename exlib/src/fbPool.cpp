@@ -0,0 +1,168 @@
+/*
+ *  fbPool.cpp
+ *  Created on: Oct 16, 2026
+ *
+ *  Copyright (c) 2026 by Leo Hoo
+ *  lion@9465.net
+ */
+
+#include "service.h"
+#include "pool.h"
+
+namespace exlib
+{
+
+class ThreadPool::Worker : public OSThread
+{
+public:
+    Worker(ThreadPool* pool) : m_pool(pool)
+    {
+    }
+
+public:
+    virtual void Run()
+    {
+        ThreadPool* pool = m_pool;
+
+        while (true)
+        {
+            AsyncTask* task = pool->m_tasks.getHead();
+
+            if (task == NULL)
+            {
+                pool->m_idle.inc();
+
+                // check again after announcing ourselves idle, a post() racing
+                // with the check above will either be seen here or claim us.
+                if ((task = pool->m_tasks.getHead()) == NULL)
+                {
+                    pool->m_sem.Wait();
+                    continue;
+                }
+
+                // take our idle slot back. if a post() already claimed it,
+                // its signal is on the way: consume it now so that it does
+                // not wake us for nothing later.
+                if (!pool->claim_idle())
+                    pool->m_sem.Wait();
+            }
+
+            task->invoke();
+        }
+    }
+
+private:
+    ThreadPool* m_pool;
+};
+
+class CallTask : public AsyncTask
+{
+public:
+    CallTask(AsyncTask* task) : m_task(task)
+    {
+    }
+
+public:
+    virtual void invoke()
+    {
+        m_task->invoke();
+        m_done.set();
+    }
+
+public:
+    AsyncTask* m_task;
+    Event m_done;
+};
+
+class FuncTask : public AsyncTask
+{
+public:
+    FuncTask(int32_t (*fn)(void*), void* arg) : m_fn(fn), m_arg(arg), m_result(0)
+    {
+    }
+
+public:
+    virtual void invoke()
+    {
+        m_result = m_fn(m_arg);
+    }
+
+public:
+    int32_t (*m_fn)(void*);
+    void* m_arg;
+    int32_t m_result;
+};
+
+bool ThreadPool::on_fiber()
+{
+    OSThread* thread_ = OSThread::current();
+    return thread_ && thread_->is(Service::type);
+}
+
+void ThreadPool::start_worker()
+{
+    intptr_t n;
+
+    do
+    {
+        n = m_threads;
+        if (n >= m_max)
+            return;
+    } while (m_threads.CompareAndSwap(n, n + 1) != n);
+
+    (new Worker(this))->start();
+}
+
+bool ThreadPool::claim_idle()
+{
+    intptr_t n;
+
+    while ((n = m_idle) > 0)
+        if (m_idle.CompareAndSwap(n, n - 1) == n)
+            return true;
+
+    return false;
+}
+
+void ThreadPool::post(AsyncTask* task)
+{
+    m_tasks.putTail(task);
+
+    // every task claims an idle worker of its own, so tasks posted back to
+    // back never queue behind one worker while the pool is below m_max.
+    // with all workers busy and none to start, the next worker to finish
+    // picks the task up before it goes idle.
+    if (claim_idle())
+        m_sem.Post();
+    else
+        start_worker();
+}
+
+void ThreadPool::call(AsyncTask* task)
+{
+    if (!on_fiber())
+    {
+        task->invoke();
+        return;
+    }
+
+    CallTask ct(task);
+
+    post(&ct);
+    ct.m_done.wait();
+}
+
+int32_t ThreadPool::offload(void* pool, int32_t (*fn)(void*), void* arg)
+{
+    FuncTask task(fn, arg);
+
+    ((ThreadPool*)pool)->call(&task);
+    return task.m_result;
+}
+
+void ThreadPool::set_max_threads(int32_t max_threads)
+{
+    m_max = max_threads;
+}
+
+}
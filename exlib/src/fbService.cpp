@@ -21,14 +21,19 @@ namespace exlib
 #define FB_STK_ALIGN 256
 
 void init_timer();
+int32_t stack_size(int32_t size);
+void* stack_alloc(int32_t size);
 
 static bool s_service_inited;
+static bool s_local_timer;
 static Service* s_service = NULL;
 
-void Service::init(int32_t workers)
+void Service::init(int32_t workers, bool local_timer)
 {
     if (!s_service)
     {
+        s_local_timer = local_timer;
+
         static Service _srv(workers);
         s_service = &_srv;
         s_service->m_main.saveStackGuard();
@@ -36,6 +41,21 @@ void Service::init(int32_t workers)
     }
 }
 
+bool Service::local_timer()
+{
+    return s_local_timer;
+}
+
+int32_t Service::worker_count()
+{
+    return s_service ? (int32_t)s_service->m_count : 0;
+}
+
+Service* Service::worker(int32_t idx)
+{
+    return s_service->m_services[idx];
+}
+
 Thread_base* Thread_base::current()
 {
     if (!s_service_inited)
@@ -87,18 +107,30 @@ void Service::forEach(void (*func)(Fiber*))
 #endif
 
 Service::Service() :
-    m_master(s_service), m_main(this, NULL), m_running(&m_main), m_cb(NULL)
+    m_master(s_service), m_main(this, NULL), m_running(&m_main), m_cb(NULL),
+    m_ticks(0), m_services(NULL)
 {
     m_main.set_name("main");
     m_main.Ref();
+
+    m_seed = (int32_t)m_master->m_count.inc() - 1;
+    m_master->m_services[m_seed] = this;
 }
 
 Service::Service(int32_t workers) :
-    m_master(NULL), m_main(this, NULL), m_running(&m_main), m_cb(NULL), m_workers(workers - 1)
+    m_master(NULL), m_main(this, NULL), m_running(&m_main), m_cb(NULL),
+    m_ticks(0), m_seed(0), m_workers(workers - 1), m_count(1)
 {
     m_main.set_name("main");
     m_main.Ref();
 
+    if (workers < 1)
+        workers = 1;
+
+    m_services = new Service*[workers];
+    memset(m_services, 0, sizeof(Service*) * workers);
+    m_services[0] = this;
+
     if (!s_service_inited)
     {
         s_service_inited = true;
@@ -141,20 +173,30 @@ void Service::fiber_proc(void *(*func)(void *), Fiber *fb)
 void Service::Create(fiber_func func, void *data, int32_t stacksize, const char* name, Fiber** retVal)
 {
     Fiber *fb;
+    void *stk;
     void **stack;
 
-    stacksize = (stacksize + FB_STK_ALIGN - 1) & ~(FB_STK_ALIGN - 1);
-#ifdef WIN32
-    fb = (Fiber *) VirtualAlloc(NULL, stacksize, MEM_COMMIT | MEM_TOP_DOWN, PAGE_READWRITE);
-#else
-    fb = (Fiber *) malloc(stacksize);
-#endif
-    if (fb == NULL)
+    stacksize = stack_size(stacksize);
+    stk = stack_alloc(stacksize);
+    if (stk == NULL)
         return;
 
-    stack = (void **) fb + stacksize / sizeof(void *) - 5;
+    // the Fiber lives at the top of its stack, overflow runs into the guard page.
+    fb = (Fiber *) ((char *) stk + stacksize
+                    - ((sizeof(Fiber) + FB_STK_ALIGN - 1) & ~(FB_STK_ALIGN - 1)));
+    stack = (void **) fb - 5;
 
-    new(fb) Fiber(s_service, data);
+    Service* pService = s_service;
+    OSThread* thread_ = OSThread::current();
+
+    if (thread_ && thread_->is(Service::type))
+        pService = (Service*)thread_;
+
+    new(fb) Fiber(pService, data);
+    fb->m_stack = stk;
+    fb->m_stacksize = stacksize;
+    if (name)
+        fb->set_name(name);
 
     fb->m_cntxt.ip = (intptr_t) fiber_proc;
     fb->m_cntxt.sp = (intptr_t) stack;
@@ -191,6 +233,110 @@ void Service::Create(fiber_func func, void *data, int32_t stacksize, const char*
     fb->resume();
 }
 
+void Service::wakeup()
+{
+    intptr_t n;
+
+    while ((n = m_idleWorkers) > 0)
+        if (m_idleWorkers.CompareAndSwap(n, n - 1) == n)
+        {
+            m_sem.Post();
+            break;
+        }
+}
+
+void Service::cancel_idle()
+{
+    intptr_t n;
+
+    // if a waker has already claimed our idle slot, its post stays in
+    // m_sem and only causes one spurious wakeup later.
+    while ((n = m_idleWorkers) > 0)
+        if (m_idleWorkers.CompareAndSwap(n, n - 1) == n)
+            break;
+}
+
+Fiber* Service::steal()
+{
+    Service* r = root();
+    int32_t cnt = (int32_t)r->m_count;
+    int32_t i;
+
+    for (i = 0; i < cnt; i ++)
+    {
+        Service* victim = r->m_services[(m_seed + i) % cnt];
+
+        if (victim == NULL || victim == this
+                || victim->m_resumeList.List<Fiber>::empty())
+            continue;
+
+        List<Fiber> list;
+        victim->m_resumeList.getHalf(list);
+
+        Fiber* fb = list.getHead();
+        if (fb)
+        {
+            if (!list.empty())
+                m_resumeList.putList(list);
+
+            m_seed = (m_seed + i) % cnt;
+            return fb;
+        }
+    }
+
+    return NULL;
+}
+
+Fiber* Service::next()
+{
+    Service* r = root();
+    Fiber* fb;
+
+    while (true)
+    {
+        int32_t tmo = s_local_timer ? run_timers() : -1;
+
+        // look at the other queues once in a while so that fibers parked on
+        // a worker busy with yielding fibers do not starve.
+        if ((++m_ticks % 61) == 0 && (fb = steal()) != NULL)
+            break;
+
+        if ((fb = m_resumeList.getHead()) != NULL)
+            break;
+
+        if ((fb = steal()) != NULL)
+            break;
+
+        r->m_idleWorkers.inc();
+
+        // check again after announcing ourselves idle, a post() racing with
+        // the check above will either be seen here or will wake us.
+        if ((fb = m_resumeList.getHead()) != NULL || (fb = steal()) != NULL)
+        {
+            r->cancel_idle();
+            break;
+        }
+
+        if (tmo < 0)
+            r->m_sem.Wait();
+        else if (!r->m_sem.TimedWait(tmo))
+            r->cancel_idle();
+    }
+
+    if (r->m_idleWorkers == 0 && r->m_workers > 0)
+    {
+        if (r->m_workers.dec() < 0)
+            r->m_workers.inc();
+        else
+        {
+            Service* worker = new Service();
+            worker->start();
+        }
+    }
+
+    return fb;
+}
+
 void Service::dispatch()
 {
     assert(s_service != 0);
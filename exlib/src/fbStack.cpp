@@ -0,0 +1,275 @@
+/*
+ *  fbStack.cpp
+ *  Created on: Oct 16, 2026
+ *
+ *  Copyright (c) 2026 by Leo Hoo
+ *  lion@9465.net
+ */
+
+#include <stdlib.h>
+
+#include "osconfig.h"
+#include "service.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace exlib
+{
+
+#define MAX_STACK_CLASS 8
+
+/*
+ * fiber stacks are mapped with one inaccessible guard page below them and
+ * recycled per size. the first m_low idle stacks of a size stay resident,
+ * up to m_high more are kept mapped but handed back to the os, anything
+ * beyond that is unmapped. the free list node lives in the top page of
+ * the stack, which is never released.
+ */
+class StackItem : public linkitem
+{
+};
+
+class StackClass
+{
+public:
+    StackClass() : m_size(0), m_resident(0)
+    {
+    }
+
+public:
+    int32_t m_size;
+    int32_t m_resident;
+    List<StackItem> m_list;
+};
+
+static int32_t s_page;
+static int32_t s_low = 64;
+static int32_t s_high = 1024;
+static spinlock s_lock;
+static StackClass s_classes[MAX_STACK_CLASS];
+
+static int32_t page_size()
+{
+    if (s_page == 0)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        s_page = (int32_t)si.dwPageSize;
+#else
+        s_page = (int32_t)sysconf(_SC_PAGESIZE);
+#endif
+    }
+
+    return s_page;
+}
+
+static inline StackItem* stack_item(void* stk, int32_t size)
+{
+    return (StackItem*)((char*)stk + size - page_size());
+}
+
+static void* os_map(int32_t size)
+{
+    int32_t page = page_size();
+    char* p;
+
+#ifdef _WIN32
+    p = (char*)VirtualAlloc(NULL, size + page, MEM_RESERVE | MEM_COMMIT | MEM_TOP_DOWN,
+                            PAGE_READWRITE);
+    if (p == NULL)
+        return NULL;
+
+    // a stack without its guard page would overflow silently, fail instead.
+    DWORD old;
+    if (!VirtualProtect(p, page, PAGE_NOACCESS, &old))
+    {
+        VirtualFree(p, 0, MEM_RELEASE);
+        return NULL;
+    }
+#else
+    p = (char*)mmap(NULL, size + page, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (p == (char*)MAP_FAILED)
+        return NULL;
+
+    // a stack without its guard page would overflow silently, fail instead.
+    if (mprotect(p, page, PROT_NONE) != 0)
+    {
+        munmap(p, size + page);
+        return NULL;
+    }
+#endif
+
+    return p + page;
+}
+
+static void os_unmap(void* stk, int32_t size)
+{
+    int32_t page = page_size();
+
+#ifdef _WIN32
+    VirtualFree((char*)stk - page, 0, MEM_RELEASE);
+#else
+    munmap((char*)stk - page, size + page);
+#endif
+}
+
+static void os_release(void* stk, int32_t size)
+{
+    size -= page_size();
+
+#ifdef _WIN32
+    VirtualAlloc(stk, size, MEM_RESET, PAGE_READWRITE);
+#else
+#ifdef MADV_FREE
+    if (madvise(stk, size, MADV_FREE) == 0)
+        return;
+#endif
+    madvise(stk, size, MADV_DONTNEED);
+#endif
+}
+
+static StackClass* stack_class(int32_t size)
+{
+    int32_t i;
+
+    for (i = 0; i < MAX_STACK_CLASS; i ++)
+    {
+        if (s_classes[i].m_size == size)
+            return &s_classes[i];
+
+        if (s_classes[i].m_size == 0)
+        {
+            s_classes[i].m_size = size;
+            return &s_classes[i];
+        }
+    }
+
+    return NULL;
+}
+
+int32_t stack_size(int32_t size)
+{
+    int32_t page = page_size();
+    return (size + page - 1) & ~(page - 1);
+}
+
+void* stack_alloc(int32_t size)
+{
+    StackItem* p = NULL;
+
+    s_lock.lock();
+    StackClass* cls = stack_class(size);
+    if (cls)
+    {
+        p = cls->m_list.getHead();
+        if (p && cls->m_resident > 0)
+            cls->m_resident --;
+    }
+    s_lock.unlock();
+
+    if (p)
+        return (char*)p + page_size() - size;
+
+    return os_map(size);
+}
+
+void stack_free(void* stk, int32_t size)
+{
+    StackItem* p = stack_item(stk, size);
+    int32_t mode = 0;
+
+    s_lock.lock();
+    StackClass* cls = stack_class(size);
+    if (cls)
+    {
+        if (cls->m_resident < s_low)
+        {
+            cls->m_resident ++;
+            new(p) StackItem();
+            cls->m_list.putHead(p);
+            mode = 1;
+        }
+        else if (cls->m_list.count() < s_low + s_high)
+            mode = 2;
+    }
+    s_lock.unlock();
+
+    if (mode == 0)
+        os_unmap(stk, size);
+    else if (mode == 2)
+    {
+        os_release(stk, size);
+
+        s_lock.lock();
+        new(p) StackItem();
+        cls->m_list.putTail(p);
+        s_lock.unlock();
+    }
+}
+
+void Service::set_stack_watermark(int32_t low, int32_t high)
+{
+    int32_t i;
+
+    s_lock.lock();
+    s_low = low;
+    s_high = high;
+    s_lock.unlock();
+
+    // bring the idle stacks already pooled within the new limits, one at a
+    // time so the system calls run outside the lock.
+    for (i = 0; i < MAX_STACK_CLASS; i ++)
+    {
+        StackClass* cls = &s_classes[i];
+
+        while (true)
+        {
+            StackItem* p = NULL;
+            int32_t size;
+            bool release = false;
+
+            s_lock.lock();
+            size = cls->m_size;
+            if (cls->m_list.count() > s_low + s_high)
+            {
+                // released stacks are kept at the tail.
+                if (cls->m_list.count() == cls->m_resident)
+                    cls->m_resident --;
+                p = cls->m_list.getTail();
+            }
+            else if (cls->m_resident > s_low)
+            {
+                cls->m_resident --;
+                p = cls->m_list.getHead();
+                release = true;
+            }
+            s_lock.unlock();
+
+            if (p == NULL)
+                break;
+
+            void* stk = (char*)p + page_size() - size;
+
+            if (release)
+            {
+                os_release(stk, size);
+
+                s_lock.lock();
+                new(p) StackItem();
+                cls->m_list.putTail(p);
+                s_lock.unlock();
+            }
+            else
+                os_unmap(stk, size);
+        }
+    }
+}
+
+}
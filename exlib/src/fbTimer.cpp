@@ -0,0 +1,160 @@
+/*
+ *  fbTimer.cpp
+ *  Created on: Oct 16, 2026
+ *
+ *  Copyright (c) 2026 by Leo Hoo
+ *  lion@9465.net
+ */
+
+#include "timer.h"
+
+namespace exlib
+{
+
+void TimerWheel::insert(Timer* tm, int64_t expire)
+{
+    int64_t idx = expire - m_base;
+    List<Timer>* slot;
+
+    assert(tm->m_slot == 0);
+
+    if (idx < 0)
+    {
+        expire = m_base;
+        slot = &m_tv1[m_base & TVR_MASK];
+    }
+    else if (idx < TVR_SIZE)
+        slot = &m_tv1[expire & TVR_MASK];
+    else
+    {
+        int32_t level;
+
+        if (idx > 0xffffffffLL)
+        {
+            idx = 0xffffffffLL;
+            expire = m_base + idx;
+        }
+
+        for (level = 0; level < TVN_LEVELS - 1; level ++)
+            if (idx < (1LL << (TVR_BITS + (level + 1) * TVN_BITS)))
+                break;
+
+        slot = &m_tvn[level][(expire >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK];
+    }
+
+    tm->m_expire = expire;
+    tm->m_slot = slot;
+    slot->putTail(tm);
+    m_count ++;
+
+    if (m_next_valid && expire < m_next)
+        m_next = expire;
+}
+
+void TimerWheel::add(Timer* tm, int64_t now, int32_t ms)
+{
+    if (m_count == 0)
+    {
+        if (m_base < now)
+            m_base = now;
+        m_next_valid = false;
+    }
+
+    insert(tm, now + ms);
+}
+
+void TimerWheel::remove(Timer* tm)
+{
+    assert(tm->m_slot != 0);
+
+    tm->m_slot->remove(tm);
+    if (m_next_valid && tm->m_expire == m_next && tm->m_slot->empty())
+        m_next_valid = false;
+
+    tm->m_slot = 0;
+    m_count --;
+}
+
+int32_t TimerWheel::cascade(int32_t level)
+{
+    int32_t index = (int32_t)(m_base >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+    List<Timer> list;
+    Timer* tm;
+
+    m_tvn[level][index].getList(list);
+    while ((tm = list.getHead()) != 0)
+    {
+        tm->m_slot = 0;
+        m_count --;
+        insert(tm, tm->m_expire);
+    }
+
+    return index;
+}
+
+void TimerWheel::expire(int64_t now, List<Timer>& fired)
+{
+    while (m_base <= now)
+    {
+        if (m_count == 0)
+        {
+            m_base = now + 1;
+            break;
+        }
+
+        int32_t index = (int32_t)(m_base & TVR_MASK);
+        Timer* tm;
+
+        if (index == 0)
+        {
+            int32_t level;
+
+            for (level = 0; level < TVN_LEVELS; level ++)
+                if (cascade(level) != 0)
+                    break;
+        }
+
+        m_base ++;
+
+        while ((tm = m_tv1[index].getHead()) != 0)
+        {
+            tm->m_slot = 0;
+            m_count --;
+            fired.putTail(tm);
+        }
+    }
+
+    if (m_next_valid && m_next < m_base)
+        m_next_valid = false;
+}
+
+int32_t TimerWheel::timeout(int64_t now)
+{
+    int64_t tm;
+
+    if (m_count == 0)
+        return -1;
+
+    if (m_next_valid)
+        tm = m_next;
+    else
+    {
+        // at a cascade point the near slots are not filled in yet, so stop
+        // there and let expire() cascade first.
+        tm = m_base;
+        if (m_base & TVR_MASK)
+            while (tm <= (m_base | TVR_MASK) && m_tv1[tm & TVR_MASK].empty())
+                tm ++;
+
+        m_next = tm;
+        m_next_valid = true;
+    }
+
+    // nothing in the near vector, wake up at the next cascade point.
+    if (tm > now + 0x7fffffffLL)
+        return 0x7fffffff;
+
+    return tm > now ? (int32_t)(tm - now) : 0;
+}
+
+}
@@ -71,13 +71,22 @@ struct DBImpl::CompactionState {
 
   uint64_t total_bytes;
 
+  // Key range merged by this state: user keys in (start, end].  A
+  // subcompaction covers a slice of the compaction's key space.
+  bool has_start, has_end;
+  std::string start, end;
+  Compaction::ScanState scan;
+  Status status;
+
   Output* current_output() { return &outputs[outputs.size()-1]; }
 
   explicit CompactionState(Compaction* c)
       : compaction(c),
         outfile(NULL),
         builder(NULL),
-        total_bytes(0) {
+        total_bytes(0),
+        has_start(false),
+        has_end(false) {
   }
 };
 
@@ -132,11 +141,18 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       log_(NULL),
       seed_(0),
       tmp_batch_(new WriteBatch),
-      bg_compaction_scheduled_(false),
+      bg_compactions_scheduled_(0),
+      bg_compactions_pending_(0),
+      imm_compacting_(false),
+      manifest_writing_(false),
       manual_compaction_(NULL) {
   mem_->Ref();
   has_imm_.Release_Store(NULL);
 
+  // Room for every key range of every compaction that may run at once.
+  env_->SetBackgroundThreads(options_.max_background_compactions *
+                             options_.max_subcompactions);
+
   // Reserve ten files or so for other uses and give the rest to TableCache.
   const int table_cache_size = options_.max_open_files - kNumNonTableCacheFiles;
   table_cache_ = new TableCache(dbname_, &options_, table_cache_size);
@@ -149,7 +165,7 @@ DBImpl::~DBImpl() {
   // Wait for background work to finish
   mutex_.Lock();
   shutting_down_.Release_Store(this);  // Any non-NULL value is ok
-  while (bg_compaction_scheduled_) {
+  while (bg_compactions_scheduled_ > 0) {
     bg_cv_.Wait();
   }
   mutex_.Unlock();
@@ -221,6 +237,11 @@ void DBImpl::DeleteObsoleteFiles() {
     // or may not have been committed, so we cannot safely garbage collect.
     return;
   }
+  if (imm_compacting_) {
+    // The new level-0 table leaves pending_outputs_ before it is part of
+    // a version; CompactMemTable() does the cleanup once it is installed.
+    return;
+  }
 
   // Make a set of all of the live files
   std::set<uint64_t> live = pending_outputs_;
@@ -503,12 +524,18 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
 void DBImpl::CompactMemTable() {
   mutex_.AssertHeld();
   assert(imm_ != NULL);
+  assert(!imm_compacting_);
+  imm_compacting_ = true;
+  MaybeScheduleCompaction();
 
-  // Save the contents of the memtable as a new Table
+  // Save the contents of the memtable as a new Table.  With concurrent
+  // compactions the table always goes to level-0: a deeper level may be
+  // in the middle of being rewritten.
   VersionEdit edit;
   Version* base = versions_->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
+  Status s = WriteLevel0Table(imm_, &edit,
+      options_.max_background_compactions > 1 ? NULL : base);
   base->Unref();
 
   if (s.ok() && shutting_down_.Acquire_Load()) {
@@ -519,9 +546,10 @@ void DBImpl::CompactMemTable() {
   if (s.ok()) {
     edit.SetPrevLogNumber(0);
     edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
-    s = versions_->LogAndApply(&edit, &mutex_);
+    s = LogAndApply(&edit);
   }
 
+  imm_compacting_ = false;
   if (s.ok()) {
     // Commit to the new state
     imm_->Unref();
@@ -559,6 +587,7 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,const Slice* end) {
   ManualCompaction manual;
   manual.level = level;
   manual.done = false;
+  manual.running = false;
   if (begin == NULL) {
     manual.begin = NULL;
   } else {
@@ -581,6 +610,9 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,const Slice* end) {
       bg_cv_.Wait();
     }
   }
+  while (manual.running) {
+    bg_cv_.Wait();
+  }
   if (manual_compaction_ == &manual) {
     // Cancel my manual compaction since we aborted early for some reason.
     manual_compaction_ = NULL;
@@ -611,20 +643,47 @@ void DBImpl::RecordBackgroundError(const Status& s) {
   }
 }
 
+Status DBImpl::LogAndApply(VersionEdit* edit) {
+  mutex_.AssertHeld();
+  // VersionSet::LogAndApply() drops the mutex while it writes the
+  // MANIFEST, so concurrent compactions have to take turns here.
+  while (manifest_writing_) {
+    bg_cv_.Wait();
+  }
+  manifest_writing_ = true;
+  Status s = versions_->LogAndApply(edit, &mutex_);
+  manifest_writing_ = false;
+  bg_cv_.SignalAll();
+  return s;
+}
+
+bool DBImpl::HasBackgroundWork() {
+  mutex_.AssertHeld();
+  if (imm_ != NULL && !imm_compacting_) {
+    return true;
+  }
+  if (manual_compaction_ != NULL && !manual_compaction_->running &&
+      versions_->LevelsFree(manual_compaction_->level)) {
+    return true;
+  }
+  return versions_->NeedsCompaction();
+}
+
 void DBImpl::MaybeScheduleCompaction() {
   mutex_.AssertHeld();
-  if (bg_compaction_scheduled_) {
-    // Already scheduled
+  if (bg_compactions_pending_ > 0) {
+    // Already scheduled; it will schedule more once it has picked its work
+  } else if (bg_compactions_scheduled_ >= options_.max_background_compactions) {
+    // All background compactions are busy
   } else if (shutting_down_.Acquire_Load()) {
     // DB is being deleted; no more background compactions
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
-  } else if (imm_ == NULL &&
-             manual_compaction_ == NULL &&
-             !versions_->NeedsCompaction()) {
+  } else if (!HasBackgroundWork()) {
     // No work to be done
   } else {
-    bg_compaction_scheduled_ = true;
+    bg_compactions_scheduled_++;
+    bg_compactions_pending_++;
     env_->Schedule(&DBImpl::BGWork, this);
   }
 }
@@ -635,7 +694,9 @@ void DBImpl::BGWork(void* db) {
 
 void DBImpl::BackgroundCall() {
   MutexLock l(&mutex_);
-  assert(bg_compaction_scheduled_);
+  assert(bg_compactions_scheduled_ > 0);
+  assert(bg_compactions_pending_ > 0);
+  bg_compactions_pending_--;
   if (shutting_down_.Acquire_Load()) {
     // No more background work when shutting down.
   } else if (!bg_error_.ok()) {
@@ -644,7 +705,7 @@ void DBImpl::BackgroundCall() {
     BackgroundCompaction();
   }
 
-  bg_compaction_scheduled_ = false;
+  bg_compactions_scheduled_--;
 
   // Previous compaction may have produced too many files in a level,
   // so reschedule another compaction if needed.
@@ -655,19 +716,22 @@ void DBImpl::BackgroundCall() {
 void DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
-  if (imm_ != NULL) {
+  if (imm_ != NULL && !imm_compacting_) {
     CompactMemTable();
     return;
   }
 
   Compaction* c;
-  bool is_manual = (manual_compaction_ != NULL);
+  ManualCompaction* m = manual_compaction_;
+  bool is_manual = (m != NULL && !m->running &&
+                    versions_->LevelsFree(m->level));
   InternalKey manual_end;
   if (is_manual) {
-    ManualCompaction* m = manual_compaction_;
+    m->running = true;
     c = versions_->CompactRange(m->level, m->begin, m->end);
     m->done = (c == NULL);
     if (c != NULL) {
+      versions_->ReserveLevels(c);
       manual_end = c->input(0, c->num_input_files(0) - 1)->largest;
     }
     Log(options_.info_log,
@@ -680,6 +744,10 @@ void DBImpl::BackgroundCompaction() {
     c = versions_->PickCompaction();
   }
 
+  // The levels of c are reserved now; let another thread take whatever
+  // other work is left.
+  MaybeScheduleCompaction();
+
   Status status;
   if (c == NULL) {
     // Nothing to do
@@ -690,7 +758,7 @@ void DBImpl::BackgroundCompaction() {
     c->edit()->DeleteFile(c->level(), f->number);
     c->edit()->AddFile(c->level() + 1, f->number, f->file_size,
                        f->smallest, f->largest);
-    status = versions_->LogAndApply(c->edit(), &mutex_);
+    status = LogAndApply(c->edit());
     if (!status.ok()) {
       RecordBackgroundError(status);
     }
@@ -701,6 +769,7 @@ void DBImpl::BackgroundCompaction() {
         static_cast<unsigned long long>(f->file_size),
         status.ToString().c_str(),
         versions_->LevelSummary(&tmp));
+    versions_->ReleaseLevels(c);
   } else {
     CompactionState* compact = new CompactionState(c);
     status = DoCompactionWork(compact);
@@ -709,6 +778,7 @@ void DBImpl::BackgroundCompaction() {
     }
     CleanupCompaction(compact);
     c->ReleaseInputs();
+    versions_->ReleaseLevels(c);
     DeleteObsoleteFiles();
   }
   delete c;
@@ -723,7 +793,7 @@ void DBImpl::BackgroundCompaction() {
   }
 
   if (is_manual) {
-    ManualCompaction* m = manual_compaction_;
+    m->running = false;
     if (!status.ok()) {
       m->done = true;
     }
@@ -849,7 +919,96 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
         level + 1,
         out.number, out.file_size, out.smallest, out.largest);
   }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  return LogAndApply(compact->compaction->edit());
+}
+
+void DBImpl::GenSubcompactionBoundaries(Compaction* c,
+                                        std::vector<std::string>* bounds) {
+  // Files in "level+1" do not overlap, so their largest keys cut the key
+  // space into ranges of known size.  Only worth it for several files.
+  const int n = options_.max_subcompactions;
+  const int files = c->num_input_files(1);
+  if (n <= 1 || files < 2) {
+    return;
+  }
+
+  const int64_t total = c->NextLevelInputBytes();
+  int64_t sum = 0;
+  for (int i = 0; i + 1 < files && bounds->size() + 1 < size_t(n); i++) {
+    sum += c->input(1, i)->file_size;
+    if (sum * n < total * int64_t(bounds->size() + 1)) {
+      continue;
+    }
+    Slice key = c->input(1, i)->largest.user_key();
+    if (bounds->empty() ||
+        user_comparator()->Compare(key, Slice(bounds->back())) > 0) {
+      bounds->push_back(key.ToString());
+    }
+  }
+}
+
+// The key ranges of one compaction after the first.  Each range is also
+// posted to the background pool, but the compacting thread merges every
+// range the pool has not started by the time its own range is done, so
+// the compaction never waits for a free pool thread.  Pool items that
+// arrive late find nothing left; the last reference frees the group.
+struct DBImpl::SubcompactionGroup {
+  SubcompactionGroup(DBImpl* db, const std::vector<CompactionState*>& ranges)
+      : db(db), ranges(ranges), cv(&mu), next(0), running(0),
+        refs(static_cast<int>(ranges.size()) + 1) {
+  }
+
+  // Merge the next range nobody has taken yet.  Returns false if none.
+  bool RunNext() {
+    mu.Lock();
+    if (next == ranges.size()) {
+      mu.Unlock();
+      return false;
+    }
+    CompactionState* compact = ranges[next++];
+    running++;
+    mu.Unlock();
+
+    compact->status = db->ProcessKeyRange(compact, NULL);
+
+    mu.Lock();
+    running--;
+    cv.SignalAll();
+    mu.Unlock();
+    return true;
+  }
+
+  // Wait until every range taken by a pool thread is merged.
+  void Wait() {
+    mu.Lock();
+    while (running > 0) {
+      cv.Wait();
+    }
+    mu.Unlock();
+  }
+
+  void Unref() {
+    mu.Lock();
+    const bool last = (--refs == 0);
+    mu.Unlock();
+    if (last) {
+      delete this;
+    }
+  }
+
+  DBImpl* const db;
+  const std::vector<CompactionState*> ranges;
+  port::Mutex mu;
+  port::CondVar cv;
+  size_t next;
+  int running;
+  int refs;
+};
+
+void DBImpl::SubcompactionWork(void* group) {
+  SubcompactionGroup* g = reinterpret_cast<SubcompactionGroup*>(group);
+  g->RunNext();
+  g->Unref();
 }
 
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
@@ -871,11 +1030,100 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     compact->smallest_snapshot = snapshots_.oldest()->number_;
   }
 
+  // The first key range is merged here, the others on background threads.
+  std::vector<std::string> bounds;
+  GenSubcompactionBoundaries(compact->compaction, &bounds);
+  std::vector<CompactionState*> subs;
+  for (size_t i = 0; i < bounds.size(); i++) {
+    CompactionState* sub = new CompactionState(compact->compaction);
+    sub->smallest_snapshot = compact->smallest_snapshot;
+    sub->has_start = true;
+    sub->start = bounds[i];
+    if (i + 1 < bounds.size()) {
+      sub->has_end = true;
+      sub->end = bounds[i + 1];
+    }
+    subs.push_back(sub);
+  }
+  if (!bounds.empty()) {
+    compact->has_end = true;
+    compact->end = bounds[0];
+    Log(options_.info_log, "Compacting in %d subcompactions",
+        static_cast<int>(bounds.size() + 1));
+  }
+
+  SubcompactionGroup* group = NULL;
+  if (!subs.empty()) {
+    group = new SubcompactionGroup(this, subs);
+    for (size_t i = 0; i < subs.size(); i++) {
+      env_->Schedule(&DBImpl::SubcompactionWork, group);
+    }
+  }
+
   // Release mutex while we're actually doing the compaction work
   mutex_.Unlock();
+  Status status = ProcessKeyRange(compact, &imm_micros);
+  if (group != NULL) {
+    while (group->RunNext()) {
+    }
+    group->Wait();
+    group->Unref();
+  }
+  mutex_.Lock();
+
+  for (size_t i = 0; i < subs.size(); i++) {
+    CompactionState* sub = subs[i];
+    if (status.ok()) {
+      status = sub->status;
+    }
+    // Keep the outputs in key order; CleanupCompaction() releases them.
+    compact->outputs.insert(compact->outputs.end(),
+                            sub->outputs.begin(), sub->outputs.end());
+    compact->total_bytes += sub->total_bytes;
+    sub->outputs.clear();
+    CleanupCompaction(sub);
+  }
+
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros - imm_micros;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+    }
+  }
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    stats.bytes_written += compact->outputs[i].file_size;
+  }
 
+  stats_[compact->compaction->level() + 1].Add(stats);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  if (!status.ok()) {
+    RecordBackgroundError(status);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log,
+      "compacted to: %s", versions_->LevelSummary(&tmp));
+  return status;
+}
+
+Status DBImpl::ProcessKeyRange(CompactionState* compact,
+                               int64_t* imm_micros) {
   Iterator* input = versions_->MakeInputIterator(compact->compaction);
-  input->SeekToFirst();
+  if (compact->has_start) {
+    // Position after every entry for the user key "start"
+    InternalKey seek(compact->start, 0, static_cast<ValueType>(0));
+    input->Seek(seek.Encode());
+    while (input->Valid() && input->key().size() >= 8 &&
+           user_comparator()->Compare(ExtractUserKey(input->key()),
+                                      Slice(compact->start)) == 0) {
+      input->Next();
+    }
+  } else {
+    input->SeekToFirst();
+  }
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
@@ -883,19 +1131,26 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
   for (; input->Valid() && !shutting_down_.Acquire_Load(); ) {
     // Prioritize immutable compaction work
-    if (has_imm_.NoBarrier_Load() != NULL) {
+    if (imm_micros != NULL && has_imm_.NoBarrier_Load() != NULL) {
       const uint64_t imm_start = env_->NowMicros();
       mutex_.Lock();
-      if (imm_ != NULL) {
+      if (imm_ != NULL && !imm_compacting_) {
         CompactMemTable();
         bg_cv_.SignalAll();  // Wakeup MakeRoomForWrite() if necessary
       }
       mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
+      *imm_micros += (env_->NowMicros() - imm_start);
     }
 
     Slice key = input->key();
-    if (compact->compaction->ShouldStopBefore(key) &&
+    if (compact->has_end && key.size() >= 8 &&
+        user_comparator()->Compare(ExtractUserKey(key),
+                                   Slice(compact->end)) > 0) {
+      // Past the end of this key range
+      break;
+    }
+
+    if (compact->compaction->ShouldStopBefore(key, &compact->scan) &&
         compact->builder != NULL) {
       status = FinishCompactionOutputFile(compact, input);
       if (!status.ok()) {
@@ -925,7 +1180,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         drop = true;    // (A)
       } else if (ikey.type == kTypeDeletion &&
                  ikey.sequence <= compact->smallest_snapshot &&
-                 compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+                 compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                                        &compact->scan)) {
         // For this user key:
         // (1) there is no data in higher levels
         // (2) data in lower levels will have larger sequence numbers
@@ -938,15 +1194,6 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
 
       last_sequence_for_key = ikey.sequence;
     }
-#if 0
-    Log(options_.info_log,
-        "  Compact: %s, seq %d, type: %d %d, drop: %d, is_base: %d, "
-        "%d smallest_snapshot: %d",
-        ikey.user_key.ToString().c_str(),
-        (int)ikey.sequence, ikey.type, kTypeValue, drop,
-        compact->compaction->IsBaseLevelForKey(ikey.user_key),
-        (int)last_sequence_for_key, (int)compact->smallest_snapshot);
-#endif
 
     if (!drop) {
       // Open output file if necessary
@@ -985,31 +1232,6 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     status = input->status();
   }
   delete input;
-  input = NULL;
-
-  CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
-    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
-      stats.bytes_read += compact->compaction->input(which, i)->file_size;
-    }
-  }
-  for (size_t i = 0; i < compact->outputs.size(); i++) {
-    stats.bytes_written += compact->outputs[i].file_size;
-  }
-
-  mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
-
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
-  }
-  if (!status.ok()) {
-    RecordBackgroundError(status);
-  }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log,
-      "compacted to: %s", versions_->LevelSummary(&tmp));
   return status;
 }
 
@@ -7,6 +7,8 @@
 
 #include <deque>
 #include <set>
+#include <string>
+#include <vector>
 #include "db/dbformat.h"
 #include "db/log_writer.h"
 #include "db/snapshot.h"
@@ -17,6 +19,7 @@
 
 namespace leveldb {
 
+class Compaction;
 class MemTable;
 class TableCache;
 class Version;
@@ -104,6 +107,10 @@ class DBImpl : public DB {
 
   void RecordBackgroundError(const Status& s);
 
+  // Apply *edit through versions_->LogAndApply(), one caller at a time.
+  Status LogAndApply(VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  bool HasBackgroundWork() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
   void BackgroundCall();
@@ -113,6 +120,17 @@ class DBImpl : public DB {
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Split the inputs of *c into key ranges for parallel subcompactions.
+  // Appends the user keys that separate the ranges to *bounds.
+  void GenSubcompactionBoundaries(Compaction* c,
+                                  std::vector<std::string>* bounds);
+  struct SubcompactionGroup;
+  static void SubcompactionWork(void* group);
+
+  // Merge the part of the compaction inputs that falls in the key range
+  // of *compact.  imm_ is flushed on the way iff imm_micros is non-NULL.
+  Status ProcessKeyRange(CompactionState* compact, int64_t* imm_micros);
+
   Status OpenCompactionOutputFile(CompactionState* compact);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
   Status InstallCompactionResults(CompactionState* compact)
@@ -155,13 +173,22 @@ class DBImpl : public DB {
   // part of ongoing compactions.
   std::set<uint64_t> pending_outputs_;
 
-  // Has a background compaction been scheduled or is running?
-  bool bg_compaction_scheduled_;
+  // Number of background compactions scheduled or running, and how many
+  // of those have not yet picked their work.
+  int bg_compactions_scheduled_;
+  int bg_compactions_pending_;
+
+  // Is imm_ being written out by a background thread?
+  bool imm_compacting_;
+
+  // Is a LogAndApply() writing to the MANIFEST?
+  bool manifest_writing_;
 
   // Information for a manual compaction
   struct ManualCompaction {
     int level;
     bool done;
+    bool running;               // Picked up by a background thread
     const InternalKey* begin;   // NULL means beginning of key range
     const InternalKey* end;     // NULL means end of key range
     InternalKey tmp_storage;    // Used to keep track of compaction progress
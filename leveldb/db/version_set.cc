@@ -781,6 +781,9 @@ VersionSet::VersionSet(const std::string& dbname,
       descriptor_log_(NULL),
       dummy_versions_(this),
       current_(NULL) {
+  for (int i = 0; i < config::kNumLevels; i++) {
+    level_busy_[i] = false;
+  }
   AppendVersion(new Version(this));
 }
 
@@ -1041,6 +1044,7 @@ void VersionSet::Finalize(Version* v) {
       score = static_cast<double>(level_bytes) / MaxBytesForLevel(level);
     }
 
+    v->compaction_scores_[level] = score;
     if (score > best_score) {
       best_level = level;
       best_score = score;
@@ -1240,17 +1244,52 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   return result;
 }
 
+int VersionSet::PickLevel(bool* seek) const {
+  // We prefer compactions triggered by too much data in a level over
+  // the compactions triggered by seeks.
+  int level = -1;
+  // A level needs compaction once its score reaches 1; ties go to the
+  // shallower level, as in Finalize().
+  double best_score = 0;
+  for (int i = 0; i < config::kNumLevels - 1; i++) {
+    const double score = current_->compaction_scores_[i];
+    if (score >= 1 && score > best_score && LevelsFree(i)) {
+      level = i;
+      best_score = score;
+    }
+  }
+  if (level < 0 && current_->file_to_compact_ != NULL &&
+      LevelsFree(current_->file_to_compact_level_)) {
+    level = current_->file_to_compact_level_;
+    if (seek != NULL) *seek = true;
+  }
+  return level;
+}
+
+void VersionSet::ReserveLevels(Compaction* c) {
+  assert(LevelsFree(c->level()));
+  assert(!c->reserved_);
+  level_busy_[c->level()] = true;
+  level_busy_[c->level() + 1] = true;
+  c->reserved_ = true;
+}
+
+void VersionSet::ReleaseLevels(Compaction* c) {
+  if (c->reserved_) {
+    level_busy_[c->level()] = false;
+    level_busy_[c->level() + 1] = false;
+    c->reserved_ = false;
+  }
+}
+
 Compaction* VersionSet::PickCompaction() {
   Compaction* c;
-  int level;
+  bool seek_compaction = false;
+  const int level = PickLevel(&seek_compaction);
 
-  // We prefer compactions triggered by too much data in a level over
-  // the compactions triggered by seeks.
-  const bool size_compaction = (current_->compaction_score_ >= 1);
-  const bool seek_compaction = (current_->file_to_compact_ != NULL);
-  if (size_compaction) {
-    level = current_->compaction_level_;
-    assert(level >= 0);
+  if (level < 0) {
+    return NULL;
+  } else if (!seek_compaction) {
     assert(level+1 < config::kNumLevels);
     c = new Compaction(level);
 
@@ -1267,12 +1306,9 @@ Compaction* VersionSet::PickCompaction() {
       // Wrap-around to the beginning of the key space
       c->inputs_[0].push_back(current_->files_[level][0]);
     }
-  } else if (seek_compaction) {
-    level = current_->file_to_compact_level_;
+  } else {
     c = new Compaction(level);
     c->inputs_[0].push_back(current_->file_to_compact_);
-  } else {
-    return NULL;
   }
 
   c->input_version_ = current_;
@@ -1290,6 +1326,7 @@ Compaction* VersionSet::PickCompaction() {
   }
 
   SetupOtherInputs(c);
+  ReserveLevels(c);
 
   return c;
 }
@@ -1400,15 +1437,20 @@ Compaction::Compaction(int level)
     : level_(level),
       max_output_file_size_(MaxFileSizeForLevel(level)),
       input_version_(NULL),
-      grandparent_index_(0),
-      seen_key_(false),
-      overlapped_bytes_(0) {
+      reserved_(false) {
+}
+
+Compaction::ScanState::ScanState()
+    : grandparent_index(0),
+      seen_key(false),
+      overlapped_bytes(0) {
   for (int i = 0; i < config::kNumLevels; i++) {
-    level_ptrs_[i] = 0;
+    level_ptrs[i] = 0;
   }
 }
 
 Compaction::~Compaction() {
+  assert(!reserved_);
   if (input_version_ != NULL) {
     input_version_->Unref();
   }
@@ -1431,13 +1473,17 @@ void Compaction::AddInputDeletions(VersionEdit* edit) {
   }
 }
 
-bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+int64_t Compaction::NextLevelInputBytes() const {
+  return TotalFileSize(inputs_[1]);
+}
+
+bool Compaction::IsBaseLevelForKey(const Slice& user_key, ScanState* scan) {
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
   for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
     const std::vector<FileMetaData*>& files = input_version_->files_[lvl];
-    for (; level_ptrs_[lvl] < files.size(); ) {
-      FileMetaData* f = files[level_ptrs_[lvl]];
+    for (; scan->level_ptrs[lvl] < files.size(); ) {
+      FileMetaData* f = files[scan->level_ptrs[lvl]];
       if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
         // We've advanced far enough
         if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0) {
@@ -1446,28 +1492,29 @@ bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
         }
         break;
       }
-      level_ptrs_[lvl]++;
+      scan->level_ptrs[lvl]++;
     }
   }
   return true;
 }
 
-bool Compaction::ShouldStopBefore(const Slice& internal_key) {
+bool Compaction::ShouldStopBefore(const Slice& internal_key,
+                                  ScanState* scan) {
   // Scan to find earliest grandparent file that contains key.
   const InternalKeyComparator* icmp = &input_version_->vset_->icmp_;
-  while (grandparent_index_ < grandparents_.size() &&
+  while (scan->grandparent_index < grandparents_.size() &&
       icmp->Compare(internal_key,
-                    grandparents_[grandparent_index_]->largest.Encode()) > 0) {
-    if (seen_key_) {
-      overlapped_bytes_ += grandparents_[grandparent_index_]->file_size;
+                    grandparents_[scan->grandparent_index]->largest.Encode()) > 0) {
+    if (scan->seen_key) {
+      scan->overlapped_bytes += grandparents_[scan->grandparent_index]->file_size;
     }
-    grandparent_index_++;
+    scan->grandparent_index++;
   }
-  seen_key_ = true;
+  scan->seen_key = true;
 
-  if (overlapped_bytes_ > kMaxGrandParentOverlapBytes) {
+  if (scan->overlapped_bytes > kMaxGrandParentOverlapBytes) {
     // Too much overlap for current output; start new output
-    overlapped_bytes_ = 0;
+    scan->overlapped_bytes = 0;
     return true;
   } else {
     return false;
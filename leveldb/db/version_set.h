@@ -147,12 +147,19 @@ class Version {
   double compaction_score_;
   int compaction_level_;
 
+  // Compaction score of every level, so that a level other than the best
+  // one can be picked while the best one is busy.
+  double compaction_scores_[config::kNumLevels];
+
   explicit Version(VersionSet* vset)
       : vset_(vset), next_(this), prev_(this), refs_(0),
         file_to_compact_(NULL),
         file_to_compact_level_(-1),
         compaction_score_(-1),
         compaction_level_(-1) {
+    for (int i = 0; i < config::kNumLevels; i++) {
+      compaction_scores_[i] = -1;
+    }
   }
 
   ~Version();
@@ -174,7 +181,8 @@ class VersionSet {
   // is both saved to persistent state and installed as the new
   // current version.  Will release *mu while actually writing to the file.
   // REQUIRES: *mu is held on entry.
-  // REQUIRES: no other thread concurrently calls LogAndApply()
+  // REQUIRES: no other thread concurrently calls LogAndApply().  Callers
+  // that may run concurrently must serialize themselves.
   Status LogAndApply(VersionEdit* edit, port::Mutex* mu)
       EXCLUSIVE_LOCKS_REQUIRED(mu);
 
@@ -224,12 +232,23 @@ class VersionSet {
   // being compacted, or zero if there is no such log file.
   uint64_t PrevLogNumber() const { return prev_log_number_; }
 
-  // Pick level and inputs for a new compaction.
+  // Pick level and inputs for a new compaction.  Levels that are in use
+  // by a running compaction are skipped.
   // Returns NULL if there is no compaction to be done.
   // Otherwise returns a pointer to a heap-allocated object that
-  // describes the compaction.  Caller should delete the result.
+  // describes the compaction and reserves its levels.  Caller should
+  // call ReleaseLevels() when it is done and then delete the result.
   Compaction* PickCompaction();
 
+  // Reserve or release "level" and "level+1" of *c for a running
+  // compaction.  A level takes part in at most one compaction at a time,
+  // which keeps concurrent compactions from touching the same files.
+  bool LevelsFree(int level) const {
+    return !level_busy_[level] && !level_busy_[level + 1];
+  }
+  void ReserveLevels(Compaction* c);
+  void ReleaseLevels(Compaction* c);
+
   // Return a compaction object for compacting the range [begin,end] in
   // the specified level.  Returns NULL if there is nothing in that
   // level that overlaps the specified range.  Caller should delete
@@ -247,10 +266,9 @@ class VersionSet {
   // The caller should delete the iterator when no longer needed.
   Iterator* MakeInputIterator(Compaction* c);
 
-  // Returns true iff some level needs a compaction.
+  // Returns true iff some level that is not busy needs a compaction.
   bool NeedsCompaction() const {
-    Version* v = current_;
-    return (v->compaction_score_ >= 1) || (v->file_to_compact_ != NULL);
+    return PickLevel(NULL) >= 0;
   }
 
   // Add all files listed in any live version to *live.
@@ -276,6 +294,10 @@ class VersionSet {
 
   void Finalize(Version* v);
 
+  // Return the level to compact next, or -1.  *seek is set when the
+  // level was chosen for the seek-triggered file_to_compact_.
+  int PickLevel(bool* seek) const;
+
   void GetRange(const std::vector<FileMetaData*>& inputs,
                 InternalKey* smallest,
                 InternalKey* largest);
@@ -313,6 +335,9 @@ class VersionSet {
   // Either an empty string, or a valid InternalKey.
   std::string compact_pointer_[config::kNumLevels];
 
+  // Levels in use by running compactions.
+  bool level_busy_[config::kNumLevels];
+
   // No copying allowed
   VersionSet(const VersionSet&);
   void operator=(const VersionSet&);
@@ -347,14 +372,35 @@ class Compaction {
   // Add all inputs to this compaction as delete operations to *edit.
   void AddInputDeletions(VersionEdit* edit);
 
+  // Scan position used by IsBaseLevelForKey() and ShouldStopBefore().
+  // Both assume increasing keys, so every subcompaction that scans its
+  // own key range keeps its own ScanState.
+  struct ScanState {
+    size_t grandparent_index;  // Index in grandparent_starts_
+    bool seen_key;             // Some output key has been seen
+    int64_t overlapped_bytes;  // Bytes of overlap between current output
+                               // and grandparent files
+
+    // level_ptrs holds indices into input_version_->levels_: our state
+    // is that we are positioned at one of the file ranges for each
+    // higher level than the ones involved in this compaction (i.e. for
+    // all L >= level_ + 2).
+    size_t level_ptrs[config::kNumLevels];
+
+    ScanState();
+  };
+
   // Returns true if the information we have available guarantees that
   // the compaction is producing data in "level+1" for which no data exists
   // in levels greater than "level+1".
-  bool IsBaseLevelForKey(const Slice& user_key);
+  bool IsBaseLevelForKey(const Slice& user_key, ScanState* scan);
 
   // Returns true iff we should stop building the current output
   // before processing "internal_key".
-  bool ShouldStopBefore(const Slice& internal_key);
+  bool ShouldStopBefore(const Slice& internal_key, ScanState* scan);
+
+  // Total bytes of the "level+1" inputs.
+  int64_t NextLevelInputBytes() const;
 
   // Release the input version for the compaction, once the compaction
   // is successful.
@@ -374,21 +420,12 @@ class Compaction {
   // Each compaction reads inputs from "level_" and "level_+1"
   std::vector<FileMetaData*> inputs_[2];      // The two sets of inputs
 
-  // State used to check for number of of overlapping grandparent files
-  // (parent == level_ + 1, grandparent == level_ + 2)
+  // Grandparent files used to check for number of of overlapping
+  // grandparent files (parent == level_ + 1, grandparent == level_ + 2)
   std::vector<FileMetaData*> grandparents_;
-  size_t grandparent_index_;  // Index in grandparent_starts_
-  bool seen_key_;             // Some output key has been seen
-  int64_t overlapped_bytes_;  // Bytes of overlap between current output
-                              // and grandparent files
-
-  // State for implementing IsBaseLevelForKey
-
-  // level_ptrs_ holds indices into input_version_->levels_: our state
-  // is that we are positioned at one of the file ranges for each
-  // higher level than the ones involved in this compaction (i.e. for
-  // all L >= level_ + 2).
-  size_t level_ptrs_[config::kNumLevels];
+
+  // Whether ReserveLevels() has been called for this compaction
+  bool reserved_;
 };
 
 }  // namespace leveldb
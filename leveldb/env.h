@@ -125,6 +125,11 @@ class Env {
       void (*function)(void* arg),
       void* arg) = 0;
 
+  // Allow at least "number" work items passed to Schedule() to run at
+  // the same time.  Never reduces the number.  The default
+  // implementation does nothing.
+  virtual void SetBackgroundThreads(int number) { }
+
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
@@ -309,6 +314,9 @@ class EnvWrapper : public Env {
   void Schedule(void (*f)(void*), void* a) {
     return target_->Schedule(f, a);
   }
+  void SetBackgroundThreads(int n) {
+    return target_->SetBackgroundThreads(n);
+  }
   void StartThread(void (*f)(void*), void* a) {
     return target_->StartThread(f, a);
   }
@@ -135,6 +135,24 @@ struct Options {
   // Default: NULL
   const FilterPolicy* filter_policy;
 
+  // Maximum number of compactions that may run at the same time.  Two
+  // compactions run concurrently only if they touch disjoint levels.
+  // Background threads are taken from env->Schedule(), which is asked
+  // to run at least this many work items at once.
+  //
+  // Default: 1
+  int max_background_compactions;
+
+  // A large compaction is split into up to this many key ranges that
+  // are merged in parallel, each into its own output files.  The extra
+  // ranges are handed to env->Schedule(), which is asked for
+  // max_background_compactions * max_subcompactions threads in total;
+  // any range no thread has picked up yet is merged by the compaction's
+  // own thread, so this only helps when there are spare cores.
+  //
+  // Default: 1
+  int max_subcompactions;
+
   // Create an Options object with default values for all fields.
   Options();
 };
@@ -7,6 +7,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <assert.h>
 #include <utils.h>
 #include <thread.h>
 #include <snappy.h>
@@ -16,7 +17,9 @@ namespace leveldb
 namespace port
 {
 
-#if defined(arm) || defined(arm64)
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+static const bool kLittleEndian = (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+#elif defined(_WIN32) || defined(I386) || defined(x64) || defined(arm) || defined(arm64)
 static const bool kLittleEndian = true;
 #else
 static const bool kLittleEndian = false;
@@ -31,8 +34,65 @@ static const bool kLittleEndian = false;
 #define fdatasync fsync
 #endif
 
-typedef exlib::OSMutex Mutex;
-typedef exlib::OSCondVar CondVar;
+class CondVar;
+
+// Mutex and CondVar park the calling fiber instead of blocking the worker
+// thread it runs on. Callers must be exlib fibers or OSThreads.
+class Mutex
+{
+public:
+    Mutex() : mu_(false)
+    {}
+
+    void Lock()
+    {
+        mu_.lock();
+    }
+
+    void Unlock()
+    {
+        mu_.unlock();
+    }
+
+    void AssertHeld()
+    {
+        assert(mu_.owned());
+    }
+
+private:
+    friend class CondVar;
+    exlib::Locker mu_;
+
+    // No copying
+    Mutex(const Mutex&);
+    void operator=(const Mutex&);
+};
+
+class CondVar
+{
+public:
+    explicit CondVar(Mutex *mu) : mu_(mu)
+    {}
+
+    void Wait()
+    {
+        cv_.wait(mu_->mu_);
+    }
+
+    void Signal()
+    {
+        cv_.notify_one();
+    }
+
+    void SignalAll()
+    {
+        cv_.notify_all();
+    }
+
+private:
+    Mutex *mu_;
+    exlib::CondVar cv_;
+};
 
 typedef intptr_t OnceType;
 #define LEVELDB_ONCE_INIT 0
@@ -79,6 +139,24 @@ inline bool Snappy_Compress(const char *input, size_t length,
     return true;
 }
 
+// Keeps the snappy hash table and scratch space between calls, so that
+// compressing a stream of blocks does not allocate.
+typedef snappy::Compressor SnappyCompressor;
+
+inline size_t Snappy_MaxCompressedLength(size_t length)
+{
+    return snappy::MaxCompressedLength(length);
+}
+
+// "output" must have room for Snappy_MaxCompressedLength(length) bytes.
+inline bool Snappy_Compress(SnappyCompressor *compressor,
+                            const char *input, size_t length,
+                            char *output, size_t *outlen)
+{
+    compressor->RawCompress(input, length, output, outlen);
+    return true;
+}
+
 inline bool Snappy_GetUncompressedLength(const char *input, size_t length,
         size_t *result)
 {
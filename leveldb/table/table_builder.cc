@@ -42,6 +42,9 @@ struct TableBuilder::Rep {
   bool pending_index_entry;
   BlockHandle pending_handle;  // Handle to add to index block
 
+  // Reused for every block; compressed_output only ever grows, so that
+  // compressing a block does not allocate.
+  port::SnappyCompressor compressor;
   std::string compressed_output;
 
   Rep(const Options& opt, WritableFile* f)
@@ -155,9 +158,15 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
 
     case kSnappyCompression: {
       std::string* compressed = &r->compressed_output;
-      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size() - (raw.size() / 8u)) {
-        block_contents = *compressed;
+      const size_t max_length = port::Snappy_MaxCompressedLength(raw.size());
+      if (compressed->size() < max_length) {
+        compressed->resize(max_length);
+      }
+      size_t length;
+      if (port::Snappy_Compress(&r->compressor, raw.data(), raw.size(),
+                                &(*compressed)[0], &length) &&
+          length < raw.size() - (raw.size() / 8u)) {
+        block_contents = Slice(compressed->data(), length);
       } else {
         // Snappy not supported, or compressed less than 12.5%, so just
         // store uncompressed form
@@ -168,7 +177,6 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
     }
   }
   WriteRawBlock(block_contents, type, handle);
-  r->compressed_output.clear();
   block->Reset();
 }
 
@@ -3,13 +3,42 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 //
 // A portable implementation of crc32c, optimized to handle
-// four bytes at a time.
+// four bytes at a time, and kernels for the crc32c instructions of
+// SSE4.2 and ARMv8 that are picked at run time.
 
 #include "util/crc32c.h"
 
 #include <stdint.h>
 #include "util/coding.h"
 
+#if defined(I386) || defined(x64)
+#define CRC32C_SSE42
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC32C_TARGET_SSE42
+#else
+#include <cpuid.h>
+#define CRC32C_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#include <nmmintrin.h>
+#elif defined(arm64) && (defined(Linux) || defined(MacOS)) && !defined(_MSC_VER)
+#define CRC32C_ARM64
+#include <arm_acle.h>
+#ifdef Linux
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#ifdef __ARM_FEATURE_CRC32
+#define CRC32C_TARGET_ARM64
+#elif defined(__clang__)
+#define CRC32C_TARGET_ARM64 __attribute__((target("crc")))
+#else
+#define CRC32C_TARGET_ARM64 __attribute__((target("+crc")))
+#endif
+#endif
+
 namespace leveldb {
 namespace crc32c {
 
@@ -283,7 +312,7 @@ static inline uint32_t LE_LOAD32(const uint8_t *p) {
   return DecodeFixed32(reinterpret_cast<const char*>(p));
 }
 
-uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
+static uint32_t ExtendPortable(uint32_t crc, const char* buf, size_t size) {
   const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
   const uint8_t *e = p + size;
   uint32_t l = crc ^ 0xffffffffu;
@@ -328,5 +357,132 @@ uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
   return l ^ 0xffffffffu;
 }
 
+#ifdef CRC32C_SSE42
+
+static bool CanUseSSE42() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return (ecx & bit_SSE4_2) != 0;
+#endif
+}
+
+CRC32C_TARGET_SSE42
+static uint32_t ExtendSSE42(uint32_t crc, const char* buf, size_t size) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
+  const uint8_t *e = p + size;
+  uint32_t l = crc ^ 0xffffffffu;
+
+  // Process bytes until p is 8-byte aligned
+  while (p != e && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    l = _mm_crc32_u8(l, *p++);
+  }
+#ifdef x64
+  // Process bytes 8 at a time
+  uint64_t l64 = l;
+  while ((e-p) >= 8) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    l64 = _mm_crc32_u64(l64, v);
+    p += 8;
+  }
+  l = static_cast<uint32_t>(l64);
+#endif
+  // Process bytes 4 at a time
+  while ((e-p) >= 4) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    l = _mm_crc32_u32(l, v);
+    p += 4;
+  }
+  // Process the last few bytes
+  while (p != e) {
+    l = _mm_crc32_u8(l, *p++);
+  }
+  return l ^ 0xffffffffu;
+}
+
+#endif  // CRC32C_SSE42
+
+#ifdef CRC32C_ARM64
+
+static bool CanUseARM64() {
+#ifdef Linux
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+  // Every 64-bit Apple CPU has the CRC32 extension.
+  return true;
+#endif
+}
+
+CRC32C_TARGET_ARM64
+static uint32_t ExtendARM64(uint32_t crc, const char* buf, size_t size) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
+  const uint8_t *e = p + size;
+  uint32_t l = crc ^ 0xffffffffu;
+
+  // Process bytes until p is 8-byte aligned
+  while (p != e && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    l = __crc32cb(l, *p++);
+  }
+  // Process bytes 8 at a time
+  while ((e-p) >= 8) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    l = __crc32cd(l, v);
+    p += 8;
+  }
+  // Process the last few bytes
+  while (p != e) {
+    l = __crc32cb(l, *p++);
+  }
+  return l ^ 0xffffffffu;
+}
+
+#endif  // CRC32C_ARM64
+
+typedef uint32_t (*ExtendFunction)(uint32_t crc, const char* buf, size_t size);
+
+static ExtendFunction extend_function = NULL;
+static port::OnceType extend_once = LEVELDB_ONCE_INIT;
+
+static void PickExtendFunction() {
+  ExtendFunction f = ExtendPortable;
+#ifdef CRC32C_SSE42
+  if (CanUseSSE42()) {
+    f = ExtendSSE42;
+  }
+#endif
+#ifdef CRC32C_ARM64
+  if (CanUseARM64()) {
+    f = ExtendARM64;
+  }
+#endif
+
+  // Check the hardware kernel against the table driven one before
+  // trusting it with on-disk checksums.
+  static const char kCheck[] = "123456789 crc32c kernel self test";
+  if (f(0, kCheck, sizeof(kCheck) - 1) !=
+      ExtendPortable(0, kCheck, sizeof(kCheck) - 1)) {
+    f = ExtendPortable;
+  }
+  extend_function = f;
+}
+
+uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
+  ExtendFunction f = extend_function;
+  if (f == NULL) {
+    port::InitOnce(&extend_once, PickExtendFunction);
+    f = extend_function;
+  }
+  return f(crc, buf, size);
+}
+
 }  // namespace crc32c
 }  // namespace leveldb
@@ -3,7 +3,6 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
-#include <deque>
 #include <set>
 #include <dirent.h>
 #include <errno.h>
@@ -16,6 +15,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 #if defined(LEVELDB_PLATFORM_ANDROID)
@@ -27,6 +27,8 @@
 #include "util/logging.h"
 #include "util/mutexlock.h"
 #include "util/posix_logger.h"
+#include <pool.h>
+#include <service.h>
 
 namespace leveldb {
 
@@ -36,37 +38,114 @@ static Status IOError(const std::string& context, int err_number) {
   return Status::IOError(context, strerror(err_number));
 }
 
+// Threads that run blocking file calls on behalf of fibers.
+static const int kIOThreads = 4;
+static exlib::ThreadPool io_pool(kIOThreads);
+
+// Appends at least this large may stall on writeback and go to io_pool;
+// smaller ones only copy into the stdio buffer.
+static const size_t kOffloadBytes = 64 * 1024;
+
+// Runs a file operation. Only a call that may block and comes from a
+// fiber is handed to io_pool, where only the fiber waits; everything
+// else runs inline on the caller.
+template <class T>
+class FileCall : public exlib::AsyncTask {
+ public:
+  virtual void invoke() { status_ = static_cast<T*>(this)->Run(); }
+
+  Status Call(bool may_block = true) {
+    if (!may_block || !exlib::ThreadPool::on_fiber()) {
+      return static_cast<T*>(this)->Run();
+    }
+    io_pool.call(this);
+    return status_;
+  }
+
+ private:
+  Status status_;
+};
+
+// Copies what of [offset, offset+n) is already in the page cache without
+// blocking; offset -1 reads at the file position. Returns the byte count,
+// 0 when the data has to come from disk or RWF_NOWAIT is unsupported.
+static size_t ReadCached(int fd, off_t offset, size_t n, char* scratch) {
+#if defined(RWF_NOWAIT)
+  if (!exlib::ThreadPool::on_fiber()) {
+    return 0;
+  }
+  struct iovec iov;
+  iov.iov_base = scratch;
+  iov.iov_len = n;
+  ssize_t r = preadv2(fd, &iov, 1, offset, RWF_NOWAIT);
+  return (r > 0) ? r : 0;
+#else
+  return 0;
+#endif
+}
+
 class PosixSequentialFile: public SequentialFile {
  private:
   std::string filename_;
-  FILE* file_;
+  int fd_;
 
  public:
-  PosixSequentialFile(const std::string& fname, FILE* f)
-      : filename_(fname), file_(f) { }
-  virtual ~PosixSequentialFile() { fclose(file_); }
+  PosixSequentialFile(const std::string& fname, int fd)
+      : filename_(fname), fd_(fd) { }
+  virtual ~PosixSequentialFile() { close(fd_); }
 
   virtual Status Read(size_t n, Slice* result, char* scratch) {
-    Status s;
-    size_t r = fread_unlocked(scratch, 1, n, file_);
-    *result = Slice(scratch, r);
-    if (r < n) {
-      if (feof(file_)) {
-        // We leave status as ok if we hit the end of the file
-      } else {
-        // A partial read with an error: return a non-ok status
-        s = IOError(filename_, errno);
-      }
+    size_t cached = ReadCached(fd_, -1, n, scratch);
+    if (cached == n) {
+      *result = Slice(scratch, n);
+      return Status::OK();
     }
+    ReadCall call(this, n - cached, result, scratch + cached);
+    Status s = call.Call();
+    *result = Slice(scratch, cached + result->size());
     return s;
   }
 
   virtual Status Skip(uint64_t n) {
-    if (fseek(file_, n, SEEK_CUR)) {
+    if (lseek(fd_, n, SEEK_CUR) == static_cast<off_t>(-1)) {
       return IOError(filename_, errno);
     }
     return Status::OK();
   }
+
+ private:
+  struct ReadCall : public FileCall<ReadCall> {
+    ReadCall(PosixSequentialFile* file, size_t n, Slice* result, char* scratch)
+        : file(file), n(n), result(result), scratch(scratch) { }
+    Status Run() { return file->DoRead(n, result, scratch); }
+    PosixSequentialFile* file;
+    size_t n;
+    Slice* result;
+    char* scratch;
+  };
+
+  Status DoRead(size_t n, Slice* result, char* scratch) {
+    Status s;
+    size_t done = 0;
+    while (done < n) {
+      ssize_t r = read(fd_, scratch + done, n - done);
+      if (r < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        // A partial read with an error: return a non-ok status
+        s = IOError(filename_, errno);
+        break;
+      }
+      if (r == 0) {
+        // We leave status as ok if we hit the end of the file
+        break;
+      }
+      done += r;
+    }
+    *result = Slice(scratch, done);
+    return s;
+  }
 };
 
 // pread() based random-access
@@ -82,6 +161,32 @@ class PosixRandomAccessFile: public RandomAccessFile {
 
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const {
+    size_t cached = ReadCached(fd_, static_cast<off_t>(offset), n, scratch);
+    if (cached == n) {
+      *result = Slice(scratch, n);
+      return Status::OK();
+    }
+    ReadCall call(this, offset + cached, n - cached, result, scratch + cached);
+    Status s = call.Call();
+    *result = Slice(scratch, cached + result->size());
+    return s;
+  }
+
+ private:
+  struct ReadCall : public FileCall<ReadCall> {
+    ReadCall(const PosixRandomAccessFile* file, uint64_t offset, size_t n,
+             Slice* result, char* scratch)
+        : file(file), offset(offset), n(n), result(result), scratch(scratch) { }
+    Status Run() { return file->DoRead(offset, n, result, scratch); }
+    const PosixRandomAccessFile* file;
+    uint64_t offset;
+    size_t n;
+    Slice* result;
+    char* scratch;
+  };
+
+  Status DoRead(uint64_t offset, size_t n, Slice* result,
+                char* scratch) const {
     Status s;
     ssize_t r = pread(fd_, scratch, n, static_cast<off_t>(offset));
     *result = Slice(scratch, (r < 0) ? 0 : r);
@@ -142,7 +247,8 @@ class MmapLimiter {
   void operator=(const MmapLimiter&);
 };
 
-// mmap() based random-access
+// mmap() based random-access. Page faults are taken on the caller; these
+// reads are not routed through io_pool.
 class PosixMmapReadableFile: public RandomAccessFile {
  private:
   std::string filename_;
@@ -193,6 +299,45 @@ class PosixWritableFile : public WritableFile {
   }
 
   virtual Status Append(const Slice& data) {
+    AppendCall call(this, data);
+    return call.Call(data.size() >= kOffloadBytes);
+  }
+
+  virtual Status Close() {
+    MethodCall call(this, &PosixWritableFile::DoClose);
+    return call.Call();
+  }
+
+  // stdio writes out full buffers during Append(), so what is left here
+  // is less than one buffer and is copied into the page cache inline.
+  virtual Status Flush() {
+    MethodCall call(this, &PosixWritableFile::DoFlush);
+    return call.Call(false);
+  }
+
+  virtual Status Sync() {
+    MethodCall call(this, &PosixWritableFile::DoSync);
+    return call.Call();
+  }
+
+ private:
+  struct AppendCall : public FileCall<AppendCall> {
+    AppendCall(PosixWritableFile* file, const Slice& data)
+        : file(file), data(data) { }
+    Status Run() { return file->DoAppend(data); }
+    PosixWritableFile* file;
+    const Slice& data;
+  };
+
+  struct MethodCall : public FileCall<MethodCall> {
+    MethodCall(PosixWritableFile* file, Status (PosixWritableFile::*method)())
+        : file(file), method(method) { }
+    Status Run() { return (file->*method)(); }
+    PosixWritableFile* file;
+    Status (PosixWritableFile::*method)();
+  };
+
+  Status DoAppend(const Slice& data) {
     size_t r = fwrite_unlocked(data.data(), 1, data.size(), file_);
     if (r != data.size()) {
       return IOError(filename_, errno);
@@ -200,7 +345,7 @@ class PosixWritableFile : public WritableFile {
     return Status::OK();
   }
 
-  virtual Status Close() {
+  Status DoClose() {
     Status result;
     if (fclose(file_) != 0) {
       result = IOError(filename_, errno);
@@ -209,7 +354,7 @@ class PosixWritableFile : public WritableFile {
     return result;
   }
 
-  virtual Status Flush() {
+  Status DoFlush() {
     if (fflush_unlocked(file_) != 0) {
       return IOError(filename_, errno);
     }
@@ -243,7 +388,7 @@ class PosixWritableFile : public WritableFile {
     return s;
   }
 
-  virtual Status Sync() {
+  Status DoSync() {
     // Ensure new files referred to by the manifest are in the filesystem.
     Status s = SyncDirIfManifest();
     if (!s.ok()) {
@@ -302,12 +447,12 @@ class PosixEnv : public Env {
 
   virtual Status NewSequentialFile(const std::string& fname,
                                    SequentialFile** result) {
-    FILE* f = fopen(fname.c_str(), "r");
-    if (f == NULL) {
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
       *result = NULL;
       return IOError(fname, errno);
     } else {
-      *result = new PosixSequentialFile(fname, f);
+      *result = new PosixSequentialFile(fname, fd);
       return Status::OK();
     }
   }
@@ -452,6 +597,12 @@ class PosixEnv : public Env {
 
   virtual void Schedule(void (*function)(void*), void* arg);
 
+  virtual void SetBackgroundThreads(int number) {
+    if (number > bg_pool_.max_threads()) {
+      bg_pool_.set_max_threads(number);
+    }
+  }
+
   virtual void StartThread(void (*function)(void* arg), void* arg);
 
   virtual Status GetTestDirectory(std::string* result) {
@@ -493,105 +644,58 @@ class PosixEnv : public Env {
   }
 
   virtual void SleepForMicroseconds(int micros) {
-    usleep(micros);
+    // A write stall on a fiber must not put the whole worker to sleep.
+    if (exlib::ThreadPool::on_fiber()) {
+      exlib::Fiber::sleep((micros + 999) / 1000);
+    } else {
+      usleep(micros);
+    }
   }
 
  private:
-  void PthreadCall(const char* label, int result) {
-    if (result != 0) {
-      fprintf(stderr, "pthread %s: %s\n", label, strerror(result));
-      abort();
+  // Entry per Schedule() call
+  struct BGItem : public exlib::AsyncTask {
+    BGItem(void (*function)(void*), void* arg)
+        : function(function), arg(arg) { }
+    virtual void invoke() {
+      (*function)(arg);
+      delete this;
     }
-  }
-
-  // BGThread() is the body of the background thread
-  void BGThread();
-  static void* BGThreadWrapper(void* arg) {
-    reinterpret_cast<PosixEnv*>(arg)->BGThread();
-    return NULL;
-  }
-
-  pthread_mutex_t mu_;
-  pthread_cond_t bgsignal_;
-  pthread_t bgthread_;
-  bool started_bgthread_;
+    void (*function)(void*);
+    void* arg;
+  };
 
-  // Entry per Schedule() call
-  struct BGItem { void* arg; void (*function)(void*); };
-  typedef std::deque<BGItem> BGQueue;
-  BGQueue queue_;
+  // Background work runs on OSThreads, one at a time in Schedule() order
+  // unless SetBackgroundThreads() raises the limit. port::Mutex waits
+  // there suspend the thread rather than a fiber.
+  exlib::ThreadPool bg_pool_;
 
   PosixLockTable locks_;
   MmapLimiter mmap_limit_;
 };
 
-PosixEnv::PosixEnv() : started_bgthread_(false) {
-  PthreadCall("mutex_init", pthread_mutex_init(&mu_, NULL));
-  PthreadCall("cvar_init", pthread_cond_init(&bgsignal_, NULL));
+PosixEnv::PosixEnv() : bg_pool_(1) {
 }
 
 void PosixEnv::Schedule(void (*function)(void*), void* arg) {
-  PthreadCall("lock", pthread_mutex_lock(&mu_));
-
-  // Start background thread if necessary
-  if (!started_bgthread_) {
-    started_bgthread_ = true;
-    PthreadCall(
-        "create thread",
-        pthread_create(&bgthread_, NULL,  &PosixEnv::BGThreadWrapper, this));
-  }
-
-  // If the queue is currently empty, the background thread may currently be
-  // waiting.
-  if (queue_.empty()) {
-    PthreadCall("signal", pthread_cond_signal(&bgsignal_));
-  }
-
-  // Add to priority queue
-  queue_.push_back(BGItem());
-  queue_.back().function = function;
-  queue_.back().arg = arg;
-
-  PthreadCall("unlock", pthread_mutex_unlock(&mu_));
-}
-
-void PosixEnv::BGThread() {
-  while (true) {
-    // Wait until there is an item that is ready to run
-    PthreadCall("lock", pthread_mutex_lock(&mu_));
-    while (queue_.empty()) {
-      PthreadCall("wait", pthread_cond_wait(&bgsignal_, &mu_));
-    }
-
-    void (*function)(void*) = queue_.front().function;
-    void* arg = queue_.front().arg;
-    queue_.pop_front();
-
-    PthreadCall("unlock", pthread_mutex_unlock(&mu_));
-    (*function)(arg);
-  }
+  bg_pool_.post(new BGItem(function, arg));
 }
 
 namespace {
-struct StartThreadState {
+class StartThreadState : public exlib::OSThread {
+ public:
+  StartThreadState(void (*function)(void*), void* arg)
+      : user_function(function), arg(arg) { }
+  virtual void Run() { user_function(arg); }
+
   void (*user_function)(void*);
   void* arg;
 };
 }
-static void* StartThreadWrapper(void* arg) {
-  StartThreadState* state = reinterpret_cast<StartThreadState*>(arg);
-  state->user_function(state->arg);
-  delete state;
-  return NULL;
-}
 
 void PosixEnv::StartThread(void (*function)(void* arg), void* arg) {
-  pthread_t t;
-  StartThreadState* state = new StartThreadState;
-  state->user_function = function;
-  state->arg = arg;
-  PthreadCall("start thread",
-              pthread_create(&t, NULL,  &StartThreadWrapper, state));
+  // Started as an OSThread so the function may use port::Mutex.
+  (new StartThreadState(function, arg))->start();
 }
 
 }  // namespace
@@ -2,14 +2,14 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <deque>
-#include <process.h>
 
 #include "leveldb/env.h"
 #include "leveldb/slice.h"
 #include "port/port.h"
 #include "util/logging.h"
 #include "util/win_logger.h"
+#include <pool.h>
+#include <service.h>
 
 #ifdef DeleteFile
 #undef DeleteFile
@@ -573,6 +573,11 @@ class WinEnv : public Env {
 
   virtual void Schedule(void (*function)(void*), void* arg);
 
+  virtual void SetBackgroundThreads(int number) {
+    if (number > bg_pool_.max_threads())
+      bg_pool_.set_max_threads(number);
+  }
+
   virtual void StartThread(void (*function)(void* arg), void* arg);
 
   virtual Status GetTestDirectory(std::string* result) {
@@ -610,91 +615,52 @@ class WinEnv : public Env {
   }
 
   virtual void SleepForMicroseconds(int micros) {
-    // TODO: is there a higher precision call?
-    ::Sleep(micros / 1000);
+    // A write stall on a fiber must not put the whole worker to sleep.
+    if (exlib::ThreadPool::on_fiber())
+      exlib::Fiber::sleep((micros + 999) / 1000);
+    else
+      ::Sleep(micros / 1000);
   }
 
 private:
-  // BGThread() is the body of the background thread
-  void BGThread();
-
-  static unsigned __stdcall BGThreadWrapper(void* arg) {
-    (reinterpret_cast<WinEnv*>(arg))->BGThread();
-    _endthreadex(0);
-    return 0;
-  }
-
-  leveldb::port::Mutex mu_;
-  leveldb::port::CondVar bgsignal_;
-  HANDLE  bgthread_;
-
   // Entry per Schedule() call
-  struct BGItem { void* arg; void (*function)(void*); };
-  typedef std::deque<BGItem> BGQueue;
-  BGQueue queue_;
+  struct BGItem : public exlib::AsyncTask {
+    BGItem(void (*function)(void*), void* arg)
+        : function(function), arg(arg) { }
+    virtual void invoke() {
+      (*function)(arg);
+      delete this;
+    }
+    void (*function)(void*);
+    void* arg;
+  };
+
+  // Background work runs on OSThreads, one at a time in Schedule() order
+  // unless SetBackgroundThreads() raises the limit.
+  exlib::ThreadPool bg_pool_;
 };
 
 
-WinEnv::WinEnv() : bgthread_(NULL), bgsignal_(&mu_) {
+WinEnv::WinEnv() : bg_pool_(1) {
 }
 
 void WinEnv::Schedule(void (*function)(void*), void* arg) {
-  mu_.Lock();
-
-  // Start background thread if necessary
-  if (NULL == bgthread_) {
-    bgthread_ = (HANDLE)_beginthreadex(NULL, 0, &WinEnv::BGThreadWrapper, this, 0, NULL);
-  }
-
-  // Add to priority queue
-  queue_.push_back(BGItem());
-  queue_.back().function = function;
-  queue_.back().arg = arg;
-
-  mu_.Unlock();
-
-  bgsignal_.Signal();
+  bg_pool_.post(new BGItem(function, arg));
 }
 
-void WinEnv::BGThread() {
-  while (true) {
-    // Wait until there is an item that is ready to run
-    mu_.Lock();
-
-    while (queue_.empty()) {
-      bgsignal_.Wait();
-    }
-
-    void (*function)(void*) = queue_.front().function;
-    void* arg = queue_.front().arg;
-    queue_.pop_front();
-
-    mu_.Unlock();
-    (*function)(arg);
-  }
-  // TODO: CloseHandle(bgthread_) ??
-}
+class StartThreadState : public exlib::OSThread {
+public:
+  StartThreadState(void (*function)(void*), void* arg)
+      : user_function(function), arg(arg) { }
+  virtual void Run() { user_function(arg); }
 
-struct StartThreadState {
   void (*user_function)(void*);
   void* arg;
-  HANDLE threadHandle;
 };
 
-static unsigned __stdcall StartThreadWrapper(void* arg) {
-  StartThreadState* state = reinterpret_cast<StartThreadState*>(arg);
-  state->user_function(state->arg);
-  _endthreadex(0);
-  CloseHandle(state->threadHandle);
-  delete state;
-  return 0;
-}
-
 void WinEnv::StartThread(void (*function)(void* arg), void* arg) {
-  StartThreadState* state = new StartThreadState;
-  state->user_function = function;
-  state->arg = arg;
-  state->threadHandle = (HANDLE)_beginthreadex(NULL, 0, &StartThreadWrapper, state, 0, NULL);
+  // Started as an OSThread so the function may use port::Mutex.
+  (new StartThreadState(function, arg))->start();
 }
 
 static Env* default_env;
@@ -22,7 +22,9 @@ Options::Options()
       block_size(4096),
       block_restart_interval(16),
       compression(kSnappyCompression),
-      filter_policy(NULL) {
+      filter_policy(NULL),
+      max_background_compactions(1),
+      max_subcompactions(1) {
 }
 
 
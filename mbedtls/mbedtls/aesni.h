@@ -79,6 +79,28 @@ void mbedtls_aesni_gcm_mult( unsigned char c[16],
                      const unsigned char a[16],
                      const unsigned char b[16] );
 
+/**
+ * \brief          AES-GCM bulk en(de)cryption of whole 128-byte batches,
+ *                 with the AES and GHASH work of 8 blocks interleaved
+ *
+ * \param aes      AES context, set up with an encryption key
+ * \param mode     MBEDTLS_AES_ENCRYPT or MBEDTLS_AES_DECRYPT
+ * \param hpow     H^1 to H^8, each byte-reversed
+ * \param y        GCM counter block, advanced by one per block
+ * \param buf      GHASH state, updated with the ciphertext
+ * \param length   length of the input data
+ * \param input    input data
+ * \param output   output data
+ *
+ * \return         number of bytes processed, a multiple of 128 (the
+ *                 caller handles the rest block by block)
+ */
+size_t mbedtls_aesni_gcm_crypt( const mbedtls_aes_context *aes, int mode,
+                                const unsigned char hpow[8][16],
+                                unsigned char y[16], unsigned char buf[16],
+                                size_t length, const unsigned char *input,
+                                unsigned char *output );
+
 /**
  * \brief           Compute decryption round keys from encryption round keys
  *
@@ -0,0 +1,204 @@
+/**
+ * \file chachapoly.h
+ *
+ * \brief ChaCha20-Poly1305 AEAD construction (RFC 7539)
+ *
+ *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_CHACHAPOLY_H
+#define MBEDTLS_CHACHAPOLY_H
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "chacha20.h"
+#include "poly1305.h"
+
+#define MBEDTLS_CHACHAPOLY_ENCRYPT     1
+#define MBEDTLS_CHACHAPOLY_DECRYPT     0
+
+#define MBEDTLS_ERR_CHACHAPOLY_BAD_STATE            -0x0054 /**< The requested operation is not permitted in the current state. */
+#define MBEDTLS_ERR_CHACHAPOLY_AUTH_FAILED          -0x0056 /**< Authenticated decryption failed: data was not authentic. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          ChaCha20-Poly1305 context structure
+ */
+typedef struct
+{
+    mbedtls_chacha20_context chacha20_ctx;  /*!< keystream generator */
+    mbedtls_poly1305_context poly1305_ctx;  /*!< authenticator */
+    uint64_t aad_len;           /*!< additional data length so far */
+    uint64_t ciphertext_len;    /*!< ciphertext length so far */
+    int state;                  /*!< where in the message we are */
+    int mode;                   /*!< encrypt or decrypt */
+}
+mbedtls_chachapoly_context;
+
+/**
+ * \brief          Initialize ChaCha20-Poly1305 context
+ *
+ * \param ctx      context to be initialized
+ */
+void mbedtls_chachapoly_init( mbedtls_chachapoly_context *ctx );
+
+/**
+ * \brief          Clear ChaCha20-Poly1305 context
+ *
+ * \param ctx      context to be cleared
+ */
+void mbedtls_chachapoly_free( mbedtls_chachapoly_context *ctx );
+
+/**
+ * \brief          Set the 256-bit key
+ *
+ * \param ctx      ChaCha20-Poly1305 context
+ * \param key      the 256-bit secret key
+ *
+ * \return         0 if successful, or MBEDTLS_ERR_CHACHA20_BAD_INPUT_DATA
+ */
+int mbedtls_chachapoly_setkey( mbedtls_chachapoly_context *ctx,
+                               const unsigned char key[32] );
+
+/**
+ * \brief          Start a message
+ *
+ *                 Derives the one-time Poly1305 key from the nonce. Must
+ *                 be followed by any number of calls to
+ *                 mbedtls_chachapoly_update_aad(), then any number of
+ *                 calls to mbedtls_chachapoly_update(), then
+ *                 mbedtls_chachapoly_finish().
+ *
+ * \warning        A nonce must never be reused with the same key.
+ *
+ * \param ctx      ChaCha20-Poly1305 context
+ * \param nonce    the 96-bit nonce
+ * \param mode     MBEDTLS_CHACHAPOLY_ENCRYPT or MBEDTLS_CHACHAPOLY_DECRYPT
+ *
+ * \return         0 if successful, or a CHACHA20 / POLY1305 error code
+ */
+int mbedtls_chachapoly_starts( mbedtls_chachapoly_context *ctx,
+                               const unsigned char nonce[12],
+                               int mode );
+
+/**
+ * \brief          Feed additional authenticated data
+ *
+ * \param ctx      ChaCha20-Poly1305 context
+ * \param aad      buffer holding the additional data
+ * \param aad_len  length of the additional data
+ *
+ * \return         0 if successful, or MBEDTLS_ERR_CHACHAPOLY_BAD_STATE
+ *                 if called after mbedtls_chachapoly_update()
+ */
+int mbedtls_chachapoly_update_aad( mbedtls_chachapoly_context *ctx,
+                                   const unsigned char *aad,
+                                   size_t aad_len );
+
+/**
+ * \brief          Encrypt or decrypt part of the message
+ *
+ * \param ctx      ChaCha20-Poly1305 context
+ * \param len      length of the input data
+ * \param input    buffer holding the input data
+ * \param output   buffer for the output data (may equal input)
+ *
+ * \return         0 if successful, or MBEDTLS_ERR_CHACHAPOLY_BAD_STATE
+ */
+int mbedtls_chachapoly_update( mbedtls_chachapoly_context *ctx,
+                               size_t len,
+                               const unsigned char *input,
+                               unsigned char *output );
+
+/**
+ * \brief          Finish the message and write the tag
+ *
+ * \param ctx      ChaCha20-Poly1305 context
+ * \param mac      buffer for the 128-bit tag
+ *
+ * \return         0 if successful, or MBEDTLS_ERR_CHACHAPOLY_BAD_STATE
+ */
+int mbedtls_chachapoly_finish( mbedtls_chachapoly_context *ctx,
+                               unsigned char mac[16] );
+
+/**
+ * \brief          Encrypt a whole message and compute its tag
+ *
+ * \param ctx      ChaCha20-Poly1305 context, key already set
+ * \param length   length of the input data
+ * \param nonce    the 96-bit nonce
+ * \param aad      buffer holding the additional data
+ * \param aad_len  length of the additional data
+ * \param input    buffer holding the plaintext
+ * \param output   buffer for the ciphertext (may equal input)
+ * \param tag      buffer for the 128-bit tag
+ *
+ * \return         0 if successful, or an error code
+ */
+int mbedtls_chachapoly_encrypt_and_tag( mbedtls_chachapoly_context *ctx,
+                                        size_t length,
+                                        const unsigned char nonce[12],
+                                        const unsigned char *aad,
+                                        size_t aad_len,
+                                        const unsigned char *input,
+                                        unsigned char *output,
+                                        unsigned char tag[16] );
+
+/**
+ * \brief          Check the tag of a whole message and decrypt it
+ *
+ * \param ctx      ChaCha20-Poly1305 context, key already set
+ * \param length   length of the input data
+ * \param nonce    the 96-bit nonce
+ * \param aad      buffer holding the additional data
+ * \param aad_len  length of the additional data
+ * \param tag      the 128-bit tag to check
+ * \param input    buffer holding the ciphertext
+ * \param output   buffer for the plaintext (may equal input)
+ *
+ * \return         0 if successful and authenticated,
+ *                 MBEDTLS_ERR_CHACHAPOLY_AUTH_FAILED if the tag does not
+ *                 match (output is then zeroed), or another error code
+ */
+int mbedtls_chachapoly_auth_decrypt( mbedtls_chachapoly_context *ctx,
+                                     size_t length,
+                                     const unsigned char nonce[12],
+                                     const unsigned char *aad,
+                                     size_t aad_len,
+                                     const unsigned char tag[16],
+                                     const unsigned char *input,
+                                     unsigned char *output );
+
+/**
+ * \brief          Checkup routine
+ *
+ * \return         0 if successful, or 1 if the test failed
+ */
+int mbedtls_chachapoly_self_test( int verbose );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* chachapoly.h */
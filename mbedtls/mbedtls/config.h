@@ -229,8 +229,10 @@
 //#define MBEDTLS_ARC4_ALT
 //#define MBEDTLS_BLOWFISH_ALT
 //#define MBEDTLS_CAMELLIA_ALT
+//#define MBEDTLS_CHACHA20_ALT
 //#define MBEDTLS_DES_ALT
 //#define MBEDTLS_XTEA_ALT
+//#define MBEDTLS_POLY1305_ALT
 //#define MBEDTLS_MD2_ALT
 //#define MBEDTLS_MD4_ALT
 //#define MBEDTLS_MD5_ALT
@@ -1204,6 +1206,18 @@
  */
 #define MBEDTLS_SSL_EXPORT_KEYS
 
+/**
+ * \def MBEDTLS_SSL_OFFLOAD
+ *
+ * Enable the handshake offload callback, see mbedtls_ssl_conf_offload().
+ * The server then hands its private-key operations and (EC)DH key
+ * generation and shared secret computation to the callback, which may run
+ * them on another thread.
+ *
+ * Comment this macro to disable the offload callback
+ */
+#define MBEDTLS_SSL_OFFLOAD
+
 /**
  * \def MBEDTLS_SSL_SERVER_NAME_INDICATION
  *
@@ -1606,6 +1620,41 @@
  */
 #define MBEDTLS_CERTS_C
 
+/**
+ * \def MBEDTLS_CHACHA20_C
+ *
+ * Enable the ChaCha20 stream cipher.
+ *
+ * Module:  library/chacha20.c
+ * Caller:  library/chachapoly.c
+ *          library/cipher.c
+ *
+ * On x86-64 whole blocks are processed 4 (SSE2) or 8 (AVX2, detected at
+ * runtime) at a time, on ARM 4 at a time with NEON.
+ */
+#define MBEDTLS_CHACHA20_C
+
+/**
+ * \def MBEDTLS_CHACHAPOLY_C
+ *
+ * Enable the ChaCha20-Poly1305 AEAD algorithm.
+ *
+ * Module:  library/chachapoly.c
+ *
+ * Requires: MBEDTLS_CHACHA20_C, MBEDTLS_POLY1305_C
+ *
+ * This module enables the following ciphersuites (if other requisites are
+ * enabled as well):
+ *      MBEDTLS_TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256
+ *      MBEDTLS_TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256
+ *      MBEDTLS_TLS_DHE_RSA_WITH_CHACHA20_POLY1305_SHA256
+ *      MBEDTLS_TLS_ECDHE_PSK_WITH_CHACHA20_POLY1305_SHA256
+ *      MBEDTLS_TLS_DHE_PSK_WITH_CHACHA20_POLY1305_SHA256
+ *      MBEDTLS_TLS_RSA_PSK_WITH_CHACHA20_POLY1305_SHA256
+ *      MBEDTLS_TLS_PSK_WITH_CHACHA20_POLY1305_SHA256
+ */
+#define MBEDTLS_CHACHAPOLY_C
+
 /**
  * \def MBEDTLS_CIPHER_C
  *
@@ -2093,6 +2142,16 @@
  */
 #define MBEDTLS_PLATFORM_C
 
+/**
+ * \def MBEDTLS_POLY1305_C
+ *
+ * Enable the Poly1305 MAC algorithm.
+ *
+ * Module:  library/poly1305.c
+ * Caller:  library/chachapoly.c
+ */
+#define MBEDTLS_POLY1305_C
+
 /**
  * \def MBEDTLS_RIPEMD160_C
  *
@@ -50,6 +50,8 @@ typedef struct {
     unsigned char y[16];        /*!< Y working value */
     unsigned char buf[16];      /*!< buf working value */
     int mode;                   /*!< Encrypt or Decrypt */
+    int aesni;                  /*!< AES-NI bulk path usable */
+    unsigned char HP[8][16];    /*!< H^1..H^8 for the AES-NI path */
 }
 mbedtls_gcm_context;
 
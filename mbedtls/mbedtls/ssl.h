@@ -645,6 +645,12 @@ struct mbedtls_ssl_config
     void *p_export_keys;            /*!< context for key export callback    */
 #endif
 
+#if defined(MBEDTLS_SSL_OFFLOAD)
+    /** Callback to run handshake public-key operations                     */
+    int (*f_offload)( void *, int (*)( void * ), void * );
+    void *p_offload;                /*!< context for the offload callback   */
+#endif
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     const mbedtls_x509_crt_profile *cert_profile; /*!< verification profile */
     mbedtls_ssl_key_cert *key_cert; /*!< own certificate/key pair(s)        */
@@ -1277,6 +1283,49 @@ void mbedtls_ssl_conf_export_keys_cb( mbedtls_ssl_config *conf,
         void *p_export_keys );
 #endif /* MBEDTLS_SSL_EXPORT_KEYS */
 
+#if defined(MBEDTLS_SSL_OFFLOAD)
+/**
+ * \brief           Callback type: run a handshake public-key operation
+ *
+ * \note            The callback must call f_op( op ) exactly once and
+ *                  return its result. It may do so on another thread and
+ *                  suspend the caller (eg a fiber) until the result is
+ *                  ready: the SSL context is not touched until the callback
+ *                  returns, so the expensive RSA, ECDSA and (EC)DH
+ *                  arithmetic of a handshake does not hold up the thread
+ *                  that drives the connection.
+ *
+ * \warning         f_op uses the RNG set by mbedtls_ssl_conf_rng() and the
+ *                  own private key, which are usually shared between
+ *                  connections. When f_op runs on another thread, both
+ *                  must be thread-safe, eg mbedtls_ctr_drbg_random() with
+ *                  MBEDTLS_THREADING_C.
+ *
+ * \param p_offload Context for the callback
+ * \param f_op      Operation to run
+ * \param op        Parameter for f_op
+ *
+ * \return          The value returned by f_op
+ */
+typedef int mbedtls_ssl_offload_t( void *p_offload,
+                                   int (*f_op)( void * ),
+                                   void *op );
+
+/**
+ * \brief           Configure the handshake offload callback (server only).
+ *                  (Default: none, operations run in the caller.)
+ *
+ * \note            See \c mbedtls_ssl_offload_t.
+ *
+ * \param conf      SSL configuration context
+ * \param f_offload Callback that runs the operations
+ * \param p_offload Context for the callback
+ */
+void mbedtls_ssl_conf_offload( mbedtls_ssl_config *conf,
+                               mbedtls_ssl_offload_t *f_offload,
+                               void *p_offload );
+#endif /* MBEDTLS_SSL_OFFLOAD */
+
 /**
  * \brief          Callback type: generate a cookie
  *
@@ -45,6 +45,10 @@
 #define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES      50   /*!< Maximum entries in cache */
 #endif
 
+#if !defined(MBEDTLS_SSL_CACHE_SHARDS)
+#define MBEDTLS_SSL_CACHE_SHARDS                   16   /*!< Most independently locked parts of the cache */
+#endif
+
 /* \} name SECTION: Module settings */
 
 #ifdef __cplusplus
@@ -66,20 +70,42 @@ struct mbedtls_ssl_cache_entry
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     mbedtls_x509_buf peer_cert;         /*!< entry peer_cert    */
 #endif
-    mbedtls_ssl_cache_entry *next;      /*!< chain pointer      */
+    uint32_t hash;                      /*!< hash of session id */
+    mbedtls_ssl_cache_entry *next;      /*!< hash bucket chain  */
+    mbedtls_ssl_cache_entry *lru_prev;  /*!< more recently used */
+    mbedtls_ssl_cache_entry *lru_next;  /*!< less recently used */
 };
 
+/**
+ * \brief   One independently locked part of the cache. Entries are
+ *          hashed by session id into buckets, and kept on a list in
+ *          order of use so that the least recently used is evicted.
+ */
+typedef struct
+{
+    mbedtls_ssl_cache_entry **buckets;  /*!< hash buckets           */
+    uint32_t bucket_mask;       /*!< number of buckets - 1  */
+    int count;                  /*!< entries in this shard  */
+    mbedtls_ssl_cache_entry *lru_head;  /*!< most recently used     */
+    mbedtls_ssl_cache_entry *lru_tail;  /*!< least recently used    */
+    unsigned long hits;         /*!< successful lookups     */
+    unsigned long misses;       /*!< failed lookups         */
+    unsigned long evictions;    /*!< entries evicted        */
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t mutex;    /*!< mutex                  */
+#endif
+}
+mbedtls_ssl_cache_shard;
+
 /**
  * \brief Cache context
  */
 struct mbedtls_ssl_cache_context
 {
-    mbedtls_ssl_cache_entry *chain;     /*!< start of the chain     */
+    mbedtls_ssl_cache_shard shards[MBEDTLS_SSL_CACHE_SHARDS];   /*!< shards */
     int timeout;                /*!< cache entry timeout    */
     int max_entries;            /*!< maximum entries        */
-#if defined(MBEDTLS_THREADING_C)
-    mbedtls_threading_mutex_t mutex;    /*!< mutex                  */
-#endif
+    int shard_count;            /*!< shards in use          */
 };
 
 /**
@@ -124,11 +150,27 @@ void mbedtls_ssl_cache_set_timeout( mbedtls_ssl_cache_context *cache, int timeou
  * \brief          Set the maximum number of cache entries
  *                 (Default: MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES (50))
  *
+ *                 The cache uses one shard per 32 entries, up to
+ *                 MBEDTLS_SSL_CACHE_SHARDS. If that number changes,
+ *                 the sessions already cached are dropped.
+ *
  * \param cache    SSL cache context
  * \param max      cache entry maximum
  */
 void mbedtls_ssl_cache_set_max_entries( mbedtls_ssl_cache_context *cache, int max );
 
+/**
+ * \brief          Get the cache counters, summed over all shards
+ *
+ * \param cache    SSL cache context
+ * \param hits     number of sessions found, or NULL
+ * \param misses   number of sessions not found or expired, or NULL
+ * \param evictions number of live entries dropped to make room, or NULL
+ */
+void mbedtls_ssl_cache_get_stats( mbedtls_ssl_cache_context *cache,
+                                  unsigned long *hits, unsigned long *misses,
+                                  unsigned long *evictions );
+
 /**
  * \brief          Free referenced items in a cache context and clear memory
  *
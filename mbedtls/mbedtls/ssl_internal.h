@@ -377,6 +377,35 @@ void mbedtls_ssl_optimize_checksum( mbedtls_ssl_context *ssl,
 int mbedtls_ssl_psk_derive_premaster( mbedtls_ssl_context *ssl, mbedtls_key_exchange_type_t key_ex );
 #endif
 
+/*
+ * Handshake public-key operations, see mbedtls_ssl_conf_offload()
+ */
+typedef enum
+{
+    MBEDTLS_SSL_PK_OP_SIGN,             /* own key, input is the hash     */
+    MBEDTLS_SSL_PK_OP_DECRYPT,          /* own key, input is ciphertext   */
+    MBEDTLS_SSL_PK_OP_DHM_MAKE_PARAMS,
+    MBEDTLS_SSL_PK_OP_DHM_CALC_SECRET,
+    MBEDTLS_SSL_PK_OP_ECDH_MAKE_PARAMS,
+    MBEDTLS_SSL_PK_OP_ECDH_CALC_SECRET
+}
+mbedtls_ssl_pk_op_type;
+
+typedef struct
+{
+    mbedtls_ssl_pk_op_type type;
+    mbedtls_ssl_context *ssl;
+    mbedtls_md_type_t md_alg;
+    const unsigned char *input;
+    size_t ilen;
+    unsigned char *output;
+    size_t osize;
+    size_t *olen;
+}
+mbedtls_ssl_pk_op;
+
+int mbedtls_ssl_pk_op_run( mbedtls_ssl_context *ssl, mbedtls_ssl_pk_op *op );
+
 #if defined(MBEDTLS_PK_C)
 unsigned char mbedtls_ssl_sig_from_pk( mbedtls_pk_context *pk );
 mbedtls_pk_type_t mbedtls_ssl_pk_alg_from_sig( unsigned char sig );
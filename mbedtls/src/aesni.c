@@ -42,6 +42,15 @@
 
 #if defined(MBEDTLS_HAVE_X86_64)
 
+#include <wmmintrin.h>
+#include <smmintrin.h>
+
+/*
+ * The bulk GCM kernel uses intrinsics rather than hand-encoded opcodes;
+ * the target attribute lets them compile without global -maes/-mpclmul.
+ */
+#define AESNI_GCM_TARGET __attribute__((target("aes,pclmul,sse4.1")))
+
 /*
  * AES-NI support detection routine
  */
@@ -459,6 +468,169 @@ int mbedtls_aesni_setkey_enc( unsigned char *rk,
     return( 0 );
 }
 
+/*
+ * Accumulate the unreduced carry-less product of a and b into lo:mid:hi,
+ * so that several products can share one reduction.
+ */
+static inline AESNI_GCM_TARGET void aesni_clmul_acc( __m128i a, __m128i b,
+                                                     __m128i *lo, __m128i *mid,
+                                                     __m128i *hi )
+{
+    *lo  = _mm_xor_si128( *lo,  _mm_clmulepi64_si128( a, b, 0x00 ) );
+    *hi  = _mm_xor_si128( *hi,  _mm_clmulepi64_si128( a, b, 0x11 ) );
+    *mid = _mm_xor_si128( *mid, _mm_clmulepi64_si128( a, b, 0x10 ) );
+    *mid = _mm_xor_si128( *mid, _mm_clmulepi64_si128( a, b, 0x01 ) );
+}
+
+/*
+ * Fold the middle terms in, shift left by one and reduce modulo the GCM
+ * polynomial: the same steps as mbedtls_aesni_gcm_mult() above.
+ */
+static inline AESNI_GCM_TARGET __m128i aesni_gcm_reduce( __m128i lo, __m128i mid,
+                                                         __m128i hi )
+{
+    __m128i t3, t4, t5;
+
+    lo = _mm_xor_si128( lo, _mm_slli_si128( mid, 8 ) );
+    hi = _mm_xor_si128( hi, _mm_srli_si128( mid, 8 ) );
+
+    t3 = _mm_srli_epi64( lo, 63 );
+    t4 = _mm_srli_epi64( hi, 63 );
+    lo = _mm_slli_epi64( lo, 1 );
+    hi = _mm_slli_epi64( hi, 1 );
+    t5 = _mm_srli_si128( t3, 8 );
+    lo = _mm_or_si128( lo, _mm_slli_si128( t3, 8 ) );
+    hi = _mm_or_si128( hi, _mm_or_si128( _mm_slli_si128( t4, 8 ), t5 ) );
+
+    t3 = _mm_xor_si128( _mm_xor_si128( _mm_slli_epi64( lo, 63 ),
+                                       _mm_slli_epi64( lo, 62 ) ),
+                        _mm_slli_epi64( lo, 57 ) );
+    lo = _mm_xor_si128( lo, _mm_slli_si128( t3, 8 ) );
+
+    t4 = _mm_xor_si128( _mm_xor_si128( _mm_srli_epi64( lo, 1 ),
+                                       _mm_srli_epi64( lo, 2 ) ),
+                        _mm_srli_epi64( lo, 7 ) );
+    t3 = _mm_xor_si128( _mm_xor_si128( _mm_slli_epi64( lo, 63 ),
+                                       _mm_slli_epi64( lo, 62 ) ),
+                        _mm_slli_epi64( lo, 57 ) );
+    t4 = _mm_xor_si128( t4, _mm_srli_si128( t3, 8 ) );
+
+    return( _mm_xor_si128( _mm_xor_si128( t4, lo ), hi ) );
+}
+
+/*
+ * AES-GCM bulk en(de)cryption, 8 blocks at a time.
+ *
+ * The 8 counter blocks go through the AES rounds side by side, and the
+ * GHASH multiplications of 8 ciphertext blocks are slotted in between the
+ * rounds, using H^8..H^1 so that the 8 products need a single reduction.
+ * When decrypting, the ciphertext being hashed is this round's input;
+ * when encrypting it is the previous round's output, and the last batch
+ * is hashed after the loop.
+ */
+AESNI_GCM_TARGET
+size_t mbedtls_aesni_gcm_crypt( const mbedtls_aes_context *aes, int mode,
+                                const unsigned char hpow[8][16],
+                                unsigned char y[16], unsigned char buf[16],
+                                size_t length, const unsigned char *input,
+                                unsigned char *output )
+{
+    const __m128i bswap = _mm_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7,
+                                        8, 9, 10, 11, 12, 13, 14, 15 );
+    const __m128i *rkp = (const __m128i *) aes->rk;
+    const __m128i *in;
+    __m128i *out;
+    __m128i rk[15], h[8], blk[8], ghash[8];
+    __m128i ctr, x, lo, mid, hi;
+    uint32_t c;
+    size_t done = 0;
+    int i, r, pending = 0;
+    const int nr = aes->nr;
+
+    for( r = 0; r <= nr; r++ )
+        rk[r] = _mm_loadu_si128( rkp + r );
+
+    /* block i of a batch is multiplied by H^(8-i) */
+    for( i = 0; i < 8; i++ )
+        h[i] = _mm_loadu_si128( (const __m128i *) hpow[7 - i] );
+
+    x = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *) buf ), bswap );
+    ctr = _mm_loadu_si128( (const __m128i *) y );
+    c = ( (uint32_t) y[12] << 24 ) | ( (uint32_t) y[13] << 16 ) |
+        ( (uint32_t) y[14] <<  8 ) | ( (uint32_t) y[15]       );
+
+    lo = mid = hi = _mm_setzero_si128();
+
+    while( length - done >= 128 )
+    {
+        in = (const __m128i *) ( input + done );
+        out = (__m128i *) ( output + done );
+
+        if( mode == MBEDTLS_AES_DECRYPT )
+        {
+            for( i = 0; i < 8; i++ )
+                ghash[i] = _mm_shuffle_epi8( _mm_loadu_si128( in + i ), bswap );
+            ghash[0] = _mm_xor_si128( ghash[0], x );
+            pending = 1;
+        }
+
+        for( i = 0; i < 8; i++ )
+        {
+            blk[i] = _mm_insert_epi32( ctr, (int) __builtin_bswap32( c + 1 + i ), 3 );
+            blk[i] = _mm_xor_si128( blk[i], rk[0] );
+        }
+
+        for( r = 1; r < nr; r++ )
+        {
+            for( i = 0; i < 8; i++ )
+                blk[i] = _mm_aesenc_si128( blk[i], rk[r] );
+
+            if( pending && r <= 8 )
+                aesni_clmul_acc( ghash[r - 1], h[r - 1], &lo, &mid, &hi );
+        }
+
+        for( i = 0; i < 8; i++ )
+        {
+            blk[i] = _mm_aesenclast_si128( blk[i], rk[nr] );
+            blk[i] = _mm_xor_si128( blk[i], _mm_loadu_si128( in + i ) );
+            _mm_storeu_si128( out + i, blk[i] );
+        }
+
+        if( pending )
+        {
+            x = aesni_gcm_reduce( lo, mid, hi );
+            lo = mid = hi = _mm_setzero_si128();
+            pending = 0;
+        }
+
+        if( mode == MBEDTLS_AES_ENCRYPT )
+        {
+            for( i = 0; i < 8; i++ )
+                ghash[i] = _mm_shuffle_epi8( blk[i], bswap );
+            ghash[0] = _mm_xor_si128( ghash[0], x );
+            pending = 1;
+        }
+
+        c += 8;
+        done += 128;
+    }
+
+    if( pending )
+    {
+        for( i = 0; i < 8; i++ )
+            aesni_clmul_acc( ghash[i], h[i], &lo, &mid, &hi );
+        x = aesni_gcm_reduce( lo, mid, hi );
+    }
+
+    _mm_storeu_si128( (__m128i *) buf, _mm_shuffle_epi8( x, bswap ) );
+    y[12] = (unsigned char)( c >> 24 );
+    y[13] = (unsigned char)( c >> 16 );
+    y[14] = (unsigned char)( c >>  8 );
+    y[15] = (unsigned char)( c       );
+
+    return( done );
+}
+
 #endif /* MBEDTLS_HAVE_X86_64 */
 
 #endif /* MBEDTLS_AESNI_C */
@@ -0,0 +1,782 @@
+/*
+ *  ChaCha20 stream cipher
+ *
+ *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+/*
+ *  The ChaCha20 algorithm was designed by Daniel J. Bernstein.
+ *
+ *  http://cr.yp.to/chacha/chacha-20080128.pdf
+ *  https://tools.ietf.org/html/rfc7539
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_CHACHA20_C)
+
+#include "mbedtls/chacha20.h"
+
+#include <string.h>
+
+#if defined(MBEDTLS_SELF_TEST)
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdio.h>
+#define mbedtls_printf printf
+#endif /* MBEDTLS_PLATFORM_C */
+#endif /* MBEDTLS_SELF_TEST */
+
+#if !defined(MBEDTLS_CHACHA20_ALT)
+
+/*
+ * Whole blocks go through a multi-block kernel when the CPU has one:
+ * 8 blocks per AVX2 call, 4 per SSE2 or NEON call. Each kernel keeps
+ * word i of every block in one vector lane set, so the rounds are the
+ * scalar rounds applied lane-wise, and the result is transposed back to
+ * block order on the way out. AVX2 is compiled with a target attribute
+ * and only used after a cpuid/xgetbv check.
+ */
+#if defined(MBEDTLS_HAVE_ASM) && defined(__GNUC__) &&  \
+    ( defined(__amd64__) || defined(__x86_64__) )
+#define CHACHA20_X86_64
+#include <immintrin.h>
+#define CHACHA20_AVX2_TARGET __attribute__((target("avx2")))
+#elif ( defined(__ARM_NEON) || defined(__ARM_NEON__) ) && \
+    !defined(__ARM_BIG_ENDIAN)
+#define CHACHA20_NEON
+#include <arm_neon.h>
+#endif
+
+#ifndef asm
+#define asm __asm
+#endif
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize( void *v, size_t n ) {
+    volatile unsigned char *p = v; while( n-- ) *p++ = 0;
+}
+
+/*
+ * 32-bit integer manipulation macros (little endian)
+ */
+#ifndef GET_UINT32_LE
+#define GET_UINT32_LE(n,b,i)                            \
+{                                                       \
+    (n) = ( (uint32_t) (b)[(i)    ]       )             \
+        | ( (uint32_t) (b)[(i) + 1] <<  8 )             \
+        | ( (uint32_t) (b)[(i) + 2] << 16 )             \
+        | ( (uint32_t) (b)[(i) + 3] << 24 );            \
+}
+#endif
+
+#ifndef PUT_UINT32_LE
+#define PUT_UINT32_LE(n,b,i)                                    \
+{                                                               \
+    (b)[(i)    ] = (unsigned char) ( ( (n)       ) & 0xFF );    \
+    (b)[(i) + 1] = (unsigned char) ( ( (n) >>  8 ) & 0xFF );    \
+    (b)[(i) + 2] = (unsigned char) ( ( (n) >> 16 ) & 0xFF );    \
+    (b)[(i) + 3] = (unsigned char) ( ( (n) >> 24 ) & 0xFF );    \
+}
+#endif
+
+#define ROTL32( v, c ) ( ( (v) << (c) ) | ( (v) >> ( 32 - (c) ) ) )
+
+#define QUARTERROUND( x, a, b, c, d )                                   \
+{                                                                       \
+    x[a] += x[b]; x[d] ^= x[a]; x[d] = ROTL32( x[d], 16 );              \
+    x[c] += x[d]; x[b] ^= x[c]; x[b] = ROTL32( x[b], 12 );              \
+    x[a] += x[b]; x[d] ^= x[a]; x[d] = ROTL32( x[d],  8 );              \
+    x[c] += x[d]; x[b] ^= x[c]; x[b] = ROTL32( x[b],  7 );              \
+}
+
+/*
+ * Produce one 64-byte keystream block from the current state
+ */
+static void chacha20_block( const uint32_t state[16],
+                            unsigned char keystream[64] )
+{
+    uint32_t x[16];
+    size_t i;
+
+    memcpy( x, state, sizeof( x ) );
+
+    for( i = 0; i < 10; i++ )
+    {
+        QUARTERROUND( x, 0, 4,  8, 12 );
+        QUARTERROUND( x, 1, 5,  9, 13 );
+        QUARTERROUND( x, 2, 6, 10, 14 );
+        QUARTERROUND( x, 3, 7, 11, 15 );
+
+        QUARTERROUND( x, 0, 5, 10, 15 );
+        QUARTERROUND( x, 1, 6, 11, 12 );
+        QUARTERROUND( x, 2, 7,  8, 13 );
+        QUARTERROUND( x, 3, 4,  9, 14 );
+    }
+
+    for( i = 0; i < 16; i++ )
+    {
+        x[i] += state[i];
+        PUT_UINT32_LE( x[i], keystream, i << 2 );
+    }
+
+    mbedtls_zeroize( x, sizeof( x ) );
+}
+
+#if defined(CHACHA20_X86_64)
+
+/*
+ * AVX2 detection: cpuid leaf 7 for the instructions, xgetbv for the OS
+ * saving the ymm state.
+ */
+static int chacha20_has_avx2( void )
+{
+    static int done = 0;
+    static int avx2 = 0;
+    unsigned int a, b, c, d;
+
+    if( ! done )
+    {
+        asm( "cpuid" : "=a" (a), "=b" (b), "=c" (c), "=d" (d)
+                     : "a" (1), "c" (0) );
+
+        /* OSXSAVE and AVX */
+        if( ( c & 0x18000000u ) == 0x18000000u )
+        {
+            asm( "xgetbv" : "=a" (a), "=d" (d) : "c" (0) );
+
+            if( ( a & 6 ) == 6 )
+            {
+                asm( "cpuid" : "=a" (a), "=b" (b), "=c" (c), "=d" (d)
+                             : "a" (7), "c" (0) );
+                avx2 = ( b & 0x20u ) != 0;
+            }
+        }
+
+        done = 1;
+    }
+
+    return( avx2 );
+}
+
+#define SSE2_ROTL( v, c )                                               \
+    _mm_or_si128( _mm_slli_epi32( v, c ), _mm_srli_epi32( v, 32 - (c) ) )
+
+#define SSE2_ROTL16( v )                                                \
+    _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0xB1 ), 0xB1 )
+
+#define SSE2_QUARTERROUND( x, a, b, c, d )                              \
+{                                                                       \
+    x[a] = _mm_add_epi32( x[a], x[b] );                                 \
+    x[d] = _mm_xor_si128( x[d], x[a] ); x[d] = SSE2_ROTL16( x[d] );     \
+    x[c] = _mm_add_epi32( x[c], x[d] );                                 \
+    x[b] = _mm_xor_si128( x[b], x[c] ); x[b] = SSE2_ROTL( x[b], 12 );   \
+    x[a] = _mm_add_epi32( x[a], x[b] );                                 \
+    x[d] = _mm_xor_si128( x[d], x[a] ); x[d] = SSE2_ROTL( x[d], 8 );    \
+    x[c] = _mm_add_epi32( x[c], x[d] );                                 \
+    x[b] = _mm_xor_si128( x[b], x[c] ); x[b] = SSE2_ROTL( x[b], 7 );    \
+}
+
+/*
+ * Transpose four words of four blocks back into block order and XOR
+ * them into 16 bytes of each of the four output blocks
+ */
+static inline void chacha20_sse2_xor( __m128i a, __m128i b,
+                                      __m128i c, __m128i d,
+                                      const unsigned char *input,
+                                      unsigned char *output )
+{
+    __m128i t0 = _mm_unpacklo_epi32( a, b );
+    __m128i t1 = _mm_unpacklo_epi32( c, d );
+    __m128i t2 = _mm_unpackhi_epi32( a, b );
+    __m128i t3 = _mm_unpackhi_epi32( c, d );
+
+    a = _mm_unpacklo_epi64( t0, t1 );
+    b = _mm_unpackhi_epi64( t0, t1 );
+    c = _mm_unpacklo_epi64( t2, t3 );
+    d = _mm_unpackhi_epi64( t2, t3 );
+
+    _mm_storeu_si128( (__m128i *) ( output ), _mm_xor_si128( a,
+        _mm_loadu_si128( (const __m128i *) ( input ) ) ) );
+    _mm_storeu_si128( (__m128i *) ( output + 64 ), _mm_xor_si128( b,
+        _mm_loadu_si128( (const __m128i *) ( input + 64 ) ) ) );
+    _mm_storeu_si128( (__m128i *) ( output + 128 ), _mm_xor_si128( c,
+        _mm_loadu_si128( (const __m128i *) ( input + 128 ) ) ) );
+    _mm_storeu_si128( (__m128i *) ( output + 192 ), _mm_xor_si128( d,
+        _mm_loadu_si128( (const __m128i *) ( input + 192 ) ) ) );
+}
+
+/*
+ * Four blocks with SSE2 (always present on x86-64)
+ */
+static void chacha20_sse2_4x( uint32_t state[16],
+                              const unsigned char *input,
+                              unsigned char *output )
+{
+    __m128i s[16], x[16];
+    size_t i;
+
+    for( i = 0; i < 16; i++ )
+        s[i] = _mm_set1_epi32( (int) state[i] );
+    s[12] = _mm_add_epi32( s[12], _mm_set_epi32( 3, 2, 1, 0 ) );
+
+    for( i = 0; i < 16; i++ )
+        x[i] = s[i];
+
+    for( i = 0; i < 10; i++ )
+    {
+        SSE2_QUARTERROUND( x, 0, 4,  8, 12 );
+        SSE2_QUARTERROUND( x, 1, 5,  9, 13 );
+        SSE2_QUARTERROUND( x, 2, 6, 10, 14 );
+        SSE2_QUARTERROUND( x, 3, 7, 11, 15 );
+
+        SSE2_QUARTERROUND( x, 0, 5, 10, 15 );
+        SSE2_QUARTERROUND( x, 1, 6, 11, 12 );
+        SSE2_QUARTERROUND( x, 2, 7,  8, 13 );
+        SSE2_QUARTERROUND( x, 3, 4,  9, 14 );
+    }
+
+    for( i = 0; i < 16; i++ )
+        x[i] = _mm_add_epi32( x[i], s[i] );
+
+    for( i = 0; i < 16; i += 4 )
+        chacha20_sse2_xor( x[i], x[i + 1], x[i + 2], x[i + 3],
+                           input + i * 4, output + i * 4 );
+
+    state[12] += 4;
+}
+
+#define AVX2_ROTL( v, c )                                               \
+    _mm256_or_si256( _mm256_slli_epi32( v, c ),                         \
+                     _mm256_srli_epi32( v, 32 - (c) ) )
+
+#define AVX2_QUARTERROUND( x, a, b, c, d )                              \
+{                                                                       \
+    x[a] = _mm256_add_epi32( x[a], x[b] );                              \
+    x[d] = _mm256_shuffle_epi8( _mm256_xor_si256( x[d], x[a] ), r16 );  \
+    x[c] = _mm256_add_epi32( x[c], x[d] );                              \
+    x[b] = _mm256_xor_si256( x[b], x[c] ); x[b] = AVX2_ROTL( x[b], 12 );\
+    x[a] = _mm256_add_epi32( x[a], x[b] );                              \
+    x[d] = _mm256_shuffle_epi8( _mm256_xor_si256( x[d], x[a] ), r8 );   \
+    x[c] = _mm256_add_epi32( x[c], x[d] );                              \
+    x[b] = _mm256_xor_si256( x[b], x[c] ); x[b] = AVX2_ROTL( x[b], 7 ); \
+}
+
+/*
+ * Transpose eight words of eight blocks back into block order and XOR
+ * them into 32 bytes of each of the eight output blocks. Within a
+ * 128-bit lane this is the SSE2 transpose; the lane swap at the end
+ * pairs words 0-3 and 4-7 of the same block.
+ */
+static inline CHACHA20_AVX2_TARGET void chacha20_avx2_xor( const __m256i *w,
+                                                    const unsigned char *input,
+                                                    unsigned char *output )
+{
+    __m256i t0, t1, t2, t3, u[4], v[4];
+    size_t k;
+
+    t0 = _mm256_unpacklo_epi32( w[0], w[1] );
+    t1 = _mm256_unpackhi_epi32( w[0], w[1] );
+    t2 = _mm256_unpacklo_epi32( w[2], w[3] );
+    t3 = _mm256_unpackhi_epi32( w[2], w[3] );
+    u[0] = _mm256_unpacklo_epi64( t0, t2 );
+    u[1] = _mm256_unpackhi_epi64( t0, t2 );
+    u[2] = _mm256_unpacklo_epi64( t1, t3 );
+    u[3] = _mm256_unpackhi_epi64( t1, t3 );
+
+    t0 = _mm256_unpacklo_epi32( w[4], w[5] );
+    t1 = _mm256_unpackhi_epi32( w[4], w[5] );
+    t2 = _mm256_unpacklo_epi32( w[6], w[7] );
+    t3 = _mm256_unpackhi_epi32( w[6], w[7] );
+    v[0] = _mm256_unpacklo_epi64( t0, t2 );
+    v[1] = _mm256_unpackhi_epi64( t0, t2 );
+    v[2] = _mm256_unpacklo_epi64( t1, t3 );
+    v[3] = _mm256_unpackhi_epi64( t1, t3 );
+
+    for( k = 0; k < 4; k++ )
+    {
+        t0 = _mm256_permute2x128_si256( u[k], v[k], 0x20 );
+        t1 = _mm256_permute2x128_si256( u[k], v[k], 0x31 );
+
+        _mm256_storeu_si256( (__m256i *) ( output + k * 64 ),
+            _mm256_xor_si256( t0, _mm256_loadu_si256(
+                (const __m256i *) ( input + k * 64 ) ) ) );
+        _mm256_storeu_si256( (__m256i *) ( output + k * 64 + 256 ),
+            _mm256_xor_si256( t1, _mm256_loadu_si256(
+                (const __m256i *) ( input + k * 64 + 256 ) ) ) );
+    }
+}
+
+/*
+ * Eight blocks with AVX2
+ */
+static CHACHA20_AVX2_TARGET void chacha20_avx2_8x( uint32_t state[16],
+                                                   const unsigned char *input,
+                                                   unsigned char *output )
+{
+    __m256i s[16], x[16];
+    const __m256i r16 = _mm256_setr_epi8(
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13 );
+    const __m256i r8 = _mm256_setr_epi8(
+        3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+        3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14 );
+    size_t i;
+
+    for( i = 0; i < 16; i++ )
+        s[i] = _mm256_set1_epi32( (int) state[i] );
+    s[12] = _mm256_add_epi32( s[12],
+                              _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+
+    for( i = 0; i < 16; i++ )
+        x[i] = s[i];
+
+    for( i = 0; i < 10; i++ )
+    {
+        AVX2_QUARTERROUND( x, 0, 4,  8, 12 );
+        AVX2_QUARTERROUND( x, 1, 5,  9, 13 );
+        AVX2_QUARTERROUND( x, 2, 6, 10, 14 );
+        AVX2_QUARTERROUND( x, 3, 7, 11, 15 );
+
+        AVX2_QUARTERROUND( x, 0, 5, 10, 15 );
+        AVX2_QUARTERROUND( x, 1, 6, 11, 12 );
+        AVX2_QUARTERROUND( x, 2, 7,  8, 13 );
+        AVX2_QUARTERROUND( x, 3, 4,  9, 14 );
+    }
+
+    for( i = 0; i < 16; i++ )
+        x[i] = _mm256_add_epi32( x[i], s[i] );
+
+    chacha20_avx2_xor( x, input, output );
+    chacha20_avx2_xor( x + 8, input + 32, output + 32 );
+
+    _mm256_zeroupper();
+
+    state[12] += 8;
+}
+
+#endif /* CHACHA20_X86_64 */
+
+#if defined(CHACHA20_NEON)
+
+#define NEON_ROTL( v, c )                                               \
+    vorrq_u32( vshlq_n_u32( v, c ), vshrq_n_u32( v, 32 - (c) ) )
+
+#define NEON_ROTL16( v )                                                \
+    vreinterpretq_u32_u16( vrev32q_u16( vreinterpretq_u16_u32( v ) ) )
+
+#define NEON_QUARTERROUND( x, a, b, c, d )                              \
+{                                                                       \
+    x[a] = vaddq_u32( x[a], x[b] );                                     \
+    x[d] = veorq_u32( x[d], x[a] ); x[d] = NEON_ROTL16( x[d] );         \
+    x[c] = vaddq_u32( x[c], x[d] );                                     \
+    x[b] = veorq_u32( x[b], x[c] ); x[b] = NEON_ROTL( x[b], 12 );       \
+    x[a] = vaddq_u32( x[a], x[b] );                                     \
+    x[d] = veorq_u32( x[d], x[a] ); x[d] = NEON_ROTL( x[d], 8 );        \
+    x[c] = vaddq_u32( x[c], x[d] );                                     \
+    x[b] = veorq_u32( x[b], x[c] ); x[b] = NEON_ROTL( x[b], 7 );        \
+}
+
+#define NEON_XOR_BLOCK( v, off )                                        \
+    vst1q_u8( output + (off), veorq_u8( vreinterpretq_u8_u32( v ),      \
+                                        vld1q_u8( input + (off) ) ) )
+
+/*
+ * Transpose four words of four blocks back into block order and XOR
+ * them into 16 bytes of each of the four output blocks
+ */
+static inline void chacha20_neon_xor( uint32x4_t a, uint32x4_t b,
+                                      uint32x4_t c, uint32x4_t d,
+                                      const unsigned char *input,
+                                      unsigned char *output )
+{
+    uint32x4x2_t p = vtrnq_u32( a, b );
+    uint32x4x2_t q = vtrnq_u32( c, d );
+
+    NEON_XOR_BLOCK( vcombine_u32( vget_low_u32( p.val[0] ),
+                                  vget_low_u32( q.val[0] ) ), 0 );
+    NEON_XOR_BLOCK( vcombine_u32( vget_low_u32( p.val[1] ),
+                                  vget_low_u32( q.val[1] ) ), 64 );
+    NEON_XOR_BLOCK( vcombine_u32( vget_high_u32( p.val[0] ),
+                                  vget_high_u32( q.val[0] ) ), 128 );
+    NEON_XOR_BLOCK( vcombine_u32( vget_high_u32( p.val[1] ),
+                                  vget_high_u32( q.val[1] ) ), 192 );
+}
+
+/*
+ * Four blocks with NEON
+ */
+static void chacha20_neon_4x( uint32_t state[16],
+                              const unsigned char *input,
+                              unsigned char *output )
+{
+    static const uint32_t lanes[4] = { 0, 1, 2, 3 };
+    uint32x4_t s[16], x[16];
+    size_t i;
+
+    for( i = 0; i < 16; i++ )
+        s[i] = vdupq_n_u32( state[i] );
+    s[12] = vaddq_u32( s[12], vld1q_u32( lanes ) );
+
+    for( i = 0; i < 16; i++ )
+        x[i] = s[i];
+
+    for( i = 0; i < 10; i++ )
+    {
+        NEON_QUARTERROUND( x, 0, 4,  8, 12 );
+        NEON_QUARTERROUND( x, 1, 5,  9, 13 );
+        NEON_QUARTERROUND( x, 2, 6, 10, 14 );
+        NEON_QUARTERROUND( x, 3, 7, 11, 15 );
+
+        NEON_QUARTERROUND( x, 0, 5, 10, 15 );
+        NEON_QUARTERROUND( x, 1, 6, 11, 12 );
+        NEON_QUARTERROUND( x, 2, 7,  8, 13 );
+        NEON_QUARTERROUND( x, 3, 4,  9, 14 );
+    }
+
+    for( i = 0; i < 16; i++ )
+        x[i] = vaddq_u32( x[i], s[i] );
+
+    for( i = 0; i < 16; i += 4 )
+        chacha20_neon_xor( x[i], x[i + 1], x[i + 2], x[i + 3],
+                           input + i * 4, output + i * 4 );
+
+    state[12] += 4;
+}
+
+#endif /* CHACHA20_NEON */
+
+/*
+ * XOR whole blocks of keystream into the output, advancing the counter
+ */
+static void chacha20_xor_blocks( uint32_t state[16], size_t blocks,
+                                 const unsigned char *input,
+                                 unsigned char *output )
+{
+    unsigned char keystream[64];
+    size_t i;
+
+#if defined(CHACHA20_X86_64)
+    if( blocks >= 8 && chacha20_has_avx2() )
+    {
+        for( ; blocks >= 8; blocks -= 8, input += 512, output += 512 )
+            chacha20_avx2_8x( state, input, output );
+    }
+
+    for( ; blocks >= 4; blocks -= 4, input += 256, output += 256 )
+        chacha20_sse2_4x( state, input, output );
+#elif defined(CHACHA20_NEON)
+    for( ; blocks >= 4; blocks -= 4, input += 256, output += 256 )
+        chacha20_neon_4x( state, input, output );
+#endif
+
+    for( ; blocks > 0; blocks--, input += 64, output += 64 )
+    {
+        chacha20_block( state, keystream );
+        state[12]++;
+
+        for( i = 0; i < 64; i++ )
+            output[i] = input[i] ^ keystream[i];
+    }
+
+    mbedtls_zeroize( keystream, sizeof( keystream ) );
+}
+
+void mbedtls_chacha20_init( mbedtls_chacha20_context *ctx )
+{
+    memset( ctx, 0, sizeof( mbedtls_chacha20_context ) );
+
+    /* No keystream left over until the first partial block */
+    ctx->offset = 64;
+}
+
+void mbedtls_chacha20_free( mbedtls_chacha20_context *ctx )
+{
+    if( ctx == NULL )
+        return;
+
+    mbedtls_zeroize( ctx, sizeof( mbedtls_chacha20_context ) );
+}
+
+/*
+ * ChaCha20 key schedule
+ */
+int mbedtls_chacha20_setkey( mbedtls_chacha20_context *ctx,
+                             const unsigned char key[32] )
+{
+    size_t i;
+
+    if( ctx == NULL || key == NULL )
+        return( MBEDTLS_ERR_CHACHA20_BAD_INPUT_DATA );
+
+    /* "expand 32-byte k" */
+    ctx->state[0] = 0x61707865;
+    ctx->state[1] = 0x3320646e;
+    ctx->state[2] = 0x79622d32;
+    ctx->state[3] = 0x6b206574;
+
+    for( i = 0; i < 8; i++ )
+        GET_UINT32_LE( ctx->state[4 + i], key, i << 2 );
+
+    return( 0 );
+}
+
+/*
+ * Set nonce and block counter
+ */
+int mbedtls_chacha20_starts( mbedtls_chacha20_context *ctx,
+                             const unsigned char nonce[12],
+                             uint32_t counter )
+{
+    if( ctx == NULL || nonce == NULL )
+        return( MBEDTLS_ERR_CHACHA20_BAD_INPUT_DATA );
+
+    ctx->state[12] = counter;
+    GET_UINT32_LE( ctx->state[13], nonce, 0 );
+    GET_UINT32_LE( ctx->state[14], nonce, 4 );
+    GET_UINT32_LE( ctx->state[15], nonce, 8 );
+
+    mbedtls_zeroize( ctx->keystream, sizeof( ctx->keystream ) );
+    ctx->offset = 64;
+
+    return( 0 );
+}
+
+/*
+ * ChaCha20 cipher function
+ */
+int mbedtls_chacha20_update( mbedtls_chacha20_context *ctx,
+                             size_t size,
+                             const unsigned char *input,
+                             unsigned char *output )
+{
+    size_t blocks, i;
+
+    if( ctx == NULL )
+        return( MBEDTLS_ERR_CHACHA20_BAD_INPUT_DATA );
+
+    if( size > 0 && ( input == NULL || output == NULL ) )
+        return( MBEDTLS_ERR_CHACHA20_BAD_INPUT_DATA );
+
+    /* Use up the keystream left over from the previous call */
+    while( size > 0 && ctx->offset < 64 )
+    {
+        *output++ = *input++ ^ ctx->keystream[ctx->offset++];
+        size--;
+    }
+
+    blocks = size / 64;
+    if( blocks > 0 )
+    {
+        chacha20_xor_blocks( ctx->state, blocks, input, output );
+        input += blocks * 64;
+        output += blocks * 64;
+        size -= blocks * 64;
+    }
+
+    if( size > 0 )
+    {
+        chacha20_block( ctx->state, ctx->keystream );
+        ctx->state[12]++;
+
+        for( i = 0; i < size; i++ )
+            output[i] = input[i] ^ ctx->keystream[i];
+
+        ctx->offset = size;
+    }
+
+    return( 0 );
+}
+
+#endif /* !MBEDTLS_CHACHA20_ALT */
+
+/*
+ * One-shot ChaCha20
+ */
+int mbedtls_chacha20_crypt( const unsigned char key[32],
+                            const unsigned char nonce[12],
+                            uint32_t counter,
+                            size_t size,
+                            const unsigned char *input,
+                            unsigned char *output )
+{
+    mbedtls_chacha20_context ctx;
+    int ret;
+
+    mbedtls_chacha20_init( &ctx );
+
+    if( ( ret = mbedtls_chacha20_setkey( &ctx, key ) ) != 0 )
+        goto cleanup;
+
+    if( ( ret = mbedtls_chacha20_starts( &ctx, nonce, counter ) ) != 0 )
+        goto cleanup;
+
+    ret = mbedtls_chacha20_update( &ctx, size, input, output );
+
+cleanup:
+    mbedtls_chacha20_free( &ctx );
+    return( ret );
+}
+
+#if defined(MBEDTLS_SELF_TEST)
+/*
+ * RFC 7539 test vectors: A.2 #1 (all-zero key and nonce) and the
+ * section 2.4.2 example
+ */
+static const unsigned char chacha20_test_key[2][32] =
+{
+    { 0 },
+    { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+      0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+      0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+      0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f }
+};
+
+static const unsigned char chacha20_test_nonce[2][12] =
+{
+    { 0 },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4a,
+      0x00, 0x00, 0x00, 0x00 }
+};
+
+static const uint32_t chacha20_test_counter[2] = { 0, 1 };
+
+static const size_t chacha20_test_len[2] = { 64, 114 };
+
+static const unsigned char chacha20_test_pt[2][114] =
+{
+    { 0 },
+    { 'L', 'a', 'd', 'i', 'e', 's', ' ', 'a', 'n', 'd', ' ', 'G',
+      'e', 'n', 't', 'l', 'e', 'm', 'e', 'n', ' ', 'o', 'f', ' ',
+      't', 'h', 'e', ' ', 'c', 'l', 'a', 's', 's', ' ', 'o', 'f',
+      ' ', '\'', '9', '9', ':', ' ', 'I', 'f', ' ', 'I', ' ', 'c',
+      'o', 'u', 'l', 'd', ' ', 'o', 'f', 'f', 'e', 'r', ' ', 'y',
+      'o', 'u', ' ', 'o', 'n', 'l', 'y', ' ', 'o', 'n', 'e', ' ',
+      't', 'i', 'p', ' ', 'f', 'o', 'r', ' ', 't', 'h', 'e', ' ',
+      'f', 'u', 't', 'u', 'r', 'e', ',', ' ', 's', 'u', 'n', 's',
+      'c', 'r', 'e', 'e', 'n', ' ', 'w', 'o', 'u', 'l', 'd', ' ',
+      'b', 'e', ' ', 'i', 't', '.' }
+};
+
+static const unsigned char chacha20_test_ct[2][114] =
+{
+    { 0x76, 0xb8, 0xe0, 0xad, 0xa0, 0xf1, 0x3d, 0x90,
+      0x40, 0x5d, 0x6a, 0xe5, 0x53, 0x86, 0xbd, 0x28,
+      0xbd, 0xd2, 0x19, 0xb8, 0xa0, 0x8d, 0xed, 0x1a,
+      0xa8, 0x36, 0xef, 0xcc, 0x8b, 0x77, 0x0d, 0xc7,
+      0xda, 0x41, 0x59, 0x7c, 0x51, 0x57, 0x48, 0x8d,
+      0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+      0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c,
+      0xc3, 0x87, 0xb6, 0x69, 0xb2, 0xee, 0x65, 0x86 },
+    { 0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80,
+      0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+      0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2,
+      0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+      0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab,
+      0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+      0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab,
+      0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+      0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61,
+      0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+      0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06,
+      0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+      0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6,
+      0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+      0x87, 0x4d }
+};
+
+/*
+ * Checkup routine
+ */
+int mbedtls_chacha20_self_test( int verbose )
+{
+    int i, ret = 0;
+    size_t n;
+    unsigned char output[1024];
+    unsigned char check[1024];
+    mbedtls_chacha20_context ctx;
+
+    mbedtls_chacha20_init( &ctx );
+
+    for( i = 0; i < 2; i++ )
+    {
+        if( verbose != 0 )
+            mbedtls_printf( "  ChaCha20 test #%d: ", i + 1 );
+
+        mbedtls_chacha20_crypt( chacha20_test_key[i], chacha20_test_nonce[i],
+                                chacha20_test_counter[i], chacha20_test_len[i],
+                                chacha20_test_pt[i], output );
+
+        if( memcmp( output, chacha20_test_ct[i], chacha20_test_len[i] ) != 0 )
+        {
+            if( verbose != 0 )
+                mbedtls_printf( "failed\n" );
+
+            ret = 1;
+            goto exit;
+        }
+
+        if( verbose != 0 )
+            mbedtls_printf( "passed\n" );
+    }
+
+    /*
+     * The multi-block kernels must agree with the one-block path:
+     * encrypt 16 blocks at once, then byte by byte.
+     */
+    if( verbose != 0 )
+        mbedtls_printf( "  ChaCha20 test #3: " );
+
+    memset( output, 0, sizeof( output ) );
+    mbedtls_chacha20_crypt( chacha20_test_key[1], chacha20_test_nonce[1],
+                            0xfffffffe, sizeof( output ), output, output );
+
+    memset( check, 0, sizeof( check ) );
+    mbedtls_chacha20_setkey( &ctx, chacha20_test_key[1] );
+    mbedtls_chacha20_starts( &ctx, chacha20_test_nonce[1], 0xfffffffe );
+    for( n = 0; n < sizeof( check ); n++ )
+        mbedtls_chacha20_update( &ctx, 1, check + n, check + n );
+
+    if( memcmp( output, check, sizeof( output ) ) != 0 )
+    {
+        if( verbose != 0 )
+            mbedtls_printf( "failed\n" );
+
+        ret = 1;
+        goto exit;
+    }
+
+    if( verbose != 0 )
+        mbedtls_printf( "passed\n" );
+
+exit:
+    mbedtls_chacha20_free( &ctx );
+
+    if( verbose != 0 )
+        mbedtls_printf( "\n" );
+
+    return( ret );
+}
+
+#endif /* MBEDTLS_SELF_TEST */
+
+#endif /* MBEDTLS_CHACHA20_C */
@@ -0,0 +1,439 @@
+/*
+ *  ChaCha20-Poly1305 AEAD construction
+ *
+ *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+/*
+ * Definition of the construction:
+ * RFC 7539 "ChaCha20 and Poly1305 for IETF Protocols", section 2.8
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_CHACHAPOLY_C)
+
+#include "mbedtls/chachapoly.h"
+
+#include <string.h>
+
+#if defined(MBEDTLS_SELF_TEST)
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdio.h>
+#define mbedtls_printf printf
+#endif /* MBEDTLS_PLATFORM_C */
+#endif /* MBEDTLS_SELF_TEST */
+
+#define CHACHAPOLY_STATE_INIT       0
+#define CHACHAPOLY_STATE_AAD        1
+#define CHACHAPOLY_STATE_CIPHERTEXT 2 /* Encrypting or decrypting */
+#define CHACHAPOLY_STATE_FINISHED   3
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize( void *v, size_t n ) {
+    volatile unsigned char *p = v; while( n-- ) *p++ = 0;
+}
+
+/*
+ * Pad the authenticated data so far to a multiple of 16 bytes
+ */
+static int chachapoly_pad( mbedtls_chachapoly_context *ctx, uint64_t len )
+{
+    static const unsigned char zeroes[15] = { 0 };
+    uint32_t partial = (uint32_t) ( len % 16 );
+
+    if( partial == 0 )
+        return( 0 );
+
+    return( mbedtls_poly1305_update( &ctx->poly1305_ctx, zeroes,
+                                     16 - partial ) );
+}
+
+void mbedtls_chachapoly_init( mbedtls_chachapoly_context *ctx )
+{
+    memset( ctx, 0, sizeof( mbedtls_chachapoly_context ) );
+
+    mbedtls_chacha20_init( &ctx->chacha20_ctx );
+    mbedtls_poly1305_init( &ctx->poly1305_ctx );
+}
+
+void mbedtls_chachapoly_free( mbedtls_chachapoly_context *ctx )
+{
+    if( ctx == NULL )
+        return;
+
+    mbedtls_chacha20_free( &ctx->chacha20_ctx );
+    mbedtls_poly1305_free( &ctx->poly1305_ctx );
+    mbedtls_zeroize( ctx, sizeof( mbedtls_chachapoly_context ) );
+}
+
+int mbedtls_chachapoly_setkey( mbedtls_chachapoly_context *ctx,
+                               const unsigned char key[32] )
+{
+    if( ctx == NULL )
+        return( MBEDTLS_ERR_CHACHA20_BAD_INPUT_DATA );
+
+    return( mbedtls_chacha20_setkey( &ctx->chacha20_ctx, key ) );
+}
+
+int mbedtls_chachapoly_starts( mbedtls_chachapoly_context *ctx,
+                               const unsigned char nonce[12],
+                               int mode )
+{
+    int ret;
+    unsigned char poly1305_key[64];
+
+    if( ctx == NULL )
+        return( MBEDTLS_ERR_CHACHA20_BAD_INPUT_DATA );
+
+    /* The Poly1305 key is the first half of keystream block 0 */
+    if( ( ret = mbedtls_chacha20_starts( &ctx->chacha20_ctx, nonce, 0 ) ) != 0 )
+        goto cleanup;
+
+    memset( poly1305_key, 0, sizeof( poly1305_key ) );
+    if( ( ret = mbedtls_chacha20_update( &ctx->chacha20_ctx, sizeof( poly1305_key ),
+                                         poly1305_key, poly1305_key ) ) != 0 )
+        goto cleanup;
+
+    /* Encryption proper starts at block 1, where the stream now stands */
+    if( ( ret = mbedtls_poly1305_starts( &ctx->poly1305_ctx, poly1305_key ) ) != 0 )
+        goto cleanup;
+
+    ctx->aad_len        = 0;
+    ctx->ciphertext_len = 0;
+    ctx->state          = CHACHAPOLY_STATE_AAD;
+    ctx->mode           = mode;
+
+cleanup:
+    mbedtls_zeroize( poly1305_key, sizeof( poly1305_key ) );
+    return( ret );
+}
+
+int mbedtls_chachapoly_update_aad( mbedtls_chachapoly_context *ctx,
+                                   const unsigned char *aad,
+                                   size_t aad_len )
+{
+    if( ctx == NULL )
+        return( MBEDTLS_ERR_POLY1305_BAD_INPUT_DATA );
+
+    if( ctx->state != CHACHAPOLY_STATE_AAD )
+        return( MBEDTLS_ERR_CHACHAPOLY_BAD_STATE );
+
+    ctx->aad_len += aad_len;
+
+    return( mbedtls_poly1305_update( &ctx->poly1305_ctx, aad, aad_len ) );
+}
+
+int mbedtls_chachapoly_update( mbedtls_chachapoly_context *ctx,
+                               size_t len,
+                               const unsigned char *input,
+                               unsigned char *output )
+{
+    int ret;
+
+    if( ctx == NULL )
+        return( MBEDTLS_ERR_POLY1305_BAD_INPUT_DATA );
+
+    if( ctx->state != CHACHAPOLY_STATE_AAD &&
+        ctx->state != CHACHAPOLY_STATE_CIPHERTEXT )
+    {
+        return( MBEDTLS_ERR_CHACHAPOLY_BAD_STATE );
+    }
+
+    if( ctx->state == CHACHAPOLY_STATE_AAD )
+    {
+        ctx->state = CHACHAPOLY_STATE_CIPHERTEXT;
+
+        if( ( ret = chachapoly_pad( ctx, ctx->aad_len ) ) != 0 )
+            return( ret );
+    }
+
+    ctx->ciphertext_len += len;
+
+    /* The MAC always covers the ciphertext */
+    if( ctx->mode == MBEDTLS_CHACHAPOLY_ENCRYPT )
+    {
+        if( ( ret = mbedtls_chacha20_update( &ctx->chacha20_ctx, len,
+                                             input, output ) ) != 0 )
+            return( ret );
+
+        ret = mbedtls_poly1305_update( &ctx->poly1305_ctx, output, len );
+    }
+    else
+    {
+        if( ( ret = mbedtls_poly1305_update( &ctx->poly1305_ctx,
+                                             input, len ) ) != 0 )
+            return( ret );
+
+        ret = mbedtls_chacha20_update( &ctx->chacha20_ctx, len, input, output );
+    }
+
+    return( ret );
+}
+
+int mbedtls_chachapoly_finish( mbedtls_chachapoly_context *ctx,
+                               unsigned char mac[16] )
+{
+    int ret;
+    unsigned char len_block[16];
+    size_t i;
+
+    if( ctx == NULL || mac == NULL )
+        return( MBEDTLS_ERR_POLY1305_BAD_INPUT_DATA );
+
+    if( ctx->state == CHACHAPOLY_STATE_INIT ||
+        ctx->state == CHACHAPOLY_STATE_FINISHED )
+    {
+        return( MBEDTLS_ERR_CHACHAPOLY_BAD_STATE );
+    }
+
+    if( ctx->state == CHACHAPOLY_STATE_AAD )
+    {
+        if( ( ret = chachapoly_pad( ctx, ctx->aad_len ) ) != 0 )
+            return( ret );
+    }
+    else
+    {
+        if( ( ret = chachapoly_pad( ctx, ctx->ciphertext_len ) ) != 0 )
+            return( ret );
+    }
+
+    ctx->state = CHACHAPOLY_STATE_FINISHED;
+
+    /* le64( aad_len ) || le64( ciphertext_len ) */
+    for( i = 0; i < 8; i++ )
+    {
+        len_block[i]     = (unsigned char)( ctx->aad_len        >> ( i * 8 ) );
+        len_block[i + 8] = (unsigned char)( ctx->ciphertext_len >> ( i * 8 ) );
+    }
+
+    if( ( ret = mbedtls_poly1305_update( &ctx->poly1305_ctx, len_block,
+                                         sizeof( len_block ) ) ) != 0 )
+        return( ret );
+
+    return( mbedtls_poly1305_finish( &ctx->poly1305_ctx, mac ) );
+}
+
+static int chachapoly_crypt_and_tag( mbedtls_chachapoly_context *ctx,
+                                     int mode,
+                                     size_t length,
+                                     const unsigned char nonce[12],
+                                     const unsigned char *aad,
+                                     size_t aad_len,
+                                     const unsigned char *input,
+                                     unsigned char *output,
+                                     unsigned char tag[16] )
+{
+    int ret;
+
+    if( ( ret = mbedtls_chachapoly_starts( ctx, nonce, mode ) ) != 0 )
+        return( ret );
+
+    if( ( ret = mbedtls_chachapoly_update_aad( ctx, aad, aad_len ) ) != 0 )
+        return( ret );
+
+    if( ( ret = mbedtls_chachapoly_update( ctx, length, input, output ) ) != 0 )
+        return( ret );
+
+    return( mbedtls_chachapoly_finish( ctx, tag ) );
+}
+
+int mbedtls_chachapoly_encrypt_and_tag( mbedtls_chachapoly_context *ctx,
+                                        size_t length,
+                                        const unsigned char nonce[12],
+                                        const unsigned char *aad,
+                                        size_t aad_len,
+                                        const unsigned char *input,
+                                        unsigned char *output,
+                                        unsigned char tag[16] )
+{
+    return( chachapoly_crypt_and_tag( ctx, MBEDTLS_CHACHAPOLY_ENCRYPT,
+                                      length, nonce, aad, aad_len,
+                                      input, output, tag ) );
+}
+
+int mbedtls_chachapoly_auth_decrypt( mbedtls_chachapoly_context *ctx,
+                                     size_t length,
+                                     const unsigned char nonce[12],
+                                     const unsigned char *aad,
+                                     size_t aad_len,
+                                     const unsigned char tag[16],
+                                     const unsigned char *input,
+                                     unsigned char *output )
+{
+    int ret;
+    unsigned char check_tag[16];
+    size_t i;
+    int diff;
+
+    if( tag == NULL )
+        return( MBEDTLS_ERR_POLY1305_BAD_INPUT_DATA );
+
+    if( ( ret = chachapoly_crypt_and_tag( ctx, MBEDTLS_CHACHAPOLY_DECRYPT,
+                                          length, nonce, aad, aad_len,
+                                          input, output, check_tag ) ) != 0 )
+    {
+        return( ret );
+    }
+
+    /* Check tag in "constant-time" */
+    for( diff = 0, i = 0; i < sizeof( check_tag ); i++ )
+        diff |= tag[i] ^ check_tag[i];
+
+    if( diff != 0 )
+    {
+        mbedtls_zeroize( output, length );
+        return( MBEDTLS_ERR_CHACHAPOLY_AUTH_FAILED );
+    }
+
+    return( 0 );
+}
+
+#if defined(MBEDTLS_SELF_TEST)
+/*
+ * RFC 7539 section 2.8.2 example
+ */
+static const unsigned char chachapoly_test_key[32] =
+{
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+    0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f
+};
+
+static const unsigned char chachapoly_test_nonce[12] =
+{
+    0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43,
+    0x44, 0x45, 0x46, 0x47
+};
+
+static const unsigned char chachapoly_test_aad[12] =
+{
+    0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7
+};
+
+static const unsigned char chachapoly_test_pt[114] =
+{
+    'L', 'a', 'd', 'i', 'e', 's', ' ', 'a', 'n', 'd', ' ', 'G',
+    'e', 'n', 't', 'l', 'e', 'm', 'e', 'n', ' ', 'o', 'f', ' ',
+    't', 'h', 'e', ' ', 'c', 'l', 'a', 's', 's', ' ', 'o', 'f',
+    ' ', '\'', '9', '9', ':', ' ', 'I', 'f', ' ', 'I', ' ', 'c',
+    'o', 'u', 'l', 'd', ' ', 'o', 'f', 'f', 'e', 'r', ' ', 'y',
+    'o', 'u', ' ', 'o', 'n', 'l', 'y', ' ', 'o', 'n', 'e', ' ',
+    't', 'i', 'p', ' ', 'f', 'o', 'r', ' ', 't', 'h', 'e', ' ',
+    'f', 'u', 't', 'u', 'r', 'e', ',', ' ', 's', 'u', 'n', 's',
+    'c', 'r', 'e', 'e', 'n', ' ', 'w', 'o', 'u', 'l', 'd', ' ',
+    'b', 'e', ' ', 'i', 't', '.'
+};
+
+static const unsigned char chachapoly_test_ct[114] =
+{
+    0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb,
+    0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+    0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe,
+    0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6,
+    0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12,
+    0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+    0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29,
+    0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36,
+    0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c,
+    0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58,
+    0xfa, 0xb3, 0x24, 0xe4, 0xfa, 0xd6, 0x75, 0x94,
+    0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+    0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d,
+    0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+    0x61, 0x16
+};
+
+static const unsigned char chachapoly_test_mac[16] =
+{
+    0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a,
+    0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91
+};
+
+/*
+ * Checkup routine
+ */
+int mbedtls_chachapoly_self_test( int verbose )
+{
+    int ret = 0;
+    unsigned char output[114];
+    unsigned char mac[16];
+    mbedtls_chachapoly_context ctx;
+
+    mbedtls_chachapoly_init( &ctx );
+
+    if( verbose != 0 )
+        mbedtls_printf( "  ChaCha20-Poly1305 test #1 (enc): " );
+
+    mbedtls_chachapoly_setkey( &ctx, chachapoly_test_key );
+    mbedtls_chachapoly_encrypt_and_tag( &ctx, sizeof( chachapoly_test_pt ),
+                                        chachapoly_test_nonce,
+                                        chachapoly_test_aad,
+                                        sizeof( chachapoly_test_aad ),
+                                        chachapoly_test_pt, output, mac );
+
+    if( memcmp( output, chachapoly_test_ct, sizeof( output ) ) != 0 ||
+        memcmp( mac, chachapoly_test_mac, sizeof( mac ) ) != 0 )
+    {
+        if( verbose != 0 )
+            mbedtls_printf( "failed\n" );
+
+        ret = 1;
+        goto exit;
+    }
+
+    if( verbose != 0 )
+        mbedtls_printf( "passed\n  ChaCha20-Poly1305 test #1 (dec): " );
+
+    if( mbedtls_chachapoly_auth_decrypt( &ctx, sizeof( chachapoly_test_ct ),
+                                         chachapoly_test_nonce,
+                                         chachapoly_test_aad,
+                                         sizeof( chachapoly_test_aad ),
+                                         chachapoly_test_mac,
+                                         chachapoly_test_ct, output ) != 0 ||
+        memcmp( output, chachapoly_test_pt, sizeof( output ) ) != 0 )
+    {
+        if( verbose != 0 )
+            mbedtls_printf( "failed\n" );
+
+        ret = 1;
+        goto exit;
+    }
+
+    if( verbose != 0 )
+        mbedtls_printf( "passed\n" );
+
+exit:
+    mbedtls_chachapoly_free( &ctx );
+
+    if( verbose != 0 )
+        mbedtls_printf( "\n" );
+
+    return( ret );
+}
+
+#endif /* MBEDTLS_SELF_TEST */
+
+#endif /* MBEDTLS_CHACHAPOLY_C */
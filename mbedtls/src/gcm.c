@@ -126,7 +126,23 @@ static int gcm_gen_table( mbedtls_gcm_context *ctx )
 #if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
     /* With CLMUL support, we need only h, not the rest of the table */
     if( mbedtls_aesni_has_support( MBEDTLS_AESNI_CLMUL ) )
+    {
+        /* plus its first 8 powers, byte-reversed, for the bulk AES path */
+        if( ctx->aesni )
+        {
+            unsigned char p[16];
+
+            memcpy( p, h, 16 );
+            for( i = 0; i < 8; i++ )
+            {
+                for( j = 0; j < 16; j++ )
+                    ctx->HP[i][j] = p[15 - j];
+                mbedtls_aesni_gcm_mult( p, p, h );
+            }
+        }
+
         return( 0 );
+    }
 #endif
 
     /* 0 corresponds to 0 in GF(2^128) */
@@ -184,6 +200,15 @@ int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
         return( ret );
     }
 
+    ctx->aesni = 0;
+#if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
+    /* The bulk path drives the AES round keys directly */
+    if( cipher == MBEDTLS_CIPHER_ID_AES &&
+        mbedtls_aesni_has_support( MBEDTLS_AESNI_AES ) &&
+        mbedtls_aesni_has_support( MBEDTLS_AESNI_CLMUL ) )
+        ctx->aesni = 1;
+#endif
+
     if( ( ret = gcm_gen_table( ctx ) ) != 0 )
         return( ret );
 
@@ -370,6 +395,21 @@ int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
     ctx->len += length;
 
     p = input;
+
+#if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
+    if( ctx->aesni && length >= 128 )
+    {
+        use_len = mbedtls_aesni_gcm_crypt(
+                        (const mbedtls_aes_context *) ctx->cipher_ctx.cipher_ctx,
+                        ctx->mode, (const unsigned char (*)[16]) ctx->HP,
+                        ctx->y, ctx->buf, length, p, out_p );
+
+        length -= use_len;
+        p += use_len;
+        out_p += use_len;
+    }
+#endif /* MBEDTLS_AESNI_C && MBEDTLS_HAVE_X86_64 */
+
     while( length > 0 )
     {
         use_len = ( length < 16 ) ? length : 16;
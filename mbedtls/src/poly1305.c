@@ -0,0 +1,548 @@
+/*
+ *  Poly1305 one-time authenticator
+ *
+ *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+/*
+ *  The Poly1305 algorithm was designed by Daniel J. Bernstein.
+ *
+ *  http://cr.yp.to/mac/poly1305-20050329.pdf
+ *  https://tools.ietf.org/html/rfc7539
+ *
+ *  The limb arithmetic follows Andrew Moon's public domain poly1305-donna.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_POLY1305_C)
+
+#include "mbedtls/poly1305.h"
+
+#include <string.h>
+
+#if defined(MBEDTLS_SELF_TEST)
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdio.h>
+#define mbedtls_printf printf
+#endif /* MBEDTLS_PLATFORM_C */
+#endif /* MBEDTLS_SELF_TEST */
+
+#if !defined(MBEDTLS_POLY1305_ALT)
+
+/*
+ * With a 64x64->128 multiply a block costs 9 multiplies on three 44-bit
+ * limbs instead of 25 on five 26-bit limbs.
+ */
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+#define POLY1305_RADIX44
+typedef unsigned __int128 poly1305_uint128;
+#endif
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize( void *v, size_t n ) {
+    volatile unsigned char *p = v; while( n-- ) *p++ = 0;
+}
+
+/*
+ * 32-bit integer manipulation macros (little endian)
+ */
+#ifndef GET_UINT32_LE
+#define GET_UINT32_LE(n,b,i)                            \
+{                                                       \
+    (n) = ( (uint32_t) (b)[(i)    ]       )             \
+        | ( (uint32_t) (b)[(i) + 1] <<  8 )             \
+        | ( (uint32_t) (b)[(i) + 2] << 16 )             \
+        | ( (uint32_t) (b)[(i) + 3] << 24 );            \
+}
+#endif
+
+#ifndef PUT_UINT32_LE
+#define PUT_UINT32_LE(n,b,i)                                    \
+{                                                               \
+    (b)[(i)    ] = (unsigned char) ( ( (n)       ) & 0xFF );    \
+    (b)[(i) + 1] = (unsigned char) ( ( (n) >>  8 ) & 0xFF );    \
+    (b)[(i) + 2] = (unsigned char) ( ( (n) >> 16 ) & 0xFF );    \
+    (b)[(i) + 3] = (unsigned char) ( ( (n) >> 24 ) & 0xFF );    \
+}
+#endif
+
+#if defined(POLY1305_RADIX44)
+
+#define GET_UINT64_LE(n,b,i)                                    \
+{                                                               \
+    uint32_t lo_, hi_;                                          \
+    GET_UINT32_LE( lo_, b, (i) );                               \
+    GET_UINT32_LE( hi_, b, (i) + 4 );                           \
+    (n) = ( (uint64_t) hi_ << 32 ) | lo_;                       \
+}
+
+#define M44 ( (uint64_t) 0xfffffffffff )
+#define M42 ( (uint64_t) 0x3ffffffffff )
+
+static void poly1305_set_r( mbedtls_poly1305_context *ctx,
+                            const unsigned char key[16] )
+{
+    uint64_t t0, t1;
+
+    GET_UINT64_LE( t0, key, 0 );
+    GET_UINT64_LE( t1, key, 8 );
+
+    /* r &= 0xffffffc0ffffffc0ffffffc0fffffff */
+    ctx->r[0] = t0 & 0xffc0fffffff;
+    ctx->r[1] = ( ( t0 >> 44 ) | ( t1 << 20 ) ) & 0xfffffc0ffff;
+    ctx->r[2] = ( t1 >> 24 ) & 0x00ffffffc0f;
+}
+
+/*
+ * h = ( h + m ) * r mod 2^130 - 5, for each 16-byte block of input.
+ * hibit is 2^128 in limb 2, or zero for an already padded last block.
+ */
+static void poly1305_blocks( mbedtls_poly1305_context *ctx,
+                             const unsigned char *input, size_t blocks,
+                             uint64_t hibit )
+{
+    const uint64_t r0 = ctx->r[0], r1 = ctx->r[1], r2 = ctx->r[2];
+    const uint64_t s1 = r1 * ( 5 << 2 ), s2 = r2 * ( 5 << 2 );
+    uint64_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2];
+    uint64_t t0, t1, c;
+    poly1305_uint128 d0, d1, d2;
+
+    hibit <<= 40;
+
+    for( ; blocks > 0; blocks--, input += 16 )
+    {
+        GET_UINT64_LE( t0, input, 0 );
+        GET_UINT64_LE( t1, input, 8 );
+
+        h0 += t0 & M44;
+        h1 += ( ( t0 >> 44 ) | ( t1 << 20 ) ) & M44;
+        h2 += ( ( t1 >> 24 ) & M42 ) | hibit;
+
+        d0 = (poly1305_uint128) h0 * r0 + (poly1305_uint128) h1 * s2
+           + (poly1305_uint128) h2 * s1;
+        d1 = (poly1305_uint128) h0 * r1 + (poly1305_uint128) h1 * r0
+           + (poly1305_uint128) h2 * s2;
+        d2 = (poly1305_uint128) h0 * r2 + (poly1305_uint128) h1 * r1
+           + (poly1305_uint128) h2 * r0;
+
+        c = (uint64_t) ( d0 >> 44 ); h0 = (uint64_t) d0 & M44;
+        d1 += c; c = (uint64_t) ( d1 >> 44 ); h1 = (uint64_t) d1 & M44;
+        d2 += c; c = (uint64_t) ( d2 >> 42 ); h2 = (uint64_t) d2 & M42;
+        h0 += c * 5; c = h0 >> 44; h0 &= M44;
+        h1 += c;
+    }
+
+    ctx->h[0] = h0;
+    ctx->h[1] = h1;
+    ctx->h[2] = h2;
+}
+
+/*
+ * Fully reduce h, add s and write the low 128 bits
+ */
+static void poly1305_emit( mbedtls_poly1305_context *ctx,
+                           unsigned char mac[16] )
+{
+    uint64_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2];
+    uint64_t g0, g1, g2, c, t0, t1;
+
+    c = h1 >> 44; h1 &= M44;
+    h2 += c; c = h2 >> 42; h2 &= M42;
+    h0 += c * 5; c = h0 >> 44; h0 &= M44;
+    h1 += c; c = h1 >> 44; h1 &= M44;
+    h2 += c; c = h2 >> 42; h2 &= M42;
+    h0 += c * 5; c = h0 >> 44; h0 &= M44;
+    h1 += c;
+
+    /* g = h - p, selected in constant time if h >= p */
+    g0 = h0 + 5; c = g0 >> 44; g0 &= M44;
+    g1 = h1 + c; c = g1 >> 44; g1 &= M44;
+    g2 = h2 + c - ( (uint64_t) 1 << 42 );
+
+    c = ( g2 >> 63 ) - 1;
+    g0 &= c; g1 &= c; g2 &= c;
+    c = ~c;
+    h0 = ( h0 & c ) | g0;
+    h1 = ( h1 & c ) | g1;
+    h2 = ( h2 & c ) | g2;
+
+    t0 = ( (uint64_t) ctx->s[1] << 32 ) | ctx->s[0];
+    t1 = ( (uint64_t) ctx->s[3] << 32 ) | ctx->s[2];
+
+    h0 += t0 & M44; c = h0 >> 44; h0 &= M44;
+    h1 += ( ( ( t0 >> 44 ) | ( t1 << 20 ) ) & M44 ) + c; c = h1 >> 44; h1 &= M44;
+    h2 += ( ( t1 >> 24 ) & M42 ) + c; h2 &= M42;
+
+    h0 = h0 | ( h1 << 44 );
+    h1 = ( h1 >> 20 ) | ( h2 << 24 );
+
+    PUT_UINT32_LE( (uint32_t) h0, mac, 0 );
+    PUT_UINT32_LE( (uint32_t) ( h0 >> 32 ), mac, 4 );
+    PUT_UINT32_LE( (uint32_t) h1, mac, 8 );
+    PUT_UINT32_LE( (uint32_t) ( h1 >> 32 ), mac, 12 );
+}
+
+#else /* POLY1305_RADIX44 */
+
+#define M26 ( (uint32_t) 0x3ffffff )
+
+static void poly1305_set_r( mbedtls_poly1305_context *ctx,
+                            const unsigned char key[16] )
+{
+    uint32_t t0, t1, t2, t3, t4;
+
+    GET_UINT32_LE( t0, key, 0 );
+    GET_UINT32_LE( t1, key, 3 );
+    GET_UINT32_LE( t2, key, 6 );
+    GET_UINT32_LE( t3, key, 9 );
+    GET_UINT32_LE( t4, key, 12 );
+
+    /* r &= 0xffffffc0ffffffc0ffffffc0fffffff */
+    ctx->r[0] = ( t0      ) & 0x3ffffff;
+    ctx->r[1] = ( t1 >> 2 ) & 0x3ffff03;
+    ctx->r[2] = ( t2 >> 4 ) & 0x3ffc0ff;
+    ctx->r[3] = ( t3 >> 6 ) & 0x3f03fff;
+    ctx->r[4] = ( t4 >> 8 ) & 0x00fffff;
+}
+
+/*
+ * h = ( h + m ) * r mod 2^130 - 5, for each 16-byte block of input.
+ * hibit is 2^128 in limb 4, or zero for an already padded last block.
+ */
+static void poly1305_blocks( mbedtls_poly1305_context *ctx,
+                             const unsigned char *input, size_t blocks,
+                             uint64_t hibit )
+{
+    const uint32_t r0 = (uint32_t) ctx->r[0], r1 = (uint32_t) ctx->r[1],
+                   r2 = (uint32_t) ctx->r[2], r3 = (uint32_t) ctx->r[3],
+                   r4 = (uint32_t) ctx->r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = (uint32_t) ctx->h[0], h1 = (uint32_t) ctx->h[1],
+             h2 = (uint32_t) ctx->h[2], h3 = (uint32_t) ctx->h[3],
+             h4 = (uint32_t) ctx->h[4];
+    uint32_t t, c, hi = (uint32_t) hibit << 24;
+    uint64_t d0, d1, d2, d3, d4;
+
+    for( ; blocks > 0; blocks--, input += 16 )
+    {
+        GET_UINT32_LE( t, input, 0 );  h0 += ( t      ) & M26;
+        GET_UINT32_LE( t, input, 3 );  h1 += ( t >> 2 ) & M26;
+        GET_UINT32_LE( t, input, 6 );  h2 += ( t >> 4 ) & M26;
+        GET_UINT32_LE( t, input, 9 );  h3 += ( t >> 6 ) & M26;
+        GET_UINT32_LE( t, input, 12 ); h4 += ( t >> 8 ) | hi;
+
+        d0 = (uint64_t) h0 * r0 + (uint64_t) h1 * s4 + (uint64_t) h2 * s3
+           + (uint64_t) h3 * s2 + (uint64_t) h4 * s1;
+        d1 = (uint64_t) h0 * r1 + (uint64_t) h1 * r0 + (uint64_t) h2 * s4
+           + (uint64_t) h3 * s3 + (uint64_t) h4 * s2;
+        d2 = (uint64_t) h0 * r2 + (uint64_t) h1 * r1 + (uint64_t) h2 * r0
+           + (uint64_t) h3 * s4 + (uint64_t) h4 * s3;
+        d3 = (uint64_t) h0 * r3 + (uint64_t) h1 * r2 + (uint64_t) h2 * r1
+           + (uint64_t) h3 * r0 + (uint64_t) h4 * s4;
+        d4 = (uint64_t) h0 * r4 + (uint64_t) h1 * r3 + (uint64_t) h2 * r2
+           + (uint64_t) h3 * r1 + (uint64_t) h4 * r0;
+
+        c = (uint32_t) ( d0 >> 26 ); h0 = (uint32_t) d0 & M26;
+        d1 += c; c = (uint32_t) ( d1 >> 26 ); h1 = (uint32_t) d1 & M26;
+        d2 += c; c = (uint32_t) ( d2 >> 26 ); h2 = (uint32_t) d2 & M26;
+        d3 += c; c = (uint32_t) ( d3 >> 26 ); h3 = (uint32_t) d3 & M26;
+        d4 += c; c = (uint32_t) ( d4 >> 26 ); h4 = (uint32_t) d4 & M26;
+        h0 += c * 5; c = h0 >> 26; h0 &= M26;
+        h1 += c;
+    }
+
+    ctx->h[0] = h0;
+    ctx->h[1] = h1;
+    ctx->h[2] = h2;
+    ctx->h[3] = h3;
+    ctx->h[4] = h4;
+}
+
+/*
+ * Fully reduce h, add s and write the low 128 bits
+ */
+static void poly1305_emit( mbedtls_poly1305_context *ctx,
+                           unsigned char mac[16] )
+{
+    uint32_t h0 = (uint32_t) ctx->h[0], h1 = (uint32_t) ctx->h[1],
+             h2 = (uint32_t) ctx->h[2], h3 = (uint32_t) ctx->h[3],
+             h4 = (uint32_t) ctx->h[4];
+    uint32_t g0, g1, g2, g3, g4, c;
+    uint64_t f;
+
+    c = h1 >> 26; h1 &= M26;
+    h2 += c; c = h2 >> 26; h2 &= M26;
+    h3 += c; c = h3 >> 26; h3 &= M26;
+    h4 += c; c = h4 >> 26; h4 &= M26;
+    h0 += c * 5; c = h0 >> 26; h0 &= M26;
+    h1 += c;
+
+    /* g = h - p, selected in constant time if h >= p */
+    g0 = h0 + 5; c = g0 >> 26; g0 &= M26;
+    g1 = h1 + c; c = g1 >> 26; g1 &= M26;
+    g2 = h2 + c; c = g2 >> 26; g2 &= M26;
+    g3 = h3 + c; c = g3 >> 26; g3 &= M26;
+    g4 = h4 + c - ( 1UL << 26 );
+
+    c = ( g4 >> 31 ) - 1;
+    g0 &= c; g1 &= c; g2 &= c; g3 &= c; g4 &= c;
+    c = ~c;
+    h0 = ( h0 & c ) | g0;
+    h1 = ( h1 & c ) | g1;
+    h2 = ( h2 & c ) | g2;
+    h3 = ( h3 & c ) | g3;
+    h4 = ( h4 & c ) | g4;
+
+    h0 = ( ( h0       ) | ( h1 << 26 ) );
+    h1 = ( ( h1 >>  6 ) | ( h2 << 20 ) );
+    h2 = ( ( h2 >> 12 ) | ( h3 << 14 ) );
+    h3 = ( ( h3 >> 18 ) | ( h4 <<  8 ) );
+
+    f = (uint64_t) h0 + ctx->s[0];             h0 = (uint32_t) f;
+    f = (uint64_t) h1 + ctx->s[1] + ( f >> 32 ); h1 = (uint32_t) f;
+    f = (uint64_t) h2 + ctx->s[2] + ( f >> 32 ); h2 = (uint32_t) f;
+    f = (uint64_t) h3 + ctx->s[3] + ( f >> 32 ); h3 = (uint32_t) f;
+
+    PUT_UINT32_LE( h0, mac, 0 );
+    PUT_UINT32_LE( h1, mac, 4 );
+    PUT_UINT32_LE( h2, mac, 8 );
+    PUT_UINT32_LE( h3, mac, 12 );
+}
+
+#endif /* POLY1305_RADIX44 */
+
+void mbedtls_poly1305_init( mbedtls_poly1305_context *ctx )
+{
+    memset( ctx, 0, sizeof( mbedtls_poly1305_context ) );
+}
+
+void mbedtls_poly1305_free( mbedtls_poly1305_context *ctx )
+{
+    if( ctx == NULL )
+        return;
+
+    mbedtls_zeroize( ctx, sizeof( mbedtls_poly1305_context ) );
+}
+
+int mbedtls_poly1305_starts( mbedtls_poly1305_context *ctx,
+                             const unsigned char key[32] )
+{
+    if( ctx == NULL || key == NULL )
+        return( MBEDTLS_ERR_POLY1305_BAD_INPUT_DATA );
+
+    memset( ctx->h, 0, sizeof( ctx->h ) );
+    poly1305_set_r( ctx, key );
+
+    GET_UINT32_LE( ctx->s[0], key, 16 );
+    GET_UINT32_LE( ctx->s[1], key, 20 );
+    GET_UINT32_LE( ctx->s[2], key, 24 );
+    GET_UINT32_LE( ctx->s[3], key, 28 );
+
+    mbedtls_zeroize( ctx->queue, sizeof( ctx->queue ) );
+    ctx->queue_len = 0;
+
+    return( 0 );
+}
+
+int mbedtls_poly1305_update( mbedtls_poly1305_context *ctx,
+                             const unsigned char *input,
+                             size_t ilen )
+{
+    size_t fill, blocks;
+
+    if( ctx == NULL )
+        return( MBEDTLS_ERR_POLY1305_BAD_INPUT_DATA );
+
+    if( ilen > 0 && input == NULL )
+        return( MBEDTLS_ERR_POLY1305_BAD_INPUT_DATA );
+
+    if( ctx->queue_len > 0 )
+    {
+        fill = 16 - ctx->queue_len;
+
+        if( ilen < fill )
+        {
+            memcpy( ctx->queue + ctx->queue_len, input, ilen );
+            ctx->queue_len += ilen;
+            return( 0 );
+        }
+
+        memcpy( ctx->queue + ctx->queue_len, input, fill );
+        poly1305_blocks( ctx, ctx->queue, 1, 1 );
+        ctx->queue_len = 0;
+
+        input += fill;
+        ilen  -= fill;
+    }
+
+    blocks = ilen / 16;
+    if( blocks > 0 )
+    {
+        poly1305_blocks( ctx, input, blocks, 1 );
+        input += blocks * 16;
+        ilen  -= blocks * 16;
+    }
+
+    if( ilen > 0 )
+    {
+        memcpy( ctx->queue, input, ilen );
+        ctx->queue_len = ilen;
+    }
+
+    return( 0 );
+}
+
+int mbedtls_poly1305_finish( mbedtls_poly1305_context *ctx,
+                             unsigned char mac[16] )
+{
+    if( ctx == NULL || mac == NULL )
+        return( MBEDTLS_ERR_POLY1305_BAD_INPUT_DATA );
+
+    /* A short last block is padded with 0x01 and zeros, without 2^128 */
+    if( ctx->queue_len > 0 )
+    {
+        ctx->queue[ctx->queue_len] = 1;
+        memset( ctx->queue + ctx->queue_len + 1, 0,
+                15 - ctx->queue_len );
+        poly1305_blocks( ctx, ctx->queue, 1, 0 );
+        ctx->queue_len = 0;
+    }
+
+    poly1305_emit( ctx, mac );
+
+    return( 0 );
+}
+
+#endif /* !MBEDTLS_POLY1305_ALT */
+
+int mbedtls_poly1305_mac( const unsigned char key[32],
+                          const unsigned char *input,
+                          size_t ilen,
+                          unsigned char mac[16] )
+{
+    mbedtls_poly1305_context ctx;
+    int ret;
+
+    mbedtls_poly1305_init( &ctx );
+
+    if( ( ret = mbedtls_poly1305_starts( &ctx, key ) ) != 0 )
+        goto cleanup;
+
+    if( ( ret = mbedtls_poly1305_update( &ctx, input, ilen ) ) != 0 )
+        goto cleanup;
+
+    ret = mbedtls_poly1305_finish( &ctx, mac );
+
+cleanup:
+    mbedtls_poly1305_free( &ctx );
+    return( ret );
+}
+
+#if defined(MBEDTLS_SELF_TEST)
+/*
+ * RFC 7539 test vectors: A.3 #1 (all zero) and the section 2.5.2 example
+ */
+static const unsigned char poly1305_test_key[2][32] =
+{
+    { 0 },
+    { 0x85, 0xd6, 0xbe, 0x78, 0x57, 0x55, 0x6d, 0x33,
+      0x7f, 0x44, 0x52, 0xfe, 0x42, 0xd5, 0x06, 0xa8,
+      0x01, 0x03, 0x80, 0x8a, 0xfb, 0x0d, 0xb2, 0xfd,
+      0x4a, 0xbf, 0xf6, 0xaf, 0x41, 0x49, 0xf5, 0x1b }
+};
+
+static const size_t poly1305_test_len[2] = { 64, 34 };
+
+static const unsigned char poly1305_test_msg[2][64] =
+{
+    { 0 },
+    { 'C', 'r', 'y', 'p', 't', 'o', 'g', 'r', 'a', 'p', 'h', 'i',
+      'c', ' ', 'F', 'o', 'r', 'u', 'm', ' ', 'R', 'e', 's', 'e',
+      'a', 'r', 'c', 'h', ' ', 'G', 'r', 'o', 'u', 'p' }
+};
+
+static const unsigned char poly1305_test_mac[2][16] =
+{
+    { 0 },
+    { 0xa8, 0x06, 0x1d, 0xc1, 0x30, 0x51, 0x36, 0xc6,
+      0xc2, 0x2b, 0x8b, 0xaf, 0x0c, 0x01, 0x27, 0xa9 }
+};
+
+/*
+ * Checkup routine
+ */
+int mbedtls_poly1305_self_test( int verbose )
+{
+    int i, ret = 0;
+    size_t n;
+    unsigned char mac[16];
+    mbedtls_poly1305_context ctx;
+
+    mbedtls_poly1305_init( &ctx );
+
+    for( i = 0; i < 2; i++ )
+    {
+        if( verbose != 0 )
+            mbedtls_printf( "  Poly1305 test #%d: ", i + 1 );
+
+        mbedtls_poly1305_mac( poly1305_test_key[i], poly1305_test_msg[i],
+                              poly1305_test_len[i], mac );
+
+        if( memcmp( mac, poly1305_test_mac[i], 16 ) != 0 )
+            goto fail;
+
+        /* Same message fed in uneven pieces */
+        mbedtls_poly1305_starts( &ctx, poly1305_test_key[i] );
+        for( n = 0; n < poly1305_test_len[i]; n += 5 )
+            mbedtls_poly1305_update( &ctx, poly1305_test_msg[i] + n,
+                poly1305_test_len[i] - n < 5 ? poly1305_test_len[i] - n : 5 );
+        mbedtls_poly1305_finish( &ctx, mac );
+
+        if( memcmp( mac, poly1305_test_mac[i], 16 ) != 0 )
+            goto fail;
+
+        if( verbose != 0 )
+            mbedtls_printf( "passed\n" );
+    }
+
+    goto exit;
+
+fail:
+    if( verbose != 0 )
+        mbedtls_printf( "failed\n" );
+
+    ret = 1;
+
+exit:
+    mbedtls_poly1305_free( &ctx );
+
+    if( verbose != 0 )
+        mbedtls_printf( "\n" );
+
+    return( ret );
+}
+
+#endif /* MBEDTLS_SELF_TEST */
+
+#endif /* MBEDTLS_POLY1305_C */
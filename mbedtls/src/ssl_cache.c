@@ -19,8 +19,11 @@
  *  This file is part of mbed TLS (https://tls.mbed.org)
  */
 /*
- * These session callbacks use a simple chained list
- * to store and retrieve the session information.
+ * These session callbacks store sessions in a hash table keyed by session
+ * id. The table is split into shards, each with its own mutex, so that
+ * concurrent handshakes rarely wait on each other. Each shard keeps its
+ * entries in order of use and evicts the least recently used one when it
+ * is full. Small caches use fewer shards, see ssl_cache_shard_count().
  */
 
 #if !defined(MBEDTLS_CONFIG_FILE)
@@ -43,18 +46,223 @@
 #define mbedtls_free       free
 #endif
 
+#define SSL_CACHE_MIN_BUCKETS   16
+
+/*
+ * A shard only evicts among its own entries. That stays close to one LRU
+ * over the whole cache as long as each shard holds a fair number of them.
+ */
+#define SSL_CACHE_MIN_SHARD_ENTRIES 32
+
+static int ssl_cache_shard_count( int max_entries )
+{
+    int n = max_entries / SSL_CACHE_MIN_SHARD_ENTRIES;
+
+    if( n < 1 )
+        return( 1 );
+    if( n > MBEDTLS_SSL_CACHE_SHARDS )
+        return( MBEDTLS_SSL_CACHE_SHARDS );
+    return( n );
+}
+
 void mbedtls_ssl_cache_init( mbedtls_ssl_cache_context *cache )
 {
     memset( cache, 0, sizeof( mbedtls_ssl_cache_context ) );
 
     cache->timeout = MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT;
     cache->max_entries = MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES;
+    cache->shard_count = ssl_cache_shard_count( cache->max_entries );
 
 #if defined(MBEDTLS_THREADING_C)
-    mbedtls_mutex_init( &cache->mutex );
+    {
+        int i;
+
+        for( i = 0; i < MBEDTLS_SSL_CACHE_SHARDS; i++ )
+            mbedtls_mutex_init( &cache->shards[i].mutex );
+    }
 #endif
 }
 
+/*
+ * FNV-1a over the session id. Ids are random, so this mostly serves to
+ * fold every byte into the 32 bits used for shard and bucket selection.
+ */
+static uint32_t ssl_cache_hash( const unsigned char *id, size_t id_len )
+{
+    uint32_t h = 2166136261u;
+    size_t i;
+
+    for( i = 0; i < id_len; i++ )
+        h = ( h ^ id[i] ) * 16777619u;
+
+    return( h );
+}
+
+static mbedtls_ssl_cache_shard *ssl_cache_shard( mbedtls_ssl_cache_context *cache,
+                                                 uint32_t hash )
+{
+    return( &cache->shards[hash % (uint32_t) cache->shard_count] );
+}
+
+static mbedtls_ssl_cache_entry **ssl_cache_bucket( mbedtls_ssl_cache_shard *shard,
+                                                   uint32_t hash )
+{
+    return( &shard->buckets[( hash / MBEDTLS_SSL_CACHE_SHARDS ) & shard->bucket_mask] );
+}
+
+/*
+ * Share of max_entries that belongs to a shard; the shares of the shards
+ * in use add up to exactly max_entries, and each is at least one unless
+ * max_entries is 0. A shard out of use, picked by a caller that raced
+ * with mbedtls_ssl_cache_set_max_entries(), gets nothing.
+ */
+static int ssl_cache_shard_max( const mbedtls_ssl_cache_context *cache,
+                                const mbedtls_ssl_cache_shard *shard )
+{
+    int i = (int)( shard - cache->shards );
+    int n = cache->shard_count;
+
+    if( i >= n )
+        return( 0 );
+
+    return( cache->max_entries / n + ( i < cache->max_entries % n ) );
+}
+
+static mbedtls_ssl_cache_entry *ssl_cache_find( mbedtls_ssl_cache_shard *shard,
+                                                uint32_t hash,
+                                                const mbedtls_ssl_session *session )
+{
+    mbedtls_ssl_cache_entry *cur;
+
+    if( shard->buckets == NULL )
+        return( NULL );
+
+    for( cur = *ssl_cache_bucket( shard, hash ); cur != NULL; cur = cur->next )
+    {
+        if( cur->hash == hash &&
+            cur->session.id_len == session->id_len &&
+            memcmp( cur->session.id, session->id, session->id_len ) == 0 )
+            return( cur );
+    }
+
+    return( NULL );
+}
+
+static void ssl_cache_lru_unlink( mbedtls_ssl_cache_shard *shard,
+                                  mbedtls_ssl_cache_entry *entry )
+{
+    if( entry->lru_prev != NULL )
+        entry->lru_prev->lru_next = entry->lru_next;
+    else
+        shard->lru_head = entry->lru_next;
+
+    if( entry->lru_next != NULL )
+        entry->lru_next->lru_prev = entry->lru_prev;
+    else
+        shard->lru_tail = entry->lru_prev;
+
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void ssl_cache_lru_push( mbedtls_ssl_cache_shard *shard,
+                                mbedtls_ssl_cache_entry *entry )
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+
+    if( shard->lru_head != NULL )
+        shard->lru_head->lru_prev = entry;
+    else
+        shard->lru_tail = entry;
+
+    shard->lru_head = entry;
+}
+
+static void ssl_cache_bucket_unlink( mbedtls_ssl_cache_shard *shard,
+                                     mbedtls_ssl_cache_entry *entry )
+{
+    mbedtls_ssl_cache_entry **pp = ssl_cache_bucket( shard, entry->hash );
+
+    while( *pp != entry )
+        pp = &(*pp)->next;
+
+    *pp = entry->next;
+    entry->next = NULL;
+}
+
+static void ssl_cache_entry_free( mbedtls_ssl_cache_entry *entry )
+{
+    mbedtls_ssl_session_free( &entry->session );
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    mbedtls_free( entry->peer_cert.p );
+#endif /* MBEDTLS_X509_CRT_PARSE_C */
+
+    mbedtls_free( entry );
+}
+
+/*
+ * Free all entries of a shard; its bucket array is kept.
+ */
+static void ssl_cache_shard_clear( mbedtls_ssl_cache_shard *shard )
+{
+    mbedtls_ssl_cache_entry *cur, *prv;
+
+    cur = shard->lru_head;
+
+    while( cur != NULL )
+    {
+        prv = cur;
+        cur = cur->lru_next;
+
+        ssl_cache_entry_free( prv );
+    }
+
+    if( shard->buckets != NULL )
+        memset( shard->buckets, 0,
+                ( shard->bucket_mask + 1 ) * sizeof( mbedtls_ssl_cache_entry * ) );
+
+    shard->lru_head = NULL;
+    shard->lru_tail = NULL;
+    shard->count = 0;
+}
+
+/*
+ * Keep the load factor at most 1 by doubling the bucket array. The entries
+ * are relinked by walking the use list, which holds all of them. Failing to
+ * grow only makes chains longer, so it is not an error.
+ */
+static int ssl_cache_grow( mbedtls_ssl_cache_shard *shard )
+{
+    mbedtls_ssl_cache_entry **buckets;
+    mbedtls_ssl_cache_entry *cur;
+    uint32_t size;
+
+    if( shard->buckets != NULL && (uint32_t) shard->count <= shard->bucket_mask )
+        return( 0 );
+
+    size = shard->buckets == NULL ? SSL_CACHE_MIN_BUCKETS
+                                  : ( shard->bucket_mask + 1 ) * 2;
+
+    buckets = mbedtls_calloc( size, sizeof( mbedtls_ssl_cache_entry * ) );
+    if( buckets == NULL )
+        return( shard->buckets == NULL );
+
+    mbedtls_free( shard->buckets );
+    shard->buckets = buckets;
+    shard->bucket_mask = size - 1;
+
+    for( cur = shard->lru_head; cur != NULL; cur = cur->lru_next )
+    {
+        mbedtls_ssl_cache_entry **bucket = ssl_cache_bucket( shard, cur->hash );
+
+        cur->next = *bucket;
+        *bucket = cur;
+    }
+
+    return( 0 );
+}
+
 int mbedtls_ssl_cache_get( void *data, mbedtls_ssl_session *session )
 {
     int ret = 1;
@@ -62,72 +270,76 @@ int mbedtls_ssl_cache_get( void *data, mbedtls_ssl_session *session )
     time_t t = time( NULL );
 #endif
     mbedtls_ssl_cache_context *cache = (mbedtls_ssl_cache_context *) data;
-    mbedtls_ssl_cache_entry *cur, *entry;
+    uint32_t hash = ssl_cache_hash( session->id, session->id_len );
+    mbedtls_ssl_cache_shard *shard = ssl_cache_shard( cache, hash );
+    mbedtls_ssl_cache_entry *entry;
 
 #if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_lock( &cache->mutex ) != 0 )
+    if( mbedtls_mutex_lock( &shard->mutex ) != 0 )
         return( 1 );
 #endif
 
-    cur = cache->chain;
-    entry = NULL;
-
-    while( cur != NULL )
-    {
-        entry = cur;
-        cur = cur->next;
+    entry = ssl_cache_find( shard, hash, session );
+    if( entry == NULL )
+        goto exit;
 
 #if defined(MBEDTLS_HAVE_TIME)
-        if( cache->timeout != 0 &&
-            (int) ( t - entry->timestamp ) > cache->timeout )
-            continue;
+    if( cache->timeout != 0 &&
+        (int) ( t - entry->timestamp ) > cache->timeout )
+    {
+        ssl_cache_bucket_unlink( shard, entry );
+        ssl_cache_lru_unlink( shard, entry );
+        shard->count--;
+        ssl_cache_entry_free( entry );
+        goto exit;
+    }
 #endif
 
-        if( session->ciphersuite != entry->session.ciphersuite ||
-            session->compression != entry->session.compression ||
-            session->id_len != entry->session.id_len )
-            continue;
-
-        if( memcmp( session->id, entry->session.id,
-                    entry->session.id_len ) != 0 )
-            continue;
+    if( session->ciphersuite != entry->session.ciphersuite ||
+        session->compression != entry->session.compression )
+        goto exit;
 
-        memcpy( session->master, entry->session.master, 48 );
+    memcpy( session->master, entry->session.master, 48 );
 
-        session->verify_result = entry->session.verify_result;
+    session->verify_result = entry->session.verify_result;
 
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
-        /*
-         * Restore peer certificate (without rest of the original chain)
-         */
-        if( entry->peer_cert.p != NULL )
+    /*
+     * Restore peer certificate (without rest of the original chain)
+     */
+    if( entry->peer_cert.p != NULL )
+    {
+        if( ( session->peer_cert = mbedtls_calloc( 1,
+                             sizeof(mbedtls_x509_crt) ) ) == NULL )
+            goto exit;
+
+        mbedtls_x509_crt_init( session->peer_cert );
+        if( mbedtls_x509_crt_parse( session->peer_cert, entry->peer_cert.p,
+                            entry->peer_cert.len ) != 0 )
         {
-            if( ( session->peer_cert = mbedtls_calloc( 1,
-                                 sizeof(mbedtls_x509_crt) ) ) == NULL )
-            {
-                ret = 1;
-                goto exit;
-            }
-
-            mbedtls_x509_crt_init( session->peer_cert );
-            if( mbedtls_x509_crt_parse( session->peer_cert, entry->peer_cert.p,
-                                entry->peer_cert.len ) != 0 )
-            {
-                mbedtls_free( session->peer_cert );
-                session->peer_cert = NULL;
-                ret = 1;
-                goto exit;
-            }
+            mbedtls_free( session->peer_cert );
+            session->peer_cert = NULL;
+            goto exit;
         }
+    }
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
-        ret = 0;
-        goto exit;
+    if( entry != shard->lru_head )
+    {
+        ssl_cache_lru_unlink( shard, entry );
+        ssl_cache_lru_push( shard, entry );
     }
 
+    ret = 0;
+
 exit:
+    if( ret == 0 )
+        shard->hits++;
+    else
+        shard->misses++;
+
 #if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &cache->mutex ) != 0 )
+    if( mbedtls_mutex_unlock( &shard->mutex ) != 0 )
         ret = 1;
 #endif
 
@@ -138,107 +350,72 @@ int mbedtls_ssl_cache_set( void *data, const mbedtls_ssl_session *session )
 {
     int ret = 1;
 #if defined(MBEDTLS_HAVE_TIME)
-    time_t t = time( NULL ), oldest = 0;
-    mbedtls_ssl_cache_entry *old = NULL;
+    time_t t = time( NULL );
 #endif
     mbedtls_ssl_cache_context *cache = (mbedtls_ssl_cache_context *) data;
-    mbedtls_ssl_cache_entry *cur, *prv;
-    int count = 0;
+    uint32_t hash = ssl_cache_hash( session->id, session->id_len );
+    mbedtls_ssl_cache_shard *shard = ssl_cache_shard( cache, hash );
+    mbedtls_ssl_cache_entry *cur, **bucket;
 
 #if defined(MBEDTLS_THREADING_C)
-    if( ( ret = mbedtls_mutex_lock( &cache->mutex ) ) != 0 )
+    if( ( ret = mbedtls_mutex_lock( &shard->mutex ) ) != 0 )
         return( ret );
+    ret = 1;
 #endif
 
-    cur = cache->chain;
-    prv = NULL;
+    cur = ssl_cache_find( shard, hash, session );
 
-    while( cur != NULL )
+    if( cur != NULL )
     {
-        count++;
-
-#if defined(MBEDTLS_HAVE_TIME)
-        if( cache->timeout != 0 &&
-            (int) ( t - cur->timestamp ) > cache->timeout )
-        {
-            cur->timestamp = t;
-            break; /* expired, reuse this slot, update timestamp */
-        }
-#endif
-
-        if( memcmp( session->id, cur->session.id, cur->session.id_len ) == 0 )
-            break; /* client reconnected, keep timestamp for session id */
-
-#if defined(MBEDTLS_HAVE_TIME)
-        if( oldest == 0 || cur->timestamp < oldest )
-        {
-            oldest = cur->timestamp;
-            old = cur;
-        }
-#endif
-
-        prv = cur;
-        cur = cur->next;
+        /* client reconnected, keep timestamp for session id */
+        ssl_cache_lru_unlink( shard, cur );
     }
-
-    if( cur == NULL )
+    else
     {
-#if defined(MBEDTLS_HAVE_TIME)
-        /*
-         * Reuse oldest entry if max_entries reached
-         */
-        if( count >= cache->max_entries )
+        if( shard->count >= ssl_cache_shard_max( cache, shard ) )
         {
-            if( old == NULL )
-            {
-                ret = 1;
+            /*
+             * Reuse the least recently used entry
+             */
+            cur = shard->lru_tail;
+            if( cur == NULL )
                 goto exit;
-            }
 
-            cur = old;
-        }
-#else /* MBEDTLS_HAVE_TIME */
-        /*
-         * Reuse first entry in chain if max_entries reached,
-         * but move to last place
-         */
-        if( count >= cache->max_entries )
-        {
-            if( cache->chain == NULL )
-            {
-                ret = 1;
-                goto exit;
-            }
+#if defined(MBEDTLS_HAVE_TIME)
+            if( cache->timeout == 0 ||
+                (int) ( t - cur->timestamp ) <= cache->timeout )
+#endif
+                shard->evictions++;
 
-            cur = cache->chain;
-            cache->chain = cur->next;
-            cur->next = NULL;
-            prv->next = cur;
+            ssl_cache_bucket_unlink( shard, cur );
+            ssl_cache_lru_unlink( shard, cur );
         }
-#endif /* MBEDTLS_HAVE_TIME */
         else
         {
             /*
              * max_entries not reached, create new entry
              */
+            if( ssl_cache_grow( shard ) != 0 )
+                goto exit;
+
             cur = mbedtls_calloc( 1, sizeof(mbedtls_ssl_cache_entry) );
             if( cur == NULL )
-            {
-                ret = 1;
                 goto exit;
-            }
 
-            if( prv == NULL )
-                cache->chain = cur;
-            else
-                prv->next = cur;
+            shard->count++;
         }
 
 #if defined(MBEDTLS_HAVE_TIME)
         cur->timestamp = t;
 #endif
+        cur->hash = hash;
+        bucket = ssl_cache_bucket( shard, hash );
+        cur->next = *bucket;
+        *bucket = cur;
     }
 
+    ssl_cache_lru_push( shard, cur );
+
     memcpy( &cur->session, session, sizeof( mbedtls_ssl_session ) );
 
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
@@ -258,10 +435,7 @@ int mbedtls_ssl_cache_set( void *data, const mbedtls_ssl_session *session )
     {
         cur->peer_cert.p = mbedtls_calloc( 1, session->peer_cert->raw.len );
         if( cur->peer_cert.p == NULL )
-        {
-            ret = 1;
             goto exit;
-        }
 
         memcpy( cur->peer_cert.p, session->peer_cert->raw.p,
                 session->peer_cert->raw.len );
@@ -275,7 +449,7 @@ int mbedtls_ssl_cache_set( void *data, const mbedtls_ssl_session *session )
 
 exit:
 #if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &cache->mutex ) != 0 )
+    if( mbedtls_mutex_unlock( &shard->mutex ) != 0 )
         ret = 1;
 #endif
 
@@ -293,34 +467,87 @@ void mbedtls_ssl_cache_set_timeout( mbedtls_ssl_cache_context *cache, int timeou
 
 void mbedtls_ssl_cache_set_max_entries( mbedtls_ssl_cache_context *cache, int max )
 {
+    int i, n;
+
     if( max < 0 ) max = 0;
 
+    n = ssl_cache_shard_count( max );
+
+    if( n != cache->shard_count )
+    {
+        /*
+         * Session ids map to other shards now. Drop the cached sessions
+         * rather than leave them unreachable.
+         */
+#if defined(MBEDTLS_THREADING_C)
+        for( i = 0; i < MBEDTLS_SSL_CACHE_SHARDS; i++ )
+            mbedtls_mutex_lock( &cache->shards[i].mutex );
+#endif
+
+        for( i = 0; i < MBEDTLS_SSL_CACHE_SHARDS; i++ )
+            ssl_cache_shard_clear( &cache->shards[i] );
+
+        cache->shard_count = n;
+        cache->max_entries = max;
+
+#if defined(MBEDTLS_THREADING_C)
+        for( i = MBEDTLS_SSL_CACHE_SHARDS - 1; i >= 0; i-- )
+            mbedtls_mutex_unlock( &cache->shards[i].mutex );
+#endif
+        return;
+    }
+
     cache->max_entries = max;
 }
 
-void mbedtls_ssl_cache_free( mbedtls_ssl_cache_context *cache )
+void mbedtls_ssl_cache_get_stats( mbedtls_ssl_cache_context *cache,
+                                  unsigned long *hits, unsigned long *misses,
+                                  unsigned long *evictions )
 {
-    mbedtls_ssl_cache_entry *cur, *prv;
-
-    cur = cache->chain;
+    unsigned long h = 0, m = 0, e = 0;
+    int i;
 
-    while( cur != NULL )
+    for( i = 0; i < MBEDTLS_SSL_CACHE_SHARDS; i++ )
     {
-        prv = cur;
-        cur = cur->next;
+        mbedtls_ssl_cache_shard *shard = &cache->shards[i];
 
-        mbedtls_ssl_session_free( &prv->session );
+#if defined(MBEDTLS_THREADING_C)
+        if( mbedtls_mutex_lock( &shard->mutex ) != 0 )
+            continue;
+#endif
 
-#if defined(MBEDTLS_X509_CRT_PARSE_C)
-        mbedtls_free( prv->peer_cert.p );
-#endif /* MBEDTLS_X509_CRT_PARSE_C */
+        h += shard->hits;
+        m += shard->misses;
+        e += shard->evictions;
 
-        mbedtls_free( prv );
+#if defined(MBEDTLS_THREADING_C)
+        mbedtls_mutex_unlock( &shard->mutex );
+#endif
     }
 
+    if( hits != NULL )
+        *hits = h;
+    if( misses != NULL )
+        *misses = m;
+    if( evictions != NULL )
+        *evictions = e;
+}
+
+void mbedtls_ssl_cache_free( mbedtls_ssl_cache_context *cache )
+{
+    int i;
+
+    for( i = 0; i < MBEDTLS_SSL_CACHE_SHARDS; i++ )
+    {
+        mbedtls_ssl_cache_shard *shard = &cache->shards[i];
+
+        ssl_cache_shard_clear( shard );
+        mbedtls_free( shard->buckets );
+
 #if defined(MBEDTLS_THREADING_C)
-    mbedtls_mutex_free( &cache->mutex );
+        mbedtls_mutex_free( &shard->mutex );
 #endif
+    }
 }
 
 #endif /* MBEDTLS_SSL_CACHE_C */
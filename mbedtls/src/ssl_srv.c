@@ -2661,9 +2661,11 @@ static int ssl_write_server_key_exchange( mbedtls_ssl_context *ssl )
     unsigned char *p = ssl->out_msg + 4;
     unsigned char *dig_signed = p;
     size_t dig_signed_len = 0, len;
+    mbedtls_ssl_pk_op op;
     ((void) dig_signed);
     ((void) dig_signed_len);
     ((void) len);
+    ((void) op);
 #endif
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> write server key exchange" ) );
@@ -2755,9 +2757,11 @@ static int ssl_write_server_key_exchange( mbedtls_ssl_context *ssl )
             return( ret );
         }
 
-        if( ( ret = mbedtls_dhm_make_params( &ssl->handshake->dhm_ctx,
-                        (int) mbedtls_mpi_size( &ssl->handshake->dhm_ctx.P ),
-                        p, &len, ssl->conf->f_rng, ssl->conf->p_rng ) ) != 0 )
+        op.type = MBEDTLS_SSL_PK_OP_DHM_MAKE_PARAMS;
+        op.output = p;
+        op.olen = &len;
+
+        if( ( ret = mbedtls_ssl_pk_op_run( ssl, &op ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_dhm_make_params", ret );
             return( ret );
@@ -2815,9 +2819,12 @@ curve_matching_done:
             return( ret );
         }
 
-        if( ( ret = mbedtls_ecdh_make_params( &ssl->handshake->ecdh_ctx, &len,
-                                      p, MBEDTLS_SSL_MAX_CONTENT_LEN - n,
-                                      ssl->conf->f_rng, ssl->conf->p_rng ) ) != 0 )
+        op.type = MBEDTLS_SSL_PK_OP_ECDH_MAKE_PARAMS;
+        op.output = p;
+        op.osize = MBEDTLS_SSL_MAX_CONTENT_LEN - n;
+        op.olen = &len;
+
+        if( ( ret = mbedtls_ssl_pk_op_run( ssl, &op ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ecdh_make_params", ret );
             return( ret );
@@ -2979,9 +2986,14 @@ curve_matching_done:
         }
 #endif /* MBEDTLS_SSL_PROTO_TLS1_2 */
 
-        if( ( ret = mbedtls_pk_sign( mbedtls_ssl_own_key( ssl ), md_alg, hash, hashlen,
-                        p + 2 , &signature_len,
-                        ssl->conf->f_rng, ssl->conf->p_rng ) ) != 0 )
+        op.type = MBEDTLS_SSL_PK_OP_SIGN;
+        op.md_alg = md_alg;
+        op.input = hash;
+        op.ilen = hashlen;
+        op.output = p + 2;
+        op.olen = &signature_len;
+
+        if( ( ret = mbedtls_ssl_pk_op_run( ssl, &op ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_pk_sign", ret );
             return( ret );
@@ -3100,6 +3112,7 @@ static int ssl_parse_encrypted_pms( mbedtls_ssl_context *ssl,
     unsigned char mask;
     size_t i, peer_pmslen;
     unsigned int diff;
+    mbedtls_ssl_pk_op op;
 
     if( ! mbedtls_pk_can_do( mbedtls_ssl_own_key( ssl ), MBEDTLS_PK_RSA ) )
     {
@@ -3144,10 +3157,14 @@ static int ssl_parse_encrypted_pms( mbedtls_ssl_context *ssl,
     if( ret != 0 )
         return( ret );
 
-    ret = mbedtls_pk_decrypt( mbedtls_ssl_own_key( ssl ), p, len,
-                      peer_pms, &peer_pmslen,
-                      sizeof( peer_pms ),
-                      ssl->conf->f_rng, ssl->conf->p_rng );
+    op.type = MBEDTLS_SSL_PK_OP_DECRYPT;
+    op.input = p;
+    op.ilen = len;
+    op.output = peer_pms;
+    op.osize = sizeof( peer_pms );
+    op.olen = &peer_pmslen;
+
+    ret = mbedtls_ssl_pk_op_run( ssl, &op );
 
     diff  = (unsigned int) ret;
     diff |= peer_pmslen ^ 48;
@@ -3289,6 +3306,8 @@ static int ssl_parse_client_key_exchange( mbedtls_ssl_context *ssl )
 #if defined(MBEDTLS_KEY_EXCHANGE_DHE_RSA_ENABLED)
     if( ciphersuite_info->key_exchange == MBEDTLS_KEY_EXCHANGE_DHE_RSA )
     {
+        mbedtls_ssl_pk_op op;
+
         if( ( ret = ssl_parse_client_dh_public( ssl, &p, end ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, ( "ssl_parse_client_dh_public" ), ret );
@@ -3301,11 +3320,12 @@ static int ssl_parse_client_key_exchange( mbedtls_ssl_context *ssl )
             return( MBEDTLS_ERR_SSL_BAD_HS_CLIENT_KEY_EXCHANGE );
         }
 
-        if( ( ret = mbedtls_dhm_calc_secret( &ssl->handshake->dhm_ctx,
-                                      ssl->handshake->premaster,
-                                      MBEDTLS_PREMASTER_SIZE,
-                                     &ssl->handshake->pmslen,
-                                      ssl->conf->f_rng, ssl->conf->p_rng ) ) != 0 )
+        op.type = MBEDTLS_SSL_PK_OP_DHM_CALC_SECRET;
+        op.output = ssl->handshake->premaster;
+        op.osize = MBEDTLS_PREMASTER_SIZE;
+        op.olen = &ssl->handshake->pmslen;
+
+        if( ( ret = mbedtls_ssl_pk_op_run( ssl, &op ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_dhm_calc_secret", ret );
             return( MBEDTLS_ERR_SSL_BAD_HS_CLIENT_KEY_EXCHANGE_CS );
@@ -3324,6 +3344,8 @@ static int ssl_parse_client_key_exchange( mbedtls_ssl_context *ssl )
         ciphersuite_info->key_exchange == MBEDTLS_KEY_EXCHANGE_ECDH_RSA ||
         ciphersuite_info->key_exchange == MBEDTLS_KEY_EXCHANGE_ECDH_ECDSA )
     {
+        mbedtls_ssl_pk_op op;
+
         if( ( ret = mbedtls_ecdh_read_public( &ssl->handshake->ecdh_ctx,
                                       p, end - p) ) != 0 )
         {
@@ -3333,11 +3355,12 @@ static int ssl_parse_client_key_exchange( mbedtls_ssl_context *ssl )
 
         MBEDTLS_SSL_DEBUG_ECP( 3, "ECDH: Qp ", &ssl->handshake->ecdh_ctx.Qp );
 
-        if( ( ret = mbedtls_ecdh_calc_secret( &ssl->handshake->ecdh_ctx,
-                                      &ssl->handshake->pmslen,
-                                       ssl->handshake->premaster,
-                                       MBEDTLS_MPI_MAX_SIZE,
-                                       ssl->conf->f_rng, ssl->conf->p_rng ) ) != 0 )
+        op.type = MBEDTLS_SSL_PK_OP_ECDH_CALC_SECRET;
+        op.output = ssl->handshake->premaster;
+        op.osize = MBEDTLS_MPI_MAX_SIZE;
+        op.olen = &ssl->handshake->pmslen;
+
+        if( ( ret = mbedtls_ssl_pk_op_run( ssl, &op ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ecdh_calc_secret", ret );
             return( MBEDTLS_ERR_SSL_BAD_HS_CLIENT_KEY_EXCHANGE_CS );
@@ -679,12 +679,18 @@ int mbedtls_ssl_derive_keys( mbedtls_ssl_context *ssl )
     transform->keylen = cipher_info->key_bitlen / 8;
 
     if( cipher_info->mode == MBEDTLS_MODE_GCM ||
-        cipher_info->mode == MBEDTLS_MODE_CCM )
+        cipher_info->mode == MBEDTLS_MODE_CCM ||
+        cipher_info->mode == MBEDTLS_MODE_CHACHAPOLY )
     {
         transform->maclen = 0;
 
         transform->ivlen = 12;
-        transform->fixed_ivlen = 4;
+
+        /* RFC 7905: ChaCha20-Poly1305 records carry no explicit IV */
+        if( cipher_info->mode == MBEDTLS_MODE_CHACHAPOLY )
+            transform->fixed_ivlen = 12;
+        else
+            transform->fixed_ivlen = 4;
 
         /* Minimum length is expicit IV + tag */
         transform->minlen = transform->ivlen - transform->fixed_ivlen
@@ -1080,6 +1086,75 @@ void ssl_calc_verify_tls_sha384( mbedtls_ssl_context *ssl, unsigned char hash[48
 #endif /* MBEDTLS_SHA512_C */
 #endif /* MBEDTLS_SSL_PROTO_TLS1_2 */
 
+/*
+ * Handshake public-key operations. They only touch the handshake state
+ * named by op, so they may run on another thread while the caller waits
+ * in f_offload.
+ */
+static int ssl_pk_op_invoke( void *p )
+{
+    mbedtls_ssl_pk_op *op = (mbedtls_ssl_pk_op *) p;
+    mbedtls_ssl_context *ssl = op->ssl;
+
+    switch( op->type )
+    {
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+        case MBEDTLS_SSL_PK_OP_SIGN:
+            return( mbedtls_pk_sign( mbedtls_ssl_own_key( ssl ), op->md_alg,
+                                     op->input, op->ilen,
+                                     op->output, op->olen,
+                                     ssl->conf->f_rng, ssl->conf->p_rng ) );
+
+        case MBEDTLS_SSL_PK_OP_DECRYPT:
+            return( mbedtls_pk_decrypt( mbedtls_ssl_own_key( ssl ),
+                                        op->input, op->ilen,
+                                        op->output, op->olen, op->osize,
+                                        ssl->conf->f_rng, ssl->conf->p_rng ) );
+#endif /* MBEDTLS_X509_CRT_PARSE_C */
+
+#if defined(MBEDTLS_DHM_C)
+        case MBEDTLS_SSL_PK_OP_DHM_MAKE_PARAMS:
+            return( mbedtls_dhm_make_params( &ssl->handshake->dhm_ctx,
+                        (int) mbedtls_mpi_size( &ssl->handshake->dhm_ctx.P ),
+                        op->output, op->olen,
+                        ssl->conf->f_rng, ssl->conf->p_rng ) );
+
+        case MBEDTLS_SSL_PK_OP_DHM_CALC_SECRET:
+            return( mbedtls_dhm_calc_secret( &ssl->handshake->dhm_ctx,
+                        op->output, op->osize, op->olen,
+                        ssl->conf->f_rng, ssl->conf->p_rng ) );
+#endif /* MBEDTLS_DHM_C */
+
+#if defined(MBEDTLS_ECDH_C)
+        case MBEDTLS_SSL_PK_OP_ECDH_MAKE_PARAMS:
+            return( mbedtls_ecdh_make_params( &ssl->handshake->ecdh_ctx, op->olen,
+                        op->output, op->osize,
+                        ssl->conf->f_rng, ssl->conf->p_rng ) );
+
+        case MBEDTLS_SSL_PK_OP_ECDH_CALC_SECRET:
+            return( mbedtls_ecdh_calc_secret( &ssl->handshake->ecdh_ctx, op->olen,
+                        op->output, op->osize,
+                        ssl->conf->f_rng, ssl->conf->p_rng ) );
+#endif /* MBEDTLS_ECDH_C */
+
+        default:
+            return( MBEDTLS_ERR_SSL_INTERNAL_ERROR );
+    }
+}
+
+int mbedtls_ssl_pk_op_run( mbedtls_ssl_context *ssl, mbedtls_ssl_pk_op *op )
+{
+    op->ssl = ssl;
+
+#if defined(MBEDTLS_SSL_OFFLOAD)
+    if( ssl->conf->f_offload != NULL )
+        return( ssl->conf->f_offload( ssl->conf->p_offload,
+                                      ssl_pk_op_invoke, op ) );
+#endif
+
+    return( ssl_pk_op_invoke( op ) );
+}
+
 #if defined(MBEDTLS_KEY_EXCHANGE__SOME__PSK_ENABLED)
 int mbedtls_ssl_psk_derive_premaster( mbedtls_ssl_context *ssl, mbedtls_key_exchange_type_t key_ex )
 {
@@ -1137,11 +1212,15 @@ int mbedtls_ssl_psk_derive_premaster( mbedtls_ssl_context *ssl, mbedtls_key_exch
     {
         int ret;
         size_t len;
+        mbedtls_ssl_pk_op op;
 
         /* Write length only when we know the actual value */
-        if( ( ret = mbedtls_dhm_calc_secret( &ssl->handshake->dhm_ctx,
-                                      p + 2, end - ( p + 2 ), &len,
-                                      ssl->conf->f_rng, ssl->conf->p_rng ) ) != 0 )
+        op.type = MBEDTLS_SSL_PK_OP_DHM_CALC_SECRET;
+        op.output = p + 2;
+        op.osize = end - ( p + 2 );
+        op.olen = &len;
+
+        if( ( ret = mbedtls_ssl_pk_op_run( ssl, &op ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_dhm_calc_secret", ret );
             return( ret );
@@ -1159,10 +1238,14 @@ int mbedtls_ssl_psk_derive_premaster( mbedtls_ssl_context *ssl, mbedtls_key_exch
     {
         int ret;
         size_t zlen;
+        mbedtls_ssl_pk_op op;
+
+        op.type = MBEDTLS_SSL_PK_OP_ECDH_CALC_SECRET;
+        op.output = p + 2;
+        op.osize = end - ( p + 2 );
+        op.olen = &zlen;
 
-        if( ( ret = mbedtls_ecdh_calc_secret( &ssl->handshake->ecdh_ctx, &zlen,
-                                       p + 2, end - ( p + 2 ),
-                                       ssl->conf->f_rng, ssl->conf->p_rng ) ) != 0 )
+        if( ( ret = mbedtls_ssl_pk_op_run( ssl, &op ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ecdh_calc_secret", ret );
             return( ret );
@@ -1350,14 +1433,21 @@ static int ssl_encrypt_buf( mbedtls_ssl_context *ssl )
     }
     else
 #endif /* MBEDTLS_ARC4_C || MBEDTLS_CIPHER_NULL_CIPHER */
-#if defined(MBEDTLS_GCM_C) || defined(MBEDTLS_CCM_C)
+#if defined(MBEDTLS_GCM_C) || defined(MBEDTLS_CCM_C) || \
+    defined(MBEDTLS_CHACHAPOLY_C)
     if( mode == MBEDTLS_MODE_GCM ||
-        mode == MBEDTLS_MODE_CCM )
+        mode == MBEDTLS_MODE_CCM ||
+        mode == MBEDTLS_MODE_CHACHAPOLY )
     {
         int ret;
         size_t enc_msglen, olen;
         unsigned char *enc_msg;
+        unsigned char *iv = ssl->transform_out->iv_enc;
         unsigned char add_data[13];
+#if defined(MBEDTLS_CHACHAPOLY_C)
+        unsigned char nonce[12];
+        size_t i;
+#endif
         unsigned char taglen = ssl->transform_out->ciphersuite_info->flags &
                                MBEDTLS_CIPHERSUITE_SHORT_TAG ? 8 : 16;
 
@@ -1374,31 +1464,44 @@ static int ssl_encrypt_buf( mbedtls_ssl_context *ssl )
         /*
          * Generate IV
          */
+#if defined(MBEDTLS_CHACHAPOLY_C)
+        if( mode == MBEDTLS_MODE_CHACHAPOLY )
+        {
+            /* RFC 7905: the write IV XORed with the padded sequence number */
+            memcpy( nonce, ssl->transform_out->iv_enc, 12 );
+            for( i = 0; i < 8; i++ )
+                nonce[i + 4] ^= ssl->out_ctr[i];
+
+            iv = nonce;
+        }
+        else
+#endif /* MBEDTLS_CHACHAPOLY_C */
+        {
 #if defined(MBEDTLS_SSL_AEAD_RANDOM_IV)
-        ret = ssl->conf->f_rng( ssl->conf->p_rng,
-                ssl->transform_out->iv_enc + ssl->transform_out->fixed_ivlen,
-                ssl->transform_out->ivlen - ssl->transform_out->fixed_ivlen );
-        if( ret != 0 )
-            return( ret );
+            ret = ssl->conf->f_rng( ssl->conf->p_rng,
+                    ssl->transform_out->iv_enc + ssl->transform_out->fixed_ivlen,
+                    ssl->transform_out->ivlen - ssl->transform_out->fixed_ivlen );
+            if( ret != 0 )
+                return( ret );
 
-        memcpy( ssl->out_iv,
-                ssl->transform_out->iv_enc + ssl->transform_out->fixed_ivlen,
-                ssl->transform_out->ivlen - ssl->transform_out->fixed_ivlen );
+            memcpy( ssl->out_iv,
+                    ssl->transform_out->iv_enc + ssl->transform_out->fixed_ivlen,
+                    ssl->transform_out->ivlen - ssl->transform_out->fixed_ivlen );
 #else
-        if( ssl->transform_out->ivlen - ssl->transform_out->fixed_ivlen != 8 )
-        {
-            /* Reminder if we ever add an AEAD mode with a different size */
-            MBEDTLS_SSL_DEBUG_MSG( 1, ( "should never happen" ) );
-            return( MBEDTLS_ERR_SSL_INTERNAL_ERROR );
-        }
+            if( ssl->transform_out->ivlen - ssl->transform_out->fixed_ivlen != 8 )
+            {
+                /* Reminder if we ever add an AEAD mode with a different size */
+                MBEDTLS_SSL_DEBUG_MSG( 1, ( "should never happen" ) );
+                return( MBEDTLS_ERR_SSL_INTERNAL_ERROR );
+            }
 
-        memcpy( ssl->transform_out->iv_enc + ssl->transform_out->fixed_ivlen,
-                             ssl->out_ctr, 8 );
-        memcpy( ssl->out_iv, ssl->out_ctr, 8 );
+            memcpy( ssl->transform_out->iv_enc + ssl->transform_out->fixed_ivlen,
+                                 ssl->out_ctr, 8 );
+            memcpy( ssl->out_iv, ssl->out_ctr, 8 );
 #endif
+        }
 
-        MBEDTLS_SSL_DEBUG_BUF( 4, "IV used", ssl->out_iv,
-                ssl->transform_out->ivlen - ssl->transform_out->fixed_ivlen );
+        MBEDTLS_SSL_DEBUG_BUF( 4, "IV used", iv, ssl->transform_out->ivlen );
 
         /*
          * Fix pointer positions and message length with added IV
@@ -1416,7 +1519,7 @@ static int ssl_encrypt_buf( mbedtls_ssl_context *ssl )
          * Encrypt and authenticate
          */
         if( ( ret = mbedtls_cipher_auth_encrypt( &ssl->transform_out->cipher_ctx_enc,
-                                         ssl->transform_out->iv_enc,
+                                         iv,
                                          ssl->transform_out->ivlen,
                                          add_data, 13,
                                          enc_msg, enc_msglen,
@@ -1439,7 +1542,7 @@ static int ssl_encrypt_buf( mbedtls_ssl_context *ssl )
         MBEDTLS_SSL_DEBUG_BUF( 4, "after encrypt: tag", enc_msg + enc_msglen, taglen );
     }
     else
-#endif /* MBEDTLS_GCM_C || MBEDTLS_CCM_C */
+#endif /* MBEDTLS_GCM_C || MBEDTLS_CCM_C || MBEDTLS_CHACHAPOLY_C */
 #if defined(MBEDTLS_CIPHER_MODE_CBC) &&                                    \
     ( defined(MBEDTLS_AES_C) || defined(MBEDTLS_CAMELLIA_C) )
     if( mode == MBEDTLS_MODE_CBC )
@@ -1629,15 +1732,21 @@ static int ssl_decrypt_buf( mbedtls_ssl_context *ssl )
     }
     else
 #endif /* MBEDTLS_ARC4_C || MBEDTLS_CIPHER_NULL_CIPHER */
-#if defined(MBEDTLS_GCM_C) || defined(MBEDTLS_CCM_C)
+#if defined(MBEDTLS_GCM_C) || defined(MBEDTLS_CCM_C) || \
+    defined(MBEDTLS_CHACHAPOLY_C)
     if( mode == MBEDTLS_MODE_GCM ||
-        mode == MBEDTLS_MODE_CCM )
+        mode == MBEDTLS_MODE_CCM ||
+        mode == MBEDTLS_MODE_CHACHAPOLY )
     {
         int ret;
         size_t dec_msglen, olen;
         unsigned char *dec_msg;
         unsigned char *dec_msg_result;
+        unsigned char *iv = ssl->transform_in->iv_dec;
         unsigned char add_data[13];
+#if defined(MBEDTLS_CHACHAPOLY_C)
+        unsigned char nonce[12];
+#endif
         unsigned char taglen = ssl->transform_in->ciphersuite_info->flags &
                                MBEDTLS_CIPHERSUITE_SHORT_TAG ? 8 : 16;
         size_t explicit_iv_len = ssl->transform_in->ivlen -
@@ -1666,19 +1775,30 @@ static int ssl_decrypt_buf( mbedtls_ssl_context *ssl )
         MBEDTLS_SSL_DEBUG_BUF( 4, "additional data used for AEAD",
                        add_data, 13 );
 
+#if defined(MBEDTLS_CHACHAPOLY_C)
+        if( mode == MBEDTLS_MODE_CHACHAPOLY )
+        {
+            /* RFC 7905: the read IV XORed with the padded sequence number */
+            memcpy( nonce, ssl->transform_in->iv_dec, 12 );
+            for( i = 0; i < 8; i++ )
+                nonce[i + 4] ^= ssl->in_ctr[i];
+
+            iv = nonce;
+        }
+        else
+#endif /* MBEDTLS_CHACHAPOLY_C */
         memcpy( ssl->transform_in->iv_dec + ssl->transform_in->fixed_ivlen,
                 ssl->in_iv,
                 ssl->transform_in->ivlen - ssl->transform_in->fixed_ivlen );
 
-        MBEDTLS_SSL_DEBUG_BUF( 4, "IV used", ssl->transform_in->iv_dec,
-                                     ssl->transform_in->ivlen );
+        MBEDTLS_SSL_DEBUG_BUF( 4, "IV used", iv, ssl->transform_in->ivlen );
         MBEDTLS_SSL_DEBUG_BUF( 4, "TAG used", dec_msg + dec_msglen, taglen );
 
         /*
          * Decrypt and authenticate
          */
         if( ( ret = mbedtls_cipher_auth_decrypt( &ssl->transform_in->cipher_ctx_dec,
-                                         ssl->transform_in->iv_dec,
+                                         iv,
                                          ssl->transform_in->ivlen,
                                          add_data, 13,
                                          dec_msg, dec_msglen,
@@ -1701,7 +1821,7 @@ static int ssl_decrypt_buf( mbedtls_ssl_context *ssl )
         }
     }
     else
-#endif /* MBEDTLS_GCM_C || MBEDTLS_CCM_C */
+#endif /* MBEDTLS_GCM_C || MBEDTLS_CCM_C || MBEDTLS_CHACHAPOLY_C */
 #if defined(MBEDTLS_CIPHER_MODE_CBC) &&                                    \
     ( defined(MBEDTLS_AES_C) || defined(MBEDTLS_CAMELLIA_C) )
     if( mode == MBEDTLS_MODE_CBC )
@@ -6121,6 +6241,16 @@ void mbedtls_ssl_conf_export_keys_cb( mbedtls_ssl_config *conf,
 }
 #endif
 
+#if defined(MBEDTLS_SSL_OFFLOAD)
+void mbedtls_ssl_conf_offload( mbedtls_ssl_config *conf,
+                               mbedtls_ssl_offload_t *f_offload,
+                               void *p_offload )
+{
+    conf->f_offload = f_offload;
+    conf->p_offload = p_offload;
+}
+#endif
+
 /*
  * SSL get accessors
  */
@@ -6203,6 +6333,7 @@ int mbedtls_ssl_get_record_expansion( const mbedtls_ssl_context *ssl )
     {
         case MBEDTLS_MODE_GCM:
         case MBEDTLS_MODE_CCM:
+        case MBEDTLS_MODE_CHACHAPOLY:
         case MBEDTLS_MODE_STREAM:
             transform_expansion = transform->minlen;
             break;
@@ -138,6 +138,8 @@ typedef struct {
     bson_bool_t first;
 } bson_iterator;
 
+struct bson_arena;
+
 typedef struct {
     char *data;           /**< Pointer to a block of data in this BSON object. */
     char *cur;            /**< Pointer to the current position. */
@@ -145,6 +147,7 @@ typedef struct {
     bson_bool_t finished; /**< When finished, the BSON object can no longer be modified. */
     bson_bool_t ownsData; /**< Whether destroying this object will deallocate its data block */
     int err;              /**< Bitfield representing errors or warnings on this buffer */
+    struct bson_arena *arena; /**< The arena this object is being built in, if any. */
     int stackSize;        /**< Number of elements in the current stack */
     int stackPos;         /**< Index of current stack position. */
     size_t* stackPtr;     /**< Pointer to the current stack */
@@ -152,6 +155,33 @@ typedef struct {
                                Must be at end of bson struct so _bson_zero does not clear. */
 } bson;
 
+/* A reusable block that documents are built into back to back, so that
+   building a run of documents costs no allocation once the block is
+   large enough. Documents in an arena are laid out exactly as a batch of
+   them is on the wire. */
+typedef struct bson_arena {
+    char *data;           /**< The block holding the documents. */
+    int dataSize;         /**< The number of bytes allocated to data. */
+    int used;             /**< Bytes taken by committed documents. */
+    int count;            /**< Number of committed documents. */
+    int err;              /**< Union of the err fields of committed documents. */
+} bson_arena;
+
+typedef struct {
+    unsigned int hash;    /**< Hash of the element's key. */
+    int offset;           /**< Offset of the element in the document, 0 for an empty slot. */
+} bson_index_slot;
+
+/* A lookup table over the keys of a finished document. It only holds
+   offsets into the document, which must outlive it and stay unmodified. */
+typedef struct {
+    const char *data;         /**< The indexed document. */
+    int mask;                 /**< Number of slots minus one, -1 until built. */
+    int end;                  /**< Offset of the document's terminating byte. */
+    bson_index_slot *slots;   /**< Either fixed or a single allocated block. */
+    bson_index_slot fixed[32];
+} bson_index;
+
 #pragma pack(1)
 typedef union {
     char bytes[12];
@@ -291,6 +321,39 @@ MONGO_EXPORT void bson_print_raw( const char *bson , int depth );
  */
 MONGO_EXPORT bson_type bson_find( bson_iterator *it, const bson *obj, const char *name );
 
+/**
+ * Prepare an index over the top-level keys of a finished BSON object.
+ * The table is built on the first lookup, so this is cheap to call on
+ * documents that end up being read only once.
+ *
+ * @note The index points into obj's data; obj must not be modified or
+ *       destroyed while the index is in use. Pass the index to
+ *       bson_index_destroy( ) when done.
+ *
+ * @param idx the index to initialize.
+ * @param obj the BSON object to index.
+ */
+MONGO_EXPORT void bson_index_init( bson_index *idx, const bson *obj );
+
+/**
+ * Advance a bson_iterator to the named field using an index. Gives
+ * the same result as bson_find( ), including for duplicate keys.
+ *
+ * @param it the bson_iterator to use.
+ * @param idx the index to search.
+ * @param name the name of the field to find.
+ *
+ * @return the type of the found object or BSON_EOO if it is not found.
+ */
+MONGO_EXPORT bson_type bson_index_find( bson_iterator *it, bson_index *idx, const char *name );
+
+/**
+ * Release the memory held by an index.
+ *
+ * @param idx the index to destroy.
+ */
+MONGO_EXPORT void bson_index_destroy( bson_index *idx );
+
 
 MONGO_EXPORT bson_iterator* bson_iterator_alloc( void );
 MONGO_EXPORT void bson_iterator_dealloc(bson_iterator*);
@@ -683,7 +746,59 @@ MONGO_EXPORT int bson_init( bson *b );
  *
  * @return BSON_OK or BSON_ERROR.
  */
-int bson_init_size( bson *b, int size );
+MONGO_EXPORT int bson_init_size( bson *b, int size );
+
+/**
+ * Initialize an empty arena.
+ *
+ * @param a the arena to initialize.
+ * @param size the initial size of its block, 0 to allocate on first use.
+ *
+ * @return BSON_OK or BSON_ERROR.
+ */
+MONGO_EXPORT int bson_arena_init( bson_arena *a, int size );
+
+/**
+ * Forget every document in an arena, keeping its block for reuse.
+ *
+ * @param a the arena to reset.
+ */
+MONGO_EXPORT void bson_arena_reset( bson_arena *a );
+
+/**
+ * Free an arena's block.
+ *
+ * @param a the arena to destroy.
+ */
+MONGO_EXPORT void bson_arena_destroy( bson_arena *a );
+
+/**
+ * Initialize a BSON object for building at the end of an arena.
+ * Only one object can be built in an arena at a time; starting another
+ * discards an uncommitted one.
+ *
+ * @note The object's data belongs to the arena and moves when the arena
+ *       grows. Pointers into a document are only stable until the next
+ *       document is started.
+ *
+ * @param b the BSON object to initialize.
+ * @param a the arena to build in.
+ * @param size the expected size of the document.
+ *
+ * @return BSON_OK or BSON_ERROR.
+ */
+MONGO_EXPORT int bson_init_arena( bson *b, bson_arena *a, int size );
+
+/**
+ * Keep a finished BSON object built with bson_init_arena( ) in its
+ * arena. This releases b, which must not be used afterwards.
+ *
+ * @param a the arena b was built in.
+ * @param b the finished BSON object.
+ *
+ * @return BSON_OK or BSON_ERROR if b is not finished or not from a.
+ */
+MONGO_EXPORT int bson_arena_commit( bson_arena *a, bson *b );
 
 /**
  * Initialize a BSON object for building, using the provided char*
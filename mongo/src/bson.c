@@ -324,6 +324,101 @@ MONGO_EXPORT bson_type bson_find( bson_iterator *it, const bson *obj, const char
     return bson_iterator_type( it );
 }
 
+MONGO_EXPORT void bson_index_init( bson_index *idx, const bson *obj ) {
+    idx->data = obj->data;
+    idx->mask = -1;
+    idx->end = 0;
+    idx->slots = NULL;
+}
+
+/* FNV-1a; 0 is reserved so a zero hash never needs a key compare. */
+static unsigned int bson_index_hash( const char *key ) {
+    unsigned int h = 2166136261u;
+
+    while( *key )
+        h = ( h ^ ( unsigned char )*key++ ) * 16777619u;
+    return h ? h : 1;
+}
+
+static void bson_index_build( bson_index *idx ) {
+    bson_iterator it[1];
+    bson_index_slot *slot;
+    unsigned int h;
+    int count = 0;
+    int size = 8;
+
+    bson_iterator_from_buffer( it, idx->data );
+    while( bson_iterator_next( it ) )
+        count++;
+    idx->end = ( int )( it->cur - idx->data );
+
+    /* keep the table at most half full */
+    while( size < count * 2 )
+        size <<= 1;
+
+    if( size <= ( int )( sizeof( idx->fixed ) / sizeof( idx->fixed[0] ) ) )
+        idx->slots = idx->fixed;
+    else {
+        idx->slots = ( bson_index_slot * )bson_malloc( size * sizeof( bson_index_slot ) );
+        if( idx->slots == NULL ) {
+            idx->mask = 0;
+            return;
+        }
+    }
+
+    memset( idx->slots, 0, size * sizeof( bson_index_slot ) );
+    idx->mask = size - 1;
+
+    /* slots are filled in document order, so for a repeated key the
+       probe sequence reaches the first occurrence first, as bson_find does */
+    bson_iterator_from_buffer( it, idx->data );
+    while( bson_iterator_next( it ) ) {
+        h = bson_index_hash( bson_iterator_key( it ) );
+        slot = idx->slots + ( h & idx->mask );
+        while( slot->offset )
+            slot = idx->slots + ( ( slot - idx->slots + 1 ) & idx->mask );
+        slot->hash = h;
+        slot->offset = ( int )( it->cur - idx->data );
+    }
+}
+
+MONGO_EXPORT bson_type bson_index_find( bson_iterator *it, bson_index *idx, const char *name ) {
+    bson_index_slot *slot;
+    unsigned int h;
+
+    if( idx->mask < 0 )
+        bson_index_build( idx );
+
+    if( idx->slots == NULL ) {
+        /* out of memory while building: fall back to a scan */
+        bson_iterator_from_buffer( it, idx->data );
+        while( bson_iterator_next( it ) ) {
+            if ( strcmp( name, bson_iterator_key( it ) ) == 0 )
+                break;
+        }
+        return bson_iterator_type( it );
+    }
+
+    h = bson_index_hash( name );
+    slot = idx->slots + ( h & idx->mask );
+    while( slot->offset ) {
+        if( slot->hash == h && strcmp( name, idx->data + slot->offset + 1 ) == 0 )
+            break;
+        slot = idx->slots + ( ( slot - idx->slots + 1 ) & idx->mask );
+    }
+
+    it->cur = idx->data + ( slot->offset ? slot->offset : idx->end );
+    it->first = 0;
+    return bson_iterator_type( it );
+}
+
+MONGO_EXPORT void bson_index_destroy( bson_index *idx ) {
+    if( idx->slots && idx->slots != idx->fixed )
+        bson_free( idx->slots );
+    idx->slots = NULL;
+    idx->mask = -1;
+}
+
 MONGO_EXPORT bson_bool_t bson_iterator_more( const bson_iterator *i ) {
     return *( i->cur );
 }
@@ -640,6 +735,87 @@ int bson_init_unfinished_data( bson *b, char *data, int dataSize, bson_bool_t ow
     return BSON_OK;
 }
 
+MONGO_EXPORT int bson_arena_init( bson_arena *a, int size ) {
+    memset( a, 0, sizeof( bson_arena ) );
+    if( size > 0 ) {
+        a->data = ( char * )bson_malloc( size );
+        if( a->data == NULL )
+            return BSON_ERROR;
+        a->dataSize = size;
+    }
+    return BSON_OK;
+}
+
+MONGO_EXPORT void bson_arena_reset( bson_arena *a ) {
+    a->used = 0;
+    a->count = 0;
+    a->err = 0;
+}
+
+MONGO_EXPORT void bson_arena_destroy( bson_arena *a ) {
+    if( a->data )
+        bson_free( a->data );
+    memset( a, 0, sizeof( bson_arena ) );
+}
+
+/* Make room for bytesNeeded more bytes in the document being built at
+   the end of the arena. */
+static int bson_arena_grow( bson *b, const size_t bytesNeeded ) {
+    bson_arena *a = b->arena;
+    size_t pos = _bson_position( b );
+    size_t need = ( size_t )a->used + pos + bytesNeeded;
+    size_t new_size;
+    char *data;
+
+    if( need <= ( size_t )a->dataSize ) {
+        b->dataSize = a->dataSize - a->used;
+        return BSON_OK;
+    }
+
+    new_size = need + need / 2;
+    if( new_size >= INT32_MAX ) {
+        if( need >= INT32_MAX ) {
+            b->err = BSON_SIZE_OVERFLOW;
+            return BSON_ERROR;
+        }
+        new_size = INT32_MAX;
+    }
+
+    data = ( char * )bson_realloc( a->data, new_size );
+    if ( !data )
+        bson_fatal_msg( !!data, "realloc() failed" );
+
+    a->data = data;
+    a->dataSize = ( int )new_size;
+    b->data = a->data + a->used;
+    b->dataSize = a->dataSize - a->used;
+    b->cur = b->data + pos;
+
+    return BSON_OK;
+}
+
+MONGO_EXPORT int bson_init_arena( bson *b, bson_arena *a, int size ) {
+    _bson_zero( b );
+    b->arena = a;
+    b->data = a->data + a->used;
+    b->cur = b->data;
+    if( bson_arena_grow( b, size > 5 ? size : 5 ) != BSON_OK )
+        return BSON_ERROR;
+    b->cur = b->data + 4;
+    return BSON_OK;
+}
+
+MONGO_EXPORT int bson_arena_commit( bson_arena *a, bson *b ) {
+    if( b->arena != a || !b->finished || b->data != a->data + a->used )
+        return BSON_ERROR;
+
+    a->used += bson_size( b );
+    a->count++;
+    a->err |= b->err;
+    bson_destroy( b );
+    return BSON_OK;
+}
+
 static int _bson_append_grow_stack( bson * b ) {
     if ( !b->stackPtr ) {
         // If this is an empty bson structure, initially use the struct-local (fixed-size) stack
@@ -705,6 +881,9 @@ int bson_ensure_space( bson *b, const size_t bytesNeeded ) {
     if ( pos + bytesNeeded <= (size_t) b->dataSize )
         return BSON_OK;
 
+    if ( b->arena )
+        return bson_arena_grow( b, bytesNeeded );
+
     new_size = (int) ( 1.5 * ( b->dataSize + bytesNeeded ) );
 
     if( new_size < b->dataSize ) {
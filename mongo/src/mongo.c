@@ -303,10 +303,29 @@ static mongo_message *mongo_message_create( size_t len , int id , int responseTo
     return mm;
 }
 
-/* Always calls bson_free(mm) */
-static int mongo_message_send( mongo *conn, mongo_message *mm ) {
+static int mongo_read_response( mongo *conn, mongo_reply **reply );
+
+/* Read the reply to a cursor's read-ahead getMore off the wire and park
+ * it on the cursor, so that the connection can be used for something else. */
+static void mongo_cursor_settle( mongo *conn ) {
+    mongo_cursor *cursor = conn->prefetch;
+
+    conn->prefetch = NULL;
+    if( mongo_read_response( conn, &cursor->prefetched ) != MONGO_OK ) {
+        cursor->prefetched = NULL;
+        cursor->flags &= ~MONGO_CURSOR_PREFETCH;
+    }
+}
+
+/* Always calls bson_free(mm). The last tail_len bytes counted in
+ * mm->head.len are not in mm but at tail, and are written from there. */
+static int mongo_message_send_tail( mongo *conn, mongo_message *mm,
+                                    const char *tail, int tail_len ) {
     mongo_header head; /* little endian */
     int res;
+
+    if( conn->prefetch )
+        mongo_cursor_settle( conn );
     bson_little_endian32( &head.len, &mm->head.len );
     bson_little_endian32( &head.id, &mm->head.id );
     bson_little_endian32( &head.responseTo, &mm->head.responseTo );
@@ -318,13 +337,70 @@ static int mongo_message_send( mongo *conn, mongo_message *mm ) {
         return res;
     }
 
-    res = mongo_env_write_socket( conn, &mm->data, mm->head.len - sizeof( head ) );
+    res = mongo_env_write_socket( conn, &mm->data, mm->head.len - sizeof( head ) - tail_len );
     if( res != MONGO_OK ) {
         bson_free( mm );
         return res;
     }
 
     bson_free( mm );
+
+    if( tail_len )
+        return mongo_env_write_socket( conn, tail, tail_len );
+    return MONGO_OK;
+}
+
+/* Always calls bson_free(mm) */
+static int mongo_message_send( mongo *conn, mongo_message *mm ) {
+    return mongo_message_send_tail( conn, mm, NULL, 0 );
+}
+
+/* An OP_MSG reply is handed out as an OP_REPLY holding one document, the
+ * body section, so callers read both kinds of reply the same way. */
+static int mongo_read_msg( mongo *conn, const mongo_header *head, unsigned int len,
+                           mongo_reply **reply ) {
+    char prefix[5]; /* flagBits, kind of the first section */
+    mongo_reply *out;
+    unsigned int size;
+    int res;
+
+    if ( len < sizeof( *head ) + 5 + 5 || len > 64*1024*1024 )
+        return MONGO_READ_SIZE_ERROR;
+
+    if ( ( res = mongo_env_read_socket( conn, prefix, 5 ) ) != MONGO_OK )
+        return res;
+
+    /* Servers send the body section first. */
+    if ( prefix[4] != 0 )
+        return MONGO_READ_SIZE_ERROR;
+
+    out = ( mongo_reply * )bson_malloc( sizeof(mongo_reply) - sizeof(char) + len - 16 - 5 );
+
+    bson_little_endian32( &out->head.id, &head->id );
+    bson_little_endian32( &out->head.responseTo, &head->responseTo );
+    out->head.op = MONGO_OP_MSG_2013;
+
+    bson_little_endian32( &out->fields.flag, prefix );
+    out->fields.cursorID = 0;
+    out->fields.start = 0;
+    out->fields.num = 1;
+
+    /* Any later sections and the checksum are read along and ignored. */
+    res = mongo_env_read_socket( conn, &out->objs, len - 16 - 5 );
+    if( res != MONGO_OK ) {
+        bson_free( out );
+        return res;
+    }
+
+    bson_little_endian32( &size, &out->objs );
+    if ( size < 5 || size > len - 16 - 5 ) {
+        bson_free( out );
+        return MONGO_READ_SIZE_ERROR;
+    }
+    out->head.len = 16 + 20 + size;
+
+    *reply = out;
+
     return MONGO_OK;
 }
 
@@ -333,14 +409,20 @@ static int mongo_read_response( mongo *conn, mongo_reply **reply ) {
     mongo_reply_fields fields; /* header from network */
     mongo_reply *out;  /* native endian */
     unsigned int len;
+    int op;
     int res;
 
-    if ( ( res = mongo_env_read_socket( conn, &head, sizeof( head ) ) ) != MONGO_OK ||
-         ( res = mongo_env_read_socket( conn, &fields, sizeof( fields ) ) ) != MONGO_OK ) {
+    if ( ( res = mongo_env_read_socket( conn, &head, sizeof( head ) ) ) != MONGO_OK )
         return res;
-    }
 
     bson_little_endian32( &len, &head.len );
+    bson_little_endian32( &op, &head.op );
+
+    if ( op == MONGO_OP_MSG_2013 )
+        return mongo_read_msg( conn, &head, len, reply );
+
+    if ( ( res = mongo_env_read_socket( conn, &fields, sizeof( fields ) ) ) != MONGO_OK )
+        return res;
 
     if ( len < sizeof( head )+sizeof( fields ) || len > 64*1024*1024 )
         return MONGO_READ_SIZE_ERROR;  /* most likely corruption */
@@ -391,22 +473,117 @@ static char *mongo_data_append64( char *start , const void *data ) {
     return start + 8;
 }
 
+static int mongo_use_op_msg( mongo *conn ) {
+    return conn->max_wire_version >= MONGO_OP_MSG_WIRE_VERSION;
+}
+
+/* OP_MSG commands name their database in a "$db" field. */
+static void mongo_append_db( bson *b, const char *ns ) {
+    const char *dot = strchr( ns, '.' );
+    bson_append_string_n( b, "$db", ns, dot ? ( size_t )( dot - ns ) : strlen( ns ) );
+}
+
+static const char *mongo_ns_collection( const char *ns ) {
+    const char *dot = strchr( ns, '.' );
+    return dot ? dot + 1 : ns;
+}
+
+/* Allocate an OP_MSG and write it up to the documents of its sequence,
+ * which take docs_size bytes. Only inline_size bytes of them are allocated
+ * in the message; the caller copies those in at *data. */
+static mongo_message *mongo_msg_begin( int flags, const bson *command, const char *seq_id,
+                                       size_t docs_size, size_t inline_size, char **data ) {
+    mongo_message *mm;
+    char kind;
+    size_t size = 16 + 4 + 1 + bson_size( command );
+    int seq_size = 0;
+
+    if( seq_id ) {
+        size_t sl = 4 + strlen( seq_id ) + 1 + docs_size;
+        if( sl >= INT32_MAX )
+            return NULL;
+        seq_size = ( int )sl;
+        size += 1 + sl;
+    }
+
+    if( size >= INT32_MAX )
+        return NULL;
+    mm = mongo_message_create( size - ( docs_size - inline_size ), 0, 0, MONGO_OP_MSG_2013 );
+    if( mm == NULL )
+        return NULL;
+    mm->head.len = ( int )size;
+
+    *data = &mm->data;
+    *data = mongo_data_append32( *data, &flags );
+    kind = 0;
+    *data = mongo_data_append( *data, &kind, 1 );
+    *data = mongo_data_append( *data, command->data, bson_size( command ) );
+
+    if( seq_id ) {
+        kind = 1;
+        *data = mongo_data_append( *data, &kind, 1 );
+        *data = mongo_data_append32( *data, &seq_size );
+        *data = mongo_data_append( *data, seq_id, strlen( seq_id ) + 1 );
+    }
+
+    return mm;
+}
+
+/* Build an OP_MSG with command as its body and, when seq_id is given,
+ * docs as a document sequence named seq_id. */
+static mongo_message *mongo_msg_create( int flags, const bson *command,
+                                        const char *seq_id, const bson **docs, int count ) {
+    mongo_message *mm;
+    char *data;
+    size_t docs_size = 0;
+    int i;
+
+    for( i = 0; i < count; i++ )
+        docs_size += bson_size( docs[i] );
+
+    mm = mongo_msg_begin( flags, command, seq_id, docs_size, docs_size, &data );
+    if( mm == NULL )
+        return NULL;
+
+    for( i = 0; i < count; i++ )
+        data = mongo_data_append( data, docs[i]->data, bson_size( docs[i] ) );
+
+    bson_fatal_msg( ( data == ( ( char * )mm ) + mm->head.len ), "message building fail!" );
+
+    return mm;
+}
+
 /* Connection API */
 
+static void mongo_set_server_limits( mongo *conn, const bson *ismaster ) {
+    bson_iterator it;
+
+    conn->max_bson_size = MONGO_DEFAULT_MAX_BSON_SIZE;
+    conn->max_wire_version = 0;
+    conn->max_write_batch_size = MONGO_DEFAULT_MAX_WRITE_BATCH;
+    conn->max_message_size = MONGO_DEFAULT_MAX_MESSAGE_SIZE;
+
+    if( bson_find( &it, ismaster, "maxBsonObjectSize" ) )
+        conn->max_bson_size = bson_iterator_int( &it );
+    if( bson_find( &it, ismaster, "maxWireVersion" ) )
+        conn->max_wire_version = bson_iterator_int( &it );
+    if( bson_find( &it, ismaster, "maxWriteBatchSize" ) )
+        conn->max_write_batch_size = bson_iterator_int( &it );
+    if( bson_find( &it, ismaster, "maxMessageSizeBytes" ) )
+        conn->max_message_size = bson_iterator_int( &it );
+}
+
 static int mongo_check_is_master( mongo *conn ) {
     bson out;
     bson_iterator it;
     bson_bool_t ismaster = 0;
-    int max_bson_size = MONGO_DEFAULT_MAX_BSON_SIZE;
 
     if ( mongo_simple_int_command( conn, "admin", "ismaster", 1, &out ) != MONGO_OK )
         return MONGO_ERROR;
 
     if( bson_find( &it, &out, "ismaster" ) )
         ismaster = bson_iterator_bool( &it );
-    if( bson_find( &it, &out, "maxBsonObjectSize" ) )
-        max_bson_size = bson_iterator_int( &it );
-    conn->max_bson_size = max_bson_size;
+    mongo_set_server_limits( conn, &out );
 
     bson_destroy( &out );
 
@@ -432,6 +609,8 @@ static mongo_write_concern WC1 = { 1, 0, 0, 0, 0, &WC1_cmd }; /* w = 1 */
 MONGO_EXPORT void mongo_init( mongo *conn ) {
     memset( conn, 0, sizeof( mongo ) );
     conn->max_bson_size = MONGO_DEFAULT_MAX_BSON_SIZE;
+    conn->max_write_batch_size = MONGO_DEFAULT_MAX_WRITE_BATCH;
+    conn->max_message_size = MONGO_DEFAULT_MAX_MESSAGE_SIZE;
     mongo_set_write_concern( conn, &WC1 );
 }
 
@@ -588,15 +767,12 @@ static int mongo_replica_set_check_host( mongo *conn ) {
     bson_iterator it[1];
     bson_bool_t ismaster = 0;
     const char *set_name;
-    int max_bson_size = MONGO_DEFAULT_MAX_BSON_SIZE;
 
     if ( mongo_simple_int_command( conn, "admin", "ismaster", 1, out ) == MONGO_OK ) {
         if( bson_find( it, out, "ismaster" ) )
             ismaster = bson_iterator_bool( it );
 
-        if( bson_find( it, out, "maxBsonObjectSize" ) )
-            max_bson_size = bson_iterator_int( it );
-        conn->max_bson_size = max_bson_size;
+        mongo_set_server_limits( conn, out );
 
         if( bson_find( it, out, "setName" ) ) {
             set_name = bson_iterator_string( it );
@@ -733,6 +909,12 @@ MONGO_EXPORT void mongo_disconnect( mongo *conn ) {
 
     mongo_env_close_socket( conn->sock );
 
+    /* The read-ahead reply went down with the socket. */
+    if( conn->prefetch ) {
+        conn->prefetch->flags &= ~MONGO_CURSOR_PREFETCH;
+        conn->prefetch = NULL;
+    }
+
     conn->sock = 0;
     conn->connected = 0;
 }
@@ -869,6 +1051,160 @@ static int mongo_message_send_and_check_write_concern( mongo *conn, const char *
     }
 }
 
+static void mongo_set_server_error( mongo *conn, mongo_error_t err, const bson *obj ) {
+    bson_iterator it[1];
+
+    __mongo_set_error( conn, err, "See conn->lasterrstr for details.", 0 );
+    if( bson_find( it, obj, "errmsg" ) == BSON_STRING )
+        mongo_set_last_error( conn, it, ( bson * )obj );
+}
+
+/* Write commands report failure in the reply instead of through getLastError. */
+static int mongo_check_write_reply( mongo *conn, mongo_reply *reply ) {
+    bson body[1];
+    bson err[1];
+    bson_iterator it[1];
+    bson_iterator sub[1];
+
+    bson_init_finished_data( body, &reply->objs, 0 );
+
+    if( !bson_find( it, body, "ok" ) || !bson_iterator_bool( it ) ) {
+        mongo_set_server_error( conn, MONGO_COMMAND_FAILED, body );
+        return MONGO_ERROR;
+    }
+
+    if( bson_find( it, body, "writeErrors" ) == BSON_ARRAY ) {
+        bson_iterator_subiterator( it, sub );
+        if( bson_iterator_next( sub ) == BSON_OBJECT ) {
+            bson_iterator_subobject_init( sub, err, 0 );
+            mongo_set_server_error( conn, MONGO_WRITE_ERROR, err );
+            return MONGO_ERROR;
+        }
+    }
+
+    if( bson_find( it, body, "writeConcernError" ) == BSON_OBJECT ) {
+        bson_iterator_subobject_init( it, err, 0 );
+        mongo_set_server_error( conn, MONGO_WRITE_ERROR, err );
+        return MONGO_ERROR;
+    }
+
+    return MONGO_OK;
+}
+
+static void mongo_append_write_concern( bson *b, mongo_write_concern *write_concern ) {
+    bson_append_start_object( b, "writeConcern" );
+    if( !write_concern )
+        bson_append_int( b, "w", 0 );
+    else {
+        if( write_concern->mode )
+            bson_append_string( b, "w", write_concern->mode );
+        else
+            bson_append_int( b, "w", write_concern->w );
+        if( write_concern->wtimeout )
+            bson_append_int( b, "wtimeout", write_concern->wtimeout );
+        if( write_concern->j )
+            bson_append_bool( b, "j", 1 );
+        if( write_concern->fsync )
+            bson_append_bool( b, "fsync", 1 );
+    }
+    bson_append_finish_object( b );
+}
+
+static void mongo_write_command_init( bson *cmd, const char *ns, const char *cmd_name,
+                                      int ordered, mongo_write_concern *write_concern ) {
+    bson_init( cmd );
+    bson_append_string( cmd, cmd_name, mongo_ns_collection( ns ) );
+    bson_append_bool( cmd, "ordered", ordered );
+    mongo_append_write_concern( cmd, write_concern );
+    mongo_append_db( cmd, ns );
+    bson_finish( cmd );
+}
+
+/* Send one write command and, if it is acknowledged, check its reply. */
+static int mongo_write_command_send( mongo *conn, mongo_message *mm, const char *tail,
+                                     int tail_len, mongo_write_concern *write_concern ) {
+    mongo_reply *reply;
+    int res;
+
+    if( mm == NULL ) {
+        conn->err = MONGO_BSON_TOO_LARGE;
+        return MONGO_ERROR;
+    }
+
+    if( mongo_message_send_tail( conn, mm, tail, tail_len ) != MONGO_OK )
+        return MONGO_ERROR;
+
+    if( !write_concern )
+        return MONGO_OK;
+
+    if( mongo_read_response( conn, &reply ) != MONGO_OK )
+        return MONGO_ERROR;
+
+    res = mongo_check_write_reply( conn, reply );
+    bson_free( reply );
+    return res;
+}
+
+/* After a failed batch of an unordered write, whether to go on with the rest. */
+static int mongo_write_can_continue( mongo *conn, int ordered ) {
+    return !ordered && ( conn->err == MONGO_WRITE_ERROR || conn->err == MONGO_COMMAND_FAILED );
+}
+
+/* Run an insert, update or delete command over OP_MSG, with the documents
+ * sent as a document sequence, so an acknowledged write takes one round
+ * trip. Unacknowledged writes set moreToCome and get no reply at all.
+ * Each message carries at most max_write_batch_size documents and stays
+ * within max_message_size bytes. */
+static int mongo_write_command( mongo *conn, const char *ns, const char *cmd_name,
+                                const char *seq_id, const bson **docs, int count,
+                                int ordered, mongo_write_concern *write_concern ) {
+    bson cmd[1];
+    mongo_message *mm;
+    int batch = conn->max_write_batch_size > 0 ? conn->max_write_batch_size : count;
+    int result = MONGO_OK;
+    int i, n, room, size;
+
+    for( i = 0; i < count; i += n ) {
+        mongo_write_command_init( cmd, ns, cmd_name, ordered, write_concern );
+
+        /* header, flags, the command section and the sequence header */
+        room = conn->max_message_size - ( 16 + 4 + 1 + bson_size( cmd )
+                                          + 1 + 4 + ( int )strlen( seq_id ) + 1 );
+        for( n = 0; i + n < count && n < batch; n++ ) {
+            size = bson_size( docs[i + n] );
+            if( n && size > room )
+                break;
+            room -= size;
+        }
+
+        mm = mongo_msg_create( write_concern ? 0 : MONGO_MSG_MORE_TO_COME,
+                               cmd, seq_id, docs + i, n );
+        bson_destroy( cmd );
+
+        if( mongo_write_command_send( conn, mm, NULL, 0, write_concern ) != MONGO_OK ) {
+            result = MONGO_ERROR;
+            if( !mongo_write_can_continue( conn, ordered ) )
+                break;
+        }
+    }
+
+    return result;
+}
+
+/* The update or delete statement for a write command. */
+static void mongo_write_statement( bson *b, const bson *cond, const bson *op, int flags ) {
+    bson_init( b );
+    bson_append_bson( b, "q", cond );
+    if( op ) {
+        bson_append_bson( b, "u", op );
+        bson_append_bool( b, "upsert", ( flags & MONGO_UPDATE_UPSERT ) != 0 );
+        bson_append_bool( b, "multi", ( flags & MONGO_UPDATE_MULTI ) != 0 );
+    }
+    else
+        bson_append_int( b, "limit", 0 );
+    bson_finish( b );
+}
+
 MONGO_EXPORT int mongo_insert( mongo *conn, const char *ns,
                                const bson *bson, mongo_write_concern *custom_write_concern ) {
 
@@ -888,6 +1224,9 @@ MONGO_EXPORT int mongo_insert( mongo *conn, const char *ns,
         return MONGO_ERROR;
     }
 
+    if( mongo_use_op_msg( conn ) )
+        return mongo_write_command( conn, ns, "insert", "documents", &bson, 1, 1, write_concern );
+
     mm = mongo_message_create( 16 /* header */
                                + 4 /* ZERO */
                                + strlen( ns )
@@ -936,6 +1275,10 @@ MONGO_EXPORT int mongo_insert_batch( mongo *conn, const char *ns,
         return MONGO_ERROR;
     }
 
+    if( mongo_use_op_msg( conn ) )
+        return mongo_write_command( conn, ns, "insert", "documents", bsons, count,
+                                    !( flags & MONGO_CONTINUE_ON_ERROR ), write_concern );
+
     mm = mongo_message_create( size , 0 , 0 , MONGO_OP_INSERT );
     if( mm == NULL ) {
         conn->err = MONGO_BSON_TOO_LARGE;
@@ -956,6 +1299,87 @@ MONGO_EXPORT int mongo_insert_batch( mongo *conn, const char *ns,
     return mongo_message_send_and_check_write_concern( conn, ns, mm, write_concern ); 
 }
 
+MONGO_EXPORT int mongo_insert_arena( mongo *conn, const char *ns, const bson_arena *docs,
+                                     mongo_write_concern *custom_write_concern, int flags ) {
+
+    mongo_message *mm;
+    mongo_write_concern *write_concern = NULL;
+    bson cmd[1];
+    char *data;
+    int ordered = !( flags & MONGO_CONTINUE_ON_ERROR );
+    int batch = docs->count;
+    int result = MONGO_OK;
+    int pos, end, n, size;
+
+    if( mongo_validate_ns( conn, ns ) != MONGO_OK )
+        return MONGO_ERROR;
+
+    if( docs->err & ( BSON_NOT_UTF8 | BSON_FIELD_HAS_DOT | BSON_FIELD_INIT_DOLLAR ) ) {
+        conn->err = MONGO_BSON_INVALID;
+        return MONGO_ERROR;
+    }
+
+    for( pos = 0; pos < docs->used; pos += size ) {
+        bson_little_endian32( &size, docs->data + pos );
+        if( size > conn->max_bson_size ) {
+            conn->err = MONGO_BSON_TOO_LARGE;
+            return MONGO_ERROR;
+        }
+    }
+
+    if( mongo_choose_write_concern( conn, custom_write_concern,
+                                    &write_concern ) == MONGO_ERROR ) {
+        return MONGO_ERROR;
+    }
+
+    if( mongo_use_op_msg( conn ) && conn->max_write_batch_size > 0 )
+        batch = conn->max_write_batch_size;
+
+    /* the documents go out straight from the arena, in runs of at most
+       batch documents and max_bson_size bytes */
+    for( pos = 0; pos < docs->used; pos = end ) {
+        for( end = pos, n = 0; end < docs->used && n < batch; end += size, n++ ) {
+            bson_little_endian32( &size, docs->data + end );
+            if( n && end - pos + size > conn->max_bson_size )
+                break;
+        }
+
+        if( mongo_use_op_msg( conn ) ) {
+            mongo_write_command_init( cmd, ns, "insert", ordered, write_concern );
+            mm = mongo_msg_begin( write_concern ? 0 : MONGO_MSG_MORE_TO_COME,
+                                  cmd, "documents", end - pos, 0, &data );
+            bson_destroy( cmd );
+
+            if( mongo_write_command_send( conn, mm, docs->data + pos, end - pos,
+                                          write_concern ) == MONGO_OK )
+                continue;
+        }
+        else {
+            mm = mongo_message_create( 16 + 4 + strlen( ns ) + 1, 0, 0, MONGO_OP_INSERT );
+            if( mm == NULL ) {
+                conn->err = MONGO_BSON_TOO_LARGE;
+                return MONGO_ERROR;
+            }
+            mm->head.len += end - pos;
+
+            data = &mm->data;
+            data = mongo_data_append32( data, ordered ? &ZERO : &ONE );
+            data = mongo_data_append( data, ns, strlen( ns ) + 1 );
+
+            if( mongo_message_send_tail( conn, mm, docs->data + pos, end - pos ) != MONGO_OK )
+                return MONGO_ERROR;
+            if( !write_concern || mongo_check_last_error( conn, ns, write_concern ) == MONGO_OK )
+                continue;
+        }
+
+        result = MONGO_ERROR;
+        if( !mongo_write_can_continue( conn, ordered ) )
+            break;
+    }
+
+    return result;
+}
+
 MONGO_EXPORT int mongo_update( mongo *conn, const char *ns, const bson *cond,
                                const bson *op, int flags, mongo_write_concern *custom_write_concern ) {
 
@@ -975,6 +1399,18 @@ MONGO_EXPORT int mongo_update( mongo *conn, const char *ns, const bson *cond,
         return MONGO_ERROR;
     }
 
+    if( mongo_use_op_msg( conn ) ) {
+        bson stmt[1];
+        const bson *stmts[1];
+        int res;
+
+        stmts[0] = stmt;
+        mongo_write_statement( stmt, cond, op, flags );
+        res = mongo_write_command( conn, ns, "update", "updates", stmts, 1, 1, write_concern );
+        bson_destroy( stmt );
+        return res;
+    }
+
     mm = mongo_message_create( 16 /* header */
                                + 4  /* ZERO */
                                + strlen( ns ) + 1
@@ -1016,6 +1452,18 @@ MONGO_EXPORT int mongo_remove( mongo *conn, const char *ns, const bson *cond,
         return MONGO_ERROR;
     }
 
+    if( mongo_use_op_msg( conn ) ) {
+        bson stmt[1];
+        const bson *stmts[1];
+        int res;
+
+        stmts[0] = stmt;
+        mongo_write_statement( stmt, cond, NULL, 0 );
+        res = mongo_write_command( conn, ns, "delete", "deletes", stmts, 1, 1, write_concern );
+        bson_destroy( stmt );
+        return res;
+    }
+
     mm = mongo_message_create( 16  /* header */
                                + 4  /* ZERO */
                                + strlen( ns ) + 1
@@ -1159,12 +1607,177 @@ MONGO_EXPORT void mongo_write_concern_set_mode( mongo_write_concern *write_conce
     write_concern->mode = mode;
 }
 
+static void mongo_cursor_prefetch( mongo_cursor *cursor );
+
+/* Legacy query modifiers and the find command options they turn into. */
+static const char *mongo_find_modifiers[][2] = {
+    { "$query", "filter" },
+    { "$orderby", "sort" },
+    { "$hint", "hint" },
+    { "$comment", "comment" },
+    { "$maxTimeMS", "maxTimeMS" },
+    { "$max", "max" },
+    { "$min", "min" },
+    { "$returnKey", "returnKey" },
+    { "$showDiskLoc", "showRecordId" },
+    { "$snapshot", "snapshot" },
+    { "$maxScan", "maxScan" },
+    { NULL, NULL }
+};
+
+static void mongo_append_read_preference( bson *b ) {
+    bson_append_start_object( b, "$readPreference" );
+    bson_append_string( b, "mode", "secondaryPreferred" );
+    bson_append_finish_object( b );
+}
+
+/* Express the cursor's query as an OP_MSG command: the query itself on a
+ * $cmd namespace, a find command otherwise. Returns 0 for queries only
+ * OP_QUERY can run, such as $explain. */
+static int mongo_cursor_command( mongo_cursor *cursor, bson *cmd ) {
+    bson_iterator it[1];
+    bson sub[1];
+    const bson *query = cursor->query;
+    const char *coll = mongo_ns_collection( cursor->ns );
+    int wrapped = bson_find( it, query, "$query" ) == BSON_OBJECT;
+    int i;
+
+    if( !strcmp( coll, "$cmd" ) ) {
+        if( wrapped ) {
+            bson_iterator_subobject_init( it, sub, 0 );
+            query = sub;
+        }
+
+        bson_init( cmd );
+        bson_iterator_init( it, query );
+        while( bson_iterator_next( it ) )
+            bson_append_element( cmd, NULL, it );
+        mongo_append_db( cmd, cursor->ns );
+        if( cursor->options & MONGO_SLAVE_OK )
+            mongo_append_read_preference( cmd );
+        bson_finish( cmd );
+
+        return 1;
+    }
+
+    if( wrapped && bson_find( it, query, "$explain" ) )
+        return 0;
+
+    bson_init( cmd );
+    bson_append_string( cmd, "find", coll );
+
+    if( wrapped ) {
+        bson_iterator_init( it, query );
+        while( bson_iterator_next( it ) ) {
+            const char *key = bson_iterator_key( it );
+
+            for( i = 0; mongo_find_modifiers[i][0]; i++ )
+                if( !strcmp( key, mongo_find_modifiers[i][0] ) )
+                    break;
+            bson_append_element( cmd, mongo_find_modifiers[i][1], it );
+        }
+    }
+    else
+        bson_append_bson( cmd, "filter", query );
+
+    if( bson_size( cursor->fields ) > 5 )
+        bson_append_bson( cmd, "projection", cursor->fields );
+    if( cursor->skip )
+        bson_append_int( cmd, "skip", cursor->skip );
+    if( cursor->limit > 0 )
+        bson_append_int( cmd, "limit", cursor->limit );
+    else if( cursor->limit < 0 ) {
+        bson_append_int( cmd, "limit", -cursor->limit );
+        bson_append_bool( cmd, "singleBatch", 1 );
+    }
+    if( cursor->options & MONGO_TAILABLE )
+        bson_append_bool( cmd, "tailable", 1 );
+    if( cursor->options & MONGO_AWAIT_DATA )
+        bson_append_bool( cmd, "awaitData", 1 );
+    if( cursor->options & MONGO_NO_CURSOR_TIMEOUT )
+        bson_append_bool( cmd, "noCursorTimeout", 1 );
+    if( cursor->options & MONGO_PARTIAL )
+        bson_append_bool( cmd, "allowPartialResults", 1 );
+
+    mongo_append_db( cmd, cursor->ns );
+    if( ( cursor->options & MONGO_SLAVE_OK ) && !( wrapped && bson_find( it, query, "$readPreference" ) ) )
+        mongo_append_read_preference( cmd );
+    bson_finish( cmd );
+
+    cursor->flags |= MONGO_CURSOR_OP_MSG;
+    return 1;
+}
+
+/* Turn the body of a find or getMore reply into a plain batch: the
+ * documents of cursor.firstBatch or cursor.nextBatch are moved to the
+ * front of the reply, back to back, the way OP_REPLY carries them. */
+static int mongo_cursor_unpack( mongo_cursor *cursor ) {
+    mongo_reply *reply = cursor->reply;
+    bson body[1];
+    bson_iterator it[1];
+    bson_iterator sub[1];
+    bson_iterator batch[1];
+    char *out = &reply->objs;
+    int64_t id = 0;
+    int found = 0;
+    int num = 0;
+    bson_type type;
+
+    bson_init_finished_data( body, &reply->objs, 0 );
+
+    if( !bson_find( it, body, "ok" ) || !bson_iterator_bool( it ) ||
+            bson_find( sub, body, "cursor" ) != BSON_OBJECT ) {
+        if( bson_find( it, body, "errmsg" ) == BSON_STRING )
+            mongo_set_last_error( cursor->conn, it, body );
+        reply->fields.cursorID = 0;
+        reply->fields.num = 0;
+        cursor->err = MONGO_CURSOR_QUERY_FAIL;
+        return MONGO_ERROR;
+    }
+
+    bson_iterator_subiterator( sub, it );
+    while( bson_iterator_next( it ) ) {
+        const char *key = bson_iterator_key( it );
+
+        if( !strcmp( key, "id" ) )
+            id = bson_iterator_long( it );
+        else if( !strcmp( key, "firstBatch" ) || !strcmp( key, "nextBatch" ) ) {
+            *batch = *it;
+            found = 1;
+        }
+    }
+
+    if( found ) {
+        bson_iterator_subiterator( batch, it );
+        type = bson_iterator_next( it );
+        while( type == BSON_OBJECT ) {
+            const char *doc = bson_iterator_value( it );
+            int size;
+
+            bson_little_endian32( &size, doc );
+
+            /* Step past the element before the move overwrites it. */
+            type = bson_iterator_next( it );
+            memmove( out, doc, size );
+            out += size;
+            num++;
+        }
+    }
+
+    reply->head.len = ( int )( out - ( char * )reply );
+    reply->fields.cursorID = id;
+    reply->fields.num = num;
+
+    return MONGO_OK;
+}
+
 static int mongo_cursor_op_query( mongo_cursor *cursor ) {
     int res;
     char *data;
     mongo_message *mm;
     bson temp;
     bson_iterator it;
+    bson cmd[1];
 
     /* Clear any errors. */
     mongo_clear_errors( cursor->conn );
@@ -1180,27 +1793,36 @@ static int mongo_cursor_op_query( mongo_cursor *cursor ) {
     else if( mongo_cursor_bson_valid( cursor, cursor->fields ) != MONGO_OK )
         return MONGO_ERROR;
 
-    mm = mongo_message_create( 16 + /* header */
-                               4 + /*  options */
-                               strlen( cursor->ns ) + 1 + /* ns */
-                               4 + 4 + /* skip,return */
-                               bson_size( cursor->query ) +
-                               bson_size( cursor->fields ) ,
-                               0 , 0 , MONGO_OP_QUERY );
-    if( mm == NULL ) {
-        return MONGO_ERROR;
+    if( mongo_use_op_msg( cursor->conn ) && mongo_cursor_command( cursor, cmd ) ) {
+        mm = mongo_msg_create( 0, cmd, NULL, NULL, 0 );
+        bson_destroy( cmd );
+        if( mm == NULL ) {
+            return MONGO_ERROR;
+        }
     }
+    else {
+        mm = mongo_message_create( 16 + /* header */
+                                   4 + /*  options */
+                                   strlen( cursor->ns ) + 1 + /* ns */
+                                   4 + 4 + /* skip,return */
+                                   bson_size( cursor->query ) +
+                                   bson_size( cursor->fields ) ,
+                                   0 , 0 , MONGO_OP_QUERY );
+        if( mm == NULL ) {
+            return MONGO_ERROR;
+        }
 
-    data = &mm->data;
-    data = mongo_data_append32( data , &cursor->options );
-    data = mongo_data_append( data , cursor->ns , strlen( cursor->ns ) + 1 );
-    data = mongo_data_append32( data , &cursor->skip );
-    data = mongo_data_append32( data , &cursor->limit );
-    data = mongo_data_append( data , cursor->query->data , bson_size( cursor->query ) );
-    if ( cursor->fields )
-        data = mongo_data_append( data , cursor->fields->data , bson_size( cursor->fields ) );
+        data = &mm->data;
+        data = mongo_data_append32( data , &cursor->options );
+        data = mongo_data_append( data , cursor->ns , strlen( cursor->ns ) + 1 );
+        data = mongo_data_append32( data , &cursor->skip );
+        data = mongo_data_append32( data , &cursor->limit );
+        data = mongo_data_append( data , cursor->query->data , bson_size( cursor->query ) );
+        if ( cursor->fields )
+            data = mongo_data_append( data , cursor->fields->data , bson_size( cursor->fields ) );
 
-    bson_fatal_msg( ( data == ( ( char * )mm ) + mm->head.len ), "query building fail!" );
+        bson_fatal_msg( ( data == ( ( char * )mm ) + mm->head.len ), "query building fail!" );
+    }
 
     res = mongo_message_send( cursor->conn , mm );
     if( res != MONGO_OK ) {
@@ -1212,7 +1834,11 @@ static int mongo_cursor_op_query( mongo_cursor *cursor ) {
         return MONGO_ERROR;
     }
 
-    if( cursor->reply->fields.num == 1 ) {
+    if( cursor->flags & MONGO_CURSOR_OP_MSG ) {
+        if( mongo_cursor_unpack( cursor ) != MONGO_OK )
+            return MONGO_ERROR;
+    }
+    else if( cursor->reply->fields.num == 1 ) {
         bson_init_finished_data( &temp, &cursor->reply->objs, 0 );
         if( bson_find( &it, &temp, "$err" ) ) {
             mongo_set_last_error( cursor->conn, &it, &temp );
@@ -1223,13 +1849,96 @@ static int mongo_cursor_op_query( mongo_cursor *cursor ) {
 
     cursor->seen += cursor->reply->fields.num;
     cursor->flags |= MONGO_CURSOR_QUERY_SENT;
+    mongo_cursor_prefetch( cursor );
+    return MONGO_OK;
+}
+
+static int mongo_cursor_send_get_more( mongo_cursor *cursor ) {
+    mongo_message *mm;
+    int limit = 0;
+
+    if( cursor->limit > 0 )
+        limit = cursor->limit - cursor->seen;
+
+    if( cursor->flags & MONGO_CURSOR_OP_MSG ) {
+        bson cmd[1];
+
+        bson_init( cmd );
+        bson_append_long( cmd, "getMore", cursor->reply->fields.cursorID );
+        bson_append_string( cmd, "collection", mongo_ns_collection( cursor->ns ) );
+        if( limit )
+            bson_append_int( cmd, "batchSize", limit );
+        mongo_append_db( cmd, cursor->ns );
+        bson_finish( cmd );
+
+        mm = mongo_msg_create( 0, cmd, NULL, NULL, 0 );
+        bson_destroy( cmd );
+    }
+    else {
+        char *data;
+        size_t sl = strlen( cursor->ns )+1;
+
+        mm = mongo_message_create( 16 /*header*/
+                                   +4 /*ZERO*/
+                                   +sl
+                                   +4 /*numToReturn*/
+                                   +8 /*cursorID*/
+                                   , 0, 0, MONGO_OP_GET_MORE );
+        if( mm != NULL ) {
+            data = &mm->data;
+            data = mongo_data_append32( data, &ZERO );
+            data = mongo_data_append( data, cursor->ns, sl );
+            data = mongo_data_append32( data, &limit );
+            mongo_data_append64( data, &cursor->reply->fields.cursorID );
+        }
+    }
+
+    if( mm == NULL ) {
+        return MONGO_ERROR;
+    }
+
+    return mongo_message_send( cursor->conn, mm );
+}
+
+/* Ask for the next batch as soon as one arrives, so the server prepares
+ * it while the caller iterates. The reply is read by mongo_cursor_get_more,
+ * or parked on the cursor by mongo_cursor_settle if anything else needs
+ * the connection first. Tailable cursors may wait for data on the server
+ * and are left alone. */
+static void mongo_cursor_prefetch( mongo_cursor *cursor ) {
+    if( !cursor->reply->fields.cursorID ||
+            ( cursor->options & MONGO_TAILABLE ) ||
+            cursor->limit < 0 ||
+            ( cursor->limit > 0 && cursor->seen >= cursor->limit ) )
+        return;
+
+    if( mongo_cursor_send_get_more( cursor ) == MONGO_OK ) {
+        cursor->flags |= MONGO_CURSOR_PREFETCH;
+        cursor->conn->prefetch = cursor;
+    }
+}
+
+/* Pick up the reply to a getMore sent ahead by mongo_cursor_prefetch. */
+static int mongo_cursor_read_prefetch( mongo_cursor *cursor, mongo_reply **reply ) {
+    cursor->flags &= ~MONGO_CURSOR_PREFETCH;
+
+    if( cursor->conn->prefetch == cursor ) {
+        cursor->conn->prefetch = NULL;
+        return mongo_read_response( cursor->conn, reply );
+    }
+
+    *reply = cursor->prefetched;
+    cursor->prefetched = NULL;
     return MONGO_OK;
 }
 
 static int mongo_cursor_get_more( mongo_cursor *cursor ) {
+    mongo_reply *reply;
     int res;
 
-    if( cursor->limit > 0 && cursor->seen >= cursor->limit ) {
+    if( cursor->flags & MONGO_CURSOR_PREFETCH )
+        res = mongo_cursor_read_prefetch( cursor, &reply );
+    else if( cursor->limit > 0 && cursor->seen >= cursor->limit ) {
         cursor->err = MONGO_CURSOR_EXHAUSTED;
         return MONGO_ERROR;
     }
@@ -1242,46 +1951,25 @@ static int mongo_cursor_get_more( mongo_cursor *cursor ) {
         return MONGO_ERROR;
     }
     else {
-        char *data;
-        size_t sl = strlen( cursor->ns )+1;
-        int limit = 0;
-        mongo_message *mm;
-
-        if( cursor->limit > 0 )
-            limit = cursor->limit - cursor->seen;
+        res = mongo_cursor_send_get_more( cursor );
+        if( res == MONGO_OK )
+            res = mongo_read_response( cursor->conn, &reply );
+    }
 
-        mm = mongo_message_create( 16 /*header*/
-                                   +4 /*ZERO*/
-                                   +sl
-                                   +4 /*numToReturn*/
-                                   +8 /*cursorID*/
-                                   , 0, 0, MONGO_OP_GET_MORE );
-        if( mm == NULL ) {
-            return MONGO_ERROR;
-        }
+    if( res != MONGO_OK )
+        return MONGO_ERROR;
 
-        data = &mm->data;
-        data = mongo_data_append32( data, &ZERO );
-        data = mongo_data_append( data, cursor->ns, sl );
-        data = mongo_data_append32( data, &limit );
-        mongo_data_append64( data, &cursor->reply->fields.cursorID );
-
-        bson_free( cursor->reply );
-        res = mongo_message_send( cursor->conn, mm );
-        if( res != MONGO_OK ) {
-            mongo_cursor_destroy( cursor );
-            return MONGO_ERROR;
-        }
+    bson_free( cursor->reply );
+    cursor->reply = reply;
 
-        res = mongo_read_response( cursor->conn, &( cursor->reply ) );
-        if( res != MONGO_OK )
-            return MONGO_ERROR;
+    if( ( cursor->flags & MONGO_CURSOR_OP_MSG ) && mongo_cursor_unpack( cursor ) != MONGO_OK )
+        return MONGO_ERROR;
 
-        cursor->current.data = NULL;
-        cursor->seen += cursor->reply->fields.num;
+    cursor->current.data = NULL;
+    cursor->seen += cursor->reply->fields.num;
+    mongo_cursor_prefetch( cursor );
 
-        return MONGO_OK;
-    }
+    return MONGO_OK;
 }
 
 MONGO_EXPORT mongo_cursor *mongo_find( mongo *conn, const char *ns, const bson *query,
@@ -1432,25 +2120,60 @@ MONGO_EXPORT int mongo_cursor_destroy( mongo_cursor *cursor ) {
 
     if ( !cursor ) return result;
 
+    /* The batch read ahead has to come off the wire, and holds the
+     * cursor id the server ended up with. */
+    if ( cursor->flags & MONGO_CURSOR_PREFETCH ) {
+        mongo_reply *reply;
+
+        if( mongo_cursor_read_prefetch( cursor, &reply ) == MONGO_OK ) {
+            bson_free( cursor->reply );
+            cursor->reply = reply;
+            if( cursor->flags & MONGO_CURSOR_OP_MSG )
+                mongo_cursor_unpack( cursor );
+        }
+    }
+
     /* Kill cursor if live. */
     if ( cursor->reply && cursor->reply->fields.cursorID ) {
         mongo *conn = cursor->conn;
-        mongo_message *mm = mongo_message_create( 16 /*header*/
-                            +4 /*ZERO*/
-                            +4 /*numCursors*/
-                            +8 /*cursorID*/
-                            , 0, 0, MONGO_OP_KILL_CURSORS );
-        if( mm == NULL ) {
-            return MONGO_ERROR;
+        mongo_message *mm;
+
+        if( cursor->flags & MONGO_CURSOR_OP_MSG ) {
+            bson cmd[1];
+
+            bson_init( cmd );
+            bson_append_string( cmd, "killCursors", mongo_ns_collection( cursor->ns ) );
+            bson_append_start_array( cmd, "cursors" );
+            bson_append_long( cmd, "0", cursor->reply->fields.cursorID );
+            bson_append_finish_array( cmd );
+            mongo_append_db( cmd, cursor->ns );
+            bson_finish( cmd );
+
+            mm = mongo_msg_create( MONGO_MSG_MORE_TO_COME, cmd, NULL, NULL, 0 );
+            bson_destroy( cmd );
+            if( mm == NULL ) {
+                return MONGO_ERROR;
+            }
+        }
+        else {
+            mm = mongo_message_create( 16 /*header*/
+                                       +4 /*ZERO*/
+                                       +4 /*numCursors*/
+                                       +8 /*cursorID*/
+                                       , 0, 0, MONGO_OP_KILL_CURSORS );
+            if( mm == NULL ) {
+                return MONGO_ERROR;
+            }
+            data = &mm->data;
+            data = mongo_data_append32( data, &ZERO );
+            data = mongo_data_append32( data, &ONE );
+            mongo_data_append64( data, &cursor->reply->fields.cursorID );
         }
-        data = &mm->data;
-        data = mongo_data_append32( data, &ZERO );
-        data = mongo_data_append32( data, &ONE );
-        mongo_data_append64( data, &cursor->reply->fields.cursorID );
 
         result = mongo_message_send( conn, mm );
     }
 
+    bson_free( cursor->prefetched );
     bson_free( cursor->reply );
     bson_free( ( void * )cursor->ns );
 
@@ -35,6 +35,11 @@ MONGO_EXTERN_C_START
 #define MONGO_DEFAULT_PORT 27017
 
 #define MONGO_DEFAULT_MAX_BSON_SIZE 4 * 1024 * 1024
+#define MONGO_DEFAULT_MAX_WRITE_BATCH 1000
+#define MONGO_DEFAULT_MAX_MESSAGE_SIZE 48 * 1024 * 1024
+
+/* Servers at this wire version (3.6) and up are spoken to with OP_MSG. */
+#define MONGO_OP_MSG_WIRE_VERSION 6
 
 #define MONGO_ERR_LEN 128
 
@@ -75,7 +80,9 @@ typedef enum mongo_cursor_error_t {
 
 enum mongo_cursor_flags {
     MONGO_CURSOR_MUST_FREE = 1,      /**< mongo_cursor_destroy should free cursor. */
-    MONGO_CURSOR_QUERY_SENT = ( 1<<1 ) /**< Initial query has been sent. */
+    MONGO_CURSOR_QUERY_SENT = ( 1<<1 ), /**< Initial query has been sent. */
+    MONGO_CURSOR_OP_MSG = ( 1<<2 ),  /**< Runs the find/getMore commands over OP_MSG. */
+    MONGO_CURSOR_PREFETCH = ( 1<<3 ) /**< A getMore for the next batch has been sent. */
 };
 
 enum mongo_index_opts {
@@ -105,13 +112,19 @@ enum mongo_cursor_opts {
 };
 
 enum mongo_operations {
-    MONGO_OP_MSG = 1000,
+    MONGO_OP_MSG = 1000,        /**< Legacy OP_MSG, removed in 3.6. */
     MONGO_OP_UPDATE = 2001,
     MONGO_OP_INSERT = 2002,
     MONGO_OP_QUERY = 2004,
     MONGO_OP_GET_MORE = 2005,
     MONGO_OP_DELETE = 2006,
-    MONGO_OP_KILL_CURSORS = 2007
+    MONGO_OP_KILL_CURSORS = 2007,
+    MONGO_OP_MSG_2013 = 2013    /**< OP_MSG of wire version 6 and up. */
+};
+
+enum mongo_msg_flags {
+    MONGO_MSG_CHECKSUM_PRESENT = 1,  /**< The message ends with a crc32c. */
+    MONGO_MSG_MORE_TO_COME = ( 1<<1 ) /**< The server sends no reply. */
 };
 
 #pragma pack(1)
@@ -164,6 +177,8 @@ typedef struct {
     bson_bool_t primary_connected; /**< Primary node connection status. */
 } mongo_replica_set;
 
+struct mongo_cursor;
+
 typedef struct mongo {
     mongo_host_port *primary;  /**< Primary connection info. */
     mongo_replica_set *replica_set;    /**< replica_set object if connected to a replica set. */
@@ -172,8 +187,12 @@ typedef struct mongo {
     int conn_timeout_ms;       /**< Connection timeout in milliseconds. */
     int op_timeout_ms;         /**< Read and write timeout in milliseconds. */
     int max_bson_size;         /**< Largest BSON object allowed on this connection. */
+    int max_wire_version;      /**< Newest wire protocol version the server speaks. */
+    int max_write_batch_size;  /**< Most documents a single write command may carry. */
+    int max_message_size;      /**< Largest wire message the server accepts. */
     bson_bool_t connected;     /**< Connection status. */
     mongo_write_concern *write_concern; /**< The default write concern. */
+    struct mongo_cursor *prefetch; /**< Cursor whose getMore reply has not been read yet. */
 
     mongo_error_t err;          /**< Most recent driver error code. */
     int errcode;                /**< Most recent errno or WSAGetLastError(). */
@@ -182,7 +201,7 @@ typedef struct mongo {
     char lasterrstr[MONGO_ERR_LEN]; /**< getlasterror string from the server. */
 } mongo;
 
-typedef struct {
+typedef struct mongo_cursor {
     mongo_reply *reply;  /**< reply is owned by cursor */
     mongo *conn;       /**< connection is *not* owned by cursor */
     const char *ns;    /**< owned by cursor */
@@ -195,6 +214,7 @@ typedef struct {
     int options;       /**< Bitfield containing cursor options. */
     int limit;         /**< Bitfield containing cursor options. */
     int skip;          /**< Bitfield containing cursor options. */
+    mongo_reply *prefetched; /**< Next batch, read early to free the connection. */
 } mongo_cursor;
 
 /*********************************************************************
@@ -465,6 +485,24 @@ MONGO_EXPORT int mongo_insert_batch( mongo *conn, const char *ns,
                                      const bson **data, int num, mongo_write_concern *custom_write_concern,
                                      int flags );
 
+/**
+ * Insert the documents built in an arena. They are written to the
+ * socket straight from the arena rather than copied into a message, so
+ * together with bson_init_arena( ) a batch of documents is encoded
+ * without any per-document allocation or copy.
+ *
+ * @param conn a mongo object.
+ * @param ns the namespace.
+ * @param docs the arena holding the documents.
+ * @param custom_write_concern a write concern object that will
+ *     override any write concern set on the conn object.
+ * @param flags 0 or MONGO_CONTINUE_ON_ERROR, as for mongo_insert_batch( ).
+ *
+ * @return MONGO_OK or MONGO_ERROR.
+ */
+MONGO_EXPORT int mongo_insert_arena( mongo *conn, const char *ns, const bson_arena *docs,
+                                     mongo_write_concern *custom_write_concern, int flags );
+
 /**
  * Update a document in a MongoDB server.
  *
@@ -625,6 +663,10 @@ MONGO_EXPORT const bson *mongo_cursor_bson( mongo_cursor *cursor );
  * Iterate the cursor, returning the next item. When successful,
  *   the returned object will be stored in cursor->current;
  *
+ * As soon as a batch arrives the getMore for the following one is sent,
+ *   so the server prepares it while the caller works through the current
+ *   batch. Tailable and single-batch cursors are not read ahead.
+ *
  * @param cursor
  *
  * @return MONGO_OK. On error, returns MONGO_ERROR and sets
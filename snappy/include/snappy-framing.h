@@ -0,0 +1,144 @@
+// For conditions of distribution and use, see the copyright notice in
+// snappy.h.
+//
+// The Snappy framing format (framing_format.txt), for data that is too
+// large to hold in memory at once or that arrives piecemeal.
+//
+// A framed stream starts with a stream identifier chunk and continues with
+// data chunks, each holding at most kBlockSize bytes of input, either
+// Snappy-compressed or stored as-is when compression does not pay.  Every
+// data chunk carries the masked CRC-32C of its uncompressed bytes, so
+// corruption is detected chunk by chunk.  Streams may be concatenated.
+
+#ifndef UTIL_SNAPPY_SNAPPY_FRAMING_H__
+#define UTIL_SNAPPY_SNAPPY_FRAMING_H__
+
+#include <stddef.h>
+
+#include "snappy-stubs-public.h"
+#include "snappy-sinksource.h"
+
+namespace snappy {
+
+namespace internal {
+class WorkingMemory;
+}  // end namespace internal
+
+// Return the CRC-32C (Castagnoli) of "data[0,n-1]" appended to a string
+// whose CRC-32C is "crc"; pass 0 to start.  Uses the SSE4.2 instruction
+// where the CPU has it.
+uint32 Crc32c(uint32 crc, const char* data, size_t n);
+
+// Return the masked form of "crc" stored in framed chunks.  Masking keeps
+// the CRC of data that itself contains CRCs well distributed.
+inline uint32 MaskCrc32c(uint32 crc) {
+  return ((crc >> 15) | (crc << 17)) + 0xa282ead8u;
+}
+
+// A Sink that compresses everything appended to it and writes it to
+// another Sink in the framing format.  Input is buffered until a chunk of
+// kBlockSize bytes is complete, so Append() may be called with any amount
+// of data at a time.
+//
+// Example:
+//    FramingSink framed(&file_sink);
+//    while (...) framed.Append(data, n);
+//    framed.Flush();
+class FramingSink : public Sink {
+ public:
+  // Does not take ownership of "dest", which must outlive this object.
+  explicit FramingSink(Sink* dest);
+
+  // Flush()es any buffered input.
+  virtual ~FramingSink();
+
+  virtual void Append(const char* bytes, size_t n);
+
+  // Returns space in the internal input buffer when "length" bytes fit
+  // there, so that the following Append() does not copy.
+  virtual char* GetAppendBuffer(size_t length, char* scratch);
+
+  // Write buffered input to "dest" as a chunk, so that everything appended
+  // so far can be decompressed from what "dest" has received; e.g. at the
+  // end of a message.  Writes the stream identifier if nothing else has
+  // been written yet, so flushing an empty FramingSink yields a valid
+  // empty stream.
+  void Flush();
+
+  // Number of bytes written to "dest" so far.
+  size_t written() const { return written_; }
+
+ private:
+  void WriteStreamIdentifier();
+  void WriteChunk(const char* data, size_t n);
+
+  Sink* dest_;
+  char* input_;                      // kBlockSize bytes of pending input
+  size_t pending_;                   // Bytes used in input_
+  char* output_;                     // Scratch space for one chunk
+  internal::WorkingMemory* wmem_;    // Hash table for the compressor
+  size_t written_;
+  bool started_;                     // Stream identifier written?
+
+  DISALLOW_COPY_AND_ASSIGN(FramingSink);
+};
+
+// A Source that reads a stream in the framing format from another Source
+// and yields the uncompressed bytes, one chunk at a time.  Each chunk is
+// checked against its CRC-32C before it is returned.
+//
+// Unlike other Sources, Available() only counts the bytes of the chunk
+// that is currently decoded, as the total is not known until the whole
+// stream has been read.  It drops to 0 at the end of the stream or on the
+// first malformed or corrupt chunk; use ok() to tell the two apart.  For
+// the same reason a FramingSource is not suitable as input to Compress().
+class FramingSource : public Source {
+ public:
+  // Does not take ownership of "src", which must outlive this object.
+  explicit FramingSource(Source* src);
+  virtual ~FramingSource();
+
+  virtual size_t Available() const;
+  virtual const char* Peek(size_t* len);
+  virtual void Skip(size_t n);
+
+  // Returns false if the stream was malformed, truncated, or failed a
+  // checksum.
+  bool ok() const { return ok_; }
+
+ private:
+  // Decode chunks until one holds data, the stream ends, or an error is
+  // found.
+  void NextChunk();
+  // Point *data at the next "n" bytes of src_, copying them into scratch_
+  // if they are not contiguous.  They stay valid, and in src_, until the
+  // next Read().  Returns false on a short read.
+  bool Read(size_t n, const char** data);
+
+  Source* src_;
+  size_t peeked_;           // Bytes returned by Read() but not skipped
+  char* output_;            // kBlockSize bytes of decoded data
+  const char* avail_ptr_;   // Next byte to return; in output_ or, for
+                            // stored chunks, wherever Read() put them
+  size_t avail_;            // Bytes left at avail_ptr_
+  char* scratch_;           // Holds chunks that are split in src_
+  size_t scratch_size_;
+  bool started_;            // Stream identifier seen?
+  bool ok_;
+
+  DISALLOW_COPY_AND_ASSIGN(FramingSource);
+};
+
+// Compress the bytes read from "*source" and append them to "*sink" in
+// the framing format.  Return the number of bytes written.
+size_t CompressFramed(Source* source, Sink* sink);
+
+// Decompress the framed stream read from "*source" and append the data to
+// "*sink".  Returns false if the stream is malformed, truncated, or fails
+// a checksum; "*sink" then holds the data of the chunks before the bad
+// one.
+bool UncompressFramed(Source* source, Sink* sink);
+
+}  // end namespace snappy
+
+#endif  // UTIL_SNAPPY_SNAPPY_FRAMING_H__
@@ -109,6 +109,19 @@ namespace snappy {
                    char* compressed,
                    size_t* compressed_length);
 
+  // Takes the data stored in "input[0..input_length]" and stores it in
+  // the iovec "iov", filling the physical buffers in order.  The number
+  // of buffers in "iov" is given by iov_cnt.
+  //
+  // "*compressed_length" is set to the length of the compressed output.
+  // Returns false if it does not fit in the cumulative size of "iov"; the
+  // buffers then hold the start of the output and "*compressed_length" is
+  // the room that would have been needed.  Their cumulative size can be
+  // made "MaxCompressedLength(input_length)" to rule this out.
+  bool RawCompressToIOVec(const char* input, size_t input_length,
+                          const struct iovec* iov, size_t iov_cnt,
+                          size_t* compressed_length);
+
   // Given data in "compressed[0..compressed_length-1]" generated by
   // calling the Snappy::Compress routine, this routine
   // stores the uncompressed data to
@@ -164,6 +177,55 @@ namespace snappy {
   bool IsValidCompressedBuffer(const char* compressed,
                                size_t compressed_length);
 
+  // ------------------------------------------------------------------------
+  // Reusable compression context
+  // ------------------------------------------------------------------------
+
+  namespace internal {
+  class WorkingMemory;
+  }  // end namespace internal
+
+  // The routines above set up a hash table, and for inputs that arrive in
+  // pieces or go to a Sink without a suitable buffer, scratch space, on
+  // every call.  A Compressor keeps them between calls, so compressing
+  // many small buffers (e.g. database blocks) does no heap allocation:
+  // the hash table is set up by the constructor, and the scratch space by
+  // the first Compress(Source*, Sink*) or RawCompressToIOVec() call.  The
+  // output is identical to that of the routines above.
+  //
+  // A Compressor is not thread-safe; use one per thread.
+  //
+  // Example:
+  //    snappy::Compressor compressor;
+  //    for (...) {
+  //      compressor.RawCompress(block, block_length, output, &output_length);
+  //      ... Process(output, output_length) ...
+  //    }
+  class Compressor {
+   public:
+    Compressor();
+    ~Compressor();
+
+    // Same as the functions of the same name above.
+    size_t Compress(Source* source, Sink* sink);
+    size_t Compress(const char* input, size_t input_length, string* output);
+    void RawCompress(const char* input,
+                     size_t input_length,
+                     char* compressed,
+                     size_t* compressed_length);
+    bool RawCompressToIOVec(const char* input, size_t input_length,
+                            const struct iovec* iov, size_t iov_cnt,
+                            size_t* compressed_length);
+
+   private:
+    internal::WorkingMemory* wmem_;
+    char* scratch_;           // kBlockSize bytes for fragmented input
+    char* scratch_output_;    // Output space for Sinks that have none;
+                              // both allocated on first use
+
+    DISALLOW_COPY_AND_ASSIGN(Compressor);
+  };
+
   // The size of a compression block. Note that many parts of the compression
   // code assumes that kBlockSize <= 65536; in particular, the hash table
   // can only store 16-bit offsets, and EmitCopy() also assumes the offset
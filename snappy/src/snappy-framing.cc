@@ -0,0 +1,436 @@
+// For conditions of distribution and use, see the copyright notice in
+// snappy.h.
+
+#include "snappy-framing.h"
+#include "snappy.h"
+#include "snappy-internal.h"
+
+#include <string.h>
+
+#ifdef SNAPPY_X86_SIMD
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <nmmintrin.h>
+#endif
+#endif
+
+namespace snappy {
+
+// Chunk types.
+enum {
+  kCompressedData = 0x00,
+  kUncompressedData = 0x01,
+  kPadding = 0xfe,
+  kStreamIdentifier = 0xff
+};
+
+// Type, 24-bit little-endian length and "sNaPpY".
+static const char kStreamIdentifierChunk[] = "\xff\x06\x00\x00sNaPpY";
+static const size_t kStreamIdentifierSize = 10;
+
+// Type and 24-bit length, followed by the masked CRC-32C of the data in
+// compressed and uncompressed data chunks.
+static const size_t kChunkHeaderSize = 4;
+static const size_t kChunkCrcSize = 4;
+
+// -----------------------------------------------------------------------
+// CRC-32C
+// -----------------------------------------------------------------------
+
+namespace {
+
+// Tables for the portable CRC-32C, four bytes at a time.
+struct Crc32cTables {
+  uint32 t[4][256];
+
+  Crc32cTables() {
+    for (int i = 0; i < 256; i++) {
+      uint32 c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? (c >> 1) ^ 0x82f63b78u : c >> 1;
+      }
+      t[0][i] = c;
+    }
+    for (int i = 0; i < 256; i++) {
+      for (int k = 1; k < 4; k++) {
+        t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+      }
+    }
+  }
+};
+
+}  // namespace
+
+static uint32 Crc32cPortable(uint32 crc, const char* buf, size_t n) {
+  static const Crc32cTables tables;
+  const uint32 (*t)[256] = tables.t;
+  const uint8* p = reinterpret_cast<const uint8*>(buf);
+  uint32 l = crc ^ 0xffffffffu;
+
+  while (n >= 4) {
+    l ^= LittleEndian::Load32(p);
+    l = t[3][l & 0xff] ^ t[2][(l >> 8) & 0xff] ^
+        t[1][(l >> 16) & 0xff] ^ t[0][l >> 24];
+    p += 4;
+    n -= 4;
+  }
+  while (n > 0) {
+    l = t[0][(l ^ *p++) & 0xff] ^ (l >> 8);
+    n--;
+  }
+  return l ^ 0xffffffffu;
+}
+
+#ifdef SNAPPY_X86_SIMD
+
+SNAPPY_TARGET_SSE42
+static uint32 Crc32cSSE42(uint32 crc, const char* buf, size_t n) {
+  const uint8* p = reinterpret_cast<const uint8*>(buf);
+  uint32 l = crc ^ 0xffffffffu;
+
+#if defined(__x86_64__) || defined(_M_X64)
+  uint64 l64 = l;
+  while (n >= 8) {
+    l64 = _mm_crc32_u64(l64, UNALIGNED_LOAD64(p));
+    p += 8;
+    n -= 8;
+  }
+  l = static_cast<uint32>(l64);
+#endif
+  while (n >= 4) {
+    l = _mm_crc32_u32(l, UNALIGNED_LOAD32(p));
+    p += 4;
+    n -= 4;
+  }
+  while (n > 0) {
+    l = _mm_crc32_u8(l, *p++);
+    n--;
+  }
+  return l ^ 0xffffffffu;
+}
+
+#endif  // SNAPPY_X86_SIMD
+
+uint32 Crc32c(uint32 crc, const char* data, size_t n) {
+#ifdef SNAPPY_X86_SIMD
+  if (CpuHasSSE42()) {
+    return Crc32cSSE42(crc, data, n);
+  }
+#endif
+  return Crc32cPortable(crc, data, n);
+}
+
+// -----------------------------------------------------------------------
+// FramingSink
+// -----------------------------------------------------------------------
+
+FramingSink::FramingSink(Sink* dest)
+    : dest_(dest),
+      input_(new char[kBlockSize]),
+      pending_(0),
+      output_(new char[kChunkHeaderSize + kChunkCrcSize + Varint::kMax32 +
+                       MaxCompressedLength(kBlockSize)]),
+      wmem_(new internal::WorkingMemory),
+      written_(0),
+      started_(false) {
+}
+
+FramingSink::~FramingSink() {
+  Flush();
+  delete[] input_;
+  delete[] output_;
+  delete wmem_;
+}
+
+void FramingSink::Append(const char* bytes, size_t n) {
+  // Filled in through GetAppendBuffer()?
+  if (bytes == input_ + pending_) {
+    assert(n <= kBlockSize - pending_);
+    pending_ += n;
+    if (pending_ == kBlockSize) {
+      WriteChunk(input_, kBlockSize);
+      pending_ = 0;
+    }
+    return;
+  }
+
+  while (n > 0) {
+    if (pending_ == 0 && n >= kBlockSize) {
+      // A whole chunk; compress it in place.
+      WriteChunk(bytes, kBlockSize);
+      bytes += kBlockSize;
+      n -= kBlockSize;
+      continue;
+    }
+    const size_t to_copy = min(n, kBlockSize - pending_);
+    memcpy(input_ + pending_, bytes, to_copy);
+    pending_ += to_copy;
+    bytes += to_copy;
+    n -= to_copy;
+    if (pending_ == kBlockSize) {
+      WriteChunk(input_, kBlockSize);
+      pending_ = 0;
+    }
+  }
+}
+
+char* FramingSink::GetAppendBuffer(size_t length, char* scratch) {
+  if (length <= kBlockSize - pending_) {
+    return input_ + pending_;
+  }
+  return scratch;
+}
+
+void FramingSink::Flush() {
+  if (!started_) {
+    WriteStreamIdentifier();
+  }
+  if (pending_ > 0) {
+    WriteChunk(input_, pending_);
+    pending_ = 0;
+  }
+}
+
+void FramingSink::WriteStreamIdentifier() {
+  dest_->Append(kStreamIdentifierChunk, kStreamIdentifierSize);
+  written_ += kStreamIdentifierSize;
+  started_ = true;
+}
+
+void FramingSink::WriteChunk(const char* data, size_t n) {
+  assert(n > 0 && n <= kBlockSize);
+  if (!started_) {
+    WriteStreamIdentifier();
+  }
+
+  const size_t header_size = kChunkHeaderSize + kChunkCrcSize;
+  const size_t max_output =
+      header_size + Varint::kMax32 + MaxCompressedLength(n);
+  char* out = dest_->GetAppendBuffer(max_output, output_);
+
+  // The payload of a compressed chunk is a complete Snappy stream.
+  char* end = Varint::Encode32(out + header_size, n);
+  int table_size;
+  uint16* table = wmem_->GetHashTable(n, &table_size);
+  end = internal::CompressFragment(data, n, end, table, table_size);
+  size_t payload = end - (out + header_size);
+
+  // Store the data as-is unless compression saves at least 1/8th.
+  char type = kCompressedData;
+  if (payload >= n - n / 8) {
+    type = kUncompressedData;
+    payload = n;
+  }
+
+  const size_t length = kChunkCrcSize + payload;
+  out[0] = type;
+  out[1] = length & 0xff;
+  out[2] = (length >> 8) & 0xff;
+  out[3] = (length >> 16) & 0xff;
+  LittleEndian::Store32(out + kChunkHeaderSize, MaskCrc32c(Crc32c(0, data, n)));
+
+  if (type == kCompressedData) {
+    dest_->Append(out, header_size + payload);
+  } else {
+    dest_->Append(out, header_size);
+    dest_->Append(data, n);
+  }
+  written_ += header_size + payload;
+}
+
+// -----------------------------------------------------------------------
+// FramingSource
+// -----------------------------------------------------------------------
+
+FramingSource::FramingSource(Source* src)
+    : src_(src),
+      peeked_(0),
+      output_(new char[kBlockSize]),
+      avail_ptr_(NULL),
+      avail_(0),
+      scratch_(NULL),
+      scratch_size_(0),
+      started_(false),
+      ok_(true) {
+  NextChunk();
+}
+
+FramingSource::~FramingSource() {
+  // Leave src_ just past the last chunk read.
+  src_->Skip(peeked_);
+  delete[] output_;
+  delete[] scratch_;
+}
+
+size_t FramingSource::Available() const {
+  return avail_;
+}
+
+const char* FramingSource::Peek(size_t* len) {
+  *len = avail_;
+  return avail_ptr_;
+}
+
+void FramingSource::Skip(size_t n) {
+  assert(n <= avail_);
+  avail_ptr_ += n;
+  avail_ -= n;
+  if (avail_ == 0) {
+    NextChunk();
+  }
+}
+
+bool FramingSource::Read(size_t n, const char** data) {
+  src_->Skip(peeked_);
+  peeked_ = 0;
+  if (src_->Available() < n) {
+    return false;
+  }
+
+  size_t len;
+  const char* p = src_->Peek(&len);
+  if (len >= n) {
+    *data = p;
+    peeked_ = n;
+    return true;
+  }
+
+  // Stitch the bytes together from several fragments.
+  if (scratch_size_ < n) {
+    delete[] scratch_;
+    scratch_ = new char[n];
+    scratch_size_ = n;
+  }
+  size_t copied = 0;
+  while (copied < n) {
+    p = src_->Peek(&len);
+    const size_t to_copy = min(len, n - copied);
+    memcpy(scratch_ + copied, p, to_copy);
+    src_->Skip(to_copy);
+    copied += to_copy;
+  }
+  *data = scratch_;
+  return true;
+}
+
+void FramingSource::NextChunk() {
+  avail_ = 0;
+  while (ok_) {
+    src_->Skip(peeked_);
+    peeked_ = 0;
+    if (src_->Available() == 0) {
+      return;  // Clean end of stream.
+    }
+
+    const char* header;
+    if (!Read(kChunkHeaderSize, &header)) {
+      ok_ = false;
+      return;
+    }
+    const uint8 type = static_cast<uint8>(header[0]);
+    const size_t length = static_cast<uint8>(header[1]) |
+                          (static_cast<uint8>(header[2]) << 8) |
+                          (static_cast<uint8>(header[3]) << 16);
+
+    if (type == kStreamIdentifier) {
+      // Repeated at the start of each concatenated stream.
+      const char* id;
+      if (length != kStreamIdentifierSize - kChunkHeaderSize ||
+          !Read(length, &id) ||
+          memcmp(id, kStreamIdentifierChunk + kChunkHeaderSize, length) != 0) {
+        ok_ = false;
+        return;
+      }
+      started_ = true;
+      continue;
+    }
+    if (!started_) {
+      ok_ = false;
+      return;
+    }
+
+    if (type == kCompressedData || type == kUncompressedData) {
+      const char* chunk;
+      if (length < kChunkCrcSize || !Read(length, &chunk)) {
+        ok_ = false;
+        return;
+      }
+      const uint32 masked_crc = LittleEndian::Load32(chunk);
+      const char* data = chunk + kChunkCrcSize;
+      size_t n = length - kChunkCrcSize;
+
+      if (type == kCompressedData) {
+        size_t uncompressed_length;
+        if (!GetUncompressedLength(data, n, &uncompressed_length) ||
+            uncompressed_length > kBlockSize ||
+            !RawUncompress(data, n, output_)) {
+          ok_ = false;
+          return;
+        }
+        data = output_;
+        n = uncompressed_length;
+      } else if (n > kBlockSize) {
+        ok_ = false;
+        return;
+      }
+
+      if (MaskCrc32c(Crc32c(0, data, n)) != masked_crc) {
+        ok_ = false;
+        return;
+      }
+      if (n == 0) {
+        continue;
+      }
+      // Stored data is returned where Read() left it; it is skipped in
+      // src_ once the caller has consumed it.
+      avail_ptr_ = data;
+      avail_ = n;
+      return;
+    }
+
+    // Reserved unskippable chunks are 0x02-0x7f; padding and the reserved
+    // skippable chunks 0x80-0xfd carry nothing for us.
+    if (type < 0x80) {
+      ok_ = false;
+      return;
+    }
+    src_->Skip(peeked_);
+    peeked_ = 0;
+    if (src_->Available() < length) {
+      ok_ = false;
+      return;
+    }
+    src_->Skip(length);
+  }
+}
+
+// -----------------------------------------------------------------------
+// Whole-stream routines
+// -----------------------------------------------------------------------
+
+size_t CompressFramed(Source* source, Sink* sink) {
+  FramingSink framed(sink);
+  while (source->Available() > 0) {
+    size_t n;
+    const char* p = source->Peek(&n);
+    n = min(n, source->Available());
+    framed.Append(p, n);
+    source->Skip(n);
+  }
+  framed.Flush();
+  return framed.written();
+}
+
+bool UncompressFramed(Source* source, Sink* sink) {
+  FramingSource framed(source);
+  while (framed.Available() > 0) {
+    size_t n;
+    const char* p = framed.Peek(&n);
+    sink->Append(p, n);
+    framed.Skip(n);
+  }
+  return framed.ok();
+}
+
+}  // end namespace snappy
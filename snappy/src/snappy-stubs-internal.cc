@@ -31,8 +31,48 @@
 
 #include "snappy-stubs-internal.h"
 
+#ifdef SNAPPY_X86_SIMD
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 namespace snappy {
 
+#ifdef SNAPPY_X86_SIMD
+
+// ECX bits of CPUID leaf 1.
+static const int kCpuidSSSE3 = 1 << 9;
+static const int kCpuidSSE42 = 1 << 20;
+
+static int CpuidEcx() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return info[2];
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return 0;
+  }
+  return static_cast<int>(ecx);
+#endif
+}
+
+bool CpuHasSSSE3() {
+  static const int ecx = CpuidEcx();
+  return (ecx & kCpuidSSSE3) != 0;
+}
+
+bool CpuHasSSE42() {
+  static const int ecx = CpuidEcx();
+  return (ecx & kCpuidSSE42) != 0;
+}
+
+#endif  // SNAPPY_X86_SIMD
+
 void Varint::Append32(string* s, uint32 value) {
   char buf[Varint::kMax32];
   const char* p = Varint::Encode32(buf, value);
@@ -54,6 +54,22 @@
 
 #endif
 
+// x86 builds carry SSSE3 and SSE4.2 routines compiled with per-function
+// target attributes, so the rest of the library keeps the baseline
+// instruction set.  They are only called after CpuHasSSSE3() or
+// CpuHasSSE42() has returned true.
+#if defined(__x86_64__) || defined(__i386__) || \
+    defined(_M_X64) || defined(_M_IX86)
+#define SNAPPY_X86_SIMD 1
+#ifdef _MSC_VER
+#define SNAPPY_TARGET_SSSE3
+#define SNAPPY_TARGET_SSE42
+#else
+#define SNAPPY_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define SNAPPY_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
 // Needed by OS X, among others.
 #ifndef MAP_ANONYMOUS
 #define MAP_ANONYMOUS MAP_ANON
@@ -96,17 +112,12 @@ static const int64 kint64max = static_cast<int64>(0x7FFFFFFFFFFFFFFFLL);
 
 // Potentially unaligned loads and stores.
 
-// x86 and PowerPC can simply do these loads and stores native.
-
-#if defined(__i386__) || defined(__x86_64__) || defined(__powerpc__)
-
-#define UNALIGNED_LOAD16(_p) (*reinterpret_cast<const uint16 *>(_p))
-#define UNALIGNED_LOAD32(_p) (*reinterpret_cast<const uint32 *>(_p))
-#define UNALIGNED_LOAD64(_p) (*reinterpret_cast<const uint64 *>(_p))
-
-#define UNALIGNED_STORE16(_p, _val) (*reinterpret_cast<uint16 *>(_p) = (_val))
-#define UNALIGNED_STORE32(_p, _val) (*reinterpret_cast<uint32 *>(_p) = (_val))
-#define UNALIGNED_STORE64(_p, _val) (*reinterpret_cast<uint64 *>(_p) = (_val))
+// x86 and PowerPC do these loads and stores natively, but they still go
+// through the memcpy() versions at the bottom: dereferencing a misaligned
+// uint64* lets the compiler assume 8-byte alignment, and from that, that
+// two such pointers a few bytes apart never overlap, which breaks the
+// overlapping copies in the decompressor at -O3.  A fixed-size memcpy()
+// compiles to a single move.
 
 // ARMv7 and newer support native unaligned accesses, but only of 16-bit
 // and 32-bit values (not 64-bit); older versions either raise a fatal signal,
@@ -117,7 +128,7 @@ static const int64 kint64max = static_cast<int64>(0x7FFFFFFFFFFFFFFFLL);
 //
 // This is a mess, but there's not much we can do about it.
 
-#elif defined(__arm__) && \
+#if defined(__arm__) && \
       !defined(__ARM_ARCH_4__) && \
       !defined(__ARM_ARCH_4T__) && \
       !defined(__ARM_ARCH_5__) && \
@@ -153,8 +164,8 @@ inline void UNALIGNED_STORE64(void *p, uint64 v) {
 
 #else
 
-// These functions are provided for architectures that don't support
-// unaligned loads and stores.
+// These functions are provided for x86 and PowerPC (see above) and for
+// architectures that don't support unaligned loads and stores.
 
 inline uint16 UNALIGNED_LOAD16(const void *p) {
   uint16 t;
@@ -202,6 +213,20 @@ inline void UnalignedCopy64(const void *src, void *dst) {
   }
 }
 
+// Copy 16 bytes; a single unaligned vector move on most 64-bit targets.
+inline void UnalignedCopy128(const void *src, void *dst) {
+  char tmp[16];
+  memcpy(tmp, src, 16);
+  memcpy(dst, tmp, 16);
+}
+
+#ifdef SNAPPY_X86_SIMD
+// Return true if the running CPU supports the instruction set.  The
+// answer is computed once and cached.
+bool CpuHasSSSE3();
+bool CpuHasSSE42();
+#endif
+
 // The following guarantees declaration of the byte swap functions.
 #ifdef WORDS_BIGENDIAN
 
@@ -32,6 +32,14 @@
 
 #include <stdio.h>
 
+#ifdef SNAPPY_X86_SIMD
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <tmmintrin.h>
+#endif
+#endif
+
 #include <algorithm>
 #include <string>
 #include <vector>
@@ -84,33 +92,94 @@ enum {
 };
 static const int kMaximumTagLength = 5;  // COPY_4_BYTE_OFFSET plus the actual offset.
 
-// Copy "len" bytes from "src" to "op", one byte at a time.  Used for
-// handling COPY operations where the input and output regions may
+// Number of bytes that follow the tag byte "c": the offset of a copy, or
+// the length of a literal longer than 60 bytes.
+static inline uint32 TagExtraBytes(unsigned char c) {
+  if ((c & 0x3) == LITERAL) {
+    return c >= (60 << 2) ? (c >> 2) - 59 : 0;
+  }
+  return (1u << (c & 0x3)) >> 1;
+}
+
+// Copy "op_limit - op" bytes from "src" to "op", one byte at a time.  Used
+// for handling COPY operations where the input and output regions may
 // overlap.  For example, suppose:
-//    src    == "ab"
-//    op     == src + 2
-//    len    == 20
-// After IncrementalCopy(src, op, len), the result will have
+//    src       == "ab"
+//    op        == src + 2
+//    op_limit  == op + 20
+// After IncrementalCopySlow(src, op, op_limit), the result will have
 // eleven copies of "ab"
 //    ababababababababababab
 // Note that this does not match the semantics of either memcpy()
 // or memmove().
-static inline void IncrementalCopy(const char* src, char* op, ssize_t len) {
-  assert(len > 0);
-  do {
+static inline char* IncrementalCopySlow(const char* src, char* op,
+                                        char* const op_limit) {
+  while (op < op_limit) {
     *op++ = *src++;
-  } while (--len > 0);
+  }
+  return op_limit;
 }
 
-// Equivalent to IncrementalCopy except that it can write up to ten extra
-// bytes after the end of the copy, and that it is faster.
+#ifdef SNAPPY_X86_SIMD
+
+// pshufb masks that repeat the first n bytes of a register across all 16
+// bytes, for n in [1..15].
+static const char kPshufbFillPatterns[15][16] = {
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+  { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1 },
+  { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+  { 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3 },
+  { 0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0 },
+  { 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3 },
+  { 0, 1, 2, 3, 4, 5, 6, 0, 1, 2, 3, 4, 5, 6, 0, 1 },
+  { 0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7 },
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 0, 1, 2, 3, 4, 5, 6 },
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5 },
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 0, 1, 2, 3, 4 },
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0, 1, 2, 3 },
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 0, 1, 2 },
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 0, 1 },
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 0 },
+};
+
+// IncrementalCopy() for a pattern of 1 to 15 bytes.  The pattern is
+// repeated across a 16-byte register, which is then stored over and over,
+// each time advancing by the largest multiple of the pattern size that
+// fits in 16 bytes.
 //
-// The main part of this loop is a simple copy of eight bytes at a time until
-// we've copied (at least) the requested amount of bytes.  However, if op and
-// src are less than eight bytes apart (indicating a repeating pattern of
-// length < 8), we first need to expand the pattern in order to get the correct
-// results. For instance, if the buffer looks like this, with the eight-byte
-// <src> and <op> patterns marked as intervals:
+// REQUIRES: 1 <= pattern_size <= 15 and op + 16 <= buf_limit
+SNAPPY_TARGET_SSSE3
+static char* PatternCopySSSE3(char* op, size_t pattern_size,
+                              char* const op_limit, char* const buf_limit) {
+  // The load reaches into [op, op + 16 - pattern_size), which is inside
+  // the buffer but not yet written; the mask never selects those bytes.
+  const __m128i mask = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(kPshufbFillPatterns[pattern_size - 1]));
+  const __m128i pattern = _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(op - pattern_size)),
+      mask);
+  const size_t stride = pattern_size * (16 / pattern_size);
+  char* const op_end = min(op_limit, buf_limit - 15);
+  while (op < op_end) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(op), pattern);
+    op += stride;
+  }
+  return IncrementalCopySlow(op - pattern_size, op, op_limit);
+}
+
+#endif  // SNAPPY_X86_SIMD
+
+// Equivalent to IncrementalCopySlow except that it can write up to 15
+// extra bytes after op_limit, though never at or beyond buf_limit, and
+// that it is faster.
+//
+// If op and src are 16 or more bytes apart, this is a plain copy of 16
+// bytes at a time.  Closer than that, the bytes between them form a
+// repeating pattern.  With SSSE3 the pattern is expanded into a register
+// and stored 16 bytes at a time.  Otherwise, patterns shorter than 8 bytes
+// are first expanded in place with eight-byte copies. For instance, if the
+// buffer looks like this, with the eight-byte <src> and <op> patterns
+// marked as intervals:
 //
 //    abxxxxxxxxxxxx
 //    [------]           src
@@ -123,36 +192,55 @@ static inline void IncrementalCopy(const char* src, char* op, ssize_t len) {
 //    [------]           src
 //        [------]       op
 //
-// and repeat the exercise until the two no longer overlap.
-//
-// This allows us to do very well in the special case of one single byte
-// repeated many times, without taking a big hit for more general cases.
-//
-// The worst case of extra writing past the end of the match occurs when
-// op - src == 1 and len == 1; the last copy will read from byte positions
-// [0..7] and write to [4..11], whereas it was only supposed to write to
-// position 1. Thus, ten excess bytes.
-
-namespace {
-
-const int kMaxIncrementCopyOverflow = 10;
-
-inline void IncrementalCopyFastPath(const char* src, char* op, ssize_t len) {
-  while (op - src < 8) {
-    UnalignedCopy64(src, op);
-    len -= op - src;
-    op += op - src;
+// and repeat the exercise until the two are eight bytes apart, after
+// which eight-byte copies no longer overlap.
+static inline char* IncrementalCopy(const char* src, char* op,
+                                    char* const op_limit,
+                                    char* const buf_limit,
+                                    bool use_ssse3) {
+  assert(src < op);
+  assert(op <= op_limit);
+  assert(op_limit <= buf_limit);
+  size_t pattern_size = op - src;
+  if (pattern_size < 16) {
+#ifdef SNAPPY_X86_SIMD
+    if (use_ssse3 && PREDICT_TRUE(op <= buf_limit - 16)) {
+      return PatternCopySSSE3(op, pattern_size, op_limit, buf_limit);
+    }
+#endif
+    if (pattern_size < 8) {
+      if (PREDICT_FALSE(op > buf_limit - 16)) {
+        return IncrementalCopySlow(src, op, op_limit);
+      }
+      while (pattern_size < 8) {
+        UnalignedCopy64(src, op);
+        op += pattern_size;
+        pattern_size *= 2;
+      }
+      if (op >= op_limit) {
+        return op_limit;
+      }
+    }
   }
-  while (len > 0) {
-    UnalignedCopy64(src, op);
-    src += 8;
-    op += 8;
-    len -= 8;
+
+  if (pattern_size >= 16) {
+    char* const op_end = min(op_limit, buf_limit - 15);
+    while (op < op_end) {
+      UnalignedCopy128(src, op);
+      src += 16;
+      op += 16;
+    }
+  } else {
+    char* const op_end = min(op_limit, buf_limit - 7);
+    while (op < op_end) {
+      UnalignedCopy64(src, op);
+      src += 8;
+      op += 8;
+    }
   }
+  return IncrementalCopySlow(src, op, op_limit);
 }
 
-}  // namespace
-
 static inline char* EmitLiteral(char* op,
                                 const char* literal,
                                 int len,
@@ -493,163 +581,11 @@ char* CompressFragment(const char* input,
 //   bool TryFastAppend(const char* ip, size_t available, size_t length);
 // };
 
-// -----------------------------------------------------------------------
-// Lookup table for decompression code.  Generated by ComputeTable() below.
-// -----------------------------------------------------------------------
-
 // Mapping from i in range [0,4] to a mask to extract the bottom 8*i bits
 static const uint32 wordmask[] = {
   0u, 0xffu, 0xffffu, 0xffffffu, 0xffffffffu
 };
 
-// Data stored per entry in lookup table:
-//      Range   Bits-used       Description
-//      ------------------------------------
-//      1..64   0..7            Literal/copy length encoded in opcode byte
-//      0..7    8..10           Copy offset encoded in opcode byte / 256
-//      0..4    11..13          Extra bytes after opcode
-//
-// We use eight bits for the length even though 7 would have sufficed
-// because of efficiency reasons:
-//      (1) Extracting a byte is faster than a bit-field
-//      (2) It properly aligns copy offset so we do not need a <<8
-static const uint16 char_table[256] = {
-  0x0001, 0x0804, 0x1001, 0x2001, 0x0002, 0x0805, 0x1002, 0x2002,
-  0x0003, 0x0806, 0x1003, 0x2003, 0x0004, 0x0807, 0x1004, 0x2004,
-  0x0005, 0x0808, 0x1005, 0x2005, 0x0006, 0x0809, 0x1006, 0x2006,
-  0x0007, 0x080a, 0x1007, 0x2007, 0x0008, 0x080b, 0x1008, 0x2008,
-  0x0009, 0x0904, 0x1009, 0x2009, 0x000a, 0x0905, 0x100a, 0x200a,
-  0x000b, 0x0906, 0x100b, 0x200b, 0x000c, 0x0907, 0x100c, 0x200c,
-  0x000d, 0x0908, 0x100d, 0x200d, 0x000e, 0x0909, 0x100e, 0x200e,
-  0x000f, 0x090a, 0x100f, 0x200f, 0x0010, 0x090b, 0x1010, 0x2010,
-  0x0011, 0x0a04, 0x1011, 0x2011, 0x0012, 0x0a05, 0x1012, 0x2012,
-  0x0013, 0x0a06, 0x1013, 0x2013, 0x0014, 0x0a07, 0x1014, 0x2014,
-  0x0015, 0x0a08, 0x1015, 0x2015, 0x0016, 0x0a09, 0x1016, 0x2016,
-  0x0017, 0x0a0a, 0x1017, 0x2017, 0x0018, 0x0a0b, 0x1018, 0x2018,
-  0x0019, 0x0b04, 0x1019, 0x2019, 0x001a, 0x0b05, 0x101a, 0x201a,
-  0x001b, 0x0b06, 0x101b, 0x201b, 0x001c, 0x0b07, 0x101c, 0x201c,
-  0x001d, 0x0b08, 0x101d, 0x201d, 0x001e, 0x0b09, 0x101e, 0x201e,
-  0x001f, 0x0b0a, 0x101f, 0x201f, 0x0020, 0x0b0b, 0x1020, 0x2020,
-  0x0021, 0x0c04, 0x1021, 0x2021, 0x0022, 0x0c05, 0x1022, 0x2022,
-  0x0023, 0x0c06, 0x1023, 0x2023, 0x0024, 0x0c07, 0x1024, 0x2024,
-  0x0025, 0x0c08, 0x1025, 0x2025, 0x0026, 0x0c09, 0x1026, 0x2026,
-  0x0027, 0x0c0a, 0x1027, 0x2027, 0x0028, 0x0c0b, 0x1028, 0x2028,
-  0x0029, 0x0d04, 0x1029, 0x2029, 0x002a, 0x0d05, 0x102a, 0x202a,
-  0x002b, 0x0d06, 0x102b, 0x202b, 0x002c, 0x0d07, 0x102c, 0x202c,
-  0x002d, 0x0d08, 0x102d, 0x202d, 0x002e, 0x0d09, 0x102e, 0x202e,
-  0x002f, 0x0d0a, 0x102f, 0x202f, 0x0030, 0x0d0b, 0x1030, 0x2030,
-  0x0031, 0x0e04, 0x1031, 0x2031, 0x0032, 0x0e05, 0x1032, 0x2032,
-  0x0033, 0x0e06, 0x1033, 0x2033, 0x0034, 0x0e07, 0x1034, 0x2034,
-  0x0035, 0x0e08, 0x1035, 0x2035, 0x0036, 0x0e09, 0x1036, 0x2036,
-  0x0037, 0x0e0a, 0x1037, 0x2037, 0x0038, 0x0e0b, 0x1038, 0x2038,
-  0x0039, 0x0f04, 0x1039, 0x2039, 0x003a, 0x0f05, 0x103a, 0x203a,
-  0x003b, 0x0f06, 0x103b, 0x203b, 0x003c, 0x0f07, 0x103c, 0x203c,
-  0x0801, 0x0f08, 0x103d, 0x203d, 0x1001, 0x0f09, 0x103e, 0x203e,
-  0x1801, 0x0f0a, 0x103f, 0x203f, 0x2001, 0x0f0b, 0x1040, 0x2040
-};
-
-// In debug mode, allow optional computation of the table at startup.
-// Also, check that the decompression table is correct.
-#ifndef NDEBUG
-DEFINE_bool(snappy_dump_decompression_table, false,
-            "If true, we print the decompression table at startup.");
-
-static uint16 MakeEntry(unsigned int extra,
-                        unsigned int len,
-                        unsigned int copy_offset) {
-  // Check that all of the fields fit within the allocated space
-  assert(extra       == (extra & 0x7));          // At most 3 bits
-  assert(copy_offset == (copy_offset & 0x7));    // At most 3 bits
-  assert(len         == (len & 0x7f));           // At most 7 bits
-  return len | (copy_offset << 8) | (extra << 11);
-}
-
-static void ComputeTable() {
-  uint16 dst[256];
-
-  // Place invalid entries in all places to detect missing initialization
-  int assigned = 0;
-  for (int i = 0; i < 256; i++) {
-    dst[i] = 0xffff;
-  }
-
-  // Small LITERAL entries.  We store (len-1) in the top 6 bits.
-  for (unsigned int len = 1; len <= 60; len++) {
-    dst[LITERAL | ((len-1) << 2)] = MakeEntry(0, len, 0);
-    assigned++;
-  }
-
-  // Large LITERAL entries.  We use 60..63 in the high 6 bits to
-  // encode the number of bytes of length info that follow the opcode.
-  for (unsigned int extra_bytes = 1; extra_bytes <= 4; extra_bytes++) {
-    // We set the length field in the lookup table to 1 because extra
-    // bytes encode len-1.
-    dst[LITERAL | ((extra_bytes+59) << 2)] = MakeEntry(extra_bytes, 1, 0);
-    assigned++;
-  }
-
-  // COPY_1_BYTE_OFFSET.
-  //
-  // The tag byte in the compressed data stores len-4 in 3 bits, and
-  // offset/256 in 5 bits.  offset%256 is stored in the next byte.
-  //
-  // This format is used for length in range [4..11] and offset in
-  // range [0..2047]
-  for (unsigned int len = 4; len < 12; len++) {
-    for (unsigned int offset = 0; offset < 2048; offset += 256) {
-      dst[COPY_1_BYTE_OFFSET | ((len-4)<<2) | ((offset>>8)<<5)] =
-        MakeEntry(1, len, offset>>8);
-      assigned++;
-    }
-  }
-
-  // COPY_2_BYTE_OFFSET.
-  // Tag contains len-1 in top 6 bits, and offset in next two bytes.
-  for (unsigned int len = 1; len <= 64; len++) {
-    dst[COPY_2_BYTE_OFFSET | ((len-1)<<2)] = MakeEntry(2, len, 0);
-    assigned++;
-  }
-
-  // COPY_4_BYTE_OFFSET.
-  // Tag contents len-1 in top 6 bits, and offset in next four bytes.
-  for (unsigned int len = 1; len <= 64; len++) {
-    dst[COPY_4_BYTE_OFFSET | ((len-1)<<2)] = MakeEntry(4, len, 0);
-    assigned++;
-  }
-
-  // Check that each entry was initialized exactly once.
-  if (assigned != 256) {
-    fprintf(stderr, "ComputeTable: assigned only %d of 256\n", assigned);
-    abort();
-  }
-  for (int i = 0; i < 256; i++) {
-    if (dst[i] == 0xffff) {
-      fprintf(stderr, "ComputeTable: did not assign byte %d\n", i);
-      abort();
-    }
-  }
-
-  if (FLAGS_snappy_dump_decompression_table) {
-    printf("static const uint16 char_table[256] = {\n  ");
-    for (int i = 0; i < 256; i++) {
-      printf("0x%04x%s",
-             dst[i],
-             ((i == 255) ? "\n" : (((i%8) == 7) ? ",\n  " : ", ")));
-    }
-    printf("};\n");
-  }
-
-  // Check that computed table matched recorded table
-  for (int i = 0; i < 256; i++) {
-    if (dst[i] != char_table[i]) {
-      fprintf(stderr, "ComputeTable: byte %d: computed (%x), expect (%x)\n",
-              i, static_cast<int>(dst[i]), static_cast<int>(char_table[i]));
-      abort();
-    }
-  }
-}
-#endif /* !NDEBUG */
-
 // Helper class for decompression
 class SnappyDecompressor {
  private:
@@ -767,16 +703,29 @@ class SnappyDecompressor {
         ip += literal_length;
         MAYBE_REFILL();
       } else {
-        const uint32 entry = char_table[c];
-        const uint32 trailer = LittleEndian::Load32(ip) & wordmask[entry >> 11];
-        const uint32 length = entry & 0xff;
-        ip += entry >> 11;
-
-        // copy_offset/256 is encoded in bits 8..10.  By just fetching
-        // those bits, we get copy_offset (since the bit-field starts at
-        // bit 8).
-        const uint32 copy_offset = entry & 0x700;
-        if (!writer->AppendFromSelf(copy_offset + trailer, length)) {
+        // Decode the tag without a lookup table.  COPY_1_BYTE_OFFSET keeps
+        // length - 4 in bits 2..4 and offset / 256 in bits 5..7, followed
+        // by the low byte of the offset; COPY_2_BYTE_OFFSET keeps
+        // length - 1 in bits 2..7, followed by the 16-bit offset.  The two
+        // are mixed in unpredictable order, so they are decoded without a
+        // branch: "one" is 1 for COPY_1_BYTE_OFFSET and 0 otherwise.
+        // COPY_4_BYTE_OFFSET is never produced by our compressor.
+        const uint32 type = c & 0x3;
+        size_t length;
+        uint32 copy_offset;
+        if (PREDICT_TRUE(type != COPY_4_BYTE_OFFSET)) {
+          const uint32 one = COPY_2_BYTE_OFFSET - type;
+          const uint32 trailer =
+              LittleEndian::Load16(ip) & (0xffffu >> (8 * one));
+          ip += type;
+          length = ((c >> 2) & (0x3fu >> (3 * one))) + 1 + 3 * one;
+          copy_offset = trailer + ((c & 0xe0u) << 3) * one;
+        } else {
+          length = (c >> 2) + 1;
+          copy_offset = LittleEndian::Load32(ip);
+          ip += 4;
+        }
+        if (!writer->AppendFromSelf(copy_offset, length)) {
           return;
         }
         MAYBE_REFILL();
@@ -805,8 +754,7 @@ bool SnappyDecompressor::RefillTag() {
   // Read the tag character
   assert(ip < ip_limit_);
   const unsigned char c = *(reinterpret_cast<const unsigned char*>(ip));
-  const uint32 entry = char_table[c];
-  const uint32 needed = (entry >> 11) + 1;  // +1 byte for 'c'
+  const uint32 needed = TagExtraBytes(c) + 1;  // +1 byte for 'c'
   assert(needed <= sizeof(scratch_));
 
   // Read more bytes from reader if needed
@@ -871,7 +819,13 @@ bool GetUncompressedLength(Source* source, uint32* result) {
   return decompressor.ReadUncompressedLength(result);
 }
 
-size_t Compress(Source* reader, Sink* writer) {
+// Shared by Compress() and Compressor::Compress().  "scratch" and
+// "scratch_output" are either NULL, in which case they are allocated as
+// needed and freed on return, or kBlockSize and
+// MaxCompressedLength(kBlockSize) bytes provided by the caller.
+static size_t InternalCompress(Source* reader, Sink* writer,
+                               internal::WorkingMemory* wmem,
+                               char* scratch, char* scratch_output) {
   size_t written = 0;
   size_t N = reader->Available();
   char ulength[Varint::kMax32];
@@ -879,9 +833,8 @@ size_t Compress(Source* reader, Sink* writer) {
   writer->Append(ulength, p-ulength);
   written += (p - ulength);
 
-  internal::WorkingMemory wmem;
-  char* scratch = NULL;
-  char* scratch_output = NULL;
+  const bool owns_scratch = (scratch == NULL);
+  const bool owns_scratch_output = (scratch_output == NULL);
 
   while (N > 0) {
     // Get next block to compress (without copying if possible)
@@ -922,7 +875,7 @@ size_t Compress(Source* reader, Sink* writer) {
 
     // Get encoding table for compression
     int table_size;
-    uint16* table = wmem.GetHashTable(num_to_read, &table_size);
+    uint16* table = wmem->GetHashTable(num_to_read, &table_size);
 
     // Compress input_fragment and append to dest
     const int max_output = MaxCompressedLength(num_to_read);
@@ -946,12 +899,21 @@ size_t Compress(Source* reader, Sink* writer) {
     reader->Skip(pending_advance);
   }
 
-  delete[] scratch;
-  delete[] scratch_output;
+  if (owns_scratch) {
+    delete[] scratch;
+  }
+  if (owns_scratch_output) {
+    delete[] scratch_output;
+  }
 
   return written;
 }
 
+size_t Compress(Source* reader, Sink* writer) {
+  internal::WorkingMemory wmem;
+  return InternalCompress(reader, writer, &wmem, NULL, NULL);
+}
+
 // -----------------------------------------------------------------------
 // IOVec interfaces
 // -----------------------------------------------------------------------
@@ -976,6 +938,9 @@ class SnappyIOVecWriter {
   // Maximum number of bytes that will be decompressed into output_iov_.
   size_t output_limit_;
 
+  // Whether IncrementalCopy() may use SSSE3.
+  const bool use_ssse3_;
+
   inline char* GetIOVecPointer(int index, size_t offset) {
     return reinterpret_cast<char*>(output_iov_[index].iov_base) +
         offset;
@@ -990,7 +955,12 @@ class SnappyIOVecWriter {
         curr_iov_index_(0),
         curr_iov_written_(0),
         total_written_(0),
-        output_limit_(-1) {
+        output_limit_(-1),
+#ifdef SNAPPY_X86_SIMD
+        use_ssse3_(CpuHasSSSE3()) {
+#else
+        use_ssse3_(false) {
+#endif
   }
 
   inline void SetExpectedLength(size_t len) {
@@ -1037,8 +1007,7 @@ class SnappyIOVecWriter {
         output_iov_[curr_iov_index_].iov_len - curr_iov_written_ >= 16) {
       // Fast path, used for the majority (about 95%) of invocations.
       char* ptr = GetIOVecPointer(curr_iov_index_, curr_iov_written_);
-      UnalignedCopy64(ip, ptr);
-      UnalignedCopy64(ip + 8, ptr + 8);
+      UnalignedCopy128(ip, ptr);
       curr_iov_written_ += len;
       total_written_ += len;
       return true;
@@ -1102,9 +1071,12 @@ class SnappyIOVecWriter {
         if (to_copy > len) {
           to_copy = len;
         }
+        char* op = GetIOVecPointer(curr_iov_index_, curr_iov_written_);
         IncrementalCopy(GetIOVecPointer(from_iov_index, from_iov_offset),
-                        GetIOVecPointer(curr_iov_index_, curr_iov_written_),
-                        to_copy);
+                        op, op + to_copy,
+                        GetIOVecPointer(curr_iov_index_,
+                                        output_iov_[curr_iov_index_].iov_len),
+                        use_ssse3_);
         curr_iov_written_ += to_copy;
         from_iov_offset += to_copy;
         total_written_ += to_copy;
@@ -1141,11 +1113,17 @@ class SnappyArrayWriter {
   char* base_;
   char* op_;
   char* op_limit_;
+  const bool use_ssse3_;  // Whether IncrementalCopy() may use SSSE3.
 
  public:
   inline explicit SnappyArrayWriter(char* dst)
       : base_(dst),
-        op_(dst) {
+        op_(dst),
+#ifdef SNAPPY_X86_SIMD
+        use_ssse3_(CpuHasSSSE3()) {
+#else
+        use_ssse3_(false) {
+#endif
   }
 
   inline void SetExpectedLength(size_t len) {
@@ -1172,8 +1150,7 @@ class SnappyArrayWriter {
     const size_t space_left = op_limit_ - op;
     if (len <= 16 && available >= 16 + kMaximumTagLength && space_left >= 16) {
       // Fast path, used for the majority (about 95%) of invocations.
-      UnalignedCopy64(ip, op);
-      UnalignedCopy64(ip + 8, op + 8);
+      UnalignedCopy128(ip, op);
       op_ = op + len;
       return true;
     } else {
@@ -1197,19 +1174,17 @@ class SnappyArrayWriter {
     if (produced <= offset - 1u) {
       return false;
     }
-    if (len <= 16 && offset >= 8 && space_left >= 16) {
+    if (len <= 16 && offset >= 16 && space_left >= 16) {
       // Fast path, used for the majority (70-80%) of dynamic invocations.
+      UnalignedCopy128(op - offset, op);
+    } else if (len <= 16 && offset >= 8 && space_left >= 16) {
       UnalignedCopy64(op - offset, op);
       UnalignedCopy64(op - offset + 8, op + 8);
     } else {
-      if (space_left >= len + kMaxIncrementCopyOverflow) {
-        IncrementalCopyFastPath(op - offset, op, len);
-      } else {
-        if (space_left < len) {
-          return false;
-        }
-        IncrementalCopy(op - offset, op, len);
+      if (space_left < len) {
+        return false;
       }
+      IncrementalCopy(op - offset, op, op + len, op_limit_, use_ssse3_);
     }
 
     op_ = op + len;
@@ -1301,6 +1276,160 @@ size_t Compress(const char* input, size_t input_length, string* compressed) {
   return compressed_length;
 }
 
+// A Sink that writes to an iovec, for RawCompressToIOVec().  Bytes that do
+// not fit are counted but dropped.
+class SnappyIOVecSink : public Sink {
+ public:
+  SnappyIOVecSink(const struct iovec* iov, size_t iov_count)
+      : output_iov_(iov),
+        output_iov_count_(iov_count),
+        curr_iov_index_(0),
+        curr_iov_written_(0),
+        total_written_(0),
+        overflow_(false) {
+  }
+
+  virtual void Append(const char* bytes, size_t n) {
+    total_written_ += n;
+    SkipFullIOVecs();
+
+    // Already in place if "bytes" came from GetAppendBuffer().
+    if (curr_iov_index_ < output_iov_count_ && bytes == CurrentPointer() &&
+        n <= CurrentSpace()) {
+      curr_iov_written_ += n;
+      return;
+    }
+
+    while (n > 0) {
+      SkipFullIOVecs();
+      if (curr_iov_index_ == output_iov_count_) {
+        overflow_ = true;
+        return;
+      }
+      const size_t to_write = min(n, CurrentSpace());
+      memcpy(CurrentPointer(), bytes, to_write);
+      curr_iov_written_ += to_write;
+      bytes += to_write;
+      n -= to_write;
+    }
+  }
+
+  virtual char* GetAppendBuffer(size_t length, char* scratch) {
+    SkipFullIOVecs();
+    if (curr_iov_index_ < output_iov_count_ && length <= CurrentSpace()) {
+      return CurrentPointer();
+    }
+    return scratch;
+  }
+
+  size_t total_written() const { return total_written_; }
+  bool overflow() const { return overflow_; }
+
+ private:
+  char* CurrentPointer() const {
+    return reinterpret_cast<char*>(output_iov_[curr_iov_index_].iov_base) +
+        curr_iov_written_;
+  }
+
+  size_t CurrentSpace() const {
+    return output_iov_[curr_iov_index_].iov_len - curr_iov_written_;
+  }
+
+  void SkipFullIOVecs() {
+    while (curr_iov_index_ < output_iov_count_ && CurrentSpace() == 0) {
+      curr_iov_index_++;
+      curr_iov_written_ = 0;
+    }
+  }
+
+  const struct iovec* output_iov_;
+  const size_t output_iov_count_;
+  size_t curr_iov_index_;
+  size_t curr_iov_written_;
+  size_t total_written_;
+  bool overflow_;
+};
+
+bool RawCompressToIOVec(const char* input, size_t input_length,
+                        const struct iovec* iov, size_t iov_cnt,
+                        size_t* compressed_length) {
+  ByteArraySource reader(input, input_length);
+  SnappyIOVecSink writer(iov, iov_cnt);
+  Compress(&reader, &writer);
+
+  *compressed_length = writer.total_written();
+  return !writer.overflow();
+}
+
+// -----------------------------------------------------------------------
+// Compressor
+// -----------------------------------------------------------------------
+
+Compressor::Compressor()
+    : wmem_(new internal::WorkingMemory),
+      scratch_(NULL),
+      scratch_output_(NULL) {
+  // Set up the large hash table now rather than on the first input that
+  // needs it.
+  int table_size;
+  wmem_->GetHashTable(kBlockSize, &table_size);
+}
+
+Compressor::~Compressor() {
+  delete wmem_;
+  delete[] scratch_;
+  delete[] scratch_output_;
+}
+
+size_t Compressor::Compress(Source* reader, Sink* writer) {
+  if (scratch_ == NULL) {
+    scratch_ = new char[kBlockSize];
+    scratch_output_ = new char[MaxCompressedLength(kBlockSize)];
+  }
+  return InternalCompress(reader, writer, wmem_, scratch_, scratch_output_);
+}
+
+size_t Compressor::Compress(const char* input, size_t input_length,
+                            string* compressed) {
+  compressed->resize(MaxCompressedLength(input_length));
+
+  size_t compressed_length;
+  RawCompress(input, input_length, string_as_array(compressed),
+              &compressed_length);
+  compressed->resize(compressed_length);
+  return compressed_length;
+}
+
+void Compressor::RawCompress(const char* input,
+                             size_t input_length,
+                             char* compressed,
+                             size_t* compressed_length) {
+  // The input is contiguous and "compressed" has room for the worst case,
+  // so the fragments are compressed in place, without scratch space.
+  char* op = Varint::Encode32(compressed, input_length);
+  while (input_length > 0) {
+    const size_t num_to_read = min(input_length, kBlockSize);
+    int table_size;
+    uint16* table = wmem_->GetHashTable(num_to_read, &table_size);
+    op = internal::CompressFragment(input, num_to_read, op, table, table_size);
+    input += num_to_read;
+    input_length -= num_to_read;
+  }
+
+  *compressed_length = (op - compressed);
+}
+
+bool Compressor::RawCompressToIOVec(const char* input, size_t input_length,
+                                    const struct iovec* iov, size_t iov_cnt,
+                                    size_t* compressed_length) {
+  ByteArraySource reader(input, input_length);
+  SnappyIOVecSink writer(iov, iov_cnt);
+  Compress(&reader, &writer);
+
+  *compressed_length = writer.total_written();
+  return !writer.overflow();
+}
+
 
 } // end namespace snappy
 
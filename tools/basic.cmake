@@ -3,7 +3,9 @@ include(../tools/os.cmake)
 
 project(${name})
 
-file(GLOB_RECURSE src_list "*.c*")
+if(NOT src_list)
+	file(GLOB_RECURSE src_list "*.c*")
+endif()
 add_library(${name} ${src_list})
 
 SET(LIBRARY_OUTPUT_PATH ${PROJECT_SOURCE_DIR}/../../bin/${OS}_${BUILD_TYPE}/vender)
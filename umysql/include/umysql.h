@@ -83,6 +83,14 @@ typedef struct
   UINT16 charset;
 } UMTypeInfo;
 
+typedef struct
+{
+  UINT8 type;        // MYSQL_FIELDTYPE, MFTYPE_NULL for a NULL parameter
+  UINT8 isUnsigned;
+  const void *value; // TINY/SHORT/LONG/LONGLONG/FLOAT/DOUBLE in host order,
+  size_t cbValue;    // anything else as the bytes of its text form
+} UMParam;
+
 typedef struct __UMConnectionCAPI
 {
   void *(*getSocket)();
@@ -102,6 +110,17 @@ typedef struct __UMConnectionCAPI
   void (*destroyResult)(void *result);
   void *(*resultOK)(UINT64 affected, UINT64 insertId, int serverStatus, const char *message, size_t len);
 
+  // Rows of a prepared statement arrive in the binary protocol. Numeric
+  // columns are passed here as the raw little-endian value, cbValue being
+  // its width. Other columns, and all columns when this is NULL, are passed
+  // to resultRowValue in the same text form COM_QUERY would return.
+  //
+  // Appended after the original members, which keep their offsets. The
+  // struct still grew: UMConnection_Create copies all of it, so callers
+  // must be rebuilt against this header and set this member, NULL if
+  // unused.
+  int (*resultRowBinaryValue)(void *result, int icolumn, UMTypeInfo *ti, void *value, size_t cbValue);
+
 
 } UMConnectionCAPI;
 
@@ -129,4 +148,34 @@ int UMConnection_IsConnected (UMConnection conn);
 int UMConnection_Close (UMConnection conn);
 int UMConnection_SetTimeout(UMConnection conn, int timeout);
 
+// Prepare _query (or take it from the per-connection statement cache,
+// keyed by the SQL text) and execute it with _params bound to its '?'s.
+void *UMConnection_Execute(UMConnection conn, const char *_query, size_t _cbQuery, UMParam *_params, int _cParams);
+int UMConnection_SetStatementCacheSize(UMConnection conn, int num);
+
+// Send _count queries back-to-back and read their results in order into
+// _results. A query that fails leaves NULL in its slot, GetLastError
+// reports the last such failure. Returns 0 if the connection was lost,
+// any results already stored are still owned by the caller.
+int UMConnection_QueryPipeline(UMConnection conn, int _count, const char **_queries, const size_t *_cbQueries, void **_results);
+
+// Run _query and return its result with the field list filled in but no
+// rows. FetchRows then feeds up to _maxRows rows at a time to the row
+// callbacks, straight out of the receive buffer, and returns how many it
+// fed, 0 once the result set is done or -1 on failure. Rows are only read
+// from the socket as they are fetched, so memory stays bounded and a slow
+// consumer holds the server back. EndStream drops the rows not fetched.
+// No other query can run on the connection while a result set streams.
+void *UMConnection_QueryStream(UMConnection conn, const char *_query, size_t _cbQuery);
+int UMConnection_FetchRows(UMConnection conn, int _maxRows);
+int UMConnection_EndStream(UMConnection conn);
+
+// Ask for the compressed protocol on the next Connect, if the server
+// supports it. Packets shorter than _minSize bytes still go out as is
+// (MYSQL_COMPRESS_THRESHOLD is a good default), -1 turns it off again.
+// Returns the previous setting. GetTraffic reports the bytes received and
+// sent on the socket since Connect, so after compression.
+int UMConnection_SetCompression(UMConnection conn, int _minSize);
+void UMConnection_GetTraffic(UMConnection conn, UINT64 *_bytesRecv, UINT64 *_bytesSent);
+
 #endif
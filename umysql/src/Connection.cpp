@@ -74,6 +74,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 Connection::Connection (UMConnectionCAPI *_capi) 
   :	m_reader(MYSQL_RX_BUFFER_SIZE)
   , m_writer(MYSQL_TX_BUFFER_SIZE)
+  , m_zreader(0)
+  , m_zwriter(0)
 {
   PRINTMARK();
 
@@ -84,6 +86,12 @@ Connection::Connection (UMConnectionCAPI *_capi)
   memcpy (&m_capi, _capi, sizeof (UMConnectionCAPI));
   m_dbgMethodProgress = 0;
   m_errorType = UME_OTHER;
+  m_stmtCacheSize = MYSQL_STMT_CACHE_SIZE;
+  m_streamResult = NULL;
+  m_compressThreshold = -1;
+  m_compress = false;
+  m_bytesRecv = 0;
+  m_bytesSent = 0;
 }
 
 Connection::~Connection()
@@ -132,14 +140,14 @@ void Connection::scramble(const char *_scramble1, const char *_scramble2, UINT8
 }
 
 
-bool Connection::readSocket()
+bool Connection::fillBuffer(PacketReader &_reader)
 {
-  size_t bytesToRecv = m_reader.getEndPtr() - m_reader.getWritePtr();
+  size_t bytesToRecv = _reader.getEndPtr() - _reader.getWritePtr();
 
   if (bytesToRecv < 4096)
   {
-    m_reader.shrink();
-    bytesToRecv = m_reader.getEndPtr() - m_reader.getWritePtr();
+    _reader.shrink();
+    bytesToRecv = _reader.getEndPtr() - _reader.getWritePtr();
   }
 
   if (bytesToRecv == 0)
@@ -155,7 +163,7 @@ bool Connection::readSocket()
     }
 
 
-    int recvResult = m_capi.recvSocket(m_sockInst, m_reader.getWritePtr(), bytesToRecv);
+    int recvResult = m_capi.recvSocket(m_sockInst, _reader.getWritePtr(), bytesToRecv);
 
     if (recvResult == -1)
     {
@@ -168,19 +176,55 @@ bool Connection::readSocket()
         return false;
       }
 
-      m_reader.push (recvResult);
+      _reader.push (recvResult);
+      m_bytesRecv += recvResult;
+
+      return true;
+}
+
+bool Connection::readSocket()
+{
+  if (!m_compress)
+  {
+    return fillBuffer(m_reader);
+  }
+
+  while (true)
+  {
+    int result = m_reader.inflateFrom(m_zreader);
 
+    if (result > 0)
+    {
       return true;
+    }
+
+    if (result == -1)
+    {
+      setError("Malformed compressed packet", 0, UME_OTHER);
+      return false;
+    }
+
+    if (result == -2)
+    {
+      setError("Socket receive buffer full", 0, UME_OTHER);
+      return false;
+    }
+
+    if (!fillBuffer(m_zreader))
+    {
+      return false;
+    }
+  }
 }
 
-bool Connection::writeSocket()
+bool Connection::writeSocket(PacketWriter &_writer)
 {
-  size_t bytesToSend = m_writer.getWriteCursor() - m_writer.getReadCursor();
+  size_t bytesToSend = _writer.getWriteCursor() - _writer.getReadCursor();
 
   assert (bytesToSend > 0);
-  assert ((int)bytesToSend < m_writer.getEnd() - m_writer.getStart());
+  assert ((int)bytesToSend < _writer.getEnd() - _writer.getStart());
 
-  int sendResult = m_capi.sendSocket(m_sockInst, m_writer.getReadCursor(), bytesToSend);
+  int sendResult = m_capi.sendSocket(m_sockInst, _writer.getReadCursor(), bytesToSend);
 
   if (sendResult == -1)
   {
@@ -193,7 +237,8 @@ bool Connection::writeSocket()
       return false;
     }
 
-    m_writer.pull(sendResult);
+    _writer.pull(sendResult);
+    m_bytesSent += sendResult;
     return true;
 }
 
@@ -223,6 +268,9 @@ bool Connection::close(void)
       m_capi.clearException();
       m_capi.deleteSocket(m_sockInst);
       m_sockInst = NULL;
+      m_streamResult = NULL;
+      m_compress = false;
+      clearStatements();
       return true;
     }
   }
@@ -289,7 +337,11 @@ bool Connection::processHandshake()
 
     m_clientCaps = serverCaps;
 
-    m_clientCaps  &= ~MCP_COMPRESS;
+    if (m_compressThreshold < 0 || !(serverCaps & MCP_COMPRESS))
+    {
+      m_clientCaps  &= ~MCP_COMPRESS;
+    }
+
     m_clientCaps  &= ~MCP_NO_SCHEMA;
     m_clientCaps &= ~MCP_SSL;
 
@@ -378,14 +430,22 @@ bool Connection::isConnected(void)
 
 bool Connection::sendPacket()
 {
+  PacketWriter *writer = &m_writer;
+
+  if (m_compress)
+  {
+    m_zwriter.deflateFrom(m_writer, (size_t) m_compressThreshold);
+    writer = &m_zwriter;
+  }
+
   while (true)
   {
-    if (!writeSocket())
+    if (!writeSocket(*writer))
     {
       return false;
     }
 
-    if (m_writer.isDone())
+    if (writer->isDone())
     {
       break;
     }
@@ -464,6 +524,13 @@ bool Connection::connect(const char *_host, int _port, const char *_username, co
   m_autoCommit = _autoCommit ? (*_autoCommit) != 0 : false;
   m_charset = _charset;
 
+  // Statement ids belong to the previous session
+  clearStatements();
+  m_streamResult = NULL;
+  m_compress = false;
+  m_bytesRecv = 0;
+  m_bytesSent = 0;
+
   PRINTMARK();
   m_sockInst = m_capi.getSocket();
 
@@ -535,6 +602,19 @@ bool Connection::connect(const char *_host, int _port, const char *_username, co
 
   m_reader.skip();
 
+  // Both sides switch to compressed framing once authentication is done
+  if (m_clientCaps & MCP_COMPRESS)
+  {
+    m_zreader.reset();
+
+    if (m_zreader.getSize() < m_reader.getSize() + MYSQL_COMPRESS_HEADER_SIZE)
+    {
+      m_zreader.setSize(m_reader.getSize() + MYSQL_COMPRESS_HEADER_SIZE);
+    }
+
+    m_compress = true;
+  }
+
   PRINTMARK();
   if (_autoCommit)
   {
@@ -599,28 +679,16 @@ void Connection::handleErrorPacket()
   setError (errorMessage.c_str (), (int) errnum, UME_MYSQL);
 }
 
-void *Connection::handleResultPacket(int _fieldCount)
+bool Connection::readFields(void *resultSet, int _fieldCount, UMTypeInfo *typeInfo)
 {
-  m_reader.rewind(1);
-  UINT64 fieldCount = m_reader.readLengthCodedInteger();
-  m_reader.skip();
-
   int iField = 0;
 
-  void *resultSet = m_capi.createResult(_fieldCount);
-
-  // Read Field packets
-
-  UMTypeInfo *typeInfo = (UMTypeInfo *) alloca((size_t)(fieldCount * sizeof(UMTypeInfo)));
-  int iTypeInfo = 0;
-
   while (true)
   {
 
     if (!this->recvPacket())
     {
-      m_capi.destroyResult(resultSet);
-      return NULL;
+      return false;
     }
 
     size_t cb_catalog;
@@ -657,65 +725,147 @@ void *Connection::handleResultPacket(int _fieldCount)
 
     //UINT8 *def = m_reader.readLengthCodedBinary(&cb_default);
 
-    typeInfo[iTypeInfo].type = type;
-    typeInfo[iTypeInfo].flags = flags;
-    typeInfo[iTypeInfo].charset = charset;
-    iTypeInfo ++;
+    if (iField >= _fieldCount)
+    {
+      setError ("Too many fields in result set", 0, UME_OTHER);
+      return false;
+    }
+
+    typeInfo[iField].type = type;
+    typeInfo[iField].flags = flags;
+    typeInfo[iField].charset = charset;
 
-    m_capi.resultSetField(resultSet, iField, &typeInfo[iTypeInfo - 1], name, cb_name);
+    m_capi.resultSetField(resultSet, iField, &typeInfo[iField], name, cb_name);
     iField ++;
     m_reader.skip();
 
   }
 
-  // Read row data
+  return true;
+}
 
-  int cRows = 0;
+int Connection::readRow(void *resultSet, int _fieldCount, UMTypeInfo *typeInfo, bool _binary)
+{
+  if (!this->recvPacket())
+  {
+    return -1;
+  }
 
-  while (true)
+  UINT8 result = m_reader.readByte();
+
+  if (result == 0xfe && m_reader.getBytesLeft() < 8)
   {
+    m_reader.skip();
+    return 0;
+  }
 
-    if (!this->recvPacket())
+  if (_binary)
+  {
+    if (!handleBinaryRow(resultSet, _fieldCount, typeInfo))
     {
-      m_capi.destroyResult(resultSet);
-      return NULL;
+      m_reader.skip();
+      return -1;
     }
 
-    UINT8 result = m_reader.readByte();
+    m_reader.skip();
+    return 1;
+  }
 
-    if (result == 0xfe)
+  m_reader.rewind(1);
+
+  size_t cb_column;
+
+  m_capi.resultRowBegin(resultSet);
+
+  for (int index = 0; index < _fieldCount; index ++)
+  {
+    UINT8 *columnValue = m_reader.readLengthCodedBinary(&cb_column);
+    if (!m_capi.resultRowValue (resultSet, index, &typeInfo[index], columnValue, cb_column))
     {
       m_reader.skip();
-      break;
+      return -1;
     }
+  }
 
-    m_reader.rewind(1);
+  m_capi.resultRowEnd(resultSet);
+  m_reader.skip();
+
+  return 1;
+}
+
+void *Connection::handleResultPacket(int _fieldCount, bool _binary)
+{
+  m_reader.rewind(1);
+  UINT64 fieldCount = m_reader.readLengthCodedInteger();
+  m_reader.skip();
+
+  // The first byte only holds counts below 251
+  _fieldCount = (int) fieldCount;
+
+  void *resultSet = m_capi.createResult(_fieldCount);
+
+  // Read Field packets
+
+  UMTypeInfo *typeInfo = (UMTypeInfo *) alloca((size_t)(fieldCount * sizeof(UMTypeInfo)));
 
-    size_t cb_column;
+  if (!readFields(resultSet, _fieldCount, typeInfo))
+  {
+    m_capi.destroyResult(resultSet);
+    return NULL;
+  }
+
+  // Read row data
 
+  int cRows = 0;
 
-    m_capi.resultRowBegin(resultSet);
+  while (true)
+  {
+    int ret = readRow(resultSet, _fieldCount, typeInfo, _binary);
 
-    for (int index = 0; index < _fieldCount; index ++)
+    if (ret < 0)
     {
-      UINT8 *columnValue = m_reader.readLengthCodedBinary(&cb_column);
-      if (!m_capi.resultRowValue (resultSet, index, &typeInfo[index], columnValue, cb_column))
+      m_capi.destroyResult(resultSet);
+
+      // A row callback failed and the connection is still up: read the
+      // rest of the result set so the next response, e.g. the following
+      // query of a pipeline, is not taken for one of its rows.
+      if (m_sockInst != NULL && skipRows())
       {
-        m_capi.destroyResult(resultSet);
-        return NULL;
+        setUsageError ("Result row callback failed");
       }
+      return NULL;
     }
 
-    m_capi.resultRowEnd(resultSet);
-    cRows ++;
-    m_reader.skip();
-
+    if (ret == 0)
+    {
+      break;
+    }
 
+    cRows ++;
   }
 
   return resultSet;
 }
 
+bool Connection::skipRows()
+{
+  while (true)
+  {
+    if (!recvPacket())
+    {
+      return false;
+    }
+
+    UINT8 result = m_reader.readByte();
+    bool eof = (result == 0xfe && m_reader.getBytesLeft() < 8);
+    m_reader.skip();
+
+    if (eof)
+    {
+      return true;
+    }
+  }
+}
 
 void *Connection::query(const char *_query, size_t _cbQuery)
 {
@@ -740,6 +890,13 @@ void *Connection::query(const char *_query, size_t _cbQuery)
     return NULL;
   }
 
+  if (m_streamResult != NULL)
+  {
+    setUsageError ("A result set is still streaming");
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
   size_t len = _cbQuery;
 
   if (len > m_writer.getSize () - (MYSQL_PACKET_HEADER_SIZE + 1))
@@ -762,10 +919,16 @@ void *Connection::query(const char *_query, size_t _cbQuery)
     return NULL;
   }
 
+  void *ret = readResult(false);
+  m_dbgMethodProgress --;
+  return ret;
+}
+
+void *Connection::readResult(bool _binary)
+{
   if (!recvPacket())
   {
     PRINTMARK();
-    m_dbgMethodProgress --;
     return NULL;
   }
 
@@ -775,33 +938,840 @@ void *Connection::query(const char *_query, size_t _cbQuery)
   {
   case 0x00:
     PRINTMARK();
-    m_dbgMethodProgress --;
     return handleOKPacket();
 
   case 0xff:
     PRINTMARK();
     handleErrorPacket();
-    m_dbgMethodProgress --;
     return NULL;
 
   case 0xfe:
     PRINTMARK();
     setError ("Unexpected EOF when decoding result", 0, UME_OTHER);
-    m_dbgMethodProgress --;
     return NULL;
 
-
   default:
     PRINTMARK();
-    m_dbgMethodProgress --;
-    return handleResultPacket((int)result);
+    return handleResultPacket((int)result, _binary);
   }
+}
 
-  PRINTMARK();
-  m_dbgMethodProgress --;
-  return NULL;
+static size_t binaryWidth(UINT8 type)
+{
+  switch (type)
+  {
+  case MFTYPE_TINY:
+    return 1;
+
+  case MFTYPE_SHORT:
+  case MFTYPE_YEAR:
+    return 2;
+
+  case MFTYPE_LONG:
+  case MFTYPE_INT24:
+  case MFTYPE_FLOAT:
+    return 4;
+
+  case MFTYPE_LONGLONG:
+  case MFTYPE_DOUBLE:
+    return 8;
+  }
+
+  return 0;
+}
+
+static bool isTemporal(UINT8 type)
+{
+  return type == MFTYPE_DATE || type == MFTYPE_NEWDATE || type == MFTYPE_TIME ||
+    type == MFTYPE_DATETIME || type == MFTYPE_TIMESTAMP;
+}
+
+// Format a binary protocol number the way COM_QUERY would have sent it
+static size_t formatNumber(char *_buf, size_t _cbBuf, UMTypeInfo *_ti, const UINT8 *_value)
+{
+  bool isUns = isUnsigned(_ti->flags) || _ti->type == MFTYPE_YEAR;
+
+  switch (_ti->type)
+  {
+  case MFTYPE_TINY:
+    if (isUns)
+      return snprintf (_buf, _cbBuf, "%u", (unsigned) _value[0]);
+    return snprintf (_buf, _cbBuf, "%d", (int) (INT8) _value[0]);
+
+  case MFTYPE_SHORT:
+  case MFTYPE_YEAR:
+    {
+      UINT16 v;
+      memcpy (&v, _value, sizeof(v));
+      if (isUns)
+        return snprintf (_buf, _cbBuf, "%u", (unsigned) v);
+      return snprintf (_buf, _cbBuf, "%d", (int) (INT16) v);
+    }
+
+  case MFTYPE_LONG:
+  case MFTYPE_INT24:
+    {
+      UINT32 v;
+      memcpy (&v, _value, sizeof(v));
+      if (isUns)
+        return snprintf (_buf, _cbBuf, "%u", (unsigned) v);
+      return snprintf (_buf, _cbBuf, "%d", (int) (INT32) v);
+    }
+
+  case MFTYPE_LONGLONG:
+    {
+      UINT64 v;
+      memcpy (&v, _value, sizeof(v));
+      if (isUns)
+        return snprintf (_buf, _cbBuf, "%llu", (unsigned long long) v);
+      return snprintf (_buf, _cbBuf, "%lld", (long long) (INT64) v);
+    }
+
+  case MFTYPE_FLOAT:
+    {
+      float v;
+      size_t len = 0;
+      memcpy (&v, _value, sizeof(v));
+      // Shortest form that reads back as the same value
+      for (int prec = 6; prec <= 9; prec ++)
+      {
+        len = snprintf (_buf, _cbBuf, "%.*g", prec, (double) v);
+        if (strtof (_buf, NULL) == v)
+          break;
+      }
+      return len;
+    }
+
+  case MFTYPE_DOUBLE:
+    {
+      double v;
+      size_t len = 0;
+      memcpy (&v, _value, sizeof(v));
+      for (int prec = 15; prec <= 17; prec ++)
+      {
+        len = snprintf (_buf, _cbBuf, "%.*g", prec, v);
+        if (strtod (_buf, NULL) == v)
+          break;
+      }
+      return len;
+    }
+  }
+
+  return 0;
+}
+
+static size_t formatTemporal(char *_buf, size_t _cbBuf, UINT8 _type, const UINT8 *_value, size_t _len)
+{
+  size_t len;
+  UINT32 usec = 0;
+
+  if (_type == MFTYPE_TIME)
+  {
+    UINT8 neg = 0;
+    UINT32 days = 0;
+    UINT8 hour = 0, minute = 0, second = 0;
+
+    if (_len >= 8)
+    {
+      neg = _value[0];
+      memcpy (&days, _value + 1, 4);
+      hour = _value[5];
+      minute = _value[6];
+      second = _value[7];
+    }
+    if (_len >= 12)
+    {
+      memcpy (&usec, _value + 8, 4);
+    }
+
+    len = snprintf (_buf, _cbBuf, "%s%02u:%02u:%02u", neg ? "-" : "", (unsigned) (days * 24 + hour), (unsigned) minute, (unsigned) second);
+  }
+  else
+  {
+    UINT16 year = 0;
+    UINT8 month = 0, day = 0;
+    UINT8 hour = 0, minute = 0, second = 0;
+
+    if (_len >= 4)
+    {
+      memcpy (&year, _value, 2);
+      month = _value[2];
+      day = _value[3];
+    }
+    if (_len >= 7)
+    {
+      hour = _value[4];
+      minute = _value[5];
+      second = _value[6];
+    }
+    if (_len >= 11)
+    {
+      memcpy (&usec, _value + 7, 4);
+    }
+
+    len = snprintf (_buf, _cbBuf, "%04u-%02u-%02u", (unsigned) year, (unsigned) month, (unsigned) day);
+    if (_type == MFTYPE_DATE || _type == MFTYPE_NEWDATE)
+    {
+      return len;
+    }
+
+    len += snprintf (_buf + len, _cbBuf - len, " %02u:%02u:%02u", (unsigned) hour, (unsigned) minute, (unsigned) second);
+  }
+
+  if (usec)
+  {
+    len += snprintf (_buf + len, _cbBuf - len, ".%06u", (unsigned) usec);
+  }
+
+  return len;
+}
+
+bool Connection::handleBinaryRow(void *resultSet, int _fieldCount, UMTypeInfo *typeInfo)
+{
+  // The NULL bitmap of a binary row starts at bit 2
+  UINT8 *nullBitmap = m_reader.readBytes((_fieldCount + 7 + 2) / 8);
+  char text[64];
+
+  m_capi.resultRowBegin(resultSet);
+
+  for (int index = 0; index < _fieldCount; index ++)
+  {
+    UMTypeInfo *ti = &typeInfo[index];
+    int bit = index + 2;
+    int ret;
+
+    if (nullBitmap[bit >> 3] & (1 << (bit & 7)))
+    {
+      ret = m_capi.resultRowValue (resultSet, index, ti, NULL, 0);
+    }
+    else
+    {
+      size_t cb_column = binaryWidth(ti->type);
+
+      if (cb_column)
+      {
+        UINT8 *columnValue = m_reader.readBytes(cb_column);
+
+        if (m_capi.resultRowBinaryValue)
+        {
+          ret = m_capi.resultRowBinaryValue (resultSet, index, ti, columnValue, cb_column);
+        }
+        else
+        {
+          cb_column = formatNumber(text, sizeof(text), ti, columnValue);
+          ret = m_capi.resultRowValue (resultSet, index, ti, text, cb_column);
+        }
+      }
+      else
+        if (isTemporal(ti->type))
+        {
+          size_t len = m_reader.readByte();
+          UINT8 *columnValue = m_reader.readBytes(len);
+
+          cb_column = formatTemporal(text, sizeof(text), ti->type, columnValue, len);
+          ret = m_capi.resultRowValue (resultSet, index, ti, text, cb_column);
+        }
+        else
+        {
+          UINT8 *columnValue = m_reader.readLengthCodedBinary(&cb_column);
+          ret = m_capi.resultRowValue (resultSet, index, ti, columnValue, cb_column);
+        }
+    }
+
+    if (!ret)
+    {
+      return false;
+    }
+  }
+
+  m_capi.resultRowEnd(resultSet);
+  return true;
+}
+
+void Connection::setUsageError (const char *_message)
+{
+  // Unlike setError, a bad call leaves the connection usable
+  m_errorMessage = _message;
+  m_errno = 0;
+  m_errorType = UME_OTHER;
+}
+
+void Connection::clearStatements()
+{
+  m_stmtList.clear();
+  m_stmtCache.clear();
 }
 
+int Connection::setStatementCacheSize(int num)
+{
+  int old = (int) m_stmtCacheSize;
+
+  m_stmtCacheSize = num < 1 ? 1 : num;
+  return old;
+}
+
+Connection::Statement *Connection::prepare(const char *_query, size_t _cbQuery)
+{
+  std::string query(_query, _cbQuery);
+  std::map<std::string, StatementList::iterator>::iterator it = m_stmtCache.find(query);
+
+  if (it != m_stmtCache.end())
+  {
+    m_stmtList.splice(m_stmtList.begin(), m_stmtList, it->second);
+    return &m_stmtList.front();
+  }
+
+  if (_cbQuery > m_writer.getSize () - (MYSQL_PACKET_HEADER_SIZE + 1))
+  {
+    PRINTMARK();
+    setError ("Query too big", 0, UME_OTHER);
+    return NULL;
+  }
+
+  m_writer.reset();
+  m_writer.writeByte(MC_STMT_PREPARE);
+  m_writer.writeBytes ( (void *) _query, _cbQuery);
+  m_writer.finalize(0);
+
+  if (!sendPacket())
+  {
+    PRINTMARK();
+    return NULL;
+  }
+
+  if (!recvPacket())
+  {
+    PRINTMARK();
+    return NULL;
+  }
+
+  UINT8 result = m_reader.readByte();
+
+  if (result == 0xff)
+  {
+    handleErrorPacket();
+    return NULL;
+  }
+
+  if (result != 0x00)
+  {
+    setError ("Unexpected packet when preparing statement", 0, UME_OTHER);
+    return NULL;
+  }
+
+  Statement stmt;
+  stmt.query = query;
+  stmt.id = m_reader.readLong();
+  int cColumns = m_reader.readShort();
+  stmt.cParams = m_reader.readShort();
+  m_reader.skip();
+
+  // Skip the parameter and column definitions. Execute sends its own
+  // parameter types and the result set carries the column definitions.
+  for (int block = 0; block < 2; block ++)
+  {
+    if ((block == 0 ? stmt.cParams : cColumns) == 0)
+    {
+      continue;
+    }
+
+    while (true)
+    {
+      if (!recvPacket())
+      {
+        return NULL;
+      }
+
+      UINT8 result = m_reader.readByte();
+      bool isEOF = (result == 0xfe && m_reader.getBytesLeft() < 8);
+      m_reader.skip();
+
+      if (isEOF)
+      {
+        break;
+      }
+    }
+  }
+
+  m_stmtList.push_front(stmt);
+  m_stmtCache[query] = m_stmtList.begin();
+
+  while (m_stmtList.size() > m_stmtCacheSize)
+  {
+    Statement &old = m_stmtList.back();
+
+    // COM_STMT_CLOSE has no response
+    m_writer.reset();
+    m_writer.writeByte(MC_STMT_CLOSE);
+    m_writer.writeLong(old.id);
+    m_writer.finalize(0);
+
+    if (!sendPacket())
+    {
+      return NULL;
+    }
+
+    m_stmtCache.erase(old.query);
+    m_stmtList.pop_back();
+  }
+
+  return &m_stmtList.front();
+}
+
+void *Connection::execute(const char *_query, size_t _cbQuery, UMParam *_params, int _cParams)
+{
+  m_dbgMethodProgress ++;
+
+  if (m_dbgMethodProgress > 1)
+  {
+    /*
+    NOTE: We don't call setError here because it will close the socket worsening the concurrent access error making it impossible to trace */
+    m_errorMessage = "Concurrent access in execute method";
+    m_errno = 0;
+    m_errorType = UME_OTHER;
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  if (m_sockInst == NULL)
+  {
+    PRINTMARK();
+    setError ("Not connected", 0, UME_OTHER);
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  if (m_streamResult != NULL)
+  {
+    setUsageError ("A result set is still streaming");
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  Statement *stmt = prepare(_query, _cbQuery);
+
+  if (stmt == NULL)
+  {
+    PRINTMARK();
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  if (_cParams != stmt->cParams)
+  {
+    setUsageError ("Wrong number of parameters for statement");
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  // The writer does not grow, so size the request first
+  size_t cbPacket = 1 + 4 + 1 + 4;
+
+  if (_cParams > 0)
+  {
+    cbPacket += (_cParams + 7) / 8 + 1 + _cParams * 2;
+  }
+
+  for (int index = 0; index < _cParams; index ++)
+  {
+    UMParam *param = &_params[index];
+    size_t width = binaryWidth(param->type);
+
+    if (param->type == MFTYPE_NULL)
+    {
+      continue;
+    }
+
+    if (width && param->cbValue != width)
+    {
+      setUsageError ("Parameter size does not match its type");
+      m_dbgMethodProgress --;
+      return NULL;
+    }
+
+    cbPacket += width ? width : 9 + param->cbValue;
+  }
+
+  if (cbPacket > m_writer.getSize () - MYSQL_PACKET_HEADER_SIZE)
+  {
+    PRINTMARK();
+    setError ("Query too big", 0, UME_OTHER);
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  m_writer.reset();
+  m_writer.writeByte(MC_STMT_EXECUTE);
+  m_writer.writeLong(stmt->id);
+  m_writer.writeByte(0x00);   // CURSOR_TYPE_NO_CURSOR
+  m_writer.writeLong(1);      // Iteration count
+
+  if (_cParams > 0)
+  {
+    for (int index = 0; index < _cParams; index += 8)
+    {
+      UINT8 nullBits = 0;
+
+      for (int bit = 0; bit < 8 && index + bit < _cParams; bit ++)
+      {
+        if (_params[index + bit].type == MFTYPE_NULL)
+        {
+          nullBits |= (1 << bit);
+        }
+      }
+
+      m_writer.writeByte(nullBits);
+    }
+
+    // Parameter types follow
+    m_writer.writeByte(1);
+
+    for (int index = 0; index < _cParams; index ++)
+    {
+      UMParam *param = &_params[index];
+      UINT8 type = param->type;
+
+      // Temporal values are sent in their text form
+      if (isTemporal(type))
+      {
+        type = MFTYPE_VAR_STRING;
+      }
+
+      m_writer.writeByte(type);
+      m_writer.writeByte(param->isUnsigned ? 0x80 : 0x00);
+    }
+
+    for (int index = 0; index < _cParams; index ++)
+    {
+      UMParam *param = &_params[index];
+      size_t width = binaryWidth(param->type);
+
+      if (param->type == MFTYPE_NULL)
+      {
+        continue;
+      }
+
+      if (width)
+      {
+        m_writer.writeBytes ( (void *) param->value, width);
+      }
+      else
+      {
+        m_writer.writeLengthCodedBinary (param->value, param->cbValue);
+      }
+    }
+  }
+
+  m_writer.finalize(0);
+
+  if (!sendPacket())
+  {
+    PRINTMARK();
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  void *ret = readResult(true);
+  m_dbgMethodProgress --;
+  return ret;
+}
+
+bool Connection::queryPipeline(int _count, const char **_queries, const size_t *_cbQueries, void **_results)
+{
+  m_dbgMethodProgress ++;
+
+  if (m_dbgMethodProgress > 1)
+  {
+    /*
+    NOTE: We don't call setError here because it will close the socket worsening the concurrent access error making it impossible to trace */
+    m_errorMessage = "Concurrent access in queryPipeline method";
+    m_errno = 0;
+    m_errorType = UME_OTHER;
+    m_dbgMethodProgress --;
+    return false;
+  }
+
+  for (int index = 0; index < _count; index ++)
+  {
+    _results[index] = NULL;
+  }
+
+  if (m_sockInst == NULL)
+  {
+    PRINTMARK();
+    setError ("Not connected", 0, UME_OTHER);
+    m_dbgMethodProgress --;
+    return false;
+  }
+
+  if (m_streamResult != NULL)
+  {
+    setUsageError ("A result set is still streaming");
+    m_dbgMethodProgress --;
+    return false;
+  }
+
+  for (int index = 0; index < _count; index ++)
+  {
+    if (_cbQueries[index] > m_writer.getSize () - (MYSQL_PACKET_HEADER_SIZE + 1))
+    {
+      PRINTMARK();
+      setError ("Query too big", 0, UME_OTHER);
+      m_dbgMethodProgress --;
+      return false;
+    }
+  }
+
+  int sent = 0;
+  int done = 0;
+
+  while (done < _count)
+  {
+    size_t cbWindow = 0;
+
+    // Fill one window with queries. A query that is larger than the
+    // window is sent on its own.
+    m_writer.reset();
+
+    while (sent < _count)
+    {
+      size_t cbPacket = MYSQL_PACKET_HEADER_SIZE + 1 + _cbQueries[sent];
+
+      if (sent > done)
+      {
+        if (cbWindow + cbPacket > MYSQL_PIPELINE_WINDOW ||
+          m_writer.getWriteCursor() + cbPacket > m_writer.getEnd())
+        {
+          break;
+        }
+
+        m_writer.beginPacket();
+      }
+
+      m_writer.writeByte(MC_QUERY);
+      m_writer.writeBytes ( (void *) _queries[sent], _cbQueries[sent]);
+      m_writer.finalize(0);
+
+      cbWindow += cbPacket;
+      sent ++;
+    }
+
+    if (!sendPacket())
+    {
+      PRINTMARK();
+      m_dbgMethodProgress --;
+      return false;
+    }
+
+    while (done < sent)
+    {
+      _results[done] = readResult(false);
+
+      if (_results[done] == NULL && m_sockInst == NULL)
+      {
+        PRINTMARK();
+        m_dbgMethodProgress --;
+        return false;
+      }
+
+      done ++;
+    }
+  }
+
+  m_dbgMethodProgress --;
+  return true;
+}
+
+void *Connection::queryStream(const char *_query, size_t _cbQuery)
+{
+  m_dbgMethodProgress ++;
+
+  if (m_dbgMethodProgress > 1)
+  {
+    /*
+    NOTE: We don't call setError here because it will close the socket worsening the concurrent access error making it impossible to trace */
+    m_errorMessage = "Concurrent access in queryStream method";
+    m_errno = 0;
+    m_errorType = UME_OTHER;
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  if (m_sockInst == NULL)
+  {
+    PRINTMARK();
+    setError ("Not connected", 0, UME_OTHER);
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  if (m_streamResult != NULL)
+  {
+    setUsageError ("A result set is still streaming");
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  size_t len = _cbQuery;
+
+  if (len > m_writer.getSize () - (MYSQL_PACKET_HEADER_SIZE + 1))
+  {
+    PRINTMARK();
+    setError ("Query too big", 0, UME_OTHER);
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  m_writer.reset();
+  m_writer.writeByte(MC_QUERY);
+  m_writer.writeBytes ( (void *) _query, len);
+  m_writer.finalize(0);
+
+  if (!sendPacket() || !recvPacket())
+  {
+    PRINTMARK();
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  UINT8 result = m_reader.readByte();
+
+  switch (result)
+  {
+  case 0x00:
+    PRINTMARK();
+    m_dbgMethodProgress --;
+    return handleOKPacket();
+
+  case 0xff:
+    PRINTMARK();
+    handleErrorPacket();
+    m_dbgMethodProgress --;
+    return NULL;
+
+  case 0xfe:
+    PRINTMARK();
+    setError ("Unexpected EOF when decoding result", 0, UME_OTHER);
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  // Read the field packets now and leave the rows on the socket
+  m_reader.rewind(1);
+  int fieldCount = (int) m_reader.readLengthCodedInteger();
+  m_reader.skip();
+
+  void *resultSet = m_capi.createResult(fieldCount);
+  m_streamTypes.resize(fieldCount);
+
+  if (!readFields(resultSet, fieldCount, &m_streamTypes[0]))
+  {
+    m_capi.destroyResult(resultSet);
+    m_dbgMethodProgress --;
+    return NULL;
+  }
+
+  m_streamResult = resultSet;
+  m_dbgMethodProgress --;
+  return resultSet;
+}
+
+int Connection::fetchRows(int _maxRows)
+{
+  m_dbgMethodProgress ++;
+
+  if (m_dbgMethodProgress > 1)
+  {
+    /*
+    NOTE: We don't call setError here because it will close the socket worsening the concurrent access error making it impossible to trace */
+    m_errorMessage = "Concurrent access in fetchRows method";
+    m_errno = 0;
+    m_errorType = UME_OTHER;
+    m_dbgMethodProgress --;
+    return -1;
+  }
+
+  // Nothing left to fetch once the result set is done
+  if (m_streamResult == NULL)
+  {
+    m_dbgMethodProgress --;
+    return 0;
+  }
+
+  int cRows = 0;
+
+  while (cRows < _maxRows)
+  {
+    int ret = readRow(m_streamResult, (int) m_streamTypes.size(), &m_streamTypes[0], false);
+
+    if (ret < 0)
+    {
+      // Unless the connection is gone, the rest of the result set can
+      // still be fetched or dropped by endStream.
+      if (m_sockInst == NULL)
+      {
+        m_streamResult = NULL;
+      }
+
+      m_dbgMethodProgress --;
+      return -1;
+    }
+
+    if (ret == 0)
+    {
+      m_streamResult = NULL;
+      break;
+    }
+
+    cRows ++;
+  }
+
+  m_dbgMethodProgress --;
+  return cRows;
+}
+
+bool Connection::endStream()
+{
+  m_dbgMethodProgress ++;
+
+  if (m_dbgMethodProgress > 1)
+  {
+    /*
+    NOTE: We don't call setError here because it will close the socket worsening the concurrent access error making it impossible to trace */
+    m_errorMessage = "Concurrent access in endStream method";
+    m_errno = 0;
+    m_errorType = UME_OTHER;
+    m_dbgMethodProgress --;
+    return false;
+  }
+
+  // Drop the remaining rows without decoding them
+  bool ret = true;
+
+  if (m_streamResult != NULL)
+  {
+    ret = skipRows();
+    m_streamResult = NULL;
+  }
+
+  m_dbgMethodProgress --;
+  return ret;
+}
+
+int Connection::setCompression(int _threshold)
+{
+  int old = m_compressThreshold;
+
+  // Takes effect on the next connect
+  m_compressThreshold = _threshold < 0 ? -1 : _threshold;
+  return old;
+}
+
+void Connection::getTraffic(UINT64 *_bytesRecv, UINT64 *_bytesSent)
+{
+  *_bytesRecv = m_bytesRecv;
+  *_bytesSent = m_bytesSent;
+}
 
 int Connection::getRxBufferSize()
 {
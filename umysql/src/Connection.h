@@ -61,6 +61,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define __UMCONNECTION_H__
 
 #include <string>
+#include <list>
+#include <map>
+#include <vector>
 #include "umysql.h"
 #include "PacketReader.h"
 #include "PacketWriter.h"
@@ -96,6 +99,15 @@ private:
   void *m_sockInst;
   PacketReader m_reader;
   PacketWriter m_writer;
+
+  // Compressed protocol: socket data is framed through these buffers,
+  // which stay empty until the server agrees to compression
+  int m_compressThreshold;
+  bool m_compress;
+  PacketReader m_zreader;
+  PacketWriter m_zwriter;
+  UINT64 m_bytesRecv;
+  UINT64 m_bytesSent;
   UINT32 m_clientCaps;
   std::string m_query;
 
@@ -108,6 +120,23 @@ private:
 
   int m_dbgMethodProgress;
 
+  struct Statement
+  {
+    std::string query;
+    UINT32 id;
+    int cParams;
+  };
+
+  // Prepared statements, most recently used first
+  typedef std::list<Statement> StatementList;
+  StatementList m_stmtList;
+  std::map<std::string, StatementList::iterator> m_stmtCache;
+  size_t m_stmtCacheSize;
+
+  // Result set handed out by queryStream whose rows are still unread
+  void *m_streamResult;
+  std::vector<UMTypeInfo> m_streamTypes;
+
 public:
 
 
@@ -117,6 +146,14 @@ public:
   bool connect(const char *_host, int _port, const char *_username, const char *_password, const char *_database, int *_autoCommit, MYSQL_CHARSETS _charset);
   //void handleSocketEvent (SocketEvents _evt);
   void *query(const char *_query, size_t _cbQuery);
+  void *execute(const char *_query, size_t _cbQuery, UMParam *_params, int _cParams);
+  bool queryPipeline(int _count, const char **_queries, const size_t *_cbQueries, void **_results);
+  int setStatementCacheSize(int num);
+  void *queryStream(const char *_query, size_t _cbQuery);
+  int fetchRows(int _maxRows);
+  bool endStream();
+  int setCompression(int _threshold);
+  void getTraffic(UINT64 *_bytesRecv, UINT64 *_bytesSent);
   bool getLastError (const char **_ppOutMessage, int *_outErrno, int *_outErrorType);
 
   int getRxBufferSize();
@@ -131,8 +168,9 @@ public:
 protected:
   void changeState(State _newState, const char *message);
   bool connectSocket();
+  bool fillBuffer(PacketReader &_reader);
   bool readSocket();
-  bool writeSocket();
+  bool writeSocket(PacketWriter &_writer);
   bool processHandshake();
   void scramble(const char *_scramble1, const char *_scramble2, UINT8 _outToken[20]);
   bool recvPacket();
@@ -140,7 +178,15 @@ protected:
 
   void handleErrorPacket();
   void handleEOFPacket();
-  void *handleResultPacket(int fieldCount);
+  void *handleResultPacket(int fieldCount, bool _binary);
+  bool readFields(void *resultSet, int _fieldCount, UMTypeInfo *typeInfo);
+  int readRow(void *resultSet, int _fieldCount, UMTypeInfo *typeInfo, bool _binary);
+  bool handleBinaryRow(void *resultSet, int fieldCount, UMTypeInfo *typeInfo);
+  bool skipRows();
+  void *readResult(bool _binary);
+  Statement *prepare(const char *_query, size_t _cbQuery);
+  void clearStatements();
+  void setUsageError (const char *_message);
   void *handleOKPacket();
   void setError (const char *_message, int _errno, UMErrorType _type);
 
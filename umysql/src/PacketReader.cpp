@@ -60,6 +60,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "PacketReader.h"
 #include "mysqldefs.h"
 #include <assert.h>
+#include <zlib.h>
 
 #define BYTEORDER_UINT16(_x) (_x)
 #define BYTEORDER_UINT32(_x) (_x)
@@ -71,10 +72,17 @@ PacketReader::PacketReader (size_t _cbSize)
   m_buffEnd = m_buffStart + _cbSize;
   m_readCursor = m_buffStart;
   m_packetEnd = NULL;
+  m_zstream = NULL;
 }
 
 PacketReader::~PacketReader (void)
 {
+  if (m_zstream)
+  {
+    inflateEnd(m_zstream);
+    delete m_zstream;
+  }
+
   delete[] m_buffStart;
 }
 
@@ -88,6 +96,94 @@ void PacketReader::shrink()
   }
 }
 
+void PacketReader::reset()
+{
+  m_readCursor = m_buffStart;
+  m_writeCursor = m_buffStart;
+  m_packetEnd = NULL;
+}
+
+int PacketReader::inflateFrom(PacketReader &_raw)
+{
+  int ret = 0;
+
+  while (_raw.m_writeCursor - _raw.m_readCursor >= MYSQL_COMPRESS_HEADER_SIZE)
+  {
+    UINT8 *header = (UINT8 *) _raw.m_readCursor;
+    size_t cbCompressed = header[0] | (header[1] << 8) | (header[2] << 16);
+    size_t cbData = header[4] | (header[5] << 8) | (header[6] << 16);
+    bool stored = (cbData == 0);
+
+    if ((size_t) (_raw.m_writeCursor - _raw.m_readCursor) < MYSQL_COMPRESS_HEADER_SIZE + cbCompressed)
+    {
+      break;
+    }
+
+    if (stored)
+    {
+      cbData = cbCompressed;
+    }
+
+    if ((size_t) (m_buffEnd - m_writeCursor) < cbData)
+    {
+      shrink();
+
+      if ((size_t) (m_buffEnd - m_writeCursor) < cbData)
+      {
+        // Let the caller drain what was unpacked so far first
+        return ret ? 1 : -2;
+      }
+    }
+
+    char *payload = _raw.m_readCursor + MYSQL_COMPRESS_HEADER_SIZE;
+
+    if (stored)
+    {
+      memcpy (m_writeCursor, payload, cbData);
+    }
+    else
+    {
+      if (m_zstream == NULL)
+      {
+        m_zstream = new z_stream;
+        memset (m_zstream, 0, sizeof (z_stream));
+
+        if (inflateInit(m_zstream) != Z_OK)
+        {
+          delete m_zstream;
+          m_zstream = NULL;
+          return -1;
+        }
+      }
+      else
+      {
+        inflateReset(m_zstream);
+      }
+
+      m_zstream->next_in = (Bytef *) payload;
+      m_zstream->avail_in = (uInt) cbCompressed;
+      m_zstream->next_out = (Bytef *) m_writeCursor;
+      m_zstream->avail_out = (uInt) cbData;
+
+      if (inflate(m_zstream, Z_FINISH) != Z_STREAM_END || m_zstream->avail_out != 0)
+      {
+        return -1;
+      }
+    }
+
+    m_writeCursor += cbData;
+    _raw.m_readCursor += MYSQL_COMPRESS_HEADER_SIZE + cbCompressed;
+    ret = 1;
+  }
+
+  if (_raw.m_readCursor == _raw.m_writeCursor)
+  {
+    _raw.reset();
+  }
+
+  return ret;
+}
+
 void PacketReader::skip()
 {
   assert (m_packetEnd != NULL);
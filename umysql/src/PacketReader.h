@@ -62,6 +62,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "mysqldefs.h"
 
+struct z_stream_s;
+
 class PacketReader
 {
 private:
@@ -70,6 +72,7 @@ private:
   char *m_readCursor;
   char *m_writeCursor;
   char *m_packetEnd;
+  struct z_stream_s *m_zstream;
 
 public:
 
@@ -82,6 +85,12 @@ public:
   char *getEndPtr();
 
   void shrink();
+  void reset();
+
+  // Compressed protocol: unpack the complete frames buffered in _raw into
+  // this buffer. Returns 1 if anything was added, 0 if _raw needs more
+  // data, -1 on a malformed frame and -2 if there is no room left here.
+  int inflateFrom(PacketReader &_raw);
 
   size_t getSize();
   size_t setSize(size_t num);
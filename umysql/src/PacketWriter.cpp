@@ -59,6 +59,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "PacketWriter.h"
 #include <assert.h>
+#include <zlib.h>
 
 #define BYTEORDER_UINT16(_x) (_x)
 #define BYTEORDER_UINT32(_x) (_x)
@@ -71,10 +72,18 @@ PacketWriter::PacketWriter(size_t _cbSize)
   m_buffEnd = m_buffStart + _cbSize;
   m_readCursor = m_buffStart;
   m_writeCursor = m_buffStart;
+  m_packetStart = m_buffStart;
+  m_zstream = NULL;
 }
 
 PacketWriter::~PacketWriter(void)
 {
+  if (m_zstream)
+  {
+    deflateEnd(m_zstream);
+    delete m_zstream;
+  }
+
   delete[] m_buffStart;
 }
 
@@ -123,6 +132,15 @@ void PacketWriter::reset()
 {
   m_readCursor = m_buffStart;
   m_writeCursor = m_buffStart;
+  m_packetStart = m_buffStart;
+
+  // Reserve space for header
+  writeLong(0);
+}
+
+void PacketWriter::beginPacket()
+{
+  m_packetStart = m_writeCursor;
 
   // Reserve space for header
   writeLong(0);
@@ -134,6 +152,12 @@ void PacketWriter::writeLong (UINT32 value)
   m_writeCursor += 4;
 }
 
+void PacketWriter::writeShort (UINT16 value)
+{
+  *((UINT16*)m_writeCursor) = BYTEORDER_UINT16(value);
+  m_writeCursor += 2;
+}
+
 void PacketWriter::writeByte (UINT8 value)
 {
   *((UINT8*)m_writeCursor) = value;
@@ -155,17 +179,132 @@ void PacketWriter::writeBytes (void *data, size_t cbData)
   m_writeCursor += cbData;
 }
 
+void PacketWriter::writeLengthCodedBinary (const void *data, size_t cbData)
+{
+  if (cbData < 251)
+  {
+    writeByte((UINT8) cbData);
+  }
+  else
+    if (cbData < 65536)
+    {
+      writeByte(252);
+      writeShort((UINT16) cbData);
+    }
+    else
+      if (cbData < 16777216)
+      {
+        writeByte(253);
+        writeByte((UINT8) cbData);
+        writeShort((UINT16) (cbData >> 8));
+      }
+      else
+      {
+        writeByte(254);
+        writeLong((UINT32) cbData);
+        writeLong((UINT32) ((UINT64) cbData >> 32));
+      }
+
+  memcpy (m_writeCursor, data, cbData);
+  m_writeCursor += cbData;
+}
+
 void PacketWriter::finalize(int packetNumber)
 {
-  size_t packetLen = (m_writeCursor - m_readCursor - MYSQL_PACKET_HEADER_SIZE);
+  size_t packetLen = (m_writeCursor - m_packetStart - MYSQL_PACKET_HEADER_SIZE);
 
-  *((UINT32 *)m_buffStart) = packetLen;
-  *((UINT8 *)m_buffStart + 3) = packetNumber;
+  *((UINT32 *)m_packetStart) = packetLen;
+  *((UINT8 *)m_packetStart + 3) = packetNumber;
 
   //PrintBuffer (stdout, m_readCursor, (m_writeCursor - m_readCursor), 16);
 
 }
 
+static void writeINT24(char *_ptr, size_t _value)
+{
+  _ptr[0] = (char) (_value & 0xff);
+  _ptr[1] = (char) ((_value >> 8) & 0xff);
+  _ptr[2] = (char) ((_value >> 16) & 0xff);
+}
+
+void PacketWriter::deflateFrom(PacketWriter &_plain, size_t _threshold)
+{
+  size_t cbPlain = _plain.m_writeCursor - _plain.m_readCursor;
+  size_t cbNeeded = cbPlain + (cbPlain / MYSQL_COMPRESS_MAX_PAYLOAD + 1) * MYSQL_COMPRESS_HEADER_SIZE;
+
+  m_readCursor = m_buffStart;
+  m_writeCursor = m_buffStart;
+  m_packetStart = m_buffStart;
+
+  // Stored frames are never larger than the input, so this always fits
+  if (getSize() <= cbNeeded)
+  {
+    setSize(cbNeeded + 1);
+  }
+
+  if (m_zstream == NULL && cbPlain >= _threshold)
+  {
+    m_zstream = new z_stream;
+    memset (m_zstream, 0, sizeof (z_stream));
+
+    if (deflateInit(m_zstream, Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+      delete m_zstream;
+      m_zstream = NULL;
+    }
+  }
+
+  // The client starts every command at sequence 0
+  int packetNumber = 0;
+
+  while (_plain.m_readCursor < _plain.m_writeCursor)
+  {
+    size_t cbData = _plain.m_writeCursor - _plain.m_readCursor;
+
+    if (cbData > MYSQL_COMPRESS_MAX_PAYLOAD)
+    {
+      cbData = MYSQL_COMPRESS_MAX_PAYLOAD;
+    }
+
+    char *header = m_writeCursor;
+    char *payload = header + MYSQL_COMPRESS_HEADER_SIZE;
+    size_t cbCompressed = 0;
+
+    if (m_zstream && cbData >= _threshold && cbData > 1)
+    {
+      deflateReset(m_zstream);
+
+      m_zstream->next_in = (Bytef *) _plain.m_readCursor;
+      m_zstream->avail_in = (uInt) cbData;
+      m_zstream->next_out = (Bytef *) payload;
+      m_zstream->avail_out = (uInt) (cbData - 1);
+
+      if (deflate(m_zstream, Z_FINISH) == Z_STREAM_END)
+      {
+        cbCompressed = m_zstream->total_out;
+      }
+    }
+
+    if (cbCompressed)
+    {
+      writeINT24(header, cbCompressed);
+      writeINT24(header + 4, cbData);
+    }
+    else
+    {
+      memcpy (payload, _plain.m_readCursor, cbData);
+      cbCompressed = cbData;
+      writeINT24(header, cbData);
+      writeINT24(header + 4, 0);
+    }
+
+    header[3] = (char) packetNumber++;
+
+    m_writeCursor = payload + cbCompressed;
+    _plain.m_readCursor += cbData;
+  }
+}
+
 size_t PacketWriter::getSize(void)
 {
   return (m_buffEnd - m_buffStart);
@@ -184,6 +323,7 @@ size_t PacketWriter::setSize(size_t _cbSize)
   memcpy(buffStart, m_buffStart, m_writeCursor - m_buffStart);
   m_readCursor = m_readCursor - m_buffStart + buffStart;
   m_writeCursor = m_writeCursor - m_buffStart + buffStart;
+  m_packetStart = m_packetStart - m_buffStart + buffStart;
 
   delete m_buffStart;
   m_buffStart = buffStart;
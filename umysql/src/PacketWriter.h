@@ -62,6 +62,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "mysqldefs.h"
 
+struct z_stream_s;
+
 class PacketWriter
 {
 public:
@@ -81,12 +83,23 @@ public:
   bool isDone();
   void reset();
 
+  // Start another packet behind the finalized one, so several packets
+  // can be sent with one write.
+  void beginPacket();
+
   void writeLong (UINT32 value);
+  void writeShort (UINT16 value);
   void writeByte (UINT8 value);
+  void writeLengthCodedBinary (const void *data, size_t cbData);
   void writeNTString (const char *_str);
   void writeBytes (void *data, size_t cbData);
   void finalize(int packetNumber);
 
+  // Compressed protocol: replace the contents of this buffer with the
+  // unsent bytes of _plain split into frames, and mark those bytes sent.
+  // Frames shorter than _threshold, or that do not shrink, are stored.
+  void deflateFrom(PacketWriter &_plain, size_t _threshold);
+
   size_t getSize(void);
   size_t setSize(size_t num);
 
@@ -96,7 +109,8 @@ private:
   char *m_buffEnd;
   char *m_readCursor;
   char *m_writeCursor;
-
+  char *m_packetStart;
+  struct z_stream_s *m_zstream;
 
 };
 
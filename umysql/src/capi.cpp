@@ -124,3 +124,42 @@ EXPORT_ATTR int UMConnection_Close (UMConnection conn)
   return ((Connection *)conn)->close() ? 1 : 0;
 }
 
+EXPORT_ATTR void * UMConnection_Execute(UMConnection conn, const char *_query, size_t _cbQuery, UMParam *_params, int _cParams)
+{
+  return ((Connection *)conn)->execute(_query, _cbQuery, _params, _cParams);
+}
+
+EXPORT_ATTR int UMConnection_SetStatementCacheSize(UMConnection conn, int num)
+{
+  return ((Connection *)conn)->setStatementCacheSize(num);
+}
+
+EXPORT_ATTR int UMConnection_QueryPipeline(UMConnection conn, int _count, const char **_queries, const size_t *_cbQueries, void **_results)
+{
+  return ((Connection *)conn)->queryPipeline(_count, _queries, _cbQueries, _results) ? 1 : 0;
+}
+
+EXPORT_ATTR void * UMConnection_QueryStream(UMConnection conn, const char *_query, size_t _cbQuery)
+{
+  return ((Connection *)conn)->queryStream(_query, _cbQuery);
+}
+
+EXPORT_ATTR int UMConnection_FetchRows(UMConnection conn, int _maxRows)
+{
+  return ((Connection *)conn)->fetchRows(_maxRows);
+}
+
+EXPORT_ATTR int UMConnection_EndStream(UMConnection conn)
+{
+  return ((Connection *)conn)->endStream() ? 1 : 0;
+}
+
+EXPORT_ATTR int UMConnection_SetCompression(UMConnection conn, int _minSize)
+{
+  return ((Connection *)conn)->setCompression(_minSize);
+}
+
+EXPORT_ATTR void UMConnection_GetTraffic(UMConnection conn, UINT64 *_bytesRecv, UINT64 *_bytesSent)
+{
+  ((Connection *)conn)->getTraffic(_bytesRecv, _bytesSent);
+}
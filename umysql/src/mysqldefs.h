@@ -96,6 +96,9 @@ enum MYSQL_COMMANDS
   MC_INIT_DB = 2,
   MC_QUERY = 3,
   MC_LIST = 4,
+  MC_STMT_PREPARE = 0x16,
+  MC_STMT_EXECUTE = 0x17,
+  MC_STMT_CLOSE = 0x19,
 };
 
 enum MYSQL_PACKETREAD
@@ -393,4 +396,17 @@ enum MYSQL_FIELDFLAG
 #define MYSQL_TX_BUFFER_SIZE (MYSQL_PACKET_SIZE + MYSQL_PACKET_HEADER_SIZE)
 #define MYSQL_RX_BUFFER_SIZE (MYSQL_PACKET_SIZE + MYSQL_PACKET_HEADER_SIZE)
 
+// Pipelined queries are sent in batches of at most this many bytes, and
+// the results of a batch are read before the next one is sent. This keeps
+// the batch within the socket buffers so neither side blocks on send.
+#define MYSQL_PIPELINE_WINDOW (64 * 1024)
+#define MYSQL_STMT_CACHE_SIZE 64
+
+// Compressed protocol frames carry a 3 byte compressed length, a sequence
+// number and the 3 byte uncompressed length, which is 0 when the payload
+// was stored as is. Payloads below the threshold are never compressed.
+#define MYSQL_COMPRESS_HEADER_SIZE 7
+#define MYSQL_COMPRESS_MAX_PAYLOAD 0xffffff
+#define MYSQL_COMPRESS_THRESHOLD 50
+
 #endif
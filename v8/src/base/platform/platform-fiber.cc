@@ -1,8 +1,14 @@
 #include "src/v8.h"
+#include "src/isolate.h"
 #include "src/profiler/sampler.h"
 #include <exlib/include/fiber.h>
 #include <exlib/include/service.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#endif
+
 #ifdef _WIN32
 
 #ifdef CreateMutex
@@ -25,10 +31,141 @@ namespace v8
 namespace internal
 {
 
+#ifndef _WIN32
+
+#define MAX_FIBER_SAMPLES 256
+
+/*
+ * the stack of a fiber can only be walked on the worker that runs it, so
+ * every tick interrupts all workers with SIGPROF. the handler installed by
+ * sampler.cc finds the isolate through the TLS of the running fiber and,
+ * if it takes the sample, calls CountFiberSample() to count it per fiber
+ * name.
+ */
+class FiberSampler
+{
+public:
+    struct Entry
+    {
+        base::Atomic32 state;
+        base::Atomic32 count;
+        char name[16];
+    };
+
+    enum
+    {
+        kEmpty = 0,
+        kWriting,
+        kReady
+    };
+
+public:
+    static void Signal()
+    {
+        int32_t cnt = exlib::Service::worker_count();
+        pthread_t self = pthread_self();
+        int32_t i;
+
+        for (i = 0; i < cnt; i++)
+        {
+            exlib::Service* worker = exlib::Service::worker(i);
+
+            if (worker && worker->thread_ && !pthread_equal(worker->thread_, self))
+                pthread_kill(worker->thread_, SIGPROF);
+        }
+    }
+
+    static int32_t Samples(const char** names, int32_t* counts, int32_t size)
+    {
+        int32_t i, n = 0;
+
+        for (i = 0; i < MAX_FIBER_SAMPLES && n < size; i++)
+            if (base::Acquire_Load(&entries_[i].state) == kReady)
+            {
+                names[n] = entries_[i].name;
+                counts[n] = base::NoBarrier_Load(&entries_[i].count);
+                n++;
+            }
+
+        return n;
+    }
+
+    static void Reset()
+    {
+        int32_t i;
+
+        for (i = 0; i < MAX_FIBER_SAMPLES; i++)
+            base::NoBarrier_Store(&entries_[i].count, 0);
+    }
+
+    // runs in the signal handler, so nothing here may lock or allocate.
+    static void CountCurrent()
+    {
+        exlib::OSThread* thread_ = exlib::OSThread::current();
+
+        if (thread_ && thread_->is(exlib::Service::type))
+        {
+            const char* name = ((exlib::Service*)thread_)->running()->name();
+            Count(name[0] ? name : "?");
+        }
+    }
+
+private:
+    static void Count(const char* name)
+    {
+        uint32_t hash = 2166136261u;
+        int32_t i, j;
+
+        for (i = 0; i < (int32_t)sizeof(entries_[0].name) && name[i]; i++)
+            hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+
+        for (j = 0; j < MAX_FIBER_SAMPLES; j++)
+        {
+            Entry& e = entries_[(hash + j) % MAX_FIBER_SAMPLES];
+            base::Atomic32 state = base::Acquire_Load(&e.state);
+
+            // slots are claimed once and never released.
+            if (state == kEmpty)
+            {
+                if (base::NoBarrier_CompareAndSwap(&e.state, kEmpty, kWriting) != kEmpty)
+                    return;
+
+                strncpy(e.name, name, sizeof(e.name));
+                e.name[sizeof(e.name) - 1] = '\0';
+                base::Release_Store(&e.state, kReady);
+            }
+            else if (state != kReady)
+                return;
+            else if (strncmp(e.name, name, sizeof(e.name) - 1))
+                continue;
+
+            base::NoBarrier_AtomicIncrement(&e.count, 1);
+            return;
+        }
+    }
+
+private:
+    static Entry entries_[MAX_FIBER_SAMPLES];
+};
+
+FiberSampler::Entry FiberSampler::entries_[MAX_FIBER_SAMPLES];
+
+void Sampler::DoSample()
+{
+    if (!IsActive())
+        return;
+
+    FiberSampler::Signal();
+}
+
+#else
+
 void Sampler::DoSample()
 {
 }
 
+#endif
+
 }
 
 namespace base
@@ -112,9 +249,43 @@ void Thread::SetThreadLocal(LocalStorageKey key, void *value)
 
 void OS::Sleep(TimeDelta interval)
 {
-    exlib::Fiber::sleep(interval.InMicroseconds());
+    exlib::Fiber::sleep(static_cast<int32_t>(interval.InMilliseconds()));
+}
+
+#ifndef _WIN32
+
+int32_t GetFiberSamples(const char** names, int32_t* counts, int32_t size)
+{
+    return internal::FiberSampler::Samples(names, counts, size);
 }
 
+void ResetFiberSamples()
+{
+    internal::FiberSampler::Reset();
+}
+
+void CountFiberSample()
+{
+    internal::FiberSampler::CountCurrent();
+}
+
+#else
+
+int32_t GetFiberSamples(const char** names, int32_t* counts, int32_t size)
+{
+    return 0;
+}
+
+void ResetFiberSamples()
+{
+}
+
+void CountFiberSample()
+{
+}
+
+#endif
+
 }
 
 }
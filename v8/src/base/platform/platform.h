@@ -273,6 +273,27 @@ class OS {
 };
 
 
+// ----------------------------------------------------------------------------
+// Fiber samples
+//
+// While the CPU profiler is running, every tick it samples is also counted
+// against the name of the fiber it interrupted (see platform-fiber.cc).
+// There are no samples on Windows, where the fiber platform does not
+// sample.
+
+// Stores up to "size" fiber names and their tick counts in "names" and
+// "counts" and returns how many were stored.  The names stay valid for the
+// lifetime of the process.
+int32_t GetFiberSamples(const char** names, int32_t* counts, int32_t size);
+
+// Sets all tick counts back to zero.
+void ResetFiberSamples();
+
+// Counts one tick against the running fiber.  Called from the profiler's
+// signal handler, so it must stay async-signal-safe.
+void CountFiberSample();
+
+
 // Represents and controls an area of reserved memory.
 // Control of the reserved memory can be assigned to another VirtualMemory
 // object by assignment or copy-contructing. This removes the reserved memory
@@ -435,6 +435,8 @@ void SignalHandler::HandleProfilerSignal(int signal, siginfo_t* info,
   Sampler* sampler = isolate->logger()->sampler();
   if (sampler == NULL) return;
 
+  base::CountFiberSample();
+
   v8::RegisterState state;
 
 #if defined(USE_SIMULATOR)
@@ -274,6 +274,7 @@ patch_flag();
 //fs.unlink('src/version_gen.cc');
 
 fs.unlink('src/snapshot/mksnapshot.cc')
+fs.unlink('src/snapshot/snapshot-empty.cc')
 fs.unlink('src/snapshot/natives-external.cc')
 fs.unlink('src/snapshot/snapshot-external.cc')
 
@@ -42,6 +42,9 @@ function do_folder(path, base) {
 do_folder("include", "Header Files");
 do_folder("src", "Source Files");
 
+// the no-snapshot default lives with mksnapshot in v8_snapshot.
+Compiles['..\\v8_snapshot\\snapshot-empty.cc'] = 'Source Files\\snapshot';
+
 var proj = fs.readFile('tools/proj.txt');
 var filter = fs.readFile('tools/filter.txt');
 
@@ -0,0 +1,212 @@
+// Copyright 2006-2008 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Builds the startup snapshot blob and writes it out as a C++ source
+// (--startup_src) and/or a raw blob (--startup_blob).  V8 threads are
+// fibers in this tree, so the work runs on an exlib fiber.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "include/libplatform/libplatform.h"
+#include "src/assembler.h"
+#include "src/flags.h"
+#include "src/list.h"
+#include "src/snapshot/natives.h"
+#include "src/snapshot/snapshot.h"
+#include <exlib/include/service.h>
+
+using namespace v8;
+
+class SnapshotWriter {
+ public:
+  SnapshotWriter() : startup_blob_file_(NULL) {}
+
+  ~SnapshotWriter() {
+    if (startup_blob_file_) fclose(startup_blob_file_);
+  }
+
+  void SetStartupBlobFile(const char* startup_blob_file) {
+    if (startup_blob_file != NULL)
+      startup_blob_file_ = GetFileDescriptorOrDie(startup_blob_file);
+  }
+
+  void WriteSnapshot(v8::StartupData blob) const {
+    i::Vector<const i::byte> blob_vector(
+        reinterpret_cast<const i::byte*>(blob.data), blob.raw_size);
+    MaybeWriteStartupBlob(blob_vector);
+    MaybeWriteSnapshotFile(blob_vector);
+  }
+
+ private:
+  void MaybeWriteStartupBlob(const i::Vector<const i::byte>& blob) const {
+    if (!startup_blob_file_) return;
+
+    size_t written = fwrite(blob.begin(), 1, blob.length(), startup_blob_file_);
+    if (written != static_cast<size_t>(blob.length())) {
+      i::PrintF("Writing snapshot file failed.. Aborting.\n");
+      exit(1);
+    }
+  }
+
+  void MaybeWriteSnapshotFile(const i::Vector<const i::byte>& blob) const {
+    if (!i::FLAG_startup_src) return;
+
+    FILE* fp = GetFileDescriptorOrDie(i::FLAG_startup_src);
+
+    WriteFilePrefix(fp);
+    WriteData(fp, blob);
+    WriteFileSuffix(fp);
+
+    fclose(fp);
+  }
+
+  static void WriteFilePrefix(FILE* fp) {
+    fprintf(fp, "// Autogenerated snapshot file. Do not edit.\n\n");
+    fprintf(fp, "#include \"src/v8.h\"\n");
+    fprintf(fp, "#include \"src/base/platform/platform.h\"\n\n");
+    fprintf(fp, "#include \"src/snapshot/snapshot.h\"\n\n");
+    fprintf(fp, "namespace v8 {\n");
+    fprintf(fp, "namespace internal {\n\n");
+  }
+
+  static void WriteFileSuffix(FILE* fp) {
+    fprintf(fp, "const v8::StartupData* Snapshot::DefaultSnapshotBlob() {\n");
+    fprintf(fp, "  return &blob;\n");
+    fprintf(fp, "}\n\n");
+    fprintf(fp, "}  // namespace internal\n");
+    fprintf(fp, "}  // namespace v8\n");
+  }
+
+  static void WriteData(FILE* fp, const i::Vector<const i::byte>& blob) {
+    fprintf(fp, "static const byte blob_data[] = {\n");
+    WriteSnapshotData(fp, blob);
+    fprintf(fp, "};\n");
+    fprintf(fp, "static const int blob_size = %d;\n", blob.length());
+    fprintf(fp, "static const v8::StartupData blob =\n");
+    fprintf(fp, "{ (const char*) blob_data, blob_size };\n");
+  }
+
+  static void WriteSnapshotData(FILE* fp,
+                                const i::Vector<const i::byte>& blob) {
+    for (int i = 0; i < blob.length(); i++) {
+      if ((i & 0x1f) == 0x1f) fprintf(fp, "\n");
+      if (i > 0) fprintf(fp, ",");
+      fprintf(fp, "%u", static_cast<unsigned char>(blob.at(i)));
+    }
+    fprintf(fp, "\n");
+  }
+
+  static FILE* GetFileDescriptorOrDie(const char* filename) {
+    FILE* fp = base::OS::FOpen(filename, "wb");
+    if (fp == NULL) {
+      i::PrintF("Unable to open file \"%s\" for writing.\n", filename);
+      exit(1);
+    }
+    return fp;
+  }
+
+  FILE* startup_blob_file_;
+};
+
+
+char* GetExtraCode(char* filename, const char* description) {
+  if (filename == NULL || strlen(filename) == 0) return NULL;
+  ::printf("Loading script for %s: %s\n", description, filename);
+  FILE* file = base::OS::FOpen(filename, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open '%s': errno %d\n", filename, errno);
+    exit(1);
+  }
+  fseek(file, 0, SEEK_END);
+  size_t size = ftell(file);
+  rewind(file);
+  char* chars = new char[size + 1];
+  chars[size] = '\0';
+  for (size_t i = 0; i < size;) {
+    size_t read = fread(&chars[i], 1, size - i, file);
+    if (ferror(file)) {
+      fprintf(stderr, "Failed to read '%s': errno %d\n", filename, errno);
+      exit(1);
+    }
+    i += read;
+  }
+  fclose(file);
+  return chars;
+}
+
+
+static int s_argc;
+static char** s_argv;
+
+static void* snapshot_main(void*) {
+  int argc = s_argc;
+  char** argv = s_argv;
+
+  V8::InitializeICU();
+  v8::Platform* platform = v8::platform::CreateDefaultPlatform();
+  v8::V8::InitializePlatform(platform);
+  v8::V8::Initialize();
+
+  {
+    SnapshotWriter writer;
+    if (i::FLAG_startup_blob) writer.SetStartupBlobFile(i::FLAG_startup_blob);
+    char* embed_script = GetExtraCode(argc >= 2 ? argv[1] : NULL, "embedding");
+    StartupData blob = v8::V8::CreateSnapshotDataBlob(embed_script);
+    delete[] embed_script;
+
+    char* warmup_script = GetExtraCode(argc >= 3 ? argv[2] : NULL, "warm up");
+    if (warmup_script) {
+      StartupData cold = blob;
+      blob = v8::V8::WarmUpSnapshotDataBlob(cold, warmup_script);
+      delete[] cold.data;
+      delete[] warmup_script;
+    }
+
+    CHECK(blob.data);
+    writer.WriteSnapshot(blob);
+    delete[] blob.data;
+  }
+
+  V8::Dispose();
+  V8::ShutdownPlatform();
+  delete platform;
+
+  exit(0);
+  return NULL;
+}
+
+
+int main(int argc, char** argv) {
+  // By default, log code create information in the snapshot.
+  i::FLAG_log_code = true;
+  i::FLAG_logfile_per_isolate = false;
+
+  // Omit from the snapshot natives for features that can be turned off
+  // at runtime.
+  i::FLAG_harmony_shipping = false;
+
+  // Print the usage if an error occurs when parsing the command line
+  // flags or if the help flag is set.
+  int result = i::FlagList::SetFlagsFromCommandLine(&argc, argv, true);
+  if (result > 0 || (argc > 3) || i::FLAG_help) {
+    ::printf("Usage: %s --startup_src=... --startup_blob=... [extras]"
+             " [warmup]\n", argv[0]);
+    i::FlagList::PrintHelp();
+    return !i::FLAG_help;
+  }
+
+  i::CpuFeatures::Probe(true);
+
+  s_argc = argc;
+  s_argv = argv;
+
+  exlib::Service::init(1);
+  exlib::Service::Create(snapshot_main, NULL, 256 * 1024, "mksnapshot");
+  exlib::Service::dispatch();
+
+  return 0;
+}
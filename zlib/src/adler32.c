@@ -61,11 +61,46 @@ local uLong adler32_combine_ OF((uLong adler1, uLong adler2, z_off64_t len2));
 #  define MOD63(a) a %= BASE
 #endif
 
+/* Kernels for long buffers, picked once by adler32_select() from what the
+   CPU supports: AVX2 or SSSE3 on x86, NEON on ARMv8.  Each one sums whole
+   blocks in vector lanes, reducing modulo BASE every NMAX bytes like the
+   scalar loop, and leaves the tail to adler32_generic(). */
+#if defined(Z_X86_SIMD) || defined(Z_ARM64_SIMD)
+#  define ADLER32_SIMD
+#  define ADLER32_SIMD_MIN 64
+#  ifdef Z_X86_SIMD
+#    include <immintrin.h>
+     local uLong adler32_ssse3 OF((uLong adler, const Bytef *buf, uInt len));
+     local uLong adler32_avx2 OF((uLong adler, const Bytef *buf, uInt len));
+#  else
+#    include <arm_neon.h>
+     local uLong adler32_neon OF((uLong adler, const Bytef *buf, uInt len));
+#  endif
+   local uLong adler32_select OF((uLong adler, const Bytef *buf, uInt len));
+   local uLong (*adler32_func) OF((uLong adler, const Bytef *buf, uInt len)) =
+        adler32_select;
+#endif /* Z_X86_SIMD || Z_ARM64_SIMD */
+
+local uLong adler32_generic OF((uLong adler, const Bytef *buf, uInt len));
+
 /* ========================================================================= */
 uLong ZEXPORT adler32(adler, buf, len)
     uLong adler;
     const Bytef *buf;
     uInt len;
+{
+#ifdef ADLER32_SIMD
+    if (len >= ADLER32_SIMD_MIN && buf != Z_NULL)
+        return adler32_func(adler, buf, len);
+#endif
+    return adler32_generic(adler, buf, len);
+}
+
+/* ========================================================================= */
+local uLong adler32_generic(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
 {
     unsigned long sum2;
     unsigned n;
@@ -132,6 +167,232 @@ uLong ZEXPORT adler32(adler, buf, len)
     return adler | (sum2 << 16);
 }
 
+#ifdef ADLER32_SIMD
+
+/* ========================================================================= */
+local uLong adler32_select(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    uLong (*func) OF((uLong adler, const Bytef *buf, uInt len));
+    unsigned features = zcpu_features();
+
+    func = adler32_generic;
+#ifdef Z_X86_SIMD
+    if (features & ZCPU_AVX2)
+        func = adler32_avx2;
+    else if (features & ZCPU_SSSE3)
+        func = adler32_ssse3;
+#else
+    if (features & ZCPU_NEON)
+        func = adler32_neon;
+#endif
+    adler32_func = func;
+    return func(adler, buf, len);
+}
+
+/*
+  For a block of n bytes b[0..n-1] entered with sums (s1, s2):
+
+      s1' = s1 + sum(b[i])
+      s2' = s2 + n * s1 + sum((n - i) * b[i])
+
+  The kernels keep the byte sums and the weighted sums in separate lanes,
+  and add n times the running s1 of every block at the start of the next
+  one (ps below), so that each group of blocks costs one modulo.  A group
+  never exceeds NMAX bytes, so no lane can overflow.
+ */
+#ifdef Z_X86_SIMD
+
+/* ========================================================================= */
+#define ADLER32_BLOCK 32
+
+Z_TARGET_SSSE3
+local uLong adler32_ssse3(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    unsigned blocks = len / ADLER32_BLOCK;
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                       24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                       8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    len -= blocks * ADLER32_BLOCK;
+    while (blocks) {
+        unsigned n = NMAX / ADLER32_BLOCK;
+        __m128i v_ps, v_s1, v_s2, b1, b2;
+
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+
+        v_ps = _mm_cvtsi32_si128((int)(s1 * n));
+        v_s1 = zero;
+        v_s2 = _mm_cvtsi32_si128((int)s2);
+        do {
+            b1 = _mm_loadu_si128((const __m128i *)buf);
+            b2 = _mm_loadu_si128((const __m128i *)(buf + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b1, zero));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b2, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                       _mm_madd_epi16(_mm_maddubs_epi16(b1, tap1), ones));
+            v_s2 = _mm_add_epi32(v_s2,
+                       _mm_madd_epi16(_mm_maddubs_epi16(b2, tap2), ones));
+            buf += ADLER32_BLOCK;
+        } while (--n);
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0x4e));
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0xb1));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0x4e));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0xb1));
+        s1 += (unsigned)_mm_cvtsi128_si32(v_s1);
+        s2 = (unsigned)_mm_cvtsi128_si32(v_s2);
+        MOD(s1);
+        MOD(s2);
+    }
+
+    adler = s1 | (s2 << 16);
+    if (len)
+        return adler32_generic(adler, buf, len);
+    return adler;
+}
+
+/* ========================================================================= */
+Z_TARGET_AVX2
+local uLong adler32_avx2(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    unsigned blocks = len / ADLER32_BLOCK;
+    const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                         24, 23, 22, 21, 20, 19, 18, 17,
+                                         16, 15, 14, 13, 12, 11, 10, 9,
+                                         8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    len -= blocks * ADLER32_BLOCK;
+    while (blocks) {
+        unsigned n = NMAX / ADLER32_BLOCK;
+        __m256i v_ps, v_s1, v_s2, b;
+        __m128i h1, h2;
+
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+
+        v_ps = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+        v_s1 = zero;
+        v_s2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+        do {
+            b = _mm256_loadu_si256((const __m256i *)buf);
+            v_ps = _mm256_add_epi32(v_ps, v_s1);
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(b, zero));
+            v_s2 = _mm256_add_epi32(v_s2,
+                       _mm256_madd_epi16(_mm256_maddubs_epi16(b, tap), ones));
+            buf += ADLER32_BLOCK;
+        } while (--n);
+        v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 5));
+
+        h1 = _mm_add_epi32(_mm256_castsi256_si128(v_s1),
+                           _mm256_extracti128_si256(v_s1, 1));
+        h2 = _mm_add_epi32(_mm256_castsi256_si128(v_s2),
+                           _mm256_extracti128_si256(v_s2, 1));
+        h1 = _mm_add_epi32(h1, _mm_shuffle_epi32(h1, 0x4e));
+        h1 = _mm_add_epi32(h1, _mm_shuffle_epi32(h1, 0xb1));
+        h2 = _mm_add_epi32(h2, _mm_shuffle_epi32(h2, 0x4e));
+        h2 = _mm_add_epi32(h2, _mm_shuffle_epi32(h2, 0xb1));
+        s1 += (unsigned)_mm_cvtsi128_si32(h1);
+        s2 = (unsigned)_mm_cvtsi128_si32(h2);
+        MOD(s1);
+        MOD(s2);
+    }
+
+    adler = s1 | (s2 << 16);
+    if (len)
+        return adler32_generic(adler, buf, len);
+    return adler;
+}
+
+#else /* Z_ARM64_SIMD */
+
+/* ========================================================================= */
+/* The per-column byte sums are kept in 16-bit lanes, which limits a group
+   to 256 blocks of 16 bytes. */
+#define ADLER32_BLOCK 16
+
+local uLong adler32_neon(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    static const uint16_t taps[16] = {
+        16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1
+    };
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    unsigned blocks = len / ADLER32_BLOCK;
+    uint16x8_t t0 = vld1q_u16(taps), t1 = vld1q_u16(taps + 8);
+
+    len -= blocks * ADLER32_BLOCK;
+    while (blocks) {
+        unsigned n = 256;
+        uint32x4_t v_ps, v_s1, v_s2;
+        uint16x8_t col_lo, col_hi;
+        uint8x16_t b;
+
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+
+        v_ps = vdupq_n_u32(0);
+        v_s1 = vdupq_n_u32(0);
+        col_lo = vdupq_n_u16(0);
+        col_hi = vdupq_n_u16(0);
+        s2 += s1 * n * ADLER32_BLOCK;
+        do {
+            b = vld1q_u8(buf);
+            v_ps = vaddq_u32(v_ps, v_s1);
+            v_s1 = vpadalq_u16(v_s1, vpaddlq_u8(b));
+            col_lo = vaddw_u8(col_lo, vget_low_u8(b));
+            col_hi = vaddw_u8(col_hi, vget_high_u8(b));
+            buf += ADLER32_BLOCK;
+        } while (--n);
+
+        v_s2 = vshlq_n_u32(v_ps, 4);
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(col_lo), vget_low_u16(t0));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(col_lo), vget_high_u16(t0));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(col_hi), vget_low_u16(t1));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(col_hi), vget_high_u16(t1));
+
+        s1 += vaddvq_u32(v_s1);
+        s2 += vaddvq_u32(v_s2);
+        MOD(s1);
+        MOD(s2);
+    }
+
+    adler = s1 | (s2 << 16);
+    if (len)
+        return adler32_generic(adler, buf, len);
+    return adler;
+}
+
+#endif /* Z_X86_SIMD */
+
+#endif /* ADLER32_SIMD */
+
 /* ========================================================================= */
 local uLong adler32_combine_(adler1, adler2, len2)
     uLong adler1;
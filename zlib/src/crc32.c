@@ -46,6 +46,29 @@
 #  define TBLS 1
 #endif /* BYFOUR */
 
+local unsigned long crc32_generic OF((unsigned long,
+                        const unsigned char FAR *, unsigned));
+
+/* Kernels for long buffers, picked once by crc32_select() from what the CPU
+   supports: PCLMULQDQ folding on x86, the CRC32 instructions on ARMv8.  They
+   hand the unaligned head and the short tail to crc32_generic(). */
+#if defined(Z_X86_SIMD) || defined(Z_ARM64_SIMD)
+#  define CRC32_SIMD
+#  ifdef Z_X86_SIMD
+#    include <immintrin.h>
+     local unsigned long crc32_pclmul OF((unsigned long,
+                        const unsigned char FAR *, unsigned));
+#  else
+#    include <arm_acle.h>
+     local unsigned long crc32_armv8 OF((unsigned long,
+                        const unsigned char FAR *, unsigned));
+#  endif
+   local unsigned long crc32_select OF((unsigned long,
+                        const unsigned char FAR *, unsigned));
+   local unsigned long (*crc32_func) OF((unsigned long,
+                        const unsigned char FAR *, unsigned)) = crc32_select;
+#endif /* Z_X86_SIMD || Z_ARM64_SIMD */
+
 /* Local functions for crc concatenation */
 local unsigned long gf2_matrix_times OF((unsigned long *mat,
                                          unsigned long vec));
@@ -213,6 +236,19 @@ unsigned long ZEXPORT crc32(crc, buf, len)
         make_crc_table();
 #endif /* DYNAMIC_CRC_TABLE */
 
+#ifdef CRC32_SIMD
+    return crc32_func(crc, buf, len);
+#else
+    return crc32_generic(crc, buf, len);
+#endif
+}
+
+/* ========================================================================= */
+local unsigned long crc32_generic(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    unsigned len;
+{
 #ifdef BYFOUR
     if (sizeof(void *) == sizeof(ptrdiff_t)) {
         z_crc_t endian;
@@ -321,6 +357,187 @@ local unsigned long crc32_big(crc, buf, len)
 
 #endif /* BYFOUR */
 
+#ifdef CRC32_SIMD
+
+/* ========================================================================= */
+local unsigned long crc32_select(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    unsigned len;
+{
+    unsigned long (*func) OF((unsigned long, const unsigned char FAR *,
+                              unsigned));
+    unsigned features = zcpu_features();
+
+    func = crc32_generic;
+#ifdef Z_X86_SIMD
+    if (features & ZCPU_PCLMUL)
+        func = crc32_pclmul;
+#else
+    if (features & ZCPU_ARMCRC)
+        func = crc32_armv8;
+#endif
+    crc32_func = func;
+    return func(crc, buf, len);
+}
+
+#ifdef Z_X86_SIMD
+
+/* ========================================================================= */
+/*
+  Carry-less multiplication folding, after Intel's "Fast CRC Computation for
+  Generic Polynomials Using PCLMULQDQ Instruction".  Four 128-bit lanes are
+  folded 64 bytes ahead at a time, then into one lane, then down to 64 bits,
+  and a Barrett reduction leaves the 32-bit CRC.  The constants are powers of
+  x modulo the bit-reflected CRC-32 polynomial: k1/k2 fold across 512 bits,
+  k3/k4 across 128, k5 across 64, and poly holds P(x) and floor(x^64 / P(x)).
+ */
+#define CRC32_FOLD_MIN 64
+
+Z_TARGET_PCLMUL
+local unsigned long crc32_pclmul(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    unsigned len;
+{
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8, mask;
+    unsigned blocks;
+    z_crc_t c;
+
+    if (len < CRC32_FOLD_MIN)
+        return crc32_generic(crc, buf, len);
+
+    c = (z_crc_t)crc ^ 0xffffffffUL;
+    blocks = len & ~15U;
+    len -= blocks;
+
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)c));
+    buf += 64;
+    blocks -= 64;
+
+    /* k1, k2 */
+    x0 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    while (blocks >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+        buf += 64;
+        blocks -= 64;
+    }
+
+    /* fold the four lanes into one: k3, k4 */
+    x0 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* remaining 16-byte blocks */
+    while (blocks) {
+        x2 = _mm_loadu_si128((const __m128i *)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        blocks -= 16;
+    }
+
+    /* 128 bits down to 64: k4, then k5 */
+    mask = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    x2 = _mm_and_si128(x1, mask);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, mask);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    c = (z_crc_t)_mm_extract_epi32(x1, 1) ^ 0xffffffffUL;
+    if (len)
+        return crc32_generic((unsigned long)c, buf, len);
+    return (unsigned long)c;
+}
+
+#else /* Z_ARM64_SIMD */
+
+/* ========================================================================= */
+Z_TARGET_ARMCRC
+local unsigned long crc32_armv8(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    unsigned len;
+{
+    uint32_t c = (uint32_t)crc ^ 0xffffffffU;
+    uint64_t w;
+
+    while (len && ((ptrdiff_t)buf & 7)) {
+        c = __crc32b(c, *buf++);
+        len--;
+    }
+    while (len >= 32) {
+        zmemcpy(&w, buf, 8);
+        c = __crc32d(c, w);
+        zmemcpy(&w, buf + 8, 8);
+        c = __crc32d(c, w);
+        zmemcpy(&w, buf + 16, 8);
+        c = __crc32d(c, w);
+        zmemcpy(&w, buf + 24, 8);
+        c = __crc32d(c, w);
+        buf += 32;
+        len -= 32;
+    }
+    while (len >= 8) {
+        zmemcpy(&w, buf, 8);
+        c = __crc32d(c, w);
+        buf += 8;
+        len -= 8;
+    }
+    while (len--)
+        c = __crc32b(c, *buf++);
+    return (unsigned long)(c ^ 0xffffffffU);
+}
+
+#endif /* Z_X86_SIMD */
+
+#endif /* CRC32_SIMD */
+
 #define GF2_DIM 32      /* dimension of GF(2) vectors (length of CRC) */
 
 /* ========================================================================= */
@@ -92,6 +92,18 @@ local int read_buf        OF((z_streamp strm, Bytef *buf, unsigned size));
 local uInt longest_match  OF((deflate_state *s, IPos cur_match));
 #endif
 
+/* longest_match() compares eight bytes at a time on 64-bit little-endian
+   targets, where unaligned loads are cheap. */
+#if !defined(ASMV) && !defined(UNALIGNED_OK) && !defined(FASTEST) && \
+    (defined(__x86_64__) || defined(_M_X64) || \
+     (defined(__aarch64__) && !defined(__ARM_BIG_ENDIAN)))
+#  define LONGEST_MATCH_WIDE
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+local uInt compare258 OF((const Bytef *scan, const Bytef *match));
+#endif
+
 #ifdef DEBUG
 local  void check_match OF((deflate_state *s, IPos start, IPos match,
                             int length));
@@ -166,6 +178,67 @@ struct static_tree_desc_s {int dummy;}; /* for buggy compilers */
  */
 #define UPDATE_HASH(s,h,c) (h = (((h)<<s->hash_shift) ^ (c)) & s->hash_mask)
 
+/* ===========================================================================
+ * Set ins_h to the hash of the string at str.  By default the rolling hash
+ * takes the last byte of the string, as in stock zlib.
+ *
+ * Compiled with -DDEFLATE_CRC_HASH on x86, the first four bytes of the
+ * string are hashed with the SSE4.2 CRC32 instruction when the CPU has it.
+ * That spreads the keys better and gives strings that only share three
+ * bytes separate chains, so the chains that longest_match() walks are
+ * shorter.  The compressed output then depends on the CPU and can be
+ * slightly larger, so this is off by default.  Reading str+3 is safe:
+ * there is always MIN_LOOKAHEAD or WIN_INIT slack after the data in the
+ * window.  The CRC32 instruction is issued with inline assembly so that
+ * the hash is inlined into the compression loops without compiling them
+ * for SSE4.2.
+ */
+#if defined(DEFLATE_CRC_HASH) && (!defined(Z_X86_SIMD) || defined(FASTEST))
+#  undef DEFLATE_CRC_HASH
+#endif
+#ifdef DEFLATE_CRC_HASH
+#  ifdef _MSC_VER
+#    include <nmmintrin.h>
+#    define CRC_HASH(s, str) \
+       (_mm_crc32_u32(0, zload32((s)->window + (str))) & (s)->hash_mask)
+#  else
+#    define CRC_HASH(s, str) (crc_hash_asm(zload32((s)->window + (str))) & \
+                              (s)->hash_mask)
+#  endif
+#  define HASH_STRING(s, str) \
+    ((s)->crc_hash ? ((s)->ins_h = CRC_HASH(s, str)) : \
+     UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]))
+#else
+#  define HASH_STRING(s, str) \
+    UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)])
+#endif
+
+#ifdef DEFLATE_CRC_HASH
+local unsigned zload32 OF((const Bytef *p));
+
+local unsigned zload32(p)
+    const Bytef *p;
+{
+    unsigned v;
+
+    zmemcpy(&v, p, sizeof(v));
+    return v;
+}
+#endif
+
+#if defined(DEFLATE_CRC_HASH) && !defined(_MSC_VER)
+local unsigned crc_hash_asm OF((unsigned v));
+
+local unsigned crc_hash_asm(v)
+    unsigned v;
+{
+    unsigned h = 0;
+
+    __asm__("crc32l %1, %0" : "+r"(h) : "rm"(v));
+    return h;
+}
+#endif
+
 
 /* ===========================================================================
  * Insert string str in the dictionary and set match_head to the previous head
@@ -179,12 +252,12 @@ struct static_tree_desc_s {int dummy;}; /* for buggy compilers */
  */
 #ifdef FASTEST
 #define INSERT_STRING(s, str, match_head) \
-   (UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]), \
+   (HASH_STRING(s, str), \
     match_head = s->head[s->ins_h], \
     s->head[s->ins_h] = (Pos)(str))
 #else
 #define INSERT_STRING(s, str, match_head) \
-   (UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]), \
+   (HASH_STRING(s, str), \
     match_head = s->prev[(str) & s->w_mask] = s->head[s->ins_h], \
     s->head[s->ins_h] = (Pos)(str))
 #endif
@@ -289,6 +362,11 @@ int ZEXPORT deflateInit2_(strm, level, method, windowBits, memLevel, strategy,
     s->hash_size = 1 << s->hash_bits;
     s->hash_mask = s->hash_size - 1;
     s->hash_shift =  ((s->hash_bits+MIN_MATCH-1)/MIN_MATCH);
+#ifdef DEFLATE_CRC_HASH
+    s->crc_hash = (zcpu_features() & ZCPU_SSE42) != 0;
+#else
+    s->crc_hash = 0;
+#endif
 
     s->window = (Bytef *) ZALLOC(strm, s->w_size, 2*sizeof(Byte));
     s->prev   = (Posf *)  ZALLOC(strm, s->w_size, sizeof(Pos));
@@ -365,7 +443,7 @@ int ZEXPORT deflateSetDictionary (strm, dictionary, dictLength)
         str = s->strstart;
         n = s->lookahead - (MIN_MATCH-1);
         do {
-            UPDATE_HASH(s, s->ins_h, s->window[str + MIN_MATCH-1]);
+            HASH_STRING(s, str);
 #ifndef FASTEST
             s->prev[str & s->w_mask] = s->head[s->ins_h];
 #endif
@@ -1130,6 +1208,39 @@ local void lm_init (s)
 }
 
 #ifndef FASTEST
+#ifdef LONGEST_MATCH_WIDE
+/* ===========================================================================
+ * Return the length of the common prefix of scan and match, at most
+ * MAX_MATCH. The first differing byte is the lowest set byte of the
+ * exclusive-or of two little-endian words.
+ */
+local uInt compare258(scan, match)
+    const Bytef *scan;
+    const Bytef *match;
+{
+    uInt len;
+    unsigned long long a, b;
+
+    for (len = 0; len < MAX_MATCH-2; len += 8) {
+        zmemcpy(&a, scan + len, sizeof(a));
+        zmemcpy(&b, match + len, sizeof(b));
+        if ((a ^= b) != 0) {
+#ifdef _MSC_VER
+            unsigned long bit;
+
+            _BitScanForward64(&bit, a);
+            return len + (uInt)(bit >> 3);
+#else
+            return len + (uInt)(__builtin_ctzll(a) >> 3);
+#endif
+        }
+    }
+    if (scan[len] != match[len]) return len;
+    len++;
+    return scan[len] == match[len] ? len + 1 : len;
+}
+#endif /* LONGEST_MATCH_WIDE */
+
 /* ===========================================================================
  * Set match_start to the longest match starting at the given string and
  * return its length. Matches shorter or equal to prev_length are discarded,
@@ -1161,7 +1272,17 @@ local uInt longest_match(s, cur_match)
     Posf *prev = s->prev;
     uInt wmask = s->w_mask;
 
-#ifdef UNALIGNED_OK
+#if defined(LONGEST_MATCH_WIDE)
+    /* Candidates are screened on their first two bytes and on the two
+     * bytes that would extend the best match, then measured from the start
+     * by compare258(), since with crc_hash equal hash keys say nothing
+     * about scan[2].
+     */
+    ush scan_start, scan_end, match_start, match_end;
+
+    zmemcpy(&scan_start, scan, sizeof(scan_start));
+    zmemcpy(&scan_end, scan + best_len - 1, sizeof(scan_end));
+#elif defined(UNALIGNED_OK)
     /* Compare two bytes at a time. Note: this is not always beneficial.
      * Try with and without -DUNALIGNED_OK to check.
      */
@@ -1202,7 +1323,16 @@ local uInt longest_match(s, cur_match)
          * However the length of the match is limited to the lookahead, so
          * the output of deflate is not affected by the uninitialized values.
          */
-#if (defined(UNALIGNED_OK) && MAX_MATCH == 258)
+#if defined(LONGEST_MATCH_WIDE)
+        zmemcpy(&match_end, match + best_len - 1, sizeof(match_end));
+        zmemcpy(&match_start, match, sizeof(match_start));
+        if (match_end != scan_end || match_start != scan_start) continue;
+
+        len = (int)compare258(scan, match);
+        Assert(scan + len <= s->window+(unsigned)(s->window_size-1),
+               "wild scan");
+
+#elif (defined(UNALIGNED_OK) && MAX_MATCH == 258)
         /* This code assumes sizeof(unsigned short) == 2. Do not use
          * UNALIGNED_OK if your compiler uses a different size.
          */
@@ -1272,7 +1402,9 @@ local uInt longest_match(s, cur_match)
             s->match_start = cur_match;
             best_len = len;
             if (len >= nice_match) break;
-#ifdef UNALIGNED_OK
+#if defined(LONGEST_MATCH_WIDE)
+            zmemcpy(&scan_end, scan + best_len - 1, sizeof(scan_end));
+#elif defined(UNALIGNED_OK)
             scan_end = *(ushf*)(scan+best_len-1);
 #else
             scan_end1  = scan[best_len-1];
@@ -1474,7 +1606,7 @@ local void fill_window(s)
             Call UPDATE_HASH() MIN_MATCH-3 more times
 #endif
             while (s->insert) {
-                UPDATE_HASH(s, s->ins_h, s->window[str + MIN_MATCH-1]);
+                HASH_STRING(s, str);
 #ifndef FASTEST
                 s->prev[str & s->w_mask] = s->head[s->ins_h];
 #endif
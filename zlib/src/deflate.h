@@ -148,6 +148,12 @@ typedef struct internal_state {
      *   hash_shift * MIN_MATCH >= hash_bits
      */
 
+    int crc_hash;
+    /* Nonzero if strings are hashed with the SSE4.2 CRC32 instruction over
+     * their first four bytes instead of the rolling hash. ins_h then only
+     * holds the hash of the last string inserted.
+     */
+
     long block_start;
     /* Window position at the beginning of the current output block. Gets
      * negative when the window is moved backwards.
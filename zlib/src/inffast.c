@@ -10,6 +10,290 @@
 
 #ifndef ASMINF
 
+#ifdef INFLATE_CHUNK
+
+/*
+   Chunked version of inflate_fast() for 64-bit little-endian targets.  It
+   decodes the same way as the byte-wise version below, with two changes:
+
+    - The bit buffer is 64 bits wide and is topped up once per code, at the
+      top of the loop, by loading the next eight input bytes and keeping as
+      many whole bytes as fit.  That leaves at least 56 bits, more than the
+      48 a length/distance pair can use, so there are no other refills.
+      Bits above the count are either zero or the input that follows, so
+      reloading them is harmless.
+
+    - Matches are copied with memcpy()s of 16 or 8 bytes, or stores of an
+      8-byte pattern for distances under 8, that may write up to
+      INFLATE_CHUNK_SIZE - 1 bytes past the match.  inflate() leaves room
+      for this by requiring INFLATE_FAST_MIN_OUTPUT bytes of output space.
+      Bytes coming from the sliding window are copied exactly, so the window
+      needs no padding.
+
+   Entry assumptions are those of the byte-wise version, with
+   strm->avail_in >= INFLATE_FAST_MIN_INPUT and
+   strm->avail_out >= INFLATE_FAST_MIN_OUTPUT.
+ */
+
+local unsigned long long load64 OF((const unsigned char FAR *p));
+local unsigned char FAR *chunk_copy OF((unsigned char FAR *out,
+                                        unsigned dist, unsigned len));
+
+local unsigned long long load64(p)
+const unsigned char FAR *p;
+{
+    unsigned long long v;
+
+    zmemcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Copy len bytes from dist bytes back in the output to out and return
+   out + len.  Every load reads bytes that are already written: pieces are
+   no longer than the distance, and distances under 8 repeat a pattern
+   built from the first dist bytes at a stride that is a multiple of dist. */
+local unsigned char FAR *chunk_copy(out, dist, len)
+unsigned char FAR *out;
+unsigned dist;
+unsigned len;
+{
+    unsigned char FAR *from = out - dist;
+    unsigned char FAR *stop = out + len;
+    unsigned char pat[8];
+    unsigned n;
+
+    if (dist >= 16) {
+        do {
+            zmemcpy(out, from, 16);
+            out += 16;
+            from += 16;
+        } while (out < stop);
+    }
+    else if (dist >= 8) {
+        do {
+            zmemcpy(out, from, 8);
+            out += 8;
+            from += 8;
+        } while (out < stop);
+    }
+    else {
+        for (n = 0; n < 8; n++)
+            pat[n] = from[n % dist];
+        n = 8 - 8 % dist;
+        do {
+            zmemcpy(out, pat, 8);
+            out += n;
+        } while (out < stop);
+    }
+    return stop;
+}
+
+void ZLIB_INTERNAL inflate_fast(strm, start)
+z_streamp strm;
+unsigned start;         /* inflate()'s starting value for strm->avail_out */
+{
+    struct inflate_state FAR *state;
+    unsigned char FAR *in;      /* local strm->next_in */
+    unsigned char FAR *last;    /* while in < last, enough input available */
+    unsigned char FAR *out;     /* local strm->next_out */
+    unsigned char FAR *beg;     /* inflate()'s initial strm->next_out */
+    unsigned char FAR *end;     /* while out < end, enough space available */
+#ifdef INFLATE_STRICT
+    unsigned dmax;              /* maximum distance from zlib header */
+#endif
+    unsigned wsize;             /* window size or zero if not using window */
+    unsigned whave;             /* valid bytes in the window */
+    unsigned wnext;             /* window write index */
+    unsigned char FAR *window;  /* allocated sliding window, if wsize != 0 */
+    unsigned long long hold;    /* local strm->hold */
+    unsigned bits;              /* local strm->bits */
+    code const FAR *lcode;      /* local strm->lencode */
+    code const FAR *dcode;      /* local strm->distcode */
+    unsigned lmask;             /* mask for first level of length codes */
+    unsigned dmask;             /* mask for first level of distance codes */
+    code here;                  /* retrieved table entry */
+    unsigned op;                /* code bits, operation, extra bits, or */
+                                /*  window position, window bytes to copy */
+    unsigned len;               /* match length, unused bytes */
+    unsigned dist;              /* match distance */
+    unsigned char FAR *from;    /* where to copy match from */
+
+    /* copy state to local variables */
+    state = (struct inflate_state FAR *)strm->state;
+    in = strm->next_in;
+    last = in + (strm->avail_in - INFLATE_FAST_MIN_INPUT);
+    out = strm->next_out;
+    beg = out - (start - strm->avail_out);
+    end = out + (strm->avail_out - (INFLATE_FAST_MIN_OUTPUT - 1));
+#ifdef INFLATE_STRICT
+    dmax = state->dmax;
+#endif
+    wsize = state->wsize;
+    whave = state->whave;
+    wnext = state->wnext;
+    window = state->window;
+    hold = state->hold;
+    bits = state->bits;
+    lcode = state->lencode;
+    dcode = state->distcode;
+    lmask = (1U << state->lenbits) - 1;
+    dmask = (1U << state->distbits) - 1;
+
+    /* decode literals and length/distances until end-of-block or not enough
+       input data or output space */
+    do {
+        hold |= load64(in) << bits;
+        in += (63 - bits) >> 3;
+        bits |= 56;
+        here = lcode[hold & lmask];
+      dolen:
+        op = (unsigned)(here.bits);
+        hold >>= op;
+        bits -= op;
+        op = (unsigned)(here.op);
+        if (op == 0) {                          /* literal */
+            Tracevv((stderr, here.val >= 0x20 && here.val < 0x7f ?
+                    "inflate:         literal '%c'\n" :
+                    "inflate:         literal 0x%02x\n", here.val));
+            *out++ = (unsigned char)(here.val);
+        }
+        else if (op & 16) {                     /* length base */
+            len = (unsigned)(here.val);
+            op &= 15;                           /* number of extra bits */
+            if (op) {
+                len += (unsigned)hold & ((1U << op) - 1);
+                hold >>= op;
+                bits -= op;
+            }
+            Tracevv((stderr, "inflate:         length %u\n", len));
+            here = dcode[hold & dmask];
+          dodist:
+            op = (unsigned)(here.bits);
+            hold >>= op;
+            bits -= op;
+            op = (unsigned)(here.op);
+            if (op & 16) {                      /* distance base */
+                dist = (unsigned)(here.val);
+                op &= 15;                       /* number of extra bits */
+                dist += (unsigned)hold & ((1U << op) - 1);
+#ifdef INFLATE_STRICT
+                if (dist > dmax) {
+                    strm->msg = (char *)"invalid distance too far back";
+                    state->mode = BAD;
+                    break;
+                }
+#endif
+                hold >>= op;
+                bits -= op;
+                Tracevv((stderr, "inflate:         distance %u\n", dist));
+                op = (unsigned)(out - beg);     /* max distance in output */
+                if (dist > op) {                /* see if copy from window */
+                    op = dist - op;             /* distance back in window */
+                    if (op > whave) {
+                        if (state->sane) {
+                            strm->msg =
+                                (char *)"invalid distance too far back";
+                            state->mode = BAD;
+                            break;
+                        }
+#ifdef INFLATE_ALLOW_INVALID_DISTANCE_TOOFAR_ARRR
+                        if (len <= op - whave) {
+                            do {
+                                *out++ = 0;
+                            } while (--len);
+                            continue;
+                        }
+                        len -= op - whave;
+                        do {
+                            *out++ = 0;
+                        } while (--op > whave);
+                        if (op == 0) {
+                            out = chunk_copy(out, dist, len);
+                            continue;
+                        }
+#endif
+                    }
+                    from = window;
+                    if (wnext == 0) {           /* very common case */
+                        from += wsize - op;
+                    }
+                    else if (wnext < op) {      /* wrap around window */
+                        from += wsize + wnext - op;
+                        op -= wnext;
+                        if (op < len) {         /* some from end of window */
+                            len -= op;
+                            zmemcpy(out, from, op);
+                            out += op;
+                            from = window;      /* then from its start */
+                            op = wnext;
+                        }
+                    }
+                    else {                      /* contiguous in window */
+                        from += wnext - op;
+                    }
+                    if (op < len) {             /* some from window */
+                        len -= op;
+                        zmemcpy(out, from, op);
+                        out += op;
+                        out = chunk_copy(out, dist, len); /* rest from output */
+                    }
+                    else {
+                        zmemcpy(out, from, len);
+                        out += len;
+                    }
+                }
+                else {
+                    out = chunk_copy(out, dist, len);   /* direct from output */
+                }
+            }
+            else if ((op & 64) == 0) {          /* 2nd level distance code */
+                here = dcode[here.val + (hold & ((1U << op) - 1))];
+                goto dodist;
+            }
+            else {
+                strm->msg = (char *)"invalid distance code";
+                state->mode = BAD;
+                break;
+            }
+        }
+        else if ((op & 64) == 0) {              /* 2nd level length code */
+            here = lcode[here.val + (hold & ((1U << op) - 1))];
+            goto dolen;
+        }
+        else if (op & 32) {                     /* end-of-block */
+            Tracevv((stderr, "inflate:         end of block\n"));
+            state->mode = TYPE;
+            break;
+        }
+        else {
+            strm->msg = (char *)"invalid literal/length code";
+            state->mode = BAD;
+            break;
+        }
+    } while (in < last && out < end);
+
+    /* return unused bytes: whole bytes in hold were read ahead */
+    len = bits >> 3;
+    in -= len;
+    bits -= len << 3;
+    hold &= (1ULL << bits) - 1;
+
+    /* update state and return */
+    strm->next_in = in;
+    strm->next_out = out;
+    strm->avail_in = (unsigned)(in < last ?
+        (INFLATE_FAST_MIN_INPUT + (last - in)) :
+        (INFLATE_FAST_MIN_INPUT - (in - last)));
+    strm->avail_out = (unsigned)(out < end ?
+        (INFLATE_FAST_MIN_OUTPUT - 1) + (end - out) :
+        (INFLATE_FAST_MIN_OUTPUT - 1) - (out - end));
+    state->hold = (unsigned long)hold;
+    state->bits = bits;
+    return;
+}
+
+#else /* !INFLATE_CHUNK */
+
 /* Allow machine dependent optimization for post-increment or pre-increment.
    Based on testing to date,
    Pre-increment preferred for:
@@ -337,4 +621,6 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
    - Moving len -= 3 statement into middle of loop
  */
 
+#endif /* INFLATE_CHUNK */
+
 #endif /* !ASMINF */
@@ -9,3 +9,21 @@
  */
 
 void ZLIB_INTERNAL inflate_fast OF((z_streamp strm, unsigned start));
+
+/* inflate() hands over to inflate_fast() when at least this much input and
+   output space are available.  On 64-bit little-endian targets the chunked
+   inflate_fast() refills its bit buffer eight input bytes at a time and
+   copies matches in 8- and 16-byte pieces that can run up to
+   INFLATE_CHUNK_SIZE - 1 bytes past the end of the match, so it needs more
+   of both.  Define INFLATE_NO_CHUNK to use the byte-wise version. */
+#if !defined(ASMINF) && !defined(INFLATE_NO_CHUNK) && \
+    (defined(__x86_64__) || defined(_M_X64) || \
+     (defined(__aarch64__) && !defined(__ARM_BIG_ENDIAN)))
+#  define INFLATE_CHUNK
+#  define INFLATE_CHUNK_SIZE 16
+#  define INFLATE_FAST_MIN_INPUT 8
+#  define INFLATE_FAST_MIN_OUTPUT (258 + INFLATE_CHUNK_SIZE)
+#else
+#  define INFLATE_FAST_MIN_INPUT 6
+#  define INFLATE_FAST_MIN_OUTPUT 258
+#endif
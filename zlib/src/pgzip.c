@@ -0,0 +1,381 @@
+/* pgzip.c -- parallel gzip compression of a memory buffer
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ *
+ * The input is cut into chunks that are deflated independently on a set of
+ * threads, each one primed with the 32K of input before it, in the manner of
+ * Mark Adler's pigz.  Every chunk but the last ends with a sync flush, so the
+ * raw deflate streams line up on byte boundaries and their concatenation,
+ * between a gzip header and a trailer built with crc32_combine(), is one
+ * ordinary gzip stream.  The dictionary keeps the loss in compression
+ * against a serial deflate() to the few matches that would have crossed a
+ * chunk boundary from further back.
+ */
+
+/* @(#) $Id$ */
+
+#include "zutil.h"
+
+#ifndef Z_SOLO
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+#define PGZ_CHUNK   131072U     /* input bytes per job */
+#define PGZ_DICT    32768U      /* history given to each job */
+#define PGZ_AHEAD   2           /* jobs buffered per thread */
+#define PGZ_THREADS 64          /* most threads used by one call */
+#define PGZ_SLACK   16          /* deflateBound() margin for the sync flush */
+
+typedef struct pgz_job_s {
+    const Bytef *in;            /* chunk of the source */
+    uInt len;                   /* its length */
+    Bytef *out;                 /* its raw deflate data */
+    uLong out_len;
+    uLong crc;                  /* its CRC-32 */
+    int done;                   /* out, out_len and crc are set */
+} pgz_job;
+
+typedef struct pgz_state_s {
+    const Bytef *source;
+    int level;
+    pgz_job *jobs;
+    unsigned njobs;
+    unsigned next;              /* next job to hand out */
+    unsigned written;           /* jobs already copied to the output */
+    unsigned ahead;             /* most jobs handed out but not written */
+    int err;                    /* first error, or Z_OK */
+#ifdef _WIN32
+    SRWLOCK lock;
+    CONDITION_VARIABLE cond;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+} pgz_state;
+
+#ifdef _WIN32
+#  define PGZ_LOCK(g)       AcquireSRWLockExclusive(&(g)->lock)
+#  define PGZ_UNLOCK(g)     ReleaseSRWLockExclusive(&(g)->lock)
+#  define PGZ_WAIT(g)       SleepConditionVariableSRW(&(g)->cond, &(g)->lock, \
+                                                      INFINITE, 0)
+#  define PGZ_BROADCAST(g)  WakeAllConditionVariable(&(g)->cond)
+#else
+#  define PGZ_LOCK(g)       pthread_mutex_lock(&(g)->lock)
+#  define PGZ_UNLOCK(g)     pthread_mutex_unlock(&(g)->lock)
+#  define PGZ_WAIT(g)       pthread_cond_wait(&(g)->cond, &(g)->lock)
+#  define PGZ_BROADCAST(g)  pthread_cond_broadcast(&(g)->cond)
+#endif
+
+local int pgz_deflate OF((pgz_state *g, z_stream *strm, pgz_job *job));
+local void pgz_work OF((pgz_state *g));
+local unsigned pgz_cpus OF((void));
+
+/* ===========================================================================
+ * Deflate one job into a buffer of its own.  strm is a raw deflate stream
+ * kept by the calling thread from job to job.
+ */
+local int pgz_deflate(g, strm, job)
+    pgz_state *g;
+    z_stream *strm;
+    pgz_job *job;
+{
+    uLong bound;
+    uInt dict;
+    int last = job == g->jobs + g->njobs - 1;
+    int ret;
+
+    ret = deflateReset(strm);
+    if (ret != Z_OK)
+        return ret;
+    if (job->in != g->source) {
+        dict = (uInt)(job->in - g->source);
+        if (dict > PGZ_DICT)
+            dict = PGZ_DICT;
+        ret = deflateSetDictionary(strm, job->in - dict, dict);
+        if (ret != Z_OK)
+            return ret;
+    }
+
+    bound = deflateBound(strm, job->len) + PGZ_SLACK;
+    job->out = (Bytef *)malloc(bound);
+    if (job->out == Z_NULL)
+        return Z_MEM_ERROR;
+
+    strm->next_in = (Bytef *)job->in;
+    strm->avail_in = job->len;
+    strm->next_out = job->out;
+    strm->avail_out = (uInt)bound;
+    ret = deflate(strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if (ret != (last ? Z_STREAM_END : Z_OK) || strm->avail_in != 0)
+        return ret == Z_OK || ret == Z_STREAM_END ? Z_BUF_ERROR : ret;
+
+    job->out_len = bound - strm->avail_out;
+    job->crc = crc32(0L, job->in, job->len);
+    return Z_OK;
+}
+
+/* ===========================================================================
+ * Worker loop: take the next job as long as no more than g->ahead jobs wait
+ * to be written, and publish it when done.  Stops at the last job or at the
+ * first error.
+ */
+local void pgz_work(g)
+    pgz_state *g;
+{
+    z_stream strm;
+    pgz_job *job;
+    int ready, ret;
+
+    strm.zalloc = (alloc_func)0;
+    strm.zfree = (free_func)0;
+    strm.opaque = (voidpf)0;
+    ret = deflateInit2(&strm, g->level, Z_DEFLATED, -MAX_WBITS, DEF_MEM_LEVEL,
+                       Z_DEFAULT_STRATEGY);
+    ready = ret == Z_OK;
+
+    PGZ_LOCK(g);
+    if (ret != Z_OK && g->err == Z_OK) {
+        g->err = ret;
+        PGZ_BROADCAST(g);
+    }
+    for (;;) {
+        while (g->err == Z_OK && g->next < g->njobs &&
+               g->next - g->written >= g->ahead)
+            PGZ_WAIT(g);
+        if (g->err != Z_OK || g->next >= g->njobs)
+            break;
+        job = g->jobs + g->next++;
+        PGZ_UNLOCK(g);
+
+        ret = pgz_deflate(g, &strm, job);
+
+        PGZ_LOCK(g);
+        if (ret != Z_OK && g->err == Z_OK)
+            g->err = ret;
+        job->done = 1;
+        PGZ_BROADCAST(g);
+    }
+    PGZ_UNLOCK(g);
+
+    if (ready)
+        deflateEnd(&strm);
+}
+
+#ifdef _WIN32
+local DWORD WINAPI pgz_thread(void *arg)
+{
+    pgz_work((pgz_state *)arg);
+    return 0;
+}
+#else
+local void *pgz_thread(void *arg)
+{
+    pgz_work((pgz_state *)arg);
+    return NULL;
+}
+#endif
+
+local unsigned pgz_cpus()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return (unsigned)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? (unsigned)n : 1;
+#endif
+}
+
+/* ========================================================================= */
+int ZEXPORT gzipParallel(dest, destLen, source, sourceLen, level, threads)
+    Bytef *dest;
+    uLongf *destLen;
+    const Bytef *source;
+    uLong sourceLen;
+    int level;
+    int threads;
+{
+#ifdef _WIN32
+    HANDLE tids[PGZ_THREADS];
+#else
+    pthread_t tids[PGZ_THREADS];
+#endif
+    pgz_state g;
+    pgz_job *job;
+    unsigned nthreads, started, i;
+    uLong have, crc;
+    uLongf size = *destLen;
+
+    if (level == Z_DEFAULT_COMPRESSION)
+        level = 6;
+    if (level < 0 || level > 9)
+        return Z_STREAM_ERROR;
+    if (size < 18)
+        return Z_BUF_ERROR;
+
+    g.source = source;
+    g.level = level;
+    g.njobs = sourceLen ? (unsigned)((sourceLen - 1) / PGZ_CHUNK + 1) : 1;
+    g.jobs = (pgz_job *)calloc(g.njobs, sizeof(pgz_job));
+    if (g.jobs == Z_NULL)
+        return Z_MEM_ERROR;
+    for (i = 0; i < g.njobs; i++) {
+        g.jobs[i].in = source + (uLong)i * PGZ_CHUNK;
+        g.jobs[i].len = i + 1 < g.njobs ? PGZ_CHUNK :
+                        (uInt)(sourceLen - (uLong)i * PGZ_CHUNK);
+    }
+    g.next = g.written = 0;
+    g.err = Z_OK;
+
+    nthreads = threads > 0 ? (unsigned)threads : pgz_cpus();
+    if (nthreads > g.njobs)
+        nthreads = g.njobs;
+    if (nthreads > PGZ_THREADS)
+        nthreads = PGZ_THREADS;
+    g.ahead = nthreads * PGZ_AHEAD;
+
+    /* with one thread, do the work here and write as we go */
+    started = 0;
+    if (nthreads > 1) {
+#ifdef _WIN32
+        InitializeSRWLock(&g.lock);
+        InitializeConditionVariable(&g.cond);
+        for (; started < nthreads; started++) {
+            tids[started] = CreateThread(NULL, 0, pgz_thread, &g, 0, NULL);
+            if (tids[started] == NULL)
+                break;
+        }
+#else
+        pthread_mutex_init(&g.lock, NULL);
+        pthread_cond_init(&g.cond, NULL);
+        for (; started < nthreads; started++)
+            if (pthread_create(&tids[started], NULL, pgz_thread, &g) != 0)
+                break;
+#endif
+    }
+
+    /* gzip header: no name, no time, OS_CODE */
+    dest[0] = 0x1f;
+    dest[1] = 0x8b;
+    dest[2] = Z_DEFLATED;
+    dest[3] = dest[4] = dest[5] = dest[6] = dest[7] = 0;
+    dest[8] = level == 9 ? 2 : level == 1 ? 4 : 0;
+    dest[9] = OS_CODE;
+    have = 10;
+    crc = crc32(0L, Z_NULL, 0);
+
+    /* copy the jobs out in order */
+    if (started) {
+        PGZ_LOCK(&g);
+        for (i = 0; i < g.njobs; i++) {
+            job = g.jobs + i;
+            while (!job->done && g.err == Z_OK)
+                PGZ_WAIT(&g);
+            if (g.err != Z_OK)
+                break;
+            PGZ_UNLOCK(&g);
+
+            if (job->out_len > size - 8 - have) {
+                PGZ_LOCK(&g);
+                g.err = Z_BUF_ERROR;
+                break;
+            }
+            zmemcpy(dest + have, job->out, (uInt)job->out_len);
+            have += job->out_len;
+            crc = crc32_combine(crc, job->crc, job->len);
+            free(job->out);
+            job->out = Z_NULL;
+
+            PGZ_LOCK(&g);
+            g.written++;
+            PGZ_BROADCAST(&g);
+        }
+        PGZ_BROADCAST(&g);
+        PGZ_UNLOCK(&g);
+
+        for (i = 0; i < started; i++) {
+#ifdef _WIN32
+            WaitForSingleObject(tids[i], INFINITE);
+            CloseHandle(tids[i]);
+#else
+            pthread_join(tids[i], NULL);
+#endif
+        }
+    }
+    else {
+        z_stream strm;
+
+        strm.zalloc = (alloc_func)0;
+        strm.zfree = (free_func)0;
+        strm.opaque = (voidpf)0;
+        g.err = deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS,
+                             DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+        if (g.err != Z_OK) {
+            free(g.jobs);
+            return g.err;
+        }
+        for (i = 0; i < g.njobs; i++) {
+            job = g.jobs + i;
+            g.err = pgz_deflate(&g, &strm, job);
+            if (g.err != Z_OK)
+                break;
+            if (job->out_len > size - 8 - have) {
+                g.err = Z_BUF_ERROR;
+                break;
+            }
+            zmemcpy(dest + have, job->out, (uInt)job->out_len);
+            have += job->out_len;
+            crc = crc32_combine(crc, job->crc, job->len);
+            free(job->out);
+            job->out = Z_NULL;
+        }
+        deflateEnd(&strm);
+    }
+
+    if (nthreads > 1) {
+#ifndef _WIN32
+        pthread_cond_destroy(&g.cond);
+        pthread_mutex_destroy(&g.lock);
+#endif
+    }
+    for (i = 0; i < g.njobs; i++)
+        if (g.jobs[i].out != Z_NULL)
+            free(g.jobs[i].out);
+    free(g.jobs);
+    if (g.err != Z_OK)
+        return g.err;
+
+    /* gzip trailer: CRC-32 and length modulo 2^32, little-endian */
+    dest[have++] = (Bytef)(crc & 0xff);
+    dest[have++] = (Bytef)((crc >> 8) & 0xff);
+    dest[have++] = (Bytef)((crc >> 16) & 0xff);
+    dest[have++] = (Bytef)((crc >> 24) & 0xff);
+    dest[have++] = (Bytef)(sourceLen & 0xff);
+    dest[have++] = (Bytef)((sourceLen >> 8) & 0xff);
+    dest[have++] = (Bytef)((sourceLen >> 16) & 0xff);
+    dest[have++] = (Bytef)((sourceLen >> 24) & 0xff);
+    *destLen = have;
+    return Z_OK;
+}
+
+/* ===========================================================================
+ * Per job: the raw deflate bound of deflateBound() plus the sync flush
+ * margin, plus the gzip header and trailer.
+ */
+uLong ZEXPORT gzipParallelBound(sourceLen)
+    uLong sourceLen;
+{
+    uLong njobs = sourceLen ? (sourceLen - 1) / PGZ_CHUNK + 1 : 1;
+
+    return sourceLen + (sourceLen >> 12) + (sourceLen >> 14) +
+           (sourceLen >> 25) + njobs * (7 + PGZ_SLACK) + 18;
+}
+
+#endif /* !Z_SOLO */
@@ -71,6 +71,8 @@
 #    define gzgets                z_gzgets
 #    define gzoffset              z_gzoffset
 #    define gzoffset64            z_gzoffset64
+#    define gzipParallel          z_gzipParallel
+#    define gzipParallelBound     z_gzipParallelBound
 #    define gzopen                z_gzopen
 #    define gzopen64              z_gzopen64
 #    ifdef _WIN32
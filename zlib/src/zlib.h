@@ -1177,6 +1177,32 @@ ZEXTERN uLong ZEXPORT compressBound OF((uLong sourceLen));
    compress() or compress2() call to allocate the destination buffer.
 */
 
+ZEXTERN int ZEXPORT gzipParallel OF((Bytef *dest,   uLongf *destLen,
+                                     const Bytef *source, uLong sourceLen,
+                                     int level, int threads));
+/*
+     Compresses the source buffer into a single gzip stream in the
+   destination buffer, deflating 128K chunks of it on up to threads threads
+   at once, or on as many threads as there are processors if threads is zero
+   or less.  Each chunk is deflated with the 32K of input before it as a
+   preset dictionary, so the result is a few bytes per chunk larger than what
+   compress2() would give at the same level.  The level parameter has the
+   same meaning as in deflateInit.  Upon entry, destLen is the total size of
+   the destination buffer, which must be at least the value returned by
+   gzipParallelBound(sourceLen).  Upon exit, destLen is the actual size of
+   the gzip stream, which has no file name or modification time.
+
+     gzipParallel returns Z_OK if success, Z_MEM_ERROR if there was not
+   enough memory, Z_BUF_ERROR if there was not enough room in the output
+   buffer, Z_STREAM_ERROR if the level parameter is invalid.
+*/
+
+ZEXTERN uLong ZEXPORT gzipParallelBound OF((uLong sourceLen));
+/*
+     gzipParallelBound() returns an upper bound on the size of the gzip
+   stream written by gzipParallel() for sourceLen bytes.
+*/
+
 ZEXTERN int ZEXPORT uncompress OF((Bytef *dest,   uLongf *destLen,
                                    const Bytef *source, uLong sourceLen));
 /*
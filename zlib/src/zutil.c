@@ -9,6 +9,19 @@
 #ifndef Z_SOLO
 #  include "gzguts.h"
 #endif
+#ifdef Z_X86_SIMD
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+#endif
+#if defined(Z_ARM64_SIMD) && defined(__linux__)
+#  include <sys/auxv.h>
+#  ifndef HWCAP_CRC32
+#    define HWCAP_CRC32 (1 << 7)
+#  endif
+#endif
 
 #ifndef NO_DUMMY_DECL
 struct internal_state      {int dummy;}; /* for buggy compilers */
@@ -139,6 +152,88 @@ const char * ZEXPORT zError(err)
     return ERR_MSG(err);
 }
 
+/* ========================================================================= */
+#if defined(Z_X86_SIMD) && defined(_MSC_VER)
+#  define zxgetbv() ((unsigned)_xgetbv(0))
+#elif defined(Z_X86_SIMD)
+local unsigned zxgetbv OF((void));
+
+local unsigned zxgetbv()
+{
+    unsigned int eax, edx;
+
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+}
+#endif
+
+local unsigned zcpu_probe OF((void));
+
+local unsigned zcpu_probe()
+{
+    unsigned features = 0;
+#if defined(Z_X86_SIMD)
+    unsigned int eax, ebx, ecx, edx;
+#  ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 0);
+    eax = (unsigned)info[0];
+    if (eax < 1)
+        return 0;
+    __cpuid(info, 1);
+    ecx = (unsigned)info[2];
+#  else
+    if (__get_cpuid_max(0, 0) < 1 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    eax = __get_cpuid_max(0, 0);
+#  endif
+    if (ecx & (1 << 9))
+        features |= ZCPU_SSSE3;
+    if (ecx & (1 << 20))
+        features |= ZCPU_SSE42;
+    if ((ecx & (1 << 1)) && (ecx & (1 << 19)))
+        features |= ZCPU_PCLMUL;
+
+    /* AVX2 also needs the OS to save the ymm registers */
+    if ((ecx & (1 << 27)) && (ecx & (1 << 28)) && eax >= 7 &&
+        (zxgetbv() & 6) == 6) {
+#  ifdef _MSC_VER
+        __cpuidex(info, 7, 0);
+        ebx = (unsigned)info[1];
+#  else
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+#  endif
+        if (ebx & (1 << 5))
+            features |= ZCPU_AVX2;
+    }
+#elif defined(Z_ARM64_SIMD)
+    features |= ZCPU_NEON;
+#  ifdef __linux__
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+        features |= ZCPU_ARMCRC;
+#  else
+    /* every 64-bit Apple CPU has the CRC32 extension */
+    features |= ZCPU_ARMCRC;
+#  endif
+#endif
+    return features;
+}
+
+unsigned ZLIB_INTERNAL zcpu_features()
+{
+    /* the top bit marks the probe as done; racing first calls store the
+       same value */
+    static volatile unsigned features = 0;
+    unsigned f = features;
+
+    if (f == 0) {
+        f = zcpu_probe() | 0x80000000U;
+        features = f;
+    }
+    return f & 0x7fffffffU;
+}
+
 #if defined(_WIN32_WCE)
     /* The Microsoft C Run-Time Library for Windows CE doesn't have
      * errno.  We define it as a global variable to simplify porting.
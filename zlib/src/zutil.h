@@ -249,4 +249,46 @@ extern const char * const z_errmsg[10]; /* indexed by 2-zlib_error */
 #define ZSWAP32(q) ((((q) >> 24) & 0xff) + (((q) >> 8) & 0xff00) + \
                     (((q) & 0xff00) << 8) + (((q) & 0xff) << 24))
 
+/* SIMD kernels for the checksums.  They are compiled with per-function
+   target attributes, so the rest of the library keeps the baseline
+   instruction set, and are only called after zcpu_features() has seen the
+   matching CPU support.  Define NO_SIMD to build without them. */
+#ifndef NO_SIMD
+#  if defined(__x86_64__) || defined(__i386__) || \
+      defined(_M_X64) || defined(_M_IX86)
+#    define Z_X86_SIMD
+#    ifdef _MSC_VER
+#      define Z_TARGET_SSSE3
+#      define Z_TARGET_SSE42
+#      define Z_TARGET_PCLMUL
+#      define Z_TARGET_AVX2
+#    else
+#      define Z_TARGET_SSSE3  __attribute__((target("ssse3")))
+#      define Z_TARGET_SSE42  __attribute__((target("sse4.2")))
+#      define Z_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#      define Z_TARGET_AVX2   __attribute__((target("avx2")))
+#    endif
+#  elif defined(__aarch64__) && defined(__GNUC__) && \
+        !defined(__ARM_BIG_ENDIAN) && (defined(__linux__) || defined(__APPLE__))
+#    define Z_ARM64_SIMD
+#    ifdef __ARM_FEATURE_CRC32
+#      define Z_TARGET_ARMCRC
+#    elif defined(__clang__)
+#      define Z_TARGET_ARMCRC __attribute__((target("crc")))
+#    else
+#      define Z_TARGET_ARMCRC __attribute__((target("+crc")))
+#    endif
+#  endif
+#endif
+
+#define ZCPU_SSSE3      0x01
+#define ZCPU_SSE42      0x02
+#define ZCPU_PCLMUL     0x04
+#define ZCPU_AVX2       0x08
+#define ZCPU_NEON       0x10
+#define ZCPU_ARMCRC     0x20
+
+/* return the ZCPU_* bits of the running CPU, probed on the first call */
+unsigned ZLIB_INTERNAL zcpu_features OF((void));
+
 #endif /* ZUTIL_H */